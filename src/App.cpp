@@ -10,6 +10,7 @@
 #include "system/color.h"
 #include "system/sokol_time.h"
 #include "system/palettes.h"
+#include "system/profiler.h"
 #include "system/format.h"
 #include "system/whereami.h"
 #include <string.h>
@@ -194,6 +195,23 @@ void App::DrawGui()
     }
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+// the trace contains the last PROFILER_MAX_FRAMES frames, open it with chrome://tracing or https://ui.perfetto.dev
+void App::WriteProfilerTrace()
+{
+    if (!profiler_is_enabled())
+    {
+        log_warn("the profiler is disabled, enable it in the debug window before writing a trace");
+        return;
+    }
+
+    const char* path = format("%s/profiler_trace.json", m_pFolderPath);
+    if (profiler_write_trace(path))
+        log_info("profiler trace written to '%s'", path);
+    else
+        log_error("can't write the profiler trace to '%s'", path);
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 void App::Update(CA::MetalDrawable* drawable)
 {
@@ -204,10 +222,16 @@ void App::Update(CA::MetalDrawable* drawable)
     while (m_AnimationTime>60.f)    // no animation lasts more than 60 seconds, so reset so we can keep float precision
         m_AnimationTime -= 60.f;
 
+    profiler_begin_frame();
+    PROFILER_SCOPE("frame");
+
     mu_begin(m_pGuiContext);
     renderer_begin_frame(m_pRenderer);
-    m_pEditor->Draw(m_pRenderer);
-    m_pEditor->UserInterface(m_pGuiContext);
+    {
+        PROFILER_SCOPE("editor draw");
+        m_pEditor->Draw(m_pRenderer);
+        m_pEditor->UserInterface(m_pGuiContext);
+    }
 
     // debug interface
     if (m_pEditor->IsDebugWindowOpen() && mu_begin_window_ex(m_pGuiContext, "Debug", mu_rect(1550, 500, 300, 400), MU_OPT_NOCLOSE))
@@ -219,6 +243,9 @@ void App::Update(CA::MetalDrawable* drawable)
             mu_text(m_pGuiContext, format("%3.2f ms", m_DeltaTime*1000.f));
             mu_text(m_pGuiContext, "time");
             mu_text(m_pGuiContext, format("%3.2f s", m_Time));
+            mu_text(m_pGuiContext, "profiler (F12 : trace)");
+            if (mu_checkbox(m_pGuiContext, "enabled", &m_ProfilerEnabled))
+                profiler_set_enabled(m_ProfilerEnabled != 0);
         }
 
         renderer_debug_interface(m_pRenderer, m_pGuiContext);
@@ -227,7 +254,10 @@ void App::Update(CA::MetalDrawable* drawable)
     }
 
     mu_end(m_pGuiContext);
-    DrawGui();
+    {
+        PROFILER_SCOPE("gui commands");
+        DrawGui();
+    }
 
     renderer_end_frame(m_pRenderer);
     renderer_flush(m_pRenderer, drawable);
@@ -272,6 +302,9 @@ void App::OnKeyEvent(int key, int scancode, int action, int mods)
     if (key == GLFW_KEY_R && action == GLFW_PRESS && mods&GLFW_MOD_SUPER)
         renderer_reload_shaders(m_pRenderer);
 
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+        WriteProfilerTrace();
+
     m_pEditor->OnKeyEvent(key, scancode, action, mods);
 }
 
@@ -23,6 +23,7 @@ private:
     void InitGui();
     void RetrieveFolderPath();
     void DrawGui();
+    void WriteProfilerTrace();
 
 private:
     MTL::Device* m_Device {nullptr};
@@ -41,6 +42,7 @@ private:
     float m_Time;
     float m_DeltaTime;
     float m_AnimationTime;
+    int m_ProfilerEnabled {0};
     char* m_pFolderPath {nullptr};
 
     Editor* m_pEditor;
@@ -18,7 +18,7 @@ void Editor::Init(struct GLFWwindow* window, aabb zone, const char* folder_path)
     aabb_grow(&m_ExternalZone, vec2_splat(4.f));
     m_PopupHalfSize = (vec2) {250.f, 50.f};
     m_PopupCoord = vec2_sub(aabb_get_center(&m_Zone), m_PopupHalfSize);
-    m_pUndoContext = undo_init(1<<18, 1<<8);
+    m_pUndoContext = undo_init_ex(1<<22, 1<<10, undo_storage_delta);
     m_PrimitiveEditor.Init(window, zone, m_pUndoContext);
     m_MenuBarState = MenuBar_None;
     m_SnapToGrid = 0;
@@ -40,7 +40,12 @@ void Editor::OnKeyEvent(int key, int scancode, int action, int mods)
 {
     UNUSED_VARIABLE(scancode);
     if (key == GLFW_KEY_Z && action == GLFW_PRESS && mods&GLFW_MOD_SUPER)
-        Undo();
+    {
+        if (mods&GLFW_MOD_SHIFT)
+            Redo();
+        else
+            Undo();
+    }
     
     if (key == GLFW_KEY_BACKSPACE && action == GLFW_PRESS && mods&GLFW_MOD_SUPER)
         Delete();
@@ -113,6 +118,14 @@ void Editor::DebugInterface(struct mu_Context* gui_context)
         mu_text(gui_context, format("%3.2f%%", undo_states_stat));
         mu_text(gui_context, "stack");
         mu_text(gui_context, format("%d", undo_get_num_states(m_pUndoContext)));
+        mu_text(gui_context, "redo");
+        mu_text(gui_context, format("%d", undo_get_num_redo(m_pUndoContext)));
+
+        size_t stored_bytes, raw_bytes;
+        undo_memory(m_pUndoContext, &stored_bytes, &raw_bytes);
+        uint32_t num_states = undo_get_num_states(m_pUndoContext);
+        mu_text(gui_context, "bytes/state");
+        mu_text(gui_context, format("%zu (%zu raw)", stored_bytes / (num_states ? num_states : 1), raw_bytes / (num_states ? num_states : 1)));
     }
 }
 
@@ -217,7 +230,7 @@ void Editor::MenuBar(struct mu_Context* gui_context)
         if (m_MenuBarState == MenuBar_Edit)
         {
             if (mu_begin_window_ex(gui_context, "edit", 
-                mu_rect(row_size + padding, text_height + padding, row_size + padding, text_height * 4 + padding), window_options))
+                mu_rect(row_size + padding, text_height + padding, row_size + padding, text_height * 5 + padding), window_options))
             {
                 mu_layout_row(gui_context, 1, (int[]) {-1}, 0);
                 if (mu_button_ex(gui_context, "Undo ~Z", 0, 0))
@@ -225,6 +238,11 @@ void Editor::MenuBar(struct mu_Context* gui_context)
                     Undo();
                     m_MenuBarState = MenuBar_None;
                 }
+                if (mu_button_ex(gui_context, "Redo ~shift Z", 0, 0))
+                {
+                    Redo();
+                    m_MenuBarState = MenuBar_None;
+                }
                 if (mu_button_ex(gui_context, "Delete", 0, 0))
                 {
                     Delete();
@@ -307,32 +325,31 @@ void Editor::Save()
     nfdresult_t result = NFD_SaveDialog( "tds", m_pFolderPath, &save_path );
     if (result == NFD_OKAY)
     {
-        // prepare the file in memory
-        size_t length = TDS_FILE_MAXSIZE;
-        void* buffer = malloc(length);
-        serializer_context serializer;
-
-        serializer_init(&serializer, buffer, length);
-        serializer_write_uint32_t(&serializer, TDS_FOURCC);
-        serializer_write_uint16_t(&serializer, TDS_MAJOR);
-        serializer_write_uint16_t(&serializer, TDS_MINOR);
-        m_PrimitiveEditor.Serialize(&serializer, tds_normalizion_support(TDS_MAJOR, TDS_MINOR));
-
-        if (serializer_get_status(&serializer) == serializer_no_error)
+        FILE* f = fopen(save_path, "wb");
+        if (f != NULL)
         {
-            FILE* f = fopen(save_path, "wb");
-            if (f != NULL)
+            // the file is written chunk by chunk
+            uint8_t chunk[TDS_FILE_CHUNKSIZE];
+            serializer_context serializer;
+
+            serializer_init_write_file(&serializer, f, chunk, sizeof(chunk));
+            serializer_write_uint32_t(&serializer, TDS_FOURCC);
+            serializer_write_uint16_t(&serializer, TDS_MAJOR);
+            serializer_write_uint16_t(&serializer, TDS_MINOR);
+            m_PrimitiveEditor.Serialize(&serializer, tds_normalizion_support(TDS_MAJOR, TDS_MINOR));
+            serializer_flush(&serializer);
+
+            bool success = (fclose(f) == 0) && (serializer_get_status(&serializer) == serializer_no_error);
+            if (!success)
             {
-                fwrite(serializer.buffer, serializer.position, 1, f);
-                fclose(f);
+                // don't leave a truncated file
+                remove(save_path);
+                Popup("save failure", "unable to write the file, the disk might be full");
             }
-            else
-                Popup("save failure", "the filename might be illegal or you don't have the write access for this folder");
         }
         else
-            log_error("buffer too small, cannot save shape");
+            Popup("save failure", "the filename might be illegal or you don't have the write access for this folder");
 
-        free(buffer);
         free(save_path);
     }
     else if (result == NFD_ERROR)
@@ -351,47 +368,35 @@ void Editor::Load()
         if (f != NULL)
         {
             log_info("opening file '%s'", load_path);
-            fseek(f, 0L, SEEK_END);
-            size_t file_length = ftell(f);
-            fseek(f, 0L, SEEK_SET);
 
-            // don't read too big file, probably not a TDS file
-            if (file_length<TDS_FILE_MAXSIZE)
-            {
-                void* buffer = malloc(file_length);
-                fread(buffer, file_length, 1, f);
+            // the file is read chunk by chunk
+            uint8_t chunk[TDS_FILE_CHUNKSIZE];
+            serializer_context serializer;
+            serializer_init_read_file(&serializer, f, chunk, sizeof(chunk));
 
-                serializer_context serializer;
-                serializer_init(&serializer, buffer, file_length);
+            if (serializer_read_uint32_t(&serializer) == TDS_FOURCC)
+            {
+                uint16_t major = serializer_read_uint16_t(&serializer);
 
-                if (serializer_read_uint32_t(&serializer) == TDS_FOURCC)
+                // check only the major for compatibility
+                if (major == TDS_MAJOR)
                 {
-                    uint16_t major = serializer_read_uint16_t(&serializer);
-
-                    // check only the major for compatibility
-                    if (major == TDS_MAJOR)
-                    {
-                        // discard minor version
-                        uint16_t minor = serializer_read_uint16_t(&serializer);
-                        log_info("loading file version %d.%03d", major, minor);
-
-                        m_PrimitiveEditor.Deserialize(&serializer, major, minor, tds_normalizion_support(major, minor));
-
-                        if (serializer_get_status(&serializer) != serializer_no_error)
-                            Popup("load failure", "unable to load primitives");
-                        else
-                            m_PrimitiveEditor.UndoSnapshot();
-                    }
+                    // discard minor version
+                    uint16_t minor = serializer_read_uint16_t(&serializer);
+                    log_info("loading file version %d.%03d", major, minor);
+
+                    m_PrimitiveEditor.Deserialize(&serializer, major, minor, tds_normalizion_support(major, minor));
+
+                    if (serializer_get_status(&serializer) != serializer_no_error)
+                        Popup("load failure", "unable to load primitives");
                     else
-                        Popup("load failure", "file too old and not compatible");
+                        m_PrimitiveEditor.UndoSnapshot();
                 }
                 else
-                    Popup("load failure", "not a ToodeeSculpt file");
-
-                free(buffer);
+                    Popup("load failure", "file too old and not compatible");
             }
             else
-                Popup("load failure", "the file is too big to be loaded");
+                Popup("load failure", "not a ToodeeSculpt file");
 
             fclose(f);
         }
@@ -407,6 +412,12 @@ void Editor::Undo()
     m_pActiveEditor->Undo();
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+void Editor::Redo()
+{
+    m_pActiveEditor->Redo();
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 void Editor::Delete()
 {
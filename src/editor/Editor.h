@@ -24,6 +24,7 @@ public:
     void Copy();
     void Paste();
     void Undo();
+    void Redo();
     void Delete();
     void Terminate();
 
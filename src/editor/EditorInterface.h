@@ -25,5 +25,6 @@ public:
     virtual void Copy() = 0;
     virtual void Paste() = 0;
     virtual void Undo() = 0;
+    virtual void Redo() = 0;
     virtual void Delete() = 0;
 };
\ No newline at end of file
@@ -14,7 +14,7 @@
 
 #define UNUSED_VARIABLE(a) (void)(a)
 
-struct palette primitive_palette;
+const size_t clipboard_buffer_size = (1<<20);
 
 //----------------------------------------------------------------------------------------------------------------------------
 PrimitiveEditor::PrimitiveEditor() : EditorInterface()
@@ -32,6 +32,8 @@ void PrimitiveEditor::Init(struct GLFWwindow* window, aabb zone, struct undo_con
     plist_init(PRIMITIVES_STACK_RESERVATION);
     cc_init(&m_MultipleSelection);
     cc_reserve(&m_MultipleSelection, PRIMITIVES_STACK_RESERVATION);
+    cc_init(&m_Candidates);
+    cc_resize(&m_Candidates, PRIMITIVES_STACK_RESERVATION);
     m_EditionZone = zone;
     m_pUndoContext = undo;
     m_SnapToGrid = false;
@@ -275,15 +277,30 @@ void PrimitiveEditor::OnMouseButton(int button, int action, int mods)
     }
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+// fills m_Candidates from the spatial index of the primitive list instead of testing every primitive
+uint32_t PrimitiveEditor::QueryCandidates()
+{
+    uint32_t num_candidates = plist_query_candidates(m_MousePosition, cc_first(&m_Candidates), (uint32_t)cc_size(&m_Candidates));
+    if (num_candidates > cc_size(&m_Candidates))
+    {
+        cc_resize(&m_Candidates, num_candidates);
+        plist_query_candidates(m_MousePosition, cc_first(&m_Candidates), num_candidates);
+    }
+    return num_candidates;
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 bool PrimitiveEditor::SelectPrimitive()
 {
+    // topmost first
     cc_clear(&m_MultipleSelection);
-    for(uint32_t i=0; i<plist_size(); ++i)
+    uint32_t num_candidates = QueryCandidates();
+    for(uint32_t i=0; i<num_candidates; ++i)
     {
-        primitive *p = plist_get(i);
-        if (primitive_test_mouse_cursor(p, m_MousePosition, true))
-            cc_push(&m_MultipleSelection, i);
+        uint32_t index = *cc_get(&m_Candidates, i);
+        if (primitive_test_mouse_cursor(plist_get(index), m_MousePosition, true))
+            cc_push(&m_MultipleSelection, index);
     }
 
     size_t num_primitives = cc_size(&m_MultipleSelection);
@@ -296,7 +313,8 @@ bool PrimitiveEditor::SelectPrimitive()
 
     uint32_t nearest_primitive_index = INVALID_INDEX;
     float min_distance = FLT_MAX;
-    for(uint32_t i=0; i<cc_size(&m_MultipleSelection); ++i)
+    // from the lowest primitive, it wins a tie as when the list was scanned in order
+    for(uint32_t i=(uint32_t)cc_size(&m_MultipleSelection); i-->0; )
     {
         primitive *p = plist_get(*cc_get(&m_MultipleSelection, i));
         float distance = primitive_distance_to_nearest_point(p, m_MousePosition);
@@ -321,8 +339,8 @@ void PrimitiveEditor::Draw(struct renderer* context)
     // drawing *the* primitives
     renderer_begin_combination(context, m_SmoothBlend);
 
-    for(uint32_t i=0; i<plist_size(); ++i)
-        primitive_draw_alpha(plist_get(i), context, m_AlphaValue);
+    if (plist_size() > 0)
+        primitive_draw_array_cached(plist_get(0), plist_size(), context, m_AlphaValue);
 
     renderer_end_combination(context, m_GlobalOutline);
 
@@ -402,8 +420,11 @@ void PrimitiveEditor::Draw(struct renderer* context)
     else if (GetState() == state::IDLE)
     {
         MouseCursors::GetInstance().Default();
-        for(uint32_t i=0; i<plist_size(); ++i)
+
+        // drawn bottom to top
+        for(uint32_t j=QueryCandidates(); j-->0; )
         {
+            uint32_t i = *cc_get(&m_Candidates, j);
             primitive *primitive = plist_get(i);
             if (primitive_test_mouse_cursor(primitive, m_MousePosition, true))
             {
@@ -653,17 +674,33 @@ void PrimitiveEditor::Undo()
     // if idle, call undo manager
     else if (GetState() == state::IDLE)
     {
-        serializer_context serializer;
         size_t max_size;
         void* pBuffer = undo_undo(m_pUndoContext, &max_size);
+        RestoreState(pBuffer, max_size);
+    }
+}
 
-        if (pBuffer != nullptr)
-        {
-            serializer_init(&serializer, pBuffer, max_size);
-            Deserialize(&serializer, TDS_MAJOR, TDS_MINOR, false);
-            if (serializer_get_status(&serializer) == serializer_read_error)
-                log_fatal("corrupted undo buffer");
-        }
+//----------------------------------------------------------------------------------------------------------------------------
+void PrimitiveEditor::Redo()
+{
+    if (GetState() == state::IDLE)
+    {
+        size_t max_size;
+        void* pBuffer = undo_redo(m_pUndoContext, &max_size);
+        RestoreState(pBuffer, max_size);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void PrimitiveEditor::RestoreState(void* buffer, size_t size)
+{
+    if (buffer != nullptr)
+    {
+        serializer_context serializer;
+        serializer_init(&serializer, buffer, size);
+        Deserialize(&serializer, TDS_MAJOR, TDS_MINOR, false);
+        if (serializer_get_status(&serializer) == serializer_read_error)
+            log_fatal("corrupted undo buffer");
     }
 }
 
@@ -707,7 +744,10 @@ void PrimitiveEditor::Delete()
 //----------------------------------------------------------------------------------------------------------------------------
 void PrimitiveEditor::Export()
 {
-    plist_export(m_pWindow, m_SmoothBlend, &m_EditionZone);
+    struct string_buffer clipboard = string_buffer_init(clipboard_buffer_size);
+    plist_export(&clipboard, m_SmoothBlend, &m_EditionZone);
+    glfwSetClipboardString(m_pWindow, clipboard.buffer);
+    string_buffer_terminate(&clipboard);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
@@ -779,4 +819,5 @@ void PrimitiveEditor::Terminate()
     palette_free(&primitive_palette);
     plist_terminate();
     cc_cleanup(&m_MultipleSelection);
+    cc_cleanup(&m_Candidates);
 }
@@ -39,6 +39,7 @@ public:
     virtual void Copy();
     virtual void Paste();
     virtual void Undo();
+    virtual void Redo();
     virtual void Delete();
 
     void Init(struct GLFWwindow* window, aabb zone, struct undo_context* undo);
@@ -74,6 +75,8 @@ private:
     void SetState(enum state new_state);
     enum state GetState() const {return m_CurrentState;}
     bool SelectPrimitive();
+    uint32_t QueryCandidates();
+    void RestoreState(void* buffer, size_t size);
     inline bool SelectedPrimitiveValid() {return m_SelectedPrimitiveIndex < plist_size();}
     inline bool SetSelectedPrimitive(uint32_t index);
 
@@ -114,6 +117,7 @@ private:
 
     // primitive selection
     cc_vec(uint32_t) m_MultipleSelection;
+    cc_vec(uint32_t) m_Candidates;          // primitives under the mouse cursor according to their aabb, topmost first
 
     struct undo_context* m_pUndoContext;
     vec2* m_pGrabbedPoint;
@@ -1,6 +1,8 @@
 #include "../system/microui.h"
 #include "../system/palettes.h"
+#ifndef TOODEE_HEADLESS
 #include "../system/nfd.h"
+#endif
 #include "color_box.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -127,6 +129,7 @@ int color_property_grid(struct mu_Context* gui_context, struct color_box* contex
             mu_draw_rect(gui_context, entry_rect, mu_color(packed_color_get_red(entry), packed_color_get_green(entry), packed_color_get_blue(entry), 255));
         }
 
+#ifndef TOODEE_HEADLESS
         if (mu_button(gui_context, "load"))
         {
             nfdchar_t *load_path = NULL;
@@ -137,6 +140,7 @@ int color_property_grid(struct mu_Context* gui_context, struct color_box* contex
 
             free(load_path);
         }
+#endif
     }
 
     return res;
@@ -8,20 +8,22 @@
 #include "../renderer/renderer.h"
 #include "../system/format.h"
 #include "../system/biarc.h"
+#include "../system/hash.h"
 #include "color_box.h"
-
-#define GLFW_INCLUDE_NONE
-#include <GLFW/glfw3.h>
+#include "primitive_list.h"
+#include <stddef.h>
+#include <string.h>
 
 static int g_SDFOperationComboBox = 0;
 static int g_SDFFillmodeComboBox = 0;
 static const char* g_sdf_op_names[op_last] = {"add", "blend", "sub", "overlap"};
 static const char* g_sdf_fillmode_names[fill_last] = {"solid", "outline", "hollow"};
 static draw_color point_color = (draw_color){.packed_data = 0x7f10e010};
-static draw_color radius_color = (draw_color){.packed_data = 0x7fe01010};
 
 #define UNUSED_VARIABLE(a) (void)(a)
 
+struct palette primitive_palette;
+
 //----------------------------------------------------------------------------------------------------------------------------
 void primitive_init(struct primitive* p, enum primitive_shape shape, enum sdf_operator op, color4f color, float roundness, float width)
 {
@@ -175,6 +177,8 @@ void primitive_update_aabb(struct primitive* p)
     }
     default: p->m_AABB = aabb_invalid();
     }
+
+    plist_update_index(p);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
@@ -573,6 +577,59 @@ void primitive_draw_alpha(struct primitive* p, struct renderer* gfx_context, flo
     primitive_draw(p, gfx_context, p->m_Roundness, color, p->m_Operator);
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+// hash of everything primitive_draw_alpha reads : the fields from m_Points to m_Color (contiguous), the arcs of a spline
+// and the alpha. 64 bits to make collisions unlikely with thousands of primitives
+static uint64_t primitive_hash(struct primitive const* p, float alpha)
+{
+    const size_t fields_size = offsetof(struct primitive, m_Editmode) - offsetof(struct primitive, m_Points);
+    uint8_t key[offsetof(struct primitive, m_Editmode) - offsetof(struct primitive, m_Points) + sizeof(p->m_Arcs) + sizeof(float)];
+    size_t key_size = 0;
+
+    memcpy(key, p->m_Points, fields_size);
+    key_size += fields_size;
+
+    if (p->m_Shape == shape_spline)
+    {
+        memcpy(key + key_size, p->m_Arcs, sizeof(struct arc) * p->m_NumArcs);
+        key_size += sizeof(struct arc) * p->m_NumArcs;
+    }
+
+    memcpy(key + key_size, &alpha, sizeof(float));
+    key_size += sizeof(float);
+
+    return hash_words_64(key, key_size);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// a lookup costs about as much as drawing one primitive, so the cache works on blocks of primitives : the key of a block
+// is the hash of the hashes of its primitives and an unchanged block is re-emitted with a few memcpy
+void primitive_draw_array_cached(struct primitive* primitives, uint32_t count, struct renderer* gfx_context, float alpha)
+{
+    if (!renderer_is_cache_enabled(gfx_context))
+    {
+        for(uint32_t i=0; i<count; ++i)
+            primitive_draw_alpha(&primitives[i], gfx_context, alpha);
+        return;
+    }
+
+    for(uint32_t first=0; first<count; first+=PRIMITIVE_CACHE_BLOCK)
+    {
+        uint32_t block_size = (count - first < PRIMITIVE_CACHE_BLOCK) ? count - first : PRIMITIVE_CACHE_BLOCK;
+        uint64_t hashes[PRIMITIVE_CACHE_BLOCK];
+        for(uint32_t i=0; i<block_size; ++i)
+            hashes[i] = primitive_hash(&primitives[first + i], alpha);
+
+        if (renderer_begin_cached(gfx_context, hash_words_64(hashes, block_size * sizeof(uint64_t))))
+        {
+            for(uint32_t i=0; i<block_size; ++i)
+                primitive_draw_alpha(&primitives[first + i], gfx_context, alpha);
+
+            renderer_end_cached(gfx_context);
+        }
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 void primitive_draw_spline(struct renderer* gfx_context, const vec2* points, uint32_t num_points, float thickness, draw_color color)
 {
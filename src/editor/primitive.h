@@ -15,6 +15,7 @@ enum {PRIMITIVE_MAXPOINTS = 4};
 #define primitive_max_thickness (100.f)
 #define primitive_colinear_threshold (0.2f)
 #define primitive_max_arcs ((PRIMITIVE_MAXPOINTS-1)*2)
+#define PRIMITIVE_CACHE_BLOCK (64)      // primitives per renderer cache entry, see primitive_draw_array_cached
 
 // almost in sync with primitive_type to not invalid old files
 enum primitive_shape
@@ -89,6 +90,7 @@ void primitive_draw_selected(struct primitive* p, struct renderer* gfx_context,
 void primitive_draw_alpha(struct primitive* p, struct renderer* gfx_context, float alpha);
 void primitive_draw_aabb(struct primitive* p, struct renderer* gfx_context, draw_color color);
 void primitive_draw_spline(struct renderer* gfx_context, const vec2* points, uint32_t num_points, float thickness, draw_color color);
+void primitive_draw_array_cached(struct primitive* primitives, uint32_t count, struct renderer* gfx_context, float alpha);
 
 #ifdef __cplusplus
 }
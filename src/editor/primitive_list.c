@@ -3,22 +3,35 @@
 #include "export.h"
 #include <assert.h>
 
-#define GLFW_INCLUDE_NONE
-#include <GLFW/glfw3.h>
-
 #define CC_NO_SHORT_NAMES
 #include "../system/cc.h"
 #include "../system/log.h"
 #include "../system/format.h"
+#include "../system/spatial_index.h"
+
+#define PLIST_INDEX_CELL_SIZE (32.f)
 
-const size_t clipboard_buffer_size = (1<<20);
 static cc_vec(struct primitive) list;
+static struct spatial_index* grid = NULL;         // boxes of the primitives, see plist_query_candidates
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// the box of the shape and of the vertices, primitive_test_mouse_cursor can't be true outside
+static aabb index_box(struct primitive const* p)
+{
+    aabb box = p->m_AABB;
+    for(uint32_t i=0; i<primitive_get_num_points(p->m_Shape); ++i)
+        aabb_encompass(&box, p->m_Points[i]);
+
+    aabb_grow(&box, vec2_splat(primitive_point_radius));
+    return box;
+}
 
 // ---------------------------------------------------------------------------------------------------------------------------
 void plist_init(uint32_t reservation)
 {
     cc_init(&list);
     cc_reserve(&list, reservation);
+    grid = spatial_index_init(PLIST_INDEX_CELL_SIZE, reservation);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
@@ -32,6 +45,7 @@ struct primitive* plist_get(uint32_t index)
 void plist_clear(void)
 {
     cc_clear(&list);
+    spatial_index_clear(grid);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
@@ -50,6 +64,7 @@ uint32_t plist_size(void)
 void plist_push(struct primitive* p)
 {
     cc_push(&list, *p);
+    spatial_index_update(grid, plist_last(), index_box(p));
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
@@ -57,6 +72,7 @@ void plist_erase(uint32_t index)
 {
     assert(index < cc_size(&list));
     cc_erase(&list, index);
+    spatial_index_erase(grid, index);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
@@ -64,11 +80,16 @@ void plist_insert(uint32_t index, struct primitive* p)
 {
     assert(index < cc_size(&list));
     cc_insert(&list, index, *p);
+    spatial_index_insert(grid, index, index_box(p));
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
 void plist_resize(uint32_t new_size)
 {
+    for(uint32_t i=new_size; i<plist_size(); ++i)
+        spatial_index_remove(grid, i);
+
+    // new primitives are indexed by primitive_update_aabb
     cc_resize(&list, new_size);
 }
 
@@ -105,28 +126,46 @@ void plist_deserialize(serializer_context* context, uint16_t major, uint16_t min
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
-void plist_export(struct GLFWwindow* window, float smooth_blend, const aabb* edition_zone)
+void plist_export(struct string_buffer* output, float smooth_blend, const aabb* edition_zone)
 {
-    struct string_buffer clipboard = string_buffer_init(clipboard_buffer_size);
-
-    shadertoy_start(&clipboard);
+    shadertoy_start(output);
 
     float normalized_smooth_blend = smooth_blend / aabb_get_size(edition_zone).x;
     for(uint32_t i=0; i<plist_size(); ++i)
     {
         struct primitive p = *plist_get(i);
         primitive_normalize(&p, edition_zone);
-        shadertoy_export_primitive(&clipboard, &p, i, normalized_smooth_blend);
+        shadertoy_export_primitive(output, &p, i, normalized_smooth_blend);
     }
 
-    shadertoy_finalize(&clipboard);
-    glfwSetClipboardString(window, clipboard.buffer);
-
-    string_buffer_terminate(&clipboard);
+    shadertoy_finalize(output);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------
 void plist_terminate(void)
 {
     cc_cleanup(&list);
+    spatial_index_terminate(grid);
+    grid = NULL;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+uint32_t plist_query_candidates(vec2 position, uint32_t* output, uint32_t max_output)
+{
+    return spatial_index_query(grid, position, output, max_output);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+void plist_update_index(struct primitive const* p)
+{
+    if (grid == NULL || plist_size() == 0)
+        return;
+
+    // copies of a primitive (new primitive, clipboard, scenes) are not indexed
+    struct primitive const* first = cc_get(&list, 0);
+    if (p < first || p >= first + plist_size())
+        return;
+
+    uint32_t i = (uint32_t)(p - first);
+    spatial_index_update(grid, i, index_box(p));
 }
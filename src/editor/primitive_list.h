@@ -6,7 +6,7 @@
 #include "../system/aabb.h"
 
 struct primitive;
-struct GLFWwindow;
+struct string_buffer;
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,9 +23,16 @@ void plist_insert(uint32_t index, struct primitive* p);
 void plist_resize(uint32_t new_size);
 void plist_serialize(serializer_context* context, bool normalization, const aabb* edition_zone);
 void plist_deserialize(serializer_context* context, uint16_t major, uint16_t minor, bool normalization, const aabb* edition_zone);
-void plist_export(struct GLFWwindow* window, float smooth_blend, const aabb* edition_zone);
+void plist_export(struct string_buffer* output, float smooth_blend, const aabb* edition_zone);
 void plist_terminate(void);
 
+// hit-testing : the primitives of the list are kept in a spatial index, updated by primitive_update_aabb
+// writes up to max_output indices of the primitives that can be under the position (vertices included), topmost first
+// returns the number of candidates, can be bigger than max_output
+uint32_t plist_query_candidates(vec2 position, uint32_t* output, uint32_t max_output);
+// called by primitive_update_aabb, nothing happens if the primitive is not in the list
+void plist_update_index(struct primitive const* p);
+
 
 #ifdef __cplusplus
 }
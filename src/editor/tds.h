@@ -2,11 +2,12 @@
 #define __TDS__H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 static constexpr const uint32_t TDS_FOURCC = 0x32534446;    // 2SDF
 static constexpr const uint16_t TDS_MAJOR = 2;
 static constexpr const uint16_t TDS_MINOR = 7;
-static constexpr const long TDS_FILE_MAXSIZE = (1<<16);
+static constexpr const size_t TDS_FILE_CHUNKSIZE = (1<<12);     // files are streamed, any size can be saved/loaded
 
 static inline bool tds_normalizion_support(uint16_t major, uint16_t minor) {return (major>=2) && (minor>=2);}
 
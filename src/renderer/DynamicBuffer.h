@@ -12,6 +12,10 @@ public:
     NS::UInteger GetLength() const {return m_Buffers[0]->length();}
     void* Map(uint32_t currentFrameIndex);
     void Unmap(uint32_t currentFrameIndex, NS::UInteger location, NS::UInteger length);
+
+    // replaces the buffer of the frame by a bigger one, the content is not copied
+    // returns the previous buffer, released by the caller once it has been read
+    MTL::Buffer* Grow(MTL::Device* device, uint32_t currentFrameIndex, NS::UInteger length);
     void Terminate();
 
 private:
@@ -49,6 +53,16 @@ inline void DynamicBuffer::Unmap(uint32_t currentFrameIndex, NS::UInteger locati
         m_Buffers[GetIndex(currentFrameIndex)]->didModifyRange(NS::Range(location, length));
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------
+inline MTL::Buffer* DynamicBuffer::Grow(MTL::Device* device, uint32_t currentFrameIndex, NS::UInteger length)
+{
+    uint32_t index = GetIndex(currentFrameIndex);
+    MTL::Buffer* previous = m_Buffers[index];
+    m_Buffers[index] = device->newBuffer(length, m_SharedMemory ? MTL::ResourceStorageModeShared : MTL::ResourceStorageModeManaged);
+    assert(m_Buffers[index] != nullptr);
+    return previous;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 inline void DynamicBuffer::Terminate()
 {
@@ -1,31 +1,11 @@
-#define NS_PRIVATE_IMPLEMENTATION
-#define MTL_PRIVATE_IMPLEMENTATION
-#define CA_PRIVATE_IMPLEMENTATION
-#include "Metal.hpp"
-
-#include "renderer.h"
-#include "shader_reader.h"
+#include "renderer_private.h"
 #include "../system/microui.h"
 #include "../system/format.h"
 #include "../system/arc.h"
-#include "DynamicBuffer.h"
-#include "../system/PushArray.h"
 #include "../system/log.h"
-#include "../system/ortho.h"
-#include "commitmono_21_31.h"
-
-// needed for GPU Time
-#include <stdatomic.h>
-#include "../system/psmooth.h"
-
-#ifdef SHADERS_IN_EXECUTABLE
-#include "../shaders/binning.h"
-#include "../shaders/rasterizer.h"
-#endif
-
-#define SAFE_RELEASE(p) if (p!=nullptr) p->release();
-#define SHADER_PATH "/Users/geolm/Code/Geolm/ToodeeSculpt/src/shaders/"
-#define UNUSED_VARIABLE(a) (void)(a)
+#include "../system/hash.h"
+#include "../system/profiler.h"
+#include <string.h>
 
 const float small_float = 0.001f;
 
@@ -33,113 +13,35 @@ template<class T> void swap(T& a, T& b) {T tmp = a; a = b; b = tmp;}
 template<class T> T min(T a, T b) {return (a<b) ? a : b;}
 template<class T> T max(T a, T b) {return (a>b) ? a : b;}
 
-struct renderer
-{
-    MTL::Device* m_pDevice;
-    MTL::CommandQueue* m_pCommandQueue;
-    MTL::CommandBuffer* m_pCommandBuffer;
-    MTL::ComputePipelineState* m_pBinningPSO {nullptr};
-    MTL::ComputePipelineState* m_pWriteIcbPSO {nullptr};
-    MTL::RenderPipelineState* m_pDrawPSO {nullptr};
-    MTL::DepthStencilState* m_pDepthStencilState {nullptr};
-    
-    DynamicBuffer m_DrawCommandsBuffer;
-    DynamicBuffer m_CommandsAABBBuffer;
-    DynamicBuffer m_DrawDataBuffer;
-    MTL::Buffer* m_pCountersBuffer {nullptr};
-    MTL::Fence* m_pClearBuffersFence {nullptr};
-    MTL::Fence* m_pWriteIcbFence {nullptr};
-    dispatch_semaphore_t m_Semaphore;
-    MTL::Buffer* m_pHead {nullptr};
-    MTL::Buffer* m_pNodes {nullptr};
-    MTL::Buffer* m_pTileIndices {nullptr};
-    MTL::IndirectCommandBuffer* m_pIndirectCommandBuffer {nullptr};
-    MTL::Buffer* m_pIndirectArg {nullptr};
-    DynamicBuffer m_DrawCommandsArg;
-    DynamicBuffer m_BinOutputArg;
-    MTL::Texture *m_pFontTexture {nullptr};
-    
-    PushArray<draw_command> m_Commands;
-    PushArray<float> m_DrawData;
-    PushArray<quantized_aabb> m_CommandsAABB;
-    
-    uint32_t m_FrameIndex {0};
-    uint32_t m_ClipsCount {0};
-    clip_rect m_Clips[MAX_CLIPS];
-    uint16_t m_WindowWidth;
-    uint16_t m_WindowHeight;
-    uint16_t m_NumTilesWidth;
-    uint16_t m_NumTilesHeight;
-    uint32_t m_NumDrawCommands;
-    float m_AAWidth {VEC2_SQR2};
-    float m_FontScale {1.f};
-    float m_SmoothValue {0.f};
-    float m_OutlineWidth {1.f};
-    bool m_CullingDebug {false};
-    struct view_proj m_ViewProj;
-    float m_CameraScale {1.f};
-    vec2 m_CameraPosition {.x = 0.f, .y = 0.f};
-    vec2 m_FontSize;
-    quantized_aabb* m_CombinationAABB {nullptr};
-    float4 m_ClearColor {.x=41.0f/255.0f, .y= 42.0f/255.0f, .z= 48.0f/255.0f, 1.0f};
-
-    // stats
-    uint32_t m_PeakNumDrawCommands {0};
-    uint32_t m_NumDrawData {0};
-    _Atomic(float) m_GPUTime;
-    struct psmooth m_AverageGPUTime;
-};
-
-
-void renderer_build_pso(struct renderer* r);
-void renderer_build_font_texture(struct renderer* r);
-void renderer_reload_shaders(struct renderer* r);
-void renderer_build_depthstencil_state(struct renderer* r);
+static void cache_end_frame(struct renderer* r);
 
 //----------------------------------------------------------------------------------------------------------------------------
 struct renderer* renderer_init(void* device, uint32_t width, uint32_t height)
 {
-    renderer* r = new renderer;
-
-    assert(device!=nullptr);
-    r->m_pDevice = (MTL::Device*)device;
-    r->m_pCommandQueue = r->m_pDevice->newCommandQueue();
+    return renderer_init_ex(device, width, height, aabb_compact);
+}
 
-    if (r->m_pCommandQueue == nullptr)
-    {
-        log_fatal("can't create a command queue");
-        exit(EXIT_FAILURE);
-    }
+//----------------------------------------------------------------------------------------------------------------------------
+struct renderer* renderer_init_ex(void* device, uint32_t width, uint32_t height, enum renderer_aabb_format aabb_format)
+{
+    renderer* r = new renderer;
+    r->m_AABBFormat = aabb_format;
 
-    r->m_DrawCommandsBuffer.Init(r->m_pDevice, sizeof(draw_command) * MAX_COMMANDS);
-    r->m_DrawDataBuffer.Init(r->m_pDevice, sizeof(float) * MAX_DRAWDATA);
-    r->m_CommandsAABBBuffer.Init(r->m_pDevice, sizeof(quantized_aabb) * MAX_COMMANDS);
-    r->m_pCountersBuffer = r->m_pDevice->newBuffer(sizeof(counters), MTL::ResourceStorageModePrivate);
-    r->m_pNodes = r->m_pDevice->newBuffer(sizeof(tile_node) * MAX_NODES_COUNT, MTL::ResourceStorageModePrivate);
-    r->m_pClearBuffersFence = r->m_pDevice->newFence();
-    r->m_pWriteIcbFence = r->m_pDevice->newFence();
-
-    MTL::IndirectCommandBufferDescriptor* pIcbDesc = MTL::IndirectCommandBufferDescriptor::alloc()->init();
-    pIcbDesc->setCommandTypes(MTL::IndirectCommandTypeDraw);
-    pIcbDesc->setInheritBuffers(true);
-    pIcbDesc->setInheritPipelineState(true);
-    pIcbDesc->setMaxVertexBufferBindCount(2);
-    pIcbDesc->setMaxFragmentBufferBindCount(2);
-    r->m_pIndirectCommandBuffer = r->m_pDevice->newIndirectCommandBuffer(pIcbDesc, 1, MTL::ResourceStorageModePrivate);
-    pIcbDesc->release();
-
-    r->m_Semaphore = dispatch_semaphore_create(DynamicBuffer::MaxInflightBuffers);
     psmooth_init(&r->m_AverageGPUTime);
-
-    renderer_build_pso(r);
-    renderer_build_font_texture(r);
-    renderer_build_depthstencil_state(r);
+    r->m_pBackend = backend_init(r, device);
     renderer_resize(r, width, height);
     ortho_set_viewport(&r->m_ViewProj, vec2_set((float)width, (float)height), vec2_set((float)r->m_WindowWidth, (float)r->m_WindowHeight), vec2_zero());
     r->m_FontSize = vec2_scale(vec2_set(FONT_WIDTH, FONT_HEIGHT), ortho_get_radius_scale(&r->m_ViewProj));
+    r->m_Cache.m_StateHash = hash_words_64(&r->m_Cache.m_State, sizeof(cache_state));
     return r;
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+enum renderer_aabb_format renderer_aabb_format_for_size(uint32_t width, uint32_t height)
+{
+    return (width > RENDERER_COMPACT_MAX_SIZE || height > RENDERER_COMPACT_MAX_SIZE) ? aabb_wide : aabb_compact;
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_resize(struct renderer* r, uint32_t width, uint32_t height)
 {
@@ -149,323 +51,89 @@ void renderer_resize(struct renderer* r, uint32_t width, uint32_t height)
     r->m_NumTilesWidth = (uint16_t)((width + TILE_SIZE - 1) / TILE_SIZE);
     r->m_NumTilesHeight = (uint16_t)((height + TILE_SIZE - 1) / TILE_SIZE);
 
-    SAFE_RELEASE(r->m_pHead);
-    SAFE_RELEASE(r->m_pTileIndices);
-    r->m_pHead = r->m_pDevice->newBuffer(r->m_NumTilesWidth * r->m_NumTilesHeight * sizeof(tile_node), MTL::ResourceStorageModePrivate);
-    r->m_pTileIndices = r->m_pDevice->newBuffer(r->m_NumTilesWidth * r->m_NumTilesHeight * sizeof(uint16_t), MTL::ResourceStorageModePrivate);
-}
-
-//----------------------------------------------------------------------------------------------------------------------------
-void renderer_reload_shaders(struct renderer* r)
-{
-#ifndef SHADERS_IN_EXECUTABLE
-    log_info("reloading shaders");
-    renderer_build_pso(r);
-#else
-    UNUSED_VARIABLE(r);
-#endif
-}
-
-//----------------------------------------------------------------------------------------------------------------------------
-void renderer_build_depthstencil_state(struct renderer* r)
-{
-    MTL::DepthStencilDescriptor* pDsDesc = MTL::DepthStencilDescriptor::alloc()->init();
-
-    pDsDesc->setDepthCompareFunction(MTL::CompareFunction::CompareFunctionAlways);
-    pDsDesc->setDepthWriteEnabled(false);
-
-    r->m_pDepthStencilState = r->m_pDevice->newDepthStencilState(pDsDesc);
-
-    pDsDesc->release();
-}
-
-//----------------------------------------------------------------------------------------------------------------------------
-#ifdef SHADERS_IN_EXECUTABLE
-MTL::Library* renderer_build_shader(struct renderer* r, const uint8_t* shader_buffer, const char* name)
-{
-    NS::Error* pError = nullptr;
-    MTL::Library* pLibrary = r->m_pDevice->newLibrary( NS::String::string((const char*)shader_buffer, NS::UTF8StringEncoding), nullptr, &pError );
-
-    if (pLibrary == nullptr)
-    {
-        log_error("error while compiling : %s\n%s", name, pError->localizedDescription()->utf8String());
-    }
-    return pLibrary;
-}
-#else
-MTL::Library* renderer_build_shader(struct renderer* r, const char* path, const char* name)
-{
-    char* shader_buffer = read_shader_include(path, name);
-    if (shader_buffer == NULL)
-    {
-        log_fatal("can't find shader %s%s", path, name);
-        return nullptr;
-    }
-
-    NS::Error* pError = nullptr;
-    MTL::Library* pLibrary = r->m_pDevice->newLibrary( NS::String::string(shader_buffer, NS::UTF8StringEncoding), nullptr, &pError );
-
-    free(shader_buffer);
-
-    if (pLibrary == nullptr)
-    {
-        log_error("error while compiling : %s\n%s", name, pError->localizedDescription()->utf8String());
-    }
-    return pLibrary;
-}
-
-#endif
-
-//----------------------------------------------------------------------------------------------------------------------------
-void renderer_build_pso(struct renderer* r)
-{
-    SAFE_RELEASE(r->m_pBinningPSO);
-    SAFE_RELEASE(r->m_pDrawPSO);
-    SAFE_RELEASE(r->m_pWriteIcbPSO);
-
-#ifdef SHADERS_IN_EXECUTABLE
-    MTL::Library* pLibrary = renderer_build_shader(r, binning_shader, "binning");
-#else
-    MTL::Library* pLibrary = renderer_build_shader(r, SHADER_PATH, "binning.metal");
-#endif
-    if (pLibrary != nullptr)
-    {
-        MTL::Function* pBinningFunction = pLibrary->newFunction(NS::String::string("bin", NS::UTF8StringEncoding));
-        NS::Error* pError = nullptr;
-        r->m_pBinningPSO = r->m_pDevice->newComputePipelineState(pBinningFunction, &pError);
-
-        if (r->m_pBinningPSO == nullptr)
-        {
-            log_error( "%s", pError->localizedDescription()->utf8String());
-            return;
-        }
-
-        MTL::ArgumentEncoder* inputArgumentEncoder = pBinningFunction->newArgumentEncoder(0);
-        MTL::ArgumentEncoder* outputArgumentEncoder = pBinningFunction->newArgumentEncoder(1);
-
-        r->m_DrawCommandsArg.Init(r->m_pDevice, inputArgumentEncoder->encodedLength());
-        r->m_BinOutputArg.Init(r->m_pDevice, outputArgumentEncoder->encodedLength());
-
-        inputArgumentEncoder->release();
-        outputArgumentEncoder->release();
-        pBinningFunction->release();
+    uint32_t max_resolution = (r->m_AABBFormat == aabb_wide) ? UINT16_MAX : RENDERER_COMPACT_MAX_SIZE;
+    if (width > max_resolution || height > max_resolution)
+        log_warn("framebuffer is above the %d pixels supported by the aabb format, expect graphical artefacts", max_resolution);
 
-        MTL::Function* pWriteIcbFunction = pLibrary->newFunction(NS::String::string("write_icb", NS::UTF8StringEncoding));
-        r->m_pWriteIcbPSO = r->m_pDevice->newComputePipelineState(pWriteIcbFunction, &pError);
-        if (r->m_pWriteIcbPSO == nullptr)
-        {
-            log_error( "%s", pError->localizedDescription()->utf8String());
-            return;
-        }
-
-        MTL::ArgumentEncoder* indirectArgumentEncoder = pWriteIcbFunction->newArgumentEncoder(1);
-        r->m_pIndirectArg = r->m_pDevice->newBuffer(indirectArgumentEncoder->encodedLength(), MTL::ResourceStorageModeShared);
-        indirectArgumentEncoder->setArgumentBuffer(r->m_pIndirectArg, 0);
-        indirectArgumentEncoder->setIndirectCommandBuffer(r->m_pIndirectCommandBuffer, 0);
-
-        indirectArgumentEncoder->release();
-        pWriteIcbFunction->release();
-        pLibrary->release();
-    }
-
-#ifdef SHADERS_IN_EXECUTABLE
-    pLibrary = renderer_build_shader(r, rasterizer_shader, "rasterizer");
-#else
-    pLibrary = renderer_build_shader(r, SHADER_PATH, "rasterizer.metal");
-#endif
-    if (pLibrary != nullptr)
-    {
-        MTL::Function* pVertexFunction = pLibrary->newFunction(NS::String::string("tile_vs", NS::UTF8StringEncoding));
-        MTL::Function* pFragmentFunction = pLibrary->newFunction(NS::String::string("tile_fs", NS::UTF8StringEncoding));
-        NS::Error* pError = nullptr;
-
-        MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
-        pDesc->setVertexFunction(pVertexFunction);
-        pDesc->setFragmentFunction(pFragmentFunction);
-        pDesc->setSupportIndirectCommandBuffers(true);
-
-        MTL::RenderPipelineColorAttachmentDescriptor *pRenderbufferAttachment = pDesc->colorAttachments()->object(0);
-        pRenderbufferAttachment->setPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB);
-        pRenderbufferAttachment->setBlendingEnabled(false);
-        r->m_pDrawPSO = r->m_pDevice->newRenderPipelineState( pDesc, &pError );
-
-        if (r->m_pDrawPSO == nullptr)
-            log_error( "%s", pError->localizedDescription()->utf8String());
-
-        pVertexFunction->release();
-        pFragmentFunction->release();
-        pDesc->release();
-        pLibrary->release();
-    }
+    backend_resize(r);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
-void renderer_build_font_texture(struct renderer* r)
+void renderer_reload_shaders(struct renderer* r)
 {
-    MTL::TextureDescriptor* pTextureDesc = MTL::TextureDescriptor::alloc()->init();
-    pTextureDesc->setWidth(FONT_TEXTURE_WIDTH);
-    pTextureDesc->setHeight(FONT_TEXTURE_HEIGHT);
-    pTextureDesc->setPixelFormat(MTL::PixelFormatBC4_RUnorm);
-    pTextureDesc->setTextureType(MTL::TextureType2D);
-    pTextureDesc->setMipmapLevelCount(1);
-    pTextureDesc->setUsage( MTL::ResourceUsageSample | MTL::ResourceUsageRead );
-
-    r->m_pFontTexture = r->m_pDevice->newTexture(pTextureDesc);
-    r->m_pFontTexture->replaceRegion( MTL::Region( 0, 0, 0, FONT_TEXTURE_WIDTH, FONT_TEXTURE_HEIGHT, 1 ), 0, commitmono_21_31, (FONT_TEXTURE_WIDTH/4) * 8);
-    pTextureDesc->release();
+    backend_reload_shaders(r);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_begin_frame(struct renderer* r)
 {
-    assert(r->m_CombinationAABB == nullptr);
+    assert(r->m_CombinationAABB == INVALID_INDEX);
+    r->m_ProfilerStart = profiler_begin();
     r->m_FrameIndex++;
     r->m_ClipsCount = 0;
+    r->m_Cache.m_NumHits = r->m_Cache.m_NumMisses = r->m_Cache.m_NumLiveEntries = 0;
 
-    r->m_Commands.Set(r->m_DrawCommandsBuffer.Map(r->m_FrameIndex), sizeof(draw_command) * MAX_COMMANDS);
-    r->m_CommandsAABB.Set(r->m_CommandsAABBBuffer.Map(r->m_FrameIndex), sizeof(quantized_aabb) * MAX_COMMANDS);
-    r->m_DrawData.Set(r->m_DrawDataBuffer.Map(r->m_FrameIndex), sizeof(float) * MAX_DRAWDATA);
+    backend_map_buffers(r);
     renderer_set_cliprect(r, 0, 0, (uint16_t) r->m_WindowWidth, (uint16_t) r->m_WindowHeight);
-    r->m_CombinationAABB = nullptr;
+    r->m_CombinationAABB = INVALID_INDEX;
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_end_frame(struct renderer* r)
 {
-    assert(r->m_CombinationAABB == nullptr);
-    r->m_DrawCommandsBuffer.Unmap(r->m_FrameIndex, 0, r->m_Commands.GetNumElements() * sizeof(draw_command));
-    r->m_CommandsAABBBuffer.Unmap(r->m_FrameIndex, 0, r->m_CommandsAABB.GetNumElements() * sizeof(quantized_aabb));
-    r->m_DrawDataBuffer.Unmap(r->m_FrameIndex, 0, r->m_DrawData.GetNumElements() * sizeof(float));
+    assert(r->m_CombinationAABB == INVALID_INDEX);
     r->m_NumDrawCommands = r->m_Commands.GetNumElements();
     r->m_PeakNumDrawCommands = max(r->m_PeakNumDrawCommands, r->m_NumDrawCommands);
     r->m_NumDrawData = r->m_DrawData.GetNumElements();
-    psmooth_push(&r->m_AverageGPUTime, atomic_load(&r->m_GPUTime));
+    backend_unmap_buffers(r);
+    cache_end_frame(r);
+    psmooth_push(&r->m_AverageGPUTime, backend_get_frame_time(r));
+    profiler_end("command building", r->m_ProfilerStart);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
-void renderer_bin_commands(struct renderer* r)
+void renderer_fill_arguments(struct renderer* r, draw_cmd_arguments* args)
 {
-    if (r->m_pBinningPSO == nullptr)
-        return;
-
-    // clear buffers
-    MTL::BlitCommandEncoder* pBlitEncoder = r->m_pCommandBuffer->blitCommandEncoder();
-    pBlitEncoder->fillBuffer(r->m_pCountersBuffer, NS::Range(0, r->m_pCountersBuffer->length()), 0);
-    pBlitEncoder->fillBuffer(r->m_pHead, NS::Range(0, r->m_pHead->length()), 0xff);
-    pBlitEncoder->resetCommandsInBuffer(r->m_pIndirectCommandBuffer, NS::Range(0, 1));
-    pBlitEncoder->updateFence(r->m_pClearBuffersFence);
-    pBlitEncoder->endEncoding();
-
-    // run binning shader
-    MTL::ComputeCommandEncoder* pComputeEncoder = r->m_pCommandBuffer->computeCommandEncoder();
-    pComputeEncoder->waitForFence(r->m_pClearBuffersFence);
-    pComputeEncoder->setComputePipelineState(r->m_pBinningPSO);
-
-    draw_cmd_arguments* args = (draw_cmd_arguments*) r->m_DrawCommandsArg.Map(r->m_FrameIndex);
     args->clear_color = r->m_ClearColor;
     args->aa_width = r->m_AAWidth;
-    args->commands_aabb = (quantized_aabb*) r->m_CommandsAABBBuffer.GetBuffer(r->m_FrameIndex)->gpuAddress();
-    args->commands = (draw_command*) r->m_DrawCommandsBuffer.GetBuffer(r->m_FrameIndex)->gpuAddress();
-    args->draw_data = (float*) r->m_DrawDataBuffer.GetBuffer(r->m_FrameIndex)->gpuAddress();
-    args->font = (texture_half) r->m_pFontTexture->gpuResourceID()._impl;
     memcpy(args->clips, r->m_Clips, sizeof(r->m_Clips));
     args->max_nodes = MAX_NODES_COUNT;
     args->num_commands = r->m_NumDrawCommands;
     args->num_tile_height = r->m_NumTilesHeight;
     args->num_tile_width = r->m_NumTilesWidth;
-    args->screen_div = (float2) {.x = 1.f / (float)r->m_WindowWidth, .y = 1.f / (float) r->m_WindowHeight};
-    args->font_size = (float2) {.x = r->m_FontSize.x, .y = r->m_FontSize.y};
+    args->screen_div = float2(1.f / (float)r->m_WindowWidth, 1.f / (float) r->m_WindowHeight);
+    args->font_size = float2(r->m_FontSize.x, r->m_FontSize.y);
     args->outline_width = r->m_OutlineWidth;
     args->outline_color = draw_color(0xff000000);
     args->culling_debug = r->m_CullingDebug;
-    r->m_DrawCommandsArg.Unmap(r->m_FrameIndex, 0, sizeof(draw_cmd_arguments));
-
-    tiles_data* output = (tiles_data*) r->m_BinOutputArg.Map(r->m_FrameIndex);
-    output->head = (tile_node*) r->m_pHead->gpuAddress();
-    output->nodes = (tile_node*) r->m_pNodes->gpuAddress();
-    output->tile_indices = (uint16_t*) r->m_pTileIndices->gpuAddress();
-    r->m_BinOutputArg.Unmap(r->m_FrameIndex, 0, sizeof(tiles_data));
-
-    pComputeEncoder->setBuffer(r->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), 0, 0);
-    pComputeEncoder->setBuffer(r->m_BinOutputArg.GetBuffer(r->m_FrameIndex), 0, 1);
-    pComputeEncoder->setBuffer(r->m_pCountersBuffer, 0, 2);
-
-    pComputeEncoder->useResource(r->m_CommandsAABBBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
-    pComputeEncoder->useResource(r->m_DrawCommandsBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
-    pComputeEncoder->useResource(r->m_DrawDataBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
-    pComputeEncoder->useResource(r->m_pHead, MTL::ResourceUsageRead|MTL::ResourceUsageWrite);
-    pComputeEncoder->useResource(r->m_pNodes, MTL::ResourceUsageWrite);
-    pComputeEncoder->useResource(r->m_pTileIndices, MTL::ResourceUsageWrite);
-
-    MTL::Size gridSize = MTL::Size(r->m_NumTilesWidth, r->m_NumTilesHeight, 1);
-
-    NS::UInteger w = r->m_pBinningPSO->threadExecutionWidth();
-    NS::UInteger h = r->m_pBinningPSO->maxTotalThreadsPerThreadgroup() / w;
-    MTL::Size threadgroupSize(w, h, 1);
-    pComputeEncoder->dispatchThreads(gridSize, threadgroupSize);
-
-    pComputeEncoder->setComputePipelineState(r->m_pWriteIcbPSO);
-    pComputeEncoder->setBuffer(r->m_pCountersBuffer, 0, 0);
-    pComputeEncoder->setBuffer(r->m_pIndirectArg, 0, 1);
-    pComputeEncoder->useResource(r->m_pIndirectCommandBuffer, MTL::ResourceUsageWrite);
-    pComputeEncoder->dispatchThreads(MTL::Size(1, 1, 1), MTL::Size(1, 1, 1));
-    pComputeEncoder->updateFence(r->m_pWriteIcbFence);
-    pComputeEncoder->endEncoding();
+    args->occlusion_culling = r->m_OcclusionCulling;
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_flush(struct renderer* r, void* drawable)
 {
-    r->m_pCommandBuffer = r->m_pCommandQueue->commandBuffer();
-
-    dispatch_semaphore_wait(r->m_Semaphore, DISPATCH_TIME_FOREVER);
-
-    renderer_bin_commands(r);
-
-    MTL::RenderPassDescriptor* renderPassDescriptor = MTL::RenderPassDescriptor::alloc()->init();
-    MTL::RenderPassColorAttachmentDescriptor* cd = renderPassDescriptor->colorAttachments()->object(0);
-    cd->setTexture(((CA::MetalDrawable*)drawable)->texture());
-    cd->setLoadAction(MTL::LoadActionClear);
-    cd->setClearColor(MTL::ClearColor(r->m_ClearColor.x, r->m_ClearColor.y, r->m_ClearColor.z, r->m_ClearColor.w));
-    cd->setStoreAction(MTL::StoreActionStore);
-
-    MTL::RenderCommandEncoder* pRenderEncoder = r->m_pCommandBuffer->renderCommandEncoder(renderPassDescriptor);
-
-    if (r->m_pDrawPSO != nullptr && r->m_pBinningPSO != nullptr)
-    {
-        pRenderEncoder->waitForFence(r->m_pWriteIcbFence, MTL::RenderStageVertex|MTL::RenderStageFragment|MTL::RenderStageMesh|MTL::RenderStageObject);
-        pRenderEncoder->setCullMode(MTL::CullModeNone);
-        pRenderEncoder->setDepthStencilState(r->m_pDepthStencilState);
-        pRenderEncoder->setVertexBuffer(r->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), 0, 0);
-        pRenderEncoder->setVertexBuffer(r->m_pTileIndices, 0, 1);
-        pRenderEncoder->setFragmentBuffer(r->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), 0, 0);
-        pRenderEncoder->setFragmentBuffer(r->m_BinOutputArg.GetBuffer(r->m_FrameIndex), 0, 1);
-        pRenderEncoder->useResource(r->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_DrawCommandsBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_DrawDataBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_pHead, MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_pNodes, MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_pTileIndices, MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_pIndirectCommandBuffer, MTL::ResourceUsageRead);
-        pRenderEncoder->useResource(r->m_pFontTexture, MTL::ResourceUsageRead);
-        pRenderEncoder->setRenderPipelineState(r->m_pDrawPSO);
-        pRenderEncoder->executeCommandsInBuffer(r->m_pIndirectCommandBuffer, NS::Range(0, 1));
-        pRenderEncoder->endEncoding();
-    }
-
-    r->m_pCommandBuffer->addCompletedHandler(^void( MTL::CommandBuffer* pCmd )
-    {
-        UNUSED_VARIABLE(pCmd);
-        dispatch_semaphore_signal( r->m_Semaphore );
-
-        atomic_store(&r->m_GPUTime, (float)(pCmd->GPUEndTime() - pCmd->GPUStartTime()));
-    });
+    backend_flush(r, drawable);
+}
 
-    r->m_pCommandBuffer->presentDrawable((CA::MetalDrawable*)drawable);
-    r->m_pCommandBuffer->commit();
-    r->m_pCommandBuffer->waitUntilCompleted();
-    
-    renderPassDescriptor->release();
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_get_stats(struct renderer* r, struct renderer_stats* stats)
+{
+    // a field the backend doesn't know stays at 0
+    memset(stats, 0, sizeof(struct renderer_stats));
+    stats->num_commands = r->m_NumDrawCommands;
+    stats->num_draw_data = r->m_NumDrawData;
+    stats->draw_data_size = r->m_NumDrawData * sizeof(float);
+    stats->peak_commands = r->m_Commands.GetHighWaterMark();
+    stats->peak_draw_data = r->m_DrawData.GetHighWaterMark();
+    stats->command_buffers_size = (uint32_t)(r->m_Commands.GetReservedBytes() + r->m_DrawData.GetReservedBytes() +
+                                             r->m_CommandsAABB.GetReservedBytes() + r->m_CommandsWideAABB.GetReservedBytes());
+    stats->num_overflow_chunks = r->m_Commands.GetNumAllocations() + r->m_DrawData.GetNumAllocations() +
+                                 r->m_CommandsAABB.GetNumAllocations() + r->m_CommandsWideAABB.GetNumAllocations();
+    stats->num_cache_hits = r->m_Cache.m_NumHits;
+    stats->num_cache_misses = r->m_Cache.m_NumMisses;
+    stats->cache_size = (uint32_t)(r->m_Cache.m_Commands.size() * (sizeof(draw_command) + sizeof(wide_aabb)) +
+                                   r->m_Cache.m_DrawData.size() * sizeof(float));
+    backend_get_stats(r, stats);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
@@ -473,7 +141,8 @@ void renderer_debug_interface(struct renderer* r, struct mu_Context* gui_context
 {
     if (mu_header_ex(gui_context, "Renderer", MU_OPT_EXPANDED))
     {
-        mu_layout_row(gui_context, 2, (int[]) { 150, -1 }, 0);
+        int widths[] = {150, -1};
+        mu_layout_row(gui_context, 2, widths, 0);
         mu_text(gui_context, "frame count");
         mu_text(gui_context, format("%6d", r->m_FrameIndex));
         mu_text(gui_context, "draw cmd");
@@ -482,35 +151,38 @@ void renderer_debug_interface(struct renderer* r, struct mu_Context* gui_context
         mu_text(gui_context, format("%6d", r->m_PeakNumDrawCommands));
         mu_text(gui_context, "draw data");
         mu_text(gui_context, format("%6d/%d", r->m_NumDrawData, r->m_DrawData.GetMaxElements()));
+        mu_text(gui_context, "cache hits");
+        mu_text(gui_context, format("%6d/%d", r->m_Cache.m_NumHits, r->m_Cache.m_NumHits + r->m_Cache.m_NumMisses));
         mu_text(gui_context, "gpu time");
         mu_text(gui_context, format("%2.2f ms",  psmooth_average(&r->m_AverageGPUTime) * 1000.f));
         mu_text(gui_context, "aa width");
         mu_slider(gui_context, &r->m_AAWidth, 0.f, 4.f);
+
+        int full_width[] = {-1};
+        mu_layout_row(gui_context, 1, full_width, 0);
+        if (mu_checkbox(gui_context, "tile heatmap", &r->m_HeatmapDebug))
+            backend_set_heatmap(r, r->m_HeatmapDebug);
+
+        struct renderer_heatmap heatmap;
+        if (r->m_HeatmapDebug && backend_get_heatmap(r, &heatmap))
+        {
+            const char* names[heatmap_metric_count] = {"commands", "combinations", "sdf evaluations"};
+            mu_layout_row(gui_context, 2, widths, 0);
+            mu_text(gui_context, "per tile");
+            mu_text(gui_context, "max / p50 / p99");
+            for(uint32_t i=0; i<heatmap_metric_count; ++i)
+            {
+                mu_text(gui_context, names[i]);
+                mu_text(gui_context, format("%u / %u / %u", heatmap.max[i], heatmap.p50[i], heatmap.p99[i]));
+            }
+        }
     }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_terminate(struct renderer* r)
 {
-    r->m_DrawCommandsBuffer.Terminate();
-    r->m_DrawDataBuffer.Terminate();
-    r->m_CommandsAABBBuffer.Terminate();
-    r->m_DrawCommandsArg.Terminate();
-    r->m_BinOutputArg.Terminate();
-    SAFE_RELEASE(r->m_pDepthStencilState);
-    SAFE_RELEASE(r->m_pCountersBuffer);
-    SAFE_RELEASE(r->m_pClearBuffersFence);
-    SAFE_RELEASE(r->m_pWriteIcbFence);
-    SAFE_RELEASE(r->m_pBinningPSO);
-    SAFE_RELEASE(r->m_pDrawPSO);
-    SAFE_RELEASE(r->m_pWriteIcbPSO);
-    SAFE_RELEASE(r->m_pHead);
-    SAFE_RELEASE(r->m_pNodes);
-    SAFE_RELEASE(r->m_pTileIndices);
-    SAFE_RELEASE(r->m_pIndirectArg);
-    SAFE_RELEASE(r->m_pIndirectCommandBuffer);
-    SAFE_RELEASE(r->m_pCommandQueue);
-    SAFE_RELEASE(r->m_pFontTexture);
+    backend_terminate(r);
     delete r;
 }
 
@@ -534,46 +206,103 @@ void distance_screen_space(float scale, T& var, Args & ... args)
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
-static inline void write_aabb(quantized_aabb* box, float min_x, float min_y, float max_x, float max_y)
+// the bounding boxes are stored in m_CommandsAABB or m_CommandsWideAABB depending on the format, they are referenced by index
+static inline uint32_t new_aabb(struct renderer* r)
 {
-    min_x = max(min_x, 0.f);
-    min_y = max(min_y, 0.f);
-    max_x = max(max_x, 0.f);
-    max_y = max(max_y, 0.f);
-    box->min_x = uint8_t(min(uint32_t(min_x) / TILE_SIZE, (uint32_t)UINT8_MAX));
-    box->min_y = uint8_t(min(uint32_t(min_y) / TILE_SIZE, (uint32_t)UINT8_MAX));
-    box->max_x = uint8_t(min(uint32_t(max_x) / TILE_SIZE, (uint32_t)UINT8_MAX));
-    box->max_y = uint8_t(min(uint32_t(max_y) / TILE_SIZE, (uint32_t)UINT8_MAX));
+    if (r->m_AABBFormat == aabb_wide)
+        return (r->m_CommandsWideAABB.NewElement() != nullptr) ? r->m_CommandsWideAABB.GetNumElements() - 1 : INVALID_INDEX;
+    else
+        return (r->m_CommandsAABB.NewElement() != nullptr) ? r->m_CommandsAABB.GetNumElements() - 1 : INVALID_INDEX;
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
-static inline void merge_aabb(quantized_aabb* merge, const quantized_aabb* other)
+static inline wide_aabb load_aabb(struct renderer* r, uint32_t index)
 {
-    if (merge != nullptr)
-    {
-        merge->min_x = min(merge->min_x, other->min_x);
-        merge->min_y = min(merge->min_y, other->min_y);
-        merge->max_x = max(merge->max_x, other->max_x);
-        merge->max_y = max(merge->max_y, other->max_y);
-    }
+    if (r->m_AABBFormat == aabb_wide)
+        return *r->m_CommandsWideAABB.GetElement(index);
+
+    const quantized_aabb* box = r->m_CommandsAABB.GetElement(index);
+    return (wide_aabb) {.min_x = box->min_x, .min_y = box->min_y, .max_x = box->max_x, .max_y = box->max_y};
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline void store_aabb(struct renderer* r, uint32_t index, wide_aabb box)
+{
+    if (r->m_AABBFormat == aabb_wide)
+        *r->m_CommandsWideAABB.GetElement(index) = box;
+    else
+        *r->m_CommandsAABB.GetElement(index) = (quantized_aabb)
+        {
+            .min_x = (uint8_t) box.min_x,
+            .min_y = (uint8_t) box.min_y,
+            .max_x = (uint8_t) box.max_x,
+            .max_y = (uint8_t) box.max_y
+        };
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t max_aabb_coord(struct renderer* r)
+{
+    return (r->m_AABBFormat == aabb_wide) ? UINT16_MAX : UINT8_MAX;
 }
 
 //----------------------------------------------------------------------------------------------------------------------------
-static inline quantized_aabb invalid_aabb()
+static inline wide_aabb invalid_aabb(struct renderer* r)
 {
-    return (quantized_aabb)
+    const uint16_t max_coord = (uint16_t) max_aabb_coord(r);
+    return (wide_aabb)
     {
-        .min_x = UINT8_MAX,
-        .min_y = UINT8_MAX,
+        .min_x = max_coord,
+        .min_y = max_coord,
         .max_x = 0,
         .max_y = 0
     };
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+static inline void merge_aabb(struct renderer* r, wide_aabb other)
+{
+    if (r->m_CombinationAABB != INVALID_INDEX)
+    {
+        wide_aabb merge = load_aabb(r, r->m_CombinationAABB);
+        merge.min_x = min(merge.min_x, other.min_x);
+        merge.min_y = min(merge.min_y, other.min_y);
+        merge.max_x = max(merge.max_x, other.max_x);
+        merge.max_y = max(merge.max_y, other.max_y);
+        store_aabb(r, r->m_CombinationAABB, merge);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// writes the aabb of the command and grows the one of the current combination
+static inline void write_aabb(struct renderer* r, uint32_t index, float min_x, float min_y, float max_x, float max_y)
+{
+    // outside of the framebuffer : an empty box, the command is culled by the binning
+    if (max_x < 0.f || max_y < 0.f || min_x >= (float) r->m_WindowWidth || min_y >= (float) r->m_WindowHeight)
+    {
+        store_aabb(r, index, invalid_aabb(r));
+        return;
+    }
+
+    const uint32_t max_coord = max_aabb_coord(r);
+    min_x = max(min_x, 0.f);
+    min_y = max(min_y, 0.f);
+    max_x = max(max_x, 0.f);
+    max_y = max(max_y, 0.f);
+
+    wide_aabb box;
+    box.min_x = uint16_t(min(uint32_t(min_x) / TILE_SIZE, max_coord));
+    box.min_y = uint16_t(min(uint32_t(min_y) / TILE_SIZE, max_coord));
+    box.max_x = uint16_t(min(uint32_t(max_x) / TILE_SIZE, max_coord));
+    box.max_y = uint16_t(min(uint32_t(max_y) / TILE_SIZE, max_coord));
+    store_aabb(r, index, box);
+    merge_aabb(r, box);
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_begin_combination(struct renderer* r, float smooth_value)
 {
-    assert(r->m_CombinationAABB == nullptr);
+    assert(r->m_CombinationAABB == INVALID_INDEX);
     assert(smooth_value >= 0.f);
 
     draw_command* cmd = r->m_Commands.NewElement();
@@ -584,16 +313,16 @@ void renderer_begin_combination(struct renderer* r, float smooth_value)
         cmd->clip_index = (uint8_t) r->m_ClipsCount-1;
 
         float* k = r->m_DrawData.NewElement(); // just one float for the smooth
-        r->m_CombinationAABB = r->m_CommandsAABB.NewElement();
+        r->m_CombinationAABB = new_aabb(r);
         
-        if (r->m_CombinationAABB != nullptr && k != nullptr)
+        if (r->m_CombinationAABB != INVALID_INDEX && k != nullptr)
         {
             distance_screen_space(ortho_get_radius_scale(&r->m_ViewProj), smooth_value);
             *k = smooth_value;
             r->m_SmoothValue = smooth_value;
 
             // reserve a aabb that we're going to update depending on the coming shapes
-            *r->m_CombinationAABB = invalid_aabb();
+            store_aabb(r, r->m_CombinationAABB, invalid_aabb(r));
             return;
         }
         r->m_Commands.RemoveLast();
@@ -604,7 +333,7 @@ void renderer_begin_combination(struct renderer* r, float smooth_value)
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_end_combination(struct renderer* r, bool outline)
 {
-    assert(r->m_CombinationAABB != nullptr);
+    assert(r->m_CombinationAABB != INVALID_INDEX);
 
     draw_command* cmd = r->m_Commands.NewElement();
     if (cmd != nullptr)
@@ -616,12 +345,12 @@ void renderer_end_combination(struct renderer* r, bool outline)
         // we put also the smooth value as we traverse the list in reverse order on the gpu
         float* k = r->m_DrawData.NewElement(); 
 
-        quantized_aabb* aabb = r->m_CommandsAABB.NewElement();
-        if (aabb != nullptr && k != nullptr)
+        uint32_t aabb = new_aabb(r);
+        if (aabb != INVALID_INDEX && k != nullptr)
         {
-            *aabb = *r->m_CombinationAABB;
+            store_aabb(r, aabb, load_aabb(r, r->m_CombinationAABB));
             *k = r->m_SmoothValue;
-            r->m_CombinationAABB = nullptr;
+            r->m_CombinationAABB = INVALID_INDEX;
             r->m_SmoothValue = 0.f;
             return;
         }
@@ -653,8 +382,8 @@ void renderer_draw_disc(struct renderer* r, vec2 center, float radius, float thi
         cmd->type = pack_type(primitive_disc, fillmode);
 
         float* data = r->m_DrawData.NewMultiple((fillmode == fill_hollow) ? 4 : 3);
-        quantized_aabb* aabb = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabb != nullptr)
+        uint32_t aabb = new_aabb(r);
+        if (data != nullptr && aabb != INVALID_INDEX)
         {
             center = ortho_to_screen_space(&r->m_ViewProj, center);
             distance_screen_space(ortho_get_radius_scale(&r->m_ViewProj), radius, thickness);
@@ -669,8 +398,7 @@ void renderer_draw_disc(struct renderer* r, vec2 center, float radius, float thi
             else
                 write_float(data, center.x, center.y, radius);
 
-            write_aabb(aabb, center.x - max_radius, center.y - max_radius, center.x + max_radius, center.y + max_radius);
-            merge_aabb(r->m_CombinationAABB, aabb);
+            write_aabb(r, aabb, center.x - max_radius, center.y - max_radius, center.x + max_radius, center.y + max_radius);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -696,8 +424,8 @@ void renderer_draw_orientedbox(struct renderer* r, vec2 p0, vec2 p1, float width
         cmd->type = pack_type(primitive_oriented_box, fillmode);
 
         float* data = r->m_DrawData.NewMultiple(6);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             float roundness_thickness = (fillmode == fill_hollow) ? thickness : roundness;
 
@@ -707,8 +435,7 @@ void renderer_draw_orientedbox(struct renderer* r, vec2 p0, vec2 p1, float width
 
             aabb bb = aabb_from_rounded_obb(p0, p1, width, roundness_thickness + draw_cmd_aabb_bump(r, op));
             write_float(data, p0.x, p0.y, p1.x, p1.y, width, roundness_thickness);
-            write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -802,8 +529,8 @@ void renderer_draw_ellipse(struct renderer* r, vec2 p0, vec2 p1, float width, fl
             cmd->type = pack_type(primitive_ellipse, fillmode);
 
             float* data = r->m_DrawData.NewMultiple((fillmode == fill_hollow) ? 6 : 5);
-            quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-            if (data != nullptr && aabox != nullptr)
+            uint32_t aabox = new_aabb(r);
+            if (data != nullptr && aabox != INVALID_INDEX)
             {
                 p0 = ortho_to_screen_space(&r->m_ViewProj, p0);
                 p1 = ortho_to_screen_space(&r->m_ViewProj, p1);
@@ -815,8 +542,7 @@ void renderer_draw_ellipse(struct renderer* r, vec2 p0, vec2 p1, float width, fl
                 else
                     write_float(data, p0.x, p0.y, p1.x, p1.y, width);
 
-                write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-                merge_aabb(r->m_CombinationAABB, aabox);
+                write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
                 return;
             }
             r->m_Commands.RemoveLast();
@@ -844,8 +570,8 @@ void renderer_draw_triangle(struct renderer* r, vec2 p0, vec2 p1, vec2 p2, float
         cmd->type = pack_type(primitive_triangle, fillmode);
 
         float* data = r->m_DrawData.NewMultiple(7);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             p0 = ortho_to_screen_space(&r->m_ViewProj, p0);
             p1 = ortho_to_screen_space(&r->m_ViewProj, p1);
@@ -857,8 +583,7 @@ void renderer_draw_triangle(struct renderer* r, vec2 p0, vec2 p1, vec2 p2, float
             aabb bb = aabb_from_triangle(p0, p1, p2);
             aabb_grow(&bb, vec2_splat(roundness_thickness + draw_cmd_aabb_bump(r, op)));
             write_float(data, p0.x, p0.y, p1.x, p1.y, p2.x, p2.y, roundness_thickness);
-            write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -888,8 +613,8 @@ void renderer_draw_pie(struct renderer* r, vec2 center, vec2 point, float apertu
         cmd->type = pack_type(primitive_pie, fillmode);
 
         float* data = r->m_DrawData.NewMultiple((fillmode != fill_hollow) ? 7 : 8);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             center = ortho_to_screen_space(&r->m_ViewProj, center);
             point = ortho_to_screen_space(&r->m_ViewProj, point);
@@ -906,8 +631,7 @@ void renderer_draw_pie(struct renderer* r, vec2 center, vec2 point, float apertu
             else
                 write_float(data, center.x, center.y, radius, direction.x, direction.y, sinf(aperture), cosf(aperture), thickness);
                 
-            write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -952,8 +676,8 @@ void renderer_draw_arc(struct renderer* r, vec2 center, vec2 direction, float ap
         cmd->type = pack_type(primitive_ring, fillmode);
 
         float* data = r->m_DrawData.NewMultiple(8);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             center = ortho_to_screen_space(&r->m_ViewProj, center);
             distance_screen_space(ortho_get_radius_scale(&r->m_ViewProj), radius, thickness);
@@ -962,8 +686,7 @@ void renderer_draw_arc(struct renderer* r, vec2 center, vec2 direction, float ap
             aabb_grow(&bb, vec2_splat(thickness + draw_cmd_aabb_bump(r, op)));
 
             write_float(data, center.x, center.y, radius, direction.x, direction.y, sinf(aperture), cosf(aperture), thickness);
-            write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -999,8 +722,8 @@ void renderer_draw_unevencapsule(struct renderer* r, vec2 p0, vec2 p1, float rad
         cmd->type = pack_type(primitive_uneven_capsule, fillmode);
 
         float* data = r->m_DrawData.NewMultiple((fillmode != fill_hollow) ? 6 : 7);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             p0 = ortho_to_screen_space(&r->m_ViewProj, p0);
             p1 = ortho_to_screen_space(&r->m_ViewProj, p1);
@@ -1014,8 +737,7 @@ void renderer_draw_unevencapsule(struct renderer* r, vec2 p0, vec2 p1, float rad
             else
                 write_float(data, p0.x, p0.y, p1.x, p1.y, radius0, radius1, thickness);
 
-            write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -1043,8 +765,8 @@ void renderer_draw_trapezoid(struct renderer* r, vec2 p0, vec2 p1, float radius0
         cmd->type = pack_type(primitive_trapezoid, fillmode);
 
         float* data = r->m_DrawData.NewMultiple((fillmode != fill_hollow) ? 7 : 8);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             float roundness_thickness = (fillmode == fill_hollow) ? thickness : roundness;
             p0 = ortho_to_screen_space(&r->m_ViewProj, p0);
@@ -1055,8 +777,7 @@ void renderer_draw_trapezoid(struct renderer* r, vec2 p0, vec2 p1, float radius0
             aabb_grow(&bb, vec2_splat(draw_cmd_aabb_bump(r, op) + roundness_thickness));
 
             write_float(data, p0.x, p0.y, p1.x, p1.y, radius0, radius1, roundness_thickness);
-            write_aabb(aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, bb.min.x, bb.min.y, bb.max.x, bb.max.y);
 
             return;
         }
@@ -1084,14 +805,13 @@ void renderer_draw_box(struct renderer* r, float x0, float y0, float x1, float y
         cmd->type = pack_type(primitive_aabox, fill_solid);
 
         float* data = r->m_DrawData.NewMultiple(4);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             p0 = ortho_to_screen_space(&r->m_ViewProj, p0);
             p1 = ortho_to_screen_space(&r->m_ViewProj, p1);
             write_float(data, p0.x, p0.y, p1.x, p1.y);
-            write_aabb(aabox, p0.x, p0.y, p1.x, p1.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, p0.x, p0.y, p1.x, p1.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -1122,12 +842,11 @@ void renderer_draw_char(struct renderer* r, float x, float y, char c, draw_color
         cmd->custom_data = (uint8_t) (c - FONT_CHAR_FIRST);
 
         float* data = r->m_DrawData.NewMultiple(2);
-        quantized_aabb* aabox = r->m_CommandsAABB.NewElement();
-        if (data != nullptr && aabox != nullptr)
+        uint32_t aabox = new_aabb(r);
+        if (data != nullptr && aabox != INVALID_INDEX)
         {
             write_float(data, x, y);
-            write_aabb(aabox, x, y, x + r->m_FontSize.x, y + r->m_FontSize.y);
-            merge_aabb(r->m_CombinationAABB, aabox);
+            write_aabb(r, aabox, x, y, x + r->m_FontSize.x, y + r->m_FontSize.y);
             return;
         }
         r->m_Commands.RemoveLast();
@@ -1180,6 +899,10 @@ void renderer_set_cliprect_relative(struct renderer * r, aabb const* box)
     vec2 top_left = ortho_to_screen_space(&r->m_ViewProj, box->min) + vec2_splat(.5f);
     vec2 bottom_right = ortho_to_screen_space(&r->m_ViewProj, box->max) + vec2_splat(.5f);
 
+    // the box can be partially outside of the framebuffer (band rendering, zoom)
+    top_left = vec2_clamp(top_left, vec2_zero(), vec2_splat(UINT16_MAX));
+    bottom_right = vec2_clamp(bottom_right, vec2_zero(), vec2_splat(UINT16_MAX));
+
     renderer_set_cliprect(r, (uint16_t) top_left.x, (uint16_t) top_left.y, (uint16_t) bottom_right.x, (uint16_t) bottom_right.y);
 }
 
@@ -1189,6 +912,12 @@ void renderer_set_culling_debug(struct renderer* r, bool b)
     r->m_CullingDebug = b;
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_occlusion_culling(struct renderer* r, bool b)
+{
+    r->m_OcclusionCulling = b;
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 void renderer_set_viewproj(struct renderer* r, const struct view_proj* vp)
 {
@@ -1197,3 +926,334 @@ void renderer_set_viewproj(struct renderer* r, const struct view_proj* vp)
     r->m_FontSize = vec2_scale(vec2_set(FONT_WIDTH, FONT_HEIGHT), ortho_get_radius_scale(&r->m_ViewProj));
 }
 
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_num_threads(struct renderer* r, uint32_t num_threads)
+{
+    backend_set_num_threads(r, num_threads);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_binning(struct renderer* r, enum renderer_binning mode)
+{
+    backend_set_binning(r, mode);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_tile_format(struct renderer* r, enum renderer_tile_format format)
+{
+    backend_set_tile_format(r, format);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_incremental(struct renderer* r, bool enable)
+{
+    backend_set_incremental(r, enable);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_draw_data_format(struct renderer* r, enum renderer_draw_data_format format)
+{
+    backend_set_draw_data_format(r, format);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_async(struct renderer* r, bool enable)
+{
+    backend_set_async(r, enable);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_finish(struct renderer* r)
+{
+    backend_finish(r);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_heatmap(struct renderer* r, bool enable)
+{
+    r->m_HeatmapDebug = enable;
+    backend_set_heatmap(r, enable);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool renderer_get_heatmap(struct renderer* r, struct renderer_heatmap* heatmap)
+{
+    return backend_get_heatmap(r, heatmap);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_set_cache(struct renderer* r, bool enable)
+{
+    assert(!r->m_Cache.m_Recording);
+    if (!enable)
+        r->m_Cache = command_cache();
+    r->m_Cache.m_Enabled = enable;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool renderer_is_cache_enabled(struct renderer* r)
+{
+    return r->m_Cache.m_Enabled;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// retained commands
+//----------------------------------------------------------------------------------------------------------------------------
+#define CACHE_MIN_TABLE_SIZE (1024)
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t aabb_count(struct renderer* r)
+{
+    return (r->m_AABBFormat == aabb_wide) ? r->m_CommandsWideAABB.GetNumElements() : r->m_CommandsAABB.GetNumElements();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t cache_slot(uint64_t key, uint64_t state, uint32_t mask)
+{
+    uint64_t hash = key ^ state;
+    return (((uint32_t)hash ^ (uint32_t)(hash >> 32)) * 0x9e3779b1) & mask;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static uint32_t cache_find(const command_cache* c, uint64_t key, uint64_t state)
+{
+    if (c->m_Table.empty())
+        return INVALID_INDEX;
+
+    const uint32_t mask = (uint32_t) c->m_Table.size() - 1;
+    for(uint32_t slot = cache_slot(key, state, mask); ; slot = (slot + 1) & mask)
+    {
+        uint32_t index = c->m_Table[slot];
+        if (index == INVALID_INDEX)
+            return INVALID_INDEX;
+
+        const cache_entry& entry = c->m_Entries[index];
+        if (entry.key == key && entry.state == state)
+            return index;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the table is kept at most half full
+static void cache_rehash(command_cache* c)
+{
+    uint32_t size = CACHE_MIN_TABLE_SIZE;
+    while (size < c->m_Entries.size() * 2)
+        size *= 2;
+
+    c->m_Table.assign(size, INVALID_INDEX);
+    const uint32_t mask = size - 1;
+    for(uint32_t i=0; i<c->m_Entries.size(); ++i)
+    {
+        uint32_t slot = cache_slot(c->m_Entries[i].key, c->m_Entries[i].state, mask);
+        while (c->m_Table[slot] != INVALID_INDEX)
+            slot = (slot + 1) & mask;
+
+        c->m_Table[slot] = i;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// drops the entries not drawn during the frame and packs the others
+static void cache_compact(command_cache* c, uint32_t frame)
+{
+    command_cache packed;
+    for(const cache_entry& entry : c->m_Entries)
+    {
+        if (entry.frame != frame)
+            continue;
+
+        cache_entry copy = entry;
+        copy.first_command = (uint32_t) packed.m_Commands.size();
+        copy.first_data = (uint32_t) packed.m_DrawData.size();
+        packed.m_Commands.insert(packed.m_Commands.end(), c->m_Commands.begin() + entry.first_command,
+                                 c->m_Commands.begin() + entry.first_command + entry.num_commands);
+        packed.m_AABBs.insert(packed.m_AABBs.end(), c->m_AABBs.begin() + entry.first_command,
+                              c->m_AABBs.begin() + entry.first_command + entry.num_commands);
+        packed.m_DrawData.insert(packed.m_DrawData.end(), c->m_DrawData.begin() + entry.first_data,
+                                 c->m_DrawData.begin() + entry.first_data + entry.num_data);
+        packed.m_Entries.push_back(copy);
+    }
+
+    c->m_Entries.swap(packed.m_Entries);
+    c->m_Commands.swap(packed.m_Commands);
+    c->m_AABBs.swap(packed.m_AABBs);
+    c->m_DrawData.swap(packed.m_DrawData);
+    c->m_NumLiveEntries = (uint32_t) c->m_Entries.size();
+    cache_rehash(c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// copies the commands of the entry in the frame buffers, returns false if an overflow chunk can't be allocated
+static bool cache_emit(struct renderer* r, const cache_entry* entry)
+{
+    const command_cache* c = &r->m_Cache;
+    if (entry->num_commands == 0)
+        return true;
+
+    // allocated first so nothing is emitted if one of the buffers can't grow
+    const uint32_t first_data = r->m_DrawData.GetNumElements();
+    draw_command* commands = r->m_Commands.NewMultiple(entry->num_commands);
+    float* data = (commands != nullptr && entry->num_data > 0) ? r->m_DrawData.NewMultiple(entry->num_data) : nullptr;
+    wide_aabb* wide_boxes = nullptr;
+    quantized_aabb* quantized_boxes = nullptr;
+    if (commands != nullptr && (data != nullptr || entry->num_data == 0))
+    {
+        if (r->m_AABBFormat == aabb_wide)
+            wide_boxes = r->m_CommandsWideAABB.NewMultiple(entry->num_commands);
+        else
+            quantized_boxes = r->m_CommandsAABB.NewMultiple(entry->num_commands);
+    }
+
+    if (wide_boxes == nullptr && quantized_boxes == nullptr)
+    {
+        for(uint32_t i=0; commands != nullptr && i<entry->num_commands; ++i)
+            r->m_Commands.RemoveLast();
+        for(uint32_t i=0; data != nullptr && i<entry->num_data; ++i)
+            r->m_DrawData.RemoveLast();
+        return false;
+    }
+
+    memcpy(commands, &c->m_Commands[entry->first_command], entry->num_commands * sizeof(draw_command));
+    for(uint32_t i=0; i<entry->num_commands; ++i)
+        commands[i].data_index += first_data;
+
+    if (entry->num_data > 0)
+        memcpy(data, &c->m_DrawData[entry->first_data], entry->num_data * sizeof(float));
+
+    const wide_aabb* boxes = &c->m_AABBs[entry->first_command];
+    if (r->m_AABBFormat == aabb_wide)
+        memcpy(wide_boxes, boxes, entry->num_commands * sizeof(wide_aabb));
+    else
+    {
+        for(uint32_t i=0; i<entry->num_commands; ++i)
+            quantized_boxes[i] = (quantized_aabb) {(uint8_t)boxes[i].min_x, (uint8_t)boxes[i].min_y, (uint8_t)boxes[i].max_x, (uint8_t)boxes[i].max_y};
+    }
+
+    merge_aabb(r, entry->bounds);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool renderer_begin_cached(struct renderer* r, uint64_t key)
+{
+    command_cache* c = &r->m_Cache;
+    assert(!c->m_Recording);
+
+    if (!c->m_Enabled)
+        return true;
+
+    // everything that changes the output of renderer_draw_* for the same parameters
+    cache_state state = 
+    {
+        .view_proj = r->m_ViewProj,
+        .smooth_value = r->m_SmoothValue,
+        .aa_width = r->m_AAWidth,
+        .clips_count = r->m_ClipsCount,
+        .window_width = r->m_WindowWidth,
+        .window_height = r->m_WindowHeight
+    };
+
+    if (memcmp(&state, &c->m_State, sizeof(cache_state)) != 0)
+    {
+        c->m_State = state;
+        c->m_StateHash = hash_words_64(&state, sizeof(cache_state));
+    }
+
+    uint32_t index = cache_find(c, key, c->m_StateHash);
+    if (index != INVALID_INDEX)
+    {
+        cache_entry* entry = &c->m_Entries[index];
+        if (!cache_emit(r, entry))
+            log_warn("out of draw commands/draw data buffer, expect graphical artefacts");
+
+        if (entry->frame != r->m_FrameIndex)
+        {
+            entry->frame = r->m_FrameIndex;
+            c->m_NumLiveEntries++;
+        }
+        c->m_NumHits++;
+        return false;
+    }
+
+    c->m_Recording = true;
+    c->m_RecordKey = key;
+    c->m_RecordFirstCommand = r->m_Commands.GetNumElements();
+    c->m_RecordFirstData = r->m_DrawData.GetNumElements();
+    c->m_RecordFirstAABB = aabb_count(r);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_end_cached(struct renderer* r)
+{
+    command_cache* c = &r->m_Cache;
+    if (!c->m_Recording)
+        return;
+
+    c->m_Recording = false;
+    c->m_NumMisses++;
+
+    cache_entry entry =
+    {
+        .key = c->m_RecordKey,
+        .state = c->m_StateHash,
+        .frame = r->m_FrameIndex,
+        .first_command = (uint32_t) c->m_Commands.size(),
+        .num_commands = r->m_Commands.GetNumElements() - c->m_RecordFirstCommand,
+        .first_data = (uint32_t) c->m_DrawData.size(),
+        .num_data = r->m_DrawData.GetNumElements() - c->m_RecordFirstData,
+        .bounds = invalid_aabb(r)
+    };
+
+    // a buffer was full, the output is not complete
+    if (aabb_count(r) - c->m_RecordFirstAABB != entry.num_commands)
+        return;
+
+    for(uint32_t i=0; i<entry.num_commands; ++i)
+    {
+        draw_command cmd = *r->m_Commands.GetElement(c->m_RecordFirstCommand + i);
+        cmd.data_index -= c->m_RecordFirstData;
+        c->m_Commands.push_back(cmd);
+
+        wide_aabb box = load_aabb(r, c->m_RecordFirstAABB + i);
+        c->m_AABBs.push_back(box);
+        entry.bounds.min_x = min(entry.bounds.min_x, box.min_x);
+        entry.bounds.min_y = min(entry.bounds.min_y, box.min_y);
+        entry.bounds.max_x = max(entry.bounds.max_x, box.max_x);
+        entry.bounds.max_y = max(entry.bounds.max_y, box.max_y);
+    }
+
+    if (entry.num_data > 0)
+    {
+        // the data can be split between the buffer and an overflow chunk
+        c->m_DrawData.resize(entry.first_data + entry.num_data);
+        r->m_DrawData.CopyTo(c->m_RecordFirstData, entry.num_data, &c->m_DrawData[entry.first_data]);
+    }
+
+    c->m_Entries.push_back(entry);
+    c->m_NumLiveEntries++;
+
+    if (c->m_Entries.size() * 2 > c->m_Table.size())
+        cache_rehash(c);
+    else
+    {
+        const uint32_t mask = (uint32_t) c->m_Table.size() - 1;
+        uint32_t slot = cache_slot(entry.key, entry.state, mask);
+        while (c->m_Table[slot] != INVALID_INDEX)
+            slot = (slot + 1) & mask;
+
+        c->m_Table[slot] = (uint32_t) c->m_Entries.size() - 1;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// called at the end of the frame, the memory of the entries not drawn anymore is reclaimed when they are a quarter of the cache
+static void cache_end_frame(struct renderer* r)
+{
+    command_cache* c = &r->m_Cache;
+    uint32_t num_stale = (uint32_t) c->m_Entries.size() - c->m_NumLiveEntries;
+    if (num_stale > 0 && num_stale * 4 >= c->m_Entries.size())
+        cache_compact(c, r->m_FrameIndex);
+}
@@ -0,0 +1,894 @@
+#include "renderer_private.h"
+#include "cpu_kernels.h"
+#include "cpu_scheduler.h"
+#include "../system/log.h"
+#include "../system/profiler.h"
+#include "../system/sokol_time.h"
+#include "commitmono_21_31.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define UNUSED_VARIABLE(a) (void)(a)
+#define SCATTER_CHUNK_SIZE (64)     // commands per scatter task
+#define FRAMES_IN_FLIGHT (2)        // asynchronous flush : one frame is built while the previous one is rendered
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// buffers written by the front end during a frame and read by the flush of this frame
+struct frame_buffers
+{
+    draw_command* m_pCommands {nullptr};
+    float* m_pDrawData {nullptr};
+    void* m_pCommandsAABB {nullptr};           // quantized_aabb or wide_aabb
+    float16* m_pHalfDrawData {nullptr};        // compact draw data, encoded at the end of the frame
+    bool m_HalfEncoded {false};                // the format was changed after the end of the frame if it's not
+    uint32_t m_CommandsCapacity {0};
+    uint32_t m_DrawDataCapacity {0};
+    uint64_t m_Fence {0};                      // last flush reading the buffers, they can't be mapped before it's completed
+};
+
+// shared by the worker threads during a flush
+// everything that comes from the renderer is copied by backend_flush, the asynchronous flush doesn't read it
+struct flush_context
+{
+    draw_cmd_arguments args;
+    float* draw_data;                   // writable args.draw_data, the half draw data is decoded in it
+    const float16* half_draw_data;      // nullptr with float draw data
+    uint32_t num_draw_data;
+    uint32_t clear_color;
+    uint64_t fence;
+    tiles_data tiles;
+    tile_arrays arrays;
+    renderer_tile_format tile_format;
+    counters* counter;
+    const uint8_t* font;
+    uint32_t* framebuffer;
+    uint32_t width, height;
+    const float* smooth_borders;
+    std::vector<bin_hit>* chunks;
+    std::vector<uint32_t>* super_tiles;
+    uint32_t num_super_tiles_width;
+    const uint32_t* dirty_list;
+    uint32_t* heatmap;
+    const uint32_t* heatmap_tiles;      // tiles to measure, nullptr for all
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// headless backend : same buffers as the metal backend but binning and rasterization are done on the cpu
+struct renderer_backend
+{
+    frame_buffers m_Frames[FRAMES_IN_FLIGHT];  // only the first one is used by the synchronous flush
+    uint32_t m_CurrentFrame {0};
+    uint32_t m_FlushCapacity {0};              // commands of the per-command arrays of the flush
+    tile_node* m_pHead {nullptr};
+    tile_node* m_pNodes {nullptr};
+    uint32_t* m_pTileIndices {nullptr};
+    uint8_t* m_pFont {nullptr};
+    counters m_Counters;
+    struct cpu_scheduler* m_pScheduler {nullptr};
+    renderer_binning m_BinningMode {binning_gather};
+    renderer_tile_format m_TileFormat {tile_format_nodes};
+
+    // scatter binning
+    float* m_pSmoothBorders {nullptr};
+    uint32_t* m_pTileCounts {nullptr};
+    std::vector<bin_hit>* m_pChunks {nullptr};
+
+    // hierarchical binning
+    std::vector<uint32_t>* m_pSuperTiles {nullptr};
+    uint32_t m_NumSuperTilesWidth {0};
+    uint32_t m_NumSuperTilesHeight {0};
+
+    // tile arrays
+    uint32_t* m_pTileOffsets {nullptr};
+    tile_command* m_pTileCommands {nullptr};
+
+    // incremental rendering, the previous frame is valid if it was rasterized in the same drawable
+    bool m_Incremental {false};
+    bool m_PreviousValid {false};
+    uint64_t* m_pHashes {nullptr};
+    uint64_t* m_pPreviousHashes {nullptr};
+    wide_aabb* m_pPreviousAABB {nullptr};
+    uint32_t m_NumPreviousCommands {0};
+    uint64_t m_PreviousArgumentsHash {0};
+    void* m_pPreviousDrawable {nullptr};
+    uint8_t* m_pDirty {nullptr};
+    uint32_t* m_pDirtyList {nullptr};
+
+    // tile heatmap, heatmap_metric_count arrays of num_tiles values then a scratch array for the percentiles
+    bool m_Heatmap {false};
+    uint32_t* m_pHeatmap {nullptr};
+    renderer_heatmap m_HeatmapSummary;
+
+    // compact draw data, encoded at the end of the frame and decoded in the draw data before the binning
+    renderer_draw_data_format m_DrawDataFormat {draw_data_float};
+
+    // asynchronous flush : the flush thread runs one job at a time, the fences are the flush count
+    bool m_Async {false};
+    std::thread m_FlushThread;
+    std::mutex m_FlushMutex;
+    std::condition_variable m_FlushCondition;
+    flush_context m_Job;
+    bool m_QuitFlushThread {false};
+    uint64_t m_SubmittedFence {0};
+    uint64_t m_CompletedFence {0};             // protected by m_FlushMutex
+    float m_FrameTime {0.f};                   // protected by m_FlushMutex
+
+    // stats
+    float m_BinningTime {0.f};
+    float m_RasterizationTime {0.f};
+    uint32_t m_NumSteals {0};
+    uint32_t m_SuperTileCommands {0};
+    uint32_t m_SuperTileMaxCommands {0};
+    uint32_t m_NumSkippedTiles {0};
+};
+
+
+//----------------------------------------------------------------------------------------------------------------------------
+// BC4 block : two reference values then 16 indices of 3 bits
+static void decode_bc4_block(const uint8_t* block, uint8_t* output, uint32_t stride)
+{
+    uint8_t palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+
+    if (palette[0] > palette[1])
+    {
+        for(uint32_t i=1; i<7; ++i)
+            palette[i+1] = (uint8_t)(((7-i) * palette[0] + i * palette[1]) / 7);
+    }
+    else
+    {
+        for(uint32_t i=1; i<5; ++i)
+            palette[i+1] = (uint8_t)(((5-i) * palette[0] + i * palette[1]) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for(uint32_t i=0; i<6; ++i)
+        indices |= (uint64_t)block[2+i] << (i*8);
+
+    for(uint32_t i=0; i<16; ++i)
+        output[(i/4) * stride + (i%4)] = palette[(indices >> (i*3)) & 7];
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static uint8_t* decode_font(void)
+{
+    uint8_t* font = (uint8_t*) malloc(FONT_TEXTURE_WIDTH * FONT_TEXTURE_HEIGHT);
+    const uint8_t* block = commitmono_21_31;
+
+    for(uint32_t y=0; y<FONT_TEXTURE_HEIGHT; y+=4)
+        for(uint32_t x=0; x<FONT_TEXTURE_WIDTH; x+=4, block+=8)
+            decode_bc4_block(block, &font[y * FONT_TEXTURE_WIDTH + x], FONT_TEXTURE_WIDTH);
+
+    return font;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void bin_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    uint16_t tile_x = (uint16_t)(item_index % ctx->args.num_tile_width);
+    uint16_t tile_y = (uint16_t)(item_index / ctx->args.num_tile_width);
+    cpu_bin(&ctx->args, &ctx->tiles, ctx->counter, tile_x, tile_y);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// incremental rendering : only the dirty tiles are binned
+static void dirty_bin_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    uint32_t tile_index = ctx->dirty_list[item_index];
+    uint16_t tile_x = (uint16_t)(tile_index % ctx->args.num_tile_width);
+    uint16_t tile_y = (uint16_t)(tile_index / ctx->args.num_tile_width);
+    cpu_bin(&ctx->args, &ctx->tiles, ctx->counter, tile_x, tile_y);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void scatter_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    std::vector<bin_hit>* hits = &ctx->chunks[item_index];
+    hits->clear();
+
+    uint32_t end = std::min((item_index + 1) * SCATTER_CHUNK_SIZE, ctx->args.num_commands);
+    for(uint32_t i=item_index * SCATTER_CHUNK_SIZE; i<end; ++i)
+        cpu_bin_command(&ctx->args, i, ctx->smooth_borders[i], hits);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void coarse_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    uint16_t super_x = (uint16_t)(item_index % ctx->num_super_tiles_width);
+    uint16_t super_y = (uint16_t)(item_index / ctx->num_super_tiles_width);
+    cpu_bin_coarse(&ctx->args, super_x, super_y, &ctx->super_tiles[item_index]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void fine_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    uint16_t tile_x = (uint16_t)(item_index % ctx->args.num_tile_width);
+    uint16_t tile_y = (uint16_t)(item_index / ctx->args.num_tile_width);
+    const std::vector<uint32_t>& commands = ctx->super_tiles[(tile_y / SUPER_TILE_SIZE) * ctx->num_super_tiles_width + tile_x / SUPER_TILE_SIZE];
+    cpu_bin_fine(&ctx->args, commands.data(), (uint32_t) commands.size(), &ctx->tiles, ctx->counter, tile_x, tile_y);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void rasterize_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    if (ctx->tile_format == tile_format_arrays)
+        cpu_rasterize_arrays(&ctx->args, &ctx->arrays, ctx->font, ctx->tiles.tile_indices[item_index], ctx->framebuffer, ctx->width, ctx->height);
+    else
+        cpu_rasterize(&ctx->args, &ctx->tiles, ctx->font, ctx->tiles.tile_indices[item_index], ctx->framebuffer, ctx->width, ctx->height);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void heatmap_task(void* user_data, uint32_t item_index)
+{
+    flush_context* ctx = (flush_context*) user_data;
+    uint32_t tile_index = (ctx->heatmap_tiles != nullptr) ? ctx->heatmap_tiles[item_index] : item_index;
+    uint32_t num_tiles = ctx->args.num_tile_width * ctx->args.num_tile_height;
+
+    tile_cost cost;
+    if (ctx->tile_format == tile_format_arrays)
+        cost = cpu_tile_cost_arrays(&ctx->args, &ctx->arrays, tile_index, ctx->width, ctx->height);
+    else
+        cost = cpu_tile_cost(&ctx->args, &ctx->tiles, tile_index, ctx->width, ctx->height);
+
+    ctx->heatmap[heatmap_commands * num_tiles + tile_index] = cost.commands;
+    ctx->heatmap[heatmap_combinations * num_tiles + tile_index] = cost.combinations;
+    ctx->heatmap[heatmap_evaluations * num_tiles + tile_index] = cost.evaluations;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// nearest rank, values is reordered
+static uint32_t percentile(uint32_t* values, uint32_t count, uint32_t percent)
+{
+    uint32_t rank = (count * percent + 99) / 100;
+    uint32_t* nth = values + ((rank > 0) ? rank - 1 : 0);
+    std::nth_element(values, nth, values + count);
+    return *nth;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void update_heatmap(renderer_backend* b, flush_context* ctx, bool incremental, uint32_t num_dirty)
+{
+    uint32_t num_tiles = ctx->args.num_tile_width * ctx->args.num_tile_height;
+    if (b->m_pHeatmap == nullptr)
+        b->m_pHeatmap = (uint32_t*) malloc(sizeof(uint32_t) * num_tiles * (heatmap_metric_count + 1));
+
+    // the tiles skipped by the incremental rendering have the same lists, so the same values
+    ctx->heatmap = b->m_pHeatmap;
+    ctx->heatmap_tiles = incremental ? b->m_pDirtyList : nullptr;
+    scheduler_run(b->m_pScheduler, incremental ? num_dirty : num_tiles, heatmap_task, ctx);
+
+    renderer_heatmap* summary = &b->m_HeatmapSummary;
+    summary->num_tile_width = ctx->args.num_tile_width;
+    summary->num_tile_height = ctx->args.num_tile_height;
+
+    uint32_t* scratch = b->m_pHeatmap + heatmap_metric_count * num_tiles;
+    for(uint32_t i=0; i<heatmap_metric_count; ++i)
+    {
+        summary->tiles[i] = b->m_pHeatmap + i * num_tiles;
+        memcpy(scratch, summary->tiles[i], sizeof(uint32_t) * num_tiles);
+        summary->max[i] = *std::max_element(scratch, scratch + num_tiles);
+        summary->p50[i] = percentile(scratch, num_tiles, 50);
+        summary->p99[i] = percentile(scratch, num_tiles, 99);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void clear_tile(uint32_t* framebuffer, uint32_t width, uint32_t height, uint32_t tile_index, uint32_t num_tile_width, uint32_t color)
+{
+    uint32_t x0 = (tile_index % num_tile_width) * TILE_SIZE;
+    uint32_t y0 = (tile_index / num_tile_width) * TILE_SIZE;
+    uint32_t x1 = std::min(x0 + TILE_SIZE, width);
+    uint32_t y1 = std::min(y0 + TILE_SIZE, height);
+
+    for(uint32_t y=y0; y<y1; ++y)
+        for(uint32_t x=x0; x<x1; ++x)
+            framebuffer[y * width + x] = color;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// hashes the commands and finds the tiles that changed since the previous frame, returns false if every tile has to be
+// rendered (first frame, new drawable, global arguments changed)
+static bool find_dirty_tiles(renderer_backend* b, flush_context* ctx, uint32_t* num_dirty)
+{
+    void* drawable = ctx->framebuffer;
+    uint32_t num_tiles = ctx->args.num_tile_width * ctx->args.num_tile_height;
+
+    cpu_hash_commands(&ctx->args, ctx->num_draw_data, b->m_pHashes);
+    uint64_t arguments_hash = cpu_hash_arguments(&ctx->args);
+
+    bool incremental = b->m_PreviousValid && drawable == b->m_pPreviousDrawable && arguments_hash == b->m_PreviousArgumentsHash;
+    if (incremental)
+    {
+        memset(b->m_pDirty, 0, num_tiles);
+        *num_dirty = cpu_dirty_tiles(&ctx->args, b->m_pHashes, b->m_pPreviousHashes, b->m_pPreviousAABB,
+                                     b->m_NumPreviousCommands, b->m_pDirty, b->m_pDirtyList);
+    }
+
+    // the current frame becomes the reference
+    std::swap(b->m_pHashes, b->m_pPreviousHashes);
+    for(uint32_t i=0; i<ctx->args.num_commands; ++i)
+        b->m_pPreviousAABB[i] = cpu_command_aabb(&ctx->args, i);
+    b->m_NumPreviousCommands = ctx->args.num_commands;
+    b->m_PreviousArgumentsHash = arguments_hash;
+    b->m_pPreviousDrawable = drawable;
+    b->m_PreviousValid = (drawable != nullptr);
+    return incremental;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static size_t aabb_size(struct renderer* r)
+{
+    return (r->m_AABBFormat == aabb_wide) ? sizeof(wide_aabb) : sizeof(quantized_aabb);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void fill_arguments(struct renderer* r, const frame_buffers* frame, draw_cmd_arguments* args)
+{
+    renderer_fill_arguments(r, args);
+    args->commands = frame->m_pCommands;
+    args->commands_aabb = (r->m_AABBFormat == aabb_wide) ? nullptr : (quantized_aabb*) frame->m_pCommandsAABB;
+    args->commands_wide_aabb = (r->m_AABBFormat == aabb_wide) ? (wide_aabb*) frame->m_pCommandsAABB : nullptr;
+    args->draw_data = frame->m_pDrawData;
+    args->font = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the tile arrays index the commands on 16 bits, bigger frames fall back to the linked lists
+static renderer_tile_format tile_format(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    return (b->m_TileFormat == tile_format_arrays && r->m_NumDrawCommands <= MAX_COMMANDS) ? tile_format_arrays : tile_format_nodes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the frame continued in overflow chunks : the buffer grows to the high-water mark (at least twice bigger) and receives them
+template<class T>
+static T* linearize(PushArray<T>& array, T* buffer, uint32_t* capacity)
+{
+    if (array.IsContiguous())
+        return buffer;
+
+    if (array.GetNumElements() <= *capacity)
+    {
+        array.Linearize(buffer, *capacity * sizeof(T));
+        return buffer;
+    }
+
+    uint32_t new_capacity = std::max(array.GetHighWaterMark(), *capacity * 2);
+    T* output = (T*) malloc(sizeof(T) * new_capacity);
+    array.Linearize(output, new_capacity * sizeof(T));
+    free(buffer);
+    *capacity = new_capacity;
+    return output;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// per-command arrays of the flush, they're only touched by the flush so they grow there
+static void alloc_command_arrays(renderer_backend* b)
+{
+    b->m_pSmoothBorders = (float*) realloc(b->m_pSmoothBorders, sizeof(float) * b->m_FlushCapacity);
+    b->m_pHashes = (uint64_t*) realloc(b->m_pHashes, sizeof(uint64_t) * b->m_FlushCapacity);
+    b->m_pPreviousHashes = (uint64_t*) realloc(b->m_pPreviousHashes, sizeof(uint64_t) * b->m_FlushCapacity);
+    b->m_pPreviousAABB = (wide_aabb*) realloc(b->m_pPreviousAABB, sizeof(wide_aabb) * b->m_FlushCapacity);
+
+    delete[] b->m_pChunks;
+    b->m_pChunks = new std::vector<bin_hit>[(b->m_FlushCapacity + SCATTER_CHUNK_SIZE - 1) / SCATTER_CHUNK_SIZE];
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void alloc_frame(struct renderer* r, frame_buffers* frame)
+{
+    frame->m_CommandsCapacity = INITIAL_COMMANDS;
+    frame->m_DrawDataCapacity = INITIAL_DRAWDATA;
+    frame->m_pCommands = (draw_command*) malloc(sizeof(draw_command) * frame->m_CommandsCapacity);
+    frame->m_pDrawData = (float*) malloc(sizeof(float) * frame->m_DrawDataCapacity);
+    frame->m_pCommandsAABB = malloc(aabb_size(r) * frame->m_CommandsCapacity);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void free_frame(frame_buffers* frame)
+{
+    free(frame->m_pCommands);
+    free(frame->m_pDrawData);
+    free(frame->m_pCommandsAABB);
+    free(frame->m_pHalfDrawData);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void grow_buffers(struct renderer* r, frame_buffers* frame)
+{
+    uint32_t commands_capacity = frame->m_CommandsCapacity;
+    uint32_t aabb_capacity = frame->m_CommandsCapacity;
+    uint32_t draw_data_capacity = frame->m_DrawDataCapacity;
+
+    frame->m_pCommands = linearize(r->m_Commands, frame->m_pCommands, &commands_capacity);
+    if (r->m_AABBFormat == aabb_wide)
+        frame->m_pCommandsAABB = linearize(r->m_CommandsWideAABB, (wide_aabb*) frame->m_pCommandsAABB, &aabb_capacity);
+    else
+        frame->m_pCommandsAABB = linearize(r->m_CommandsAABB, (quantized_aabb*) frame->m_pCommandsAABB, &aabb_capacity);
+    frame->m_pDrawData = linearize(r->m_DrawData, frame->m_pDrawData, &draw_data_capacity);
+
+    // one aabb per command, they grow together
+    assert(aabb_capacity == commands_capacity);
+    frame->m_CommandsCapacity = commands_capacity;
+
+    if (draw_data_capacity != frame->m_DrawDataCapacity)
+    {
+        frame->m_DrawDataCapacity = draw_data_capacity;
+        if (frame->m_pHalfDrawData != nullptr)
+        {
+            free(frame->m_pHalfDrawData);
+            frame->m_pHalfDrawData = (float16*) malloc(sizeof(float16) * frame->m_DrawDataCapacity);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// runs on the flush thread with the asynchronous flush, on the caller otherwise
+static void execute_flush(renderer_backend* b, flush_context* ctx)
+{
+    uint32_t num_tiles = ctx->args.num_tile_width * ctx->args.num_tile_height;
+    if (ctx->args.num_commands > b->m_FlushCapacity)
+    {
+        b->m_FlushCapacity = std::max(ctx->args.num_commands, b->m_FlushCapacity * 2);
+        alloc_command_arrays(b);
+    }
+    ctx->smooth_borders = b->m_pSmoothBorders;
+    ctx->chunks = b->m_pChunks;
+
+    uint64_t steals = scheduler_get_steals(b->m_pScheduler);
+    uint64_t start = stm_now();
+    uint64_t profiler_start = profiler_begin();
+
+    // decoding is part of the binning time
+    if (ctx->half_draw_data != nullptr)
+        cpu_decode_draw_data(&ctx->args, ctx->num_draw_data, ctx->half_draw_data, ctx->draw_data);
+
+    memset(&b->m_Counters, 0, sizeof(counters));
+    memset(b->m_pHead, 0xff, num_tiles * sizeof(tile_node));
+    b->m_SuperTileCommands = b->m_SuperTileMaxCommands = 0;
+
+    uint32_t num_dirty = 0;
+    bool incremental = b->m_Incremental && find_dirty_tiles(b, ctx, &num_dirty);
+    b->m_NumSkippedTiles = incremental ? num_tiles - num_dirty : 0;
+
+    if (incremental)
+    {
+        // whatever the binning mode, the lists of the few dirty tiles are built by the per-tile binning
+        scheduler_run(b->m_pScheduler, num_dirty, dirty_bin_task, ctx);
+    }
+    else if (b->m_BinningMode == binning_scatter)
+    {
+        // commands are processed by chunks so the hits stay in submission order without sorting
+        uint32_t num_chunks = (ctx->args.num_commands + SCATTER_CHUNK_SIZE - 1) / SCATTER_CHUNK_SIZE;
+        cpu_bin_smooth_borders(&ctx->args, b->m_pSmoothBorders);
+        scheduler_run(b->m_pScheduler, num_chunks, scatter_task, ctx);
+        if (ctx->tile_format == tile_format_arrays)
+            cpu_bin_resolve_arrays(&ctx->args, b->m_pChunks, num_chunks, b->m_pTileCounts, &ctx->arrays, &b->m_Counters);
+        else
+            cpu_bin_resolve(&ctx->args, b->m_pChunks, num_chunks, b->m_pTileCounts, &ctx->tiles, &b->m_Counters);
+    }
+    else if (b->m_BinningMode == binning_hierarchical)
+    {
+        uint32_t num_super_tiles = b->m_NumSuperTilesWidth * b->m_NumSuperTilesHeight;
+        scheduler_run(b->m_pScheduler, num_super_tiles, coarse_task, ctx);
+        scheduler_run(b->m_pScheduler, num_tiles, fine_task, ctx);
+
+        for(uint32_t i=0; i<num_super_tiles; ++i)
+        {
+            uint32_t count = (uint32_t) b->m_pSuperTiles[i].size();
+            b->m_SuperTileCommands += count;
+            b->m_SuperTileMaxCommands = std::max(b->m_SuperTileMaxCommands, count);
+        }
+    }
+    else
+    {
+        // the order of the tile indices depends on the threads timing but each linked list is built by one thread
+        scheduler_run(b->m_pScheduler, num_tiles, bin_task, ctx);
+    }
+
+    // the per-tile binning modes build linked lists, they are converted after
+    if (ctx->tile_format == tile_format_arrays && (b->m_BinningMode != binning_scatter || incremental))
+        cpu_bin_compact(&ctx->args, &ctx->tiles, &ctx->arrays);
+
+    b->m_BinningTime = (float) stm_sec(stm_since(start));
+    profiler_end("binning", profiler_start);
+
+    if (b->m_Counters.num_nodes > MAX_NODES_COUNT)
+        log_warn("out of tile nodes (%d/%d), expect graphical artefacts", b->m_Counters.num_nodes, MAX_NODES_COUNT);
+
+    // not counted in the binning time
+    if (b->m_Heatmap)
+    {
+        PROFILER_SCOPE("heatmap");
+        update_heatmap(b, ctx, incremental, num_dirty);
+    }
+
+    if (ctx->framebuffer == nullptr)
+    {
+        b->m_RasterizationTime = 0.f;
+        b->m_NumSteals = (uint32_t)(scheduler_get_steals(b->m_pScheduler) - steals);
+        return;
+    }
+
+    start = stm_now();
+    profiler_start = profiler_begin();
+
+    // tiles without any command are not rasterized, same as the render pass clear on the gpu
+    if (incremental)
+    {
+        for(uint32_t i=0; i<num_dirty; ++i)
+            clear_tile(ctx->framebuffer, ctx->width, ctx->height, b->m_pDirtyList[i], ctx->args.num_tile_width, ctx->clear_color);
+    }
+    else
+    {
+        for(uint32_t i=0; i<ctx->width * ctx->height; ++i)
+            ctx->framebuffer[i] = ctx->clear_color;
+    }
+
+    scheduler_run(b->m_pScheduler, b->m_Counters.num_tiles, rasterize_task, ctx);
+
+    b->m_RasterizationTime = (float) stm_sec(stm_since(start));
+    profiler_end("rasterization", profiler_start);
+    b->m_NumSteals = (uint32_t)(scheduler_get_steals(b->m_pScheduler) - steals);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void complete_flush(renderer_backend* b, uint64_t fence)
+{
+    std::lock_guard<std::mutex> lock(b->m_FlushMutex);
+    b->m_CompletedFence = fence;
+    b->m_FrameTime = b->m_BinningTime + b->m_RasterizationTime;
+    b->m_FlushCondition.notify_all();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void flush_thread(renderer_backend* b)
+{
+    std::unique_lock<std::mutex> lock(b->m_FlushMutex);
+    for(;;)
+    {
+        b->m_FlushCondition.wait(lock, [b] {return b->m_QuitFlushThread || b->m_Job.fence > b->m_CompletedFence;});
+        if (b->m_Job.fence <= b->m_CompletedFence)
+            return;
+
+        // the job is not modified before it's completed
+        lock.unlock();
+        execute_flush(b, &b->m_Job);
+        complete_flush(b, b->m_Job.fence);
+        lock.lock();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void wait_fence(renderer_backend* b, uint64_t fence)
+{
+    std::unique_lock<std::mutex> lock(b->m_FlushMutex);
+    b->m_FlushCondition.wait(lock, [b, fence] {return b->m_CompletedFence >= fence;});
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the flush state (tile lists, counters, heatmap, settings) can be read or changed once the flush is done
+static void wait_idle(renderer_backend* b)
+{
+    wait_fence(b, b->m_SubmittedFence);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+struct renderer_backend* backend_init(struct renderer* r, void* device)
+{
+    UNUSED_VARIABLE(device);
+
+    stm_setup();
+
+    renderer_backend* b = new renderer_backend;
+    for(uint32_t i=0; i<FRAMES_IN_FLIGHT; ++i)
+        alloc_frame(r, &b->m_Frames[i]);
+    b->m_FlushCapacity = INITIAL_COMMANDS;
+    b->m_pNodes = (tile_node*) malloc(sizeof(tile_node) * MAX_NODES_COUNT);
+    b->m_pFont = decode_font();
+    b->m_pScheduler = scheduler_init(0);
+    b->m_pTileCommands = (tile_command*) malloc(sizeof(tile_command) * MAX_NODES_COUNT);
+    b->m_Job.fence = 0;
+    alloc_command_arrays(b);
+    return b;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_resize(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    uint32_t num_tiles = r->m_NumTilesWidth * r->m_NumTilesHeight;
+    wait_idle(b);
+
+    free(b->m_pHead);
+    free(b->m_pTileIndices);
+    free(b->m_pTileCounts);
+    free(b->m_pTileOffsets);
+    free(b->m_pDirty);
+    free(b->m_pDirtyList);
+    free(b->m_pHeatmap);
+    b->m_pHead = (tile_node*) malloc(num_tiles * sizeof(tile_node));
+    b->m_pTileIndices = (uint32_t*) malloc(num_tiles * sizeof(uint32_t));
+    b->m_pTileCounts = (uint32_t*) malloc(num_tiles * 2 * sizeof(uint32_t));
+    b->m_pTileOffsets = (uint32_t*) malloc((num_tiles + 1) * sizeof(uint32_t));
+    b->m_pDirty = (uint8_t*) malloc(num_tiles);
+    b->m_pDirtyList = (uint32_t*) malloc(num_tiles * sizeof(uint32_t));
+    b->m_pHeatmap = nullptr;
+    b->m_PreviousValid = false;
+
+    delete[] b->m_pSuperTiles;
+    b->m_NumSuperTilesWidth = (r->m_NumTilesWidth + SUPER_TILE_SIZE - 1) / SUPER_TILE_SIZE;
+    b->m_NumSuperTilesHeight = (r->m_NumTilesHeight + SUPER_TILE_SIZE - 1) / SUPER_TILE_SIZE;
+    b->m_pSuperTiles = new std::vector<uint32_t>[b->m_NumSuperTilesWidth * b->m_NumSuperTilesHeight];
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_reload_shaders(struct renderer* r)
+{
+    UNUSED_VARIABLE(r);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_map_buffers(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    b->m_CurrentFrame = b->m_Async ? r->m_FrameIndex % FRAMES_IN_FLIGHT : 0;
+    frame_buffers* frame = &b->m_Frames[b->m_CurrentFrame];
+
+    // the front end writes the buffers of the frame from now on, the flush that read them must be done
+    {
+        PROFILER_SCOPE("flush wait");
+        wait_fence(b, frame->m_Fence);
+    }
+
+    r->m_Commands.Set(frame->m_pCommands, sizeof(draw_command) * frame->m_CommandsCapacity);
+    if (r->m_AABBFormat == aabb_wide)
+        r->m_CommandsWideAABB.Set(frame->m_pCommandsAABB, sizeof(wide_aabb) * frame->m_CommandsCapacity);
+    else
+        r->m_CommandsAABB.Set(frame->m_pCommandsAABB, sizeof(quantized_aabb) * frame->m_CommandsCapacity);
+    r->m_DrawData.Set(frame->m_pDrawData, sizeof(float) * frame->m_DrawDataCapacity);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_unmap_buffers(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    frame_buffers* frame = &b->m_Frames[b->m_CurrentFrame];
+    grow_buffers(r, frame);
+
+    frame->m_HalfEncoded = (b->m_DrawDataFormat == draw_data_half);
+    if (frame->m_HalfEncoded)
+    {
+        draw_cmd_arguments args;
+        fill_arguments(r, frame, &args);
+        cpu_encode_draw_data(&args, r->m_NumDrawData, frame->m_pHalfDrawData);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// last completed flush, doesn't wait for the one in flight
+float backend_get_frame_time(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    std::lock_guard<std::mutex> lock(b->m_FlushMutex);
+    return b->m_FrameTime;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_get_stats(struct renderer* r, struct renderer_stats* stats)
+{
+    renderer_backend* b = r->m_pBackend;
+    wait_idle(b);
+
+    stats->num_nodes = (b->m_Counters.num_nodes < MAX_NODES_COUNT) ? b->m_Counters.num_nodes : MAX_NODES_COUNT;
+    stats->num_tiles = b->m_Counters.num_tiles;
+    stats->num_threads = scheduler_get_num_threads(b->m_pScheduler);
+    stats->num_steals = b->m_NumSteals;
+    stats->num_super_tiles = (b->m_BinningMode == binning_hierarchical) ? b->m_NumSuperTilesWidth * b->m_NumSuperTilesHeight : 0;
+    stats->super_tile_commands = b->m_SuperTileCommands;
+    stats->super_tile_max_commands = b->m_SuperTileMaxCommands;
+    stats->num_skipped_tiles = b->m_NumSkippedTiles;
+    stats->draw_data_size = stats->num_draw_data * ((b->m_DrawDataFormat == draw_data_half) ? sizeof(float16) : sizeof(float));
+
+    // what the rasterizer reads : heads and nodes, or offsets and command indices
+    uint32_t num_tiles = r->m_NumTilesWidth * r->m_NumTilesHeight;
+    if (tile_format(r) == tile_format_arrays)
+        stats->tile_lists_size = (num_tiles + 1) * sizeof(uint32_t) + stats->num_nodes * sizeof(tile_command);
+    else
+        stats->tile_lists_size = (num_tiles + stats->num_nodes) * sizeof(tile_node);
+    stats->binning_time = b->m_BinningTime;
+    stats->rasterization_time = b->m_RasterizationTime;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_num_threads(struct renderer* r, uint32_t num_threads)
+{
+    renderer_backend* b = r->m_pBackend;
+    wait_idle(b);
+    scheduler_terminate(b->m_pScheduler);
+    b->m_pScheduler = scheduler_init(num_threads);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_binning(struct renderer* r, enum renderer_binning mode)
+{
+    wait_idle(r->m_pBackend);
+    r->m_pBackend->m_BinningMode = mode;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_tile_format(struct renderer* r, enum renderer_tile_format format)
+{
+    wait_idle(r->m_pBackend);
+    r->m_pBackend->m_TileFormat = format;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_incremental(struct renderer* r, bool enable)
+{
+    wait_idle(r->m_pBackend);
+    r->m_pBackend->m_Incremental = enable;
+    r->m_pBackend->m_PreviousValid = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_heatmap(struct renderer* r, bool enable)
+{
+    // the incremental rendering only measures the dirty tiles, the others must have been measured before
+    wait_idle(r->m_pBackend);
+    r->m_pBackend->m_Heatmap = enable;
+    r->m_pBackend->m_PreviousValid = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool backend_get_heatmap(struct renderer* r, struct renderer_heatmap* heatmap)
+{
+    renderer_backend* b = r->m_pBackend;
+    wait_idle(b);
+    if (!b->m_Heatmap || b->m_pHeatmap == nullptr)
+        return false;
+
+    *heatmap = b->m_HeatmapSummary;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_draw_data_format(struct renderer* r, enum renderer_draw_data_format format)
+{
+    renderer_backend* b = r->m_pBackend;
+    wait_idle(b);
+    for(uint32_t i=0; i<FRAMES_IN_FLIGHT && format == draw_data_half; ++i)
+    {
+        frame_buffers* frame = &b->m_Frames[i];
+        if (frame->m_pHalfDrawData == nullptr)
+            frame->m_pHalfDrawData = (float16*) malloc(sizeof(float16) * frame->m_DrawDataCapacity);
+    }
+
+    b->m_DrawDataFormat = format;
+    b->m_PreviousValid = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_async(struct renderer* r, bool enable)
+{
+    renderer_backend* b = r->m_pBackend;
+    wait_idle(b);
+    if (enable == b->m_Async)
+        return;
+
+    if (enable)
+    {
+        b->m_QuitFlushThread = false;
+        b->m_FlushThread = std::thread(flush_thread, b);
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(b->m_FlushMutex);
+            b->m_QuitFlushThread = true;
+        }
+        b->m_FlushCondition.notify_all();
+        b->m_FlushThread.join();
+    }
+    b->m_Async = enable;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_finish(struct renderer* r)
+{
+    wait_idle(r->m_pBackend);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_flush(struct renderer* r, void* drawable)
+{
+    renderer_backend* b = r->m_pBackend;
+    frame_buffers* frame = &b->m_Frames[b->m_CurrentFrame];
+
+    // one flush at a time : the tile lists and the per-command arrays are shared by the frames
+    {
+        PROFILER_SCOPE("flush wait");
+        wait_idle(b);
+    }
+
+    // the job only references the buffers of the frame and the flush state, the renderer can build the next frame
+    flush_context ctx;
+    fill_arguments(r, frame, &ctx.args);
+
+    // the format was set to half after the frame was built
+    if (b->m_DrawDataFormat == draw_data_half && !frame->m_HalfEncoded)
+    {
+        cpu_encode_draw_data(&ctx.args, r->m_NumDrawData, frame->m_pHalfDrawData);
+        frame->m_HalfEncoded = true;
+    }
+    ctx.draw_data = frame->m_pDrawData;
+    ctx.half_draw_data = (b->m_DrawDataFormat == draw_data_half) ? frame->m_pHalfDrawData : nullptr;
+    ctx.num_draw_data = r->m_NumDrawData;
+    ctx.clear_color = cpu_pack_color(r->m_ClearColor);
+    ctx.fence = ++b->m_SubmittedFence;
+    ctx.tiles = {.head = b->m_pHead, .nodes = b->m_pNodes, .tile_indices = b->m_pTileIndices};
+    ctx.arrays = {.tile_offsets = b->m_pTileOffsets, .commands = b->m_pTileCommands, .tile_indices = b->m_pTileIndices};
+    ctx.tile_format = tile_format(r);
+    ctx.counter = &b->m_Counters;
+    ctx.font = b->m_pFont;
+    ctx.framebuffer = (uint32_t*) drawable;
+    ctx.width = r->m_WindowWidth;
+    ctx.height = r->m_WindowHeight;
+    ctx.super_tiles = b->m_pSuperTiles;
+    ctx.num_super_tiles_width = b->m_NumSuperTilesWidth;
+    ctx.dirty_list = b->m_pDirtyList;
+    frame->m_Fence = ctx.fence;
+
+    if (b->m_Async)
+    {
+        std::lock_guard<std::mutex> lock(b->m_FlushMutex);
+        b->m_Job = ctx;
+        b->m_FlushCondition.notify_all();
+    }
+    else
+    {
+        execute_flush(b, &ctx);
+        complete_flush(b, ctx.fence);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_terminate(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    backend_set_async(r, false);
+    for(uint32_t i=0; i<FRAMES_IN_FLIGHT; ++i)
+        free_frame(&b->m_Frames[i]);
+    free(b->m_pHead);
+    free(b->m_pNodes);
+    free(b->m_pTileIndices);
+    free(b->m_pFont);
+    free(b->m_pSmoothBorders);
+    free(b->m_pTileCounts);
+    free(b->m_pTileOffsets);
+    free(b->m_pTileCommands);
+    free(b->m_pHashes);
+    free(b->m_pPreviousHashes);
+    free(b->m_pPreviousAABB);
+    free(b->m_pDirty);
+    free(b->m_pDirtyList);
+    free(b->m_pHeatmap);
+    delete[] b->m_pChunks;
+    delete[] b->m_pSuperTiles;
+    scheduler_terminate(b->m_pScheduler);
+    delete b;
+}
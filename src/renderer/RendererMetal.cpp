@@ -0,0 +1,595 @@
+#define NS_PRIVATE_IMPLEMENTATION
+#define MTL_PRIVATE_IMPLEMENTATION
+#define CA_PRIVATE_IMPLEMENTATION
+#include "Metal.hpp"
+
+#include "renderer_private.h"
+#include "shader_reader.h"
+#include "DynamicBuffer.h"
+#include "../system/log.h"
+#include "../system/profiler.h"
+#include "commitmono_21_31.h"
+
+// needed for GPU Time
+#include <stdatomic.h>
+
+#ifdef SHADERS_IN_EXECUTABLE
+#include "../shaders/binning.h"
+#include "../shaders/rasterizer.h"
+#endif
+
+#define SAFE_RELEASE(p) if (p!=nullptr) p->release();
+#define SHADER_PATH "/Users/geolm/Code/Geolm/ToodeeSculpt/src/shaders/"
+#define UNUSED_VARIABLE(a) (void)(a)
+
+struct renderer_backend
+{
+    MTL::Device* m_pDevice;
+    MTL::CommandQueue* m_pCommandQueue;
+    MTL::CommandBuffer* m_pCommandBuffer;
+    MTL::ComputePipelineState* m_pBinningPSO {nullptr};
+    MTL::ComputePipelineState* m_pWriteIcbPSO {nullptr};
+    MTL::RenderPipelineState* m_pDrawPSO {nullptr};
+    MTL::DepthStencilState* m_pDepthStencilState {nullptr};
+
+    DynamicBuffer m_DrawCommandsBuffer;
+    DynamicBuffer m_CommandsAABBBuffer;
+    DynamicBuffer m_DrawDataBuffer;
+    MTL::Buffer* m_pCountersBuffer {nullptr};
+    MTL::Fence* m_pClearBuffersFence {nullptr};
+    MTL::Fence* m_pWriteIcbFence {nullptr};
+    MTL::Buffer* m_pHead {nullptr};
+    MTL::Buffer* m_pNodes {nullptr};
+    MTL::Buffer* m_pTileIndices {nullptr};
+    MTL::IndirectCommandBuffer* m_pIndirectCommandBuffer {nullptr};
+    MTL::Buffer* m_pIndirectArg {nullptr};
+    DynamicBuffer m_DrawCommandsArg;
+    DynamicBuffer m_BinOutputArg;
+    MTL::Texture *m_pFontTexture {nullptr};
+
+    _Atomic(float) m_GPUTime;
+
+    // frame fences : a slot of the dynamic buffers can be mapped again when the command buffer that read it is completed
+    uint64_t m_SlotSerial[DynamicBuffer::MaxInflightBuffers];
+    uint64_t m_SubmittedSerial {0};
+    _Atomic(uint64_t) m_CompletedSerial;
+    dispatch_semaphore_t m_Completion;      // signaled by each completed command buffer
+};
+
+void renderer_build_pso(struct renderer_backend* b);
+void renderer_build_font_texture(struct renderer_backend* b);
+void renderer_build_depthstencil_state(struct renderer_backend* b);
+
+//----------------------------------------------------------------------------------------------------------------------------
+struct renderer_backend* backend_init(struct renderer* r, void* device)
+{
+    // binning.metal only reads quantized_aabb
+    if (r->m_AABBFormat == aabb_wide)
+    {
+        log_warn("wide aabb are not supported by the metal backend, resolution is limited to 4096 pixels");
+        r->m_AABBFormat = aabb_compact;
+    }
+
+    renderer_backend* b = new renderer_backend;
+
+    assert(device!=nullptr);
+    b->m_pDevice = (MTL::Device*)device;
+    b->m_pCommandQueue = b->m_pDevice->newCommandQueue();
+
+    if (b->m_pCommandQueue == nullptr)
+    {
+        log_fatal("can't create a command queue");
+        exit(EXIT_FAILURE);
+    }
+
+    b->m_DrawCommandsBuffer.Init(b->m_pDevice, sizeof(draw_command) * INITIAL_COMMANDS);
+    b->m_DrawDataBuffer.Init(b->m_pDevice, sizeof(float) * INITIAL_DRAWDATA);
+    b->m_CommandsAABBBuffer.Init(b->m_pDevice, sizeof(quantized_aabb) * INITIAL_COMMANDS);
+    b->m_pCountersBuffer = b->m_pDevice->newBuffer(sizeof(counters), MTL::ResourceStorageModePrivate);
+    b->m_pNodes = b->m_pDevice->newBuffer(sizeof(tile_node) * MAX_NODES_COUNT, MTL::ResourceStorageModePrivate);
+    b->m_pClearBuffersFence = b->m_pDevice->newFence();
+    b->m_pWriteIcbFence = b->m_pDevice->newFence();
+
+    MTL::IndirectCommandBufferDescriptor* pIcbDesc = MTL::IndirectCommandBufferDescriptor::alloc()->init();
+    pIcbDesc->setCommandTypes(MTL::IndirectCommandTypeDraw);
+    pIcbDesc->setInheritBuffers(true);
+    pIcbDesc->setInheritPipelineState(true);
+    pIcbDesc->setMaxVertexBufferBindCount(2);
+    pIcbDesc->setMaxFragmentBufferBindCount(2);
+    b->m_pIndirectCommandBuffer = b->m_pDevice->newIndirectCommandBuffer(pIcbDesc, 1, MTL::ResourceStorageModePrivate);
+    pIcbDesc->release();
+
+    for(uint32_t i=0; i<DynamicBuffer::MaxInflightBuffers; ++i)
+        b->m_SlotSerial[i] = 0;
+    atomic_store(&b->m_CompletedSerial, 0);
+    b->m_Completion = dispatch_semaphore_create(0);
+    atomic_store(&b->m_GPUTime, 0.f);
+
+    renderer_build_pso(b);
+    renderer_build_font_texture(b);
+    renderer_build_depthstencil_state(b);
+    return b;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_resize(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    backend_finish(r);
+    SAFE_RELEASE(b->m_pHead);
+    SAFE_RELEASE(b->m_pTileIndices);
+    b->m_pHead = b->m_pDevice->newBuffer(r->m_NumTilesWidth * r->m_NumTilesHeight * sizeof(tile_node), MTL::ResourceStorageModePrivate);
+    b->m_pTileIndices = b->m_pDevice->newBuffer(r->m_NumTilesWidth * r->m_NumTilesHeight * sizeof(uint32_t), MTL::ResourceStorageModePrivate);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_reload_shaders(struct renderer* r)
+{
+#ifndef SHADERS_IN_EXECUTABLE
+    log_info("reloading shaders");
+    renderer_build_pso(r->m_pBackend);
+#else
+    UNUSED_VARIABLE(r);
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_build_depthstencil_state(struct renderer_backend* b)
+{
+    MTL::DepthStencilDescriptor* pDsDesc = MTL::DepthStencilDescriptor::alloc()->init();
+
+    pDsDesc->setDepthCompareFunction(MTL::CompareFunction::CompareFunctionAlways);
+    pDsDesc->setDepthWriteEnabled(false);
+
+    b->m_pDepthStencilState = b->m_pDevice->newDepthStencilState(pDsDesc);
+
+    pDsDesc->release();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+#ifdef SHADERS_IN_EXECUTABLE
+MTL::Library* renderer_build_shader(struct renderer_backend* b, const uint8_t* shader_buffer, const char* name)
+{
+    NS::Error* pError = nullptr;
+    MTL::Library* pLibrary = b->m_pDevice->newLibrary( NS::String::string((const char*)shader_buffer, NS::UTF8StringEncoding), nullptr, &pError );
+
+    if (pLibrary == nullptr)
+    {
+        log_error("error while compiling : %s\n%s", name, pError->localizedDescription()->utf8String());
+    }
+    return pLibrary;
+}
+#else
+MTL::Library* renderer_build_shader(struct renderer_backend* b, const char* path, const char* name)
+{
+    char* shader_buffer = read_shader_include(path, name);
+    if (shader_buffer == NULL)
+    {
+        log_fatal("can't find shader %s%s", path, name);
+        return nullptr;
+    }
+
+    NS::Error* pError = nullptr;
+    MTL::Library* pLibrary = b->m_pDevice->newLibrary( NS::String::string(shader_buffer, NS::UTF8StringEncoding), nullptr, &pError );
+
+    free(shader_buffer);
+
+    if (pLibrary == nullptr)
+    {
+        log_error("error while compiling : %s\n%s", name, pError->localizedDescription()->utf8String());
+    }
+    return pLibrary;
+}
+
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_build_pso(struct renderer_backend* b)
+{
+    SAFE_RELEASE(b->m_pBinningPSO);
+    SAFE_RELEASE(b->m_pDrawPSO);
+    SAFE_RELEASE(b->m_pWriteIcbPSO);
+
+#ifdef SHADERS_IN_EXECUTABLE
+    MTL::Library* pLibrary = renderer_build_shader(b, binning_shader, "binning");
+#else
+    MTL::Library* pLibrary = renderer_build_shader(b, SHADER_PATH, "binning.metal");
+#endif
+    if (pLibrary != nullptr)
+    {
+        MTL::Function* pBinningFunction = pLibrary->newFunction(NS::String::string("bin", NS::UTF8StringEncoding));
+        NS::Error* pError = nullptr;
+        b->m_pBinningPSO = b->m_pDevice->newComputePipelineState(pBinningFunction, &pError);
+
+        if (b->m_pBinningPSO == nullptr)
+        {
+            log_error( "%s", pError->localizedDescription()->utf8String());
+            return;
+        }
+
+        MTL::ArgumentEncoder* inputArgumentEncoder = pBinningFunction->newArgumentEncoder(0);
+        MTL::ArgumentEncoder* outputArgumentEncoder = pBinningFunction->newArgumentEncoder(1);
+
+        b->m_DrawCommandsArg.Init(b->m_pDevice, inputArgumentEncoder->encodedLength());
+        b->m_BinOutputArg.Init(b->m_pDevice, outputArgumentEncoder->encodedLength());
+
+        inputArgumentEncoder->release();
+        outputArgumentEncoder->release();
+        pBinningFunction->release();
+
+        MTL::Function* pWriteIcbFunction = pLibrary->newFunction(NS::String::string("write_icb", NS::UTF8StringEncoding));
+        b->m_pWriteIcbPSO = b->m_pDevice->newComputePipelineState(pWriteIcbFunction, &pError);
+        if (b->m_pWriteIcbPSO == nullptr)
+        {
+            log_error( "%s", pError->localizedDescription()->utf8String());
+            return;
+        }
+
+        MTL::ArgumentEncoder* indirectArgumentEncoder = pWriteIcbFunction->newArgumentEncoder(1);
+        b->m_pIndirectArg = b->m_pDevice->newBuffer(indirectArgumentEncoder->encodedLength(), MTL::ResourceStorageModeShared);
+        indirectArgumentEncoder->setArgumentBuffer(b->m_pIndirectArg, 0);
+        indirectArgumentEncoder->setIndirectCommandBuffer(b->m_pIndirectCommandBuffer, 0);
+
+        indirectArgumentEncoder->release();
+        pWriteIcbFunction->release();
+        pLibrary->release();
+    }
+
+#ifdef SHADERS_IN_EXECUTABLE
+    pLibrary = renderer_build_shader(b, rasterizer_shader, "rasterizer");
+#else
+    pLibrary = renderer_build_shader(b, SHADER_PATH, "rasterizer.metal");
+#endif
+    if (pLibrary != nullptr)
+    {
+        MTL::Function* pVertexFunction = pLibrary->newFunction(NS::String::string("tile_vs", NS::UTF8StringEncoding));
+        MTL::Function* pFragmentFunction = pLibrary->newFunction(NS::String::string("tile_fs", NS::UTF8StringEncoding));
+        NS::Error* pError = nullptr;
+
+        MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+        pDesc->setVertexFunction(pVertexFunction);
+        pDesc->setFragmentFunction(pFragmentFunction);
+        pDesc->setSupportIndirectCommandBuffers(true);
+
+        MTL::RenderPipelineColorAttachmentDescriptor *pRenderbufferAttachment = pDesc->colorAttachments()->object(0);
+        pRenderbufferAttachment->setPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB);
+        pRenderbufferAttachment->setBlendingEnabled(false);
+        b->m_pDrawPSO = b->m_pDevice->newRenderPipelineState( pDesc, &pError );
+
+        if (b->m_pDrawPSO == nullptr)
+            log_error( "%s", pError->localizedDescription()->utf8String());
+
+        pVertexFunction->release();
+        pFragmentFunction->release();
+        pDesc->release();
+        pLibrary->release();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_build_font_texture(struct renderer_backend* b)
+{
+    MTL::TextureDescriptor* pTextureDesc = MTL::TextureDescriptor::alloc()->init();
+    pTextureDesc->setWidth(FONT_TEXTURE_WIDTH);
+    pTextureDesc->setHeight(FONT_TEXTURE_HEIGHT);
+    pTextureDesc->setPixelFormat(MTL::PixelFormatBC4_RUnorm);
+    pTextureDesc->setTextureType(MTL::TextureType2D);
+    pTextureDesc->setMipmapLevelCount(1);
+    pTextureDesc->setUsage( MTL::ResourceUsageSample | MTL::ResourceUsageRead );
+
+    b->m_pFontTexture = b->m_pDevice->newTexture(pTextureDesc);
+    b->m_pFontTexture->replaceRegion( MTL::Region( 0, 0, 0, FONT_TEXTURE_WIDTH, FONT_TEXTURE_HEIGHT, 1 ), 0, commitmono_21_31, (FONT_TEXTURE_WIDTH/4) * 8);
+    pTextureDesc->release();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t buffer_length(DynamicBuffer& buffer, uint32_t frame_index)
+{
+    return (uint32_t) buffer.GetBuffer(frame_index)->length();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the frame continued in overflow chunks : the buffer of the frame grows to the high-water mark and receives them
+// the buffers of the other frames grow the first time they overflow
+template<class T>
+static void linearize(MTL::Device* device, DynamicBuffer& buffer, PushArray<T>& array, uint32_t frame_index)
+{
+    if (array.IsContiguous())
+        return;
+
+    MTL::Buffer* previous = nullptr;
+    uint32_t length = buffer_length(buffer, frame_index);
+    if (array.GetNumElements() * sizeof(T) > length)
+    {
+        uint32_t high_water_mark = array.GetHighWaterMark() * (uint32_t) sizeof(T);
+        previous = buffer.Grow(device, frame_index, (high_water_mark > length * 2) ? high_water_mark : length * 2);
+    }
+
+    array.Linearize(buffer.Map(frame_index), buffer_length(buffer, frame_index));
+    SAFE_RELEASE(previous);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the command buffers complete in submission order but the handlers can run on any thread, in any order :
+// the completed serial only goes up, a late handler doesn't bring it back
+static void publish_serial(renderer_backend* b, uint64_t serial)
+{
+    uint64_t completed = atomic_load(&b->m_CompletedSerial);
+    while (completed < serial)
+    {
+        // a failed exchange reloads the completed serial
+        if (atomic_compare_exchange_weak(&b->m_CompletedSerial, &completed, serial))
+            break;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// each handler signals the semaphore once, the serial is checked again after every wake
+static void wait_serial(renderer_backend* b, uint64_t serial)
+{
+    while (atomic_load(&b->m_CompletedSerial) < serial)
+        dispatch_semaphore_wait(b->m_Completion, DISPATCH_TIME_FOREVER);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_map_buffers(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+
+    // the cpu writes the buffers of the slot from now on, the gpu must be done with the frame that used them
+    uint64_t profiler_start = profiler_begin();
+    wait_serial(b, b->m_SlotSerial[r->m_FrameIndex % DynamicBuffer::MaxInflightBuffers]);
+    profiler_end("gpu wait", profiler_start);
+
+    r->m_Commands.Set(b->m_DrawCommandsBuffer.Map(r->m_FrameIndex), buffer_length(b->m_DrawCommandsBuffer, r->m_FrameIndex));
+    r->m_CommandsAABB.Set(b->m_CommandsAABBBuffer.Map(r->m_FrameIndex), buffer_length(b->m_CommandsAABBBuffer, r->m_FrameIndex));
+    r->m_DrawData.Set(b->m_DrawDataBuffer.Map(r->m_FrameIndex), buffer_length(b->m_DrawDataBuffer, r->m_FrameIndex));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_unmap_buffers(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    linearize(b->m_pDevice, b->m_DrawCommandsBuffer, r->m_Commands, r->m_FrameIndex);
+    linearize(b->m_pDevice, b->m_CommandsAABBBuffer, r->m_CommandsAABB, r->m_FrameIndex);
+    linearize(b->m_pDevice, b->m_DrawDataBuffer, r->m_DrawData, r->m_FrameIndex);
+    b->m_DrawCommandsBuffer.Unmap(r->m_FrameIndex, 0, r->m_Commands.GetNumElements() * sizeof(draw_command));
+    b->m_CommandsAABBBuffer.Unmap(r->m_FrameIndex, 0, r->m_CommandsAABB.GetNumElements() * sizeof(quantized_aabb));
+    b->m_DrawDataBuffer.Unmap(r->m_FrameIndex, 0, r->m_DrawData.GetNumElements() * sizeof(float));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+float backend_get_frame_time(struct renderer* r)
+{
+    return atomic_load(&r->m_pBackend->m_GPUTime);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_get_stats(struct renderer* r, struct renderer_stats* stats)
+{
+    stats->num_nodes = 0;
+    stats->num_tiles = 0;
+    stats->num_threads = 0;
+    stats->num_steals = 0;
+    stats->num_super_tiles = 0;
+    stats->super_tile_commands = 0;
+    stats->super_tile_max_commands = 0;
+    stats->tile_lists_size = 0;
+    stats->num_skipped_tiles = 0;
+    stats->binning_time = 0.f;
+    stats->rasterization_time = atomic_load(&r->m_pBackend->m_GPUTime);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_num_threads(struct renderer* r, uint32_t num_threads)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(num_threads);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_binning(struct renderer* r, enum renderer_binning mode)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(mode);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_tile_format(struct renderer* r, enum renderer_tile_format format)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(format);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_incremental(struct renderer* r, bool enable)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(enable);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_heatmap(struct renderer* r, bool enable)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(enable);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool backend_get_heatmap(struct renderer* r, struct renderer_heatmap* heatmap)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(heatmap);
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_draw_data_format(struct renderer* r, enum renderer_draw_data_format format)
+{
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(format);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void renderer_bin_commands(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    if (b->m_pBinningPSO == nullptr)
+        return;
+
+    // clear buffers
+    MTL::BlitCommandEncoder* pBlitEncoder = b->m_pCommandBuffer->blitCommandEncoder();
+    pBlitEncoder->fillBuffer(b->m_pCountersBuffer, NS::Range(0, b->m_pCountersBuffer->length()), 0);
+    pBlitEncoder->fillBuffer(b->m_pHead, NS::Range(0, b->m_pHead->length()), 0xff);
+    pBlitEncoder->resetCommandsInBuffer(b->m_pIndirectCommandBuffer, NS::Range(0, 1));
+    pBlitEncoder->updateFence(b->m_pClearBuffersFence);
+    pBlitEncoder->endEncoding();
+
+    // run binning shader
+    MTL::ComputeCommandEncoder* pComputeEncoder = b->m_pCommandBuffer->computeCommandEncoder();
+    pComputeEncoder->waitForFence(b->m_pClearBuffersFence);
+    pComputeEncoder->setComputePipelineState(b->m_pBinningPSO);
+
+    draw_cmd_arguments* args = (draw_cmd_arguments*) b->m_DrawCommandsArg.Map(r->m_FrameIndex);
+    renderer_fill_arguments(r, args);
+    args->commands_aabb = (quantized_aabb*) b->m_CommandsAABBBuffer.GetBuffer(r->m_FrameIndex)->gpuAddress();
+    args->commands_wide_aabb = nullptr;
+    args->commands = (draw_command*) b->m_DrawCommandsBuffer.GetBuffer(r->m_FrameIndex)->gpuAddress();
+    args->draw_data = (float*) b->m_DrawDataBuffer.GetBuffer(r->m_FrameIndex)->gpuAddress();
+    args->font = (texture_half) b->m_pFontTexture->gpuResourceID()._impl;
+    b->m_DrawCommandsArg.Unmap(r->m_FrameIndex, 0, sizeof(draw_cmd_arguments));
+
+    tiles_data* output = (tiles_data*) b->m_BinOutputArg.Map(r->m_FrameIndex);
+    output->head = (tile_node*) b->m_pHead->gpuAddress();
+    output->nodes = (tile_node*) b->m_pNodes->gpuAddress();
+    output->tile_indices = (uint32_t*) b->m_pTileIndices->gpuAddress();
+    b->m_BinOutputArg.Unmap(r->m_FrameIndex, 0, sizeof(tiles_data));
+
+    pComputeEncoder->setBuffer(b->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), 0, 0);
+    pComputeEncoder->setBuffer(b->m_BinOutputArg.GetBuffer(r->m_FrameIndex), 0, 1);
+    pComputeEncoder->setBuffer(b->m_pCountersBuffer, 0, 2);
+
+    pComputeEncoder->useResource(b->m_CommandsAABBBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
+    pComputeEncoder->useResource(b->m_DrawCommandsBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
+    pComputeEncoder->useResource(b->m_DrawDataBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
+    pComputeEncoder->useResource(b->m_pHead, MTL::ResourceUsageRead|MTL::ResourceUsageWrite);
+    pComputeEncoder->useResource(b->m_pNodes, MTL::ResourceUsageWrite);
+    pComputeEncoder->useResource(b->m_pTileIndices, MTL::ResourceUsageWrite);
+
+    MTL::Size gridSize = MTL::Size(r->m_NumTilesWidth, r->m_NumTilesHeight, 1);
+
+    NS::UInteger w = b->m_pBinningPSO->threadExecutionWidth();
+    NS::UInteger h = b->m_pBinningPSO->maxTotalThreadsPerThreadgroup() / w;
+    MTL::Size threadgroupSize(w, h, 1);
+    pComputeEncoder->dispatchThreads(gridSize, threadgroupSize);
+
+    pComputeEncoder->setComputePipelineState(b->m_pWriteIcbPSO);
+    pComputeEncoder->setBuffer(b->m_pCountersBuffer, 0, 0);
+    pComputeEncoder->setBuffer(b->m_pIndirectArg, 0, 1);
+    pComputeEncoder->useResource(b->m_pIndirectCommandBuffer, MTL::ResourceUsageWrite);
+    pComputeEncoder->dispatchThreads(MTL::Size(1, 1, 1), MTL::Size(1, 1, 1));
+    pComputeEncoder->updateFence(b->m_pWriteIcbFence);
+    pComputeEncoder->endEncoding();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_flush(struct renderer* r, void* drawable)
+{
+    renderer_backend* b = r->m_pBackend;
+    b->m_pCommandBuffer = b->m_pCommandQueue->commandBuffer();
+
+    // binning and rasterization run on the gpu, only the encoding is measured
+    uint64_t profiler_start = profiler_begin();
+    renderer_bin_commands(r);
+
+    MTL::RenderPassDescriptor* renderPassDescriptor = MTL::RenderPassDescriptor::alloc()->init();
+    MTL::RenderPassColorAttachmentDescriptor* cd = renderPassDescriptor->colorAttachments()->object(0);
+    cd->setTexture(((CA::MetalDrawable*)drawable)->texture());
+    cd->setLoadAction(MTL::LoadActionClear);
+    cd->setClearColor(MTL::ClearColor(r->m_ClearColor.x, r->m_ClearColor.y, r->m_ClearColor.z, r->m_ClearColor.w));
+    cd->setStoreAction(MTL::StoreActionStore);
+
+    MTL::RenderCommandEncoder* pRenderEncoder = b->m_pCommandBuffer->renderCommandEncoder(renderPassDescriptor);
+
+    if (b->m_pDrawPSO != nullptr && b->m_pBinningPSO != nullptr)
+    {
+        pRenderEncoder->waitForFence(b->m_pWriteIcbFence, MTL::RenderStageVertex|MTL::RenderStageFragment|MTL::RenderStageMesh|MTL::RenderStageObject);
+        pRenderEncoder->setCullMode(MTL::CullModeNone);
+        pRenderEncoder->setDepthStencilState(b->m_pDepthStencilState);
+        pRenderEncoder->setVertexBuffer(b->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), 0, 0);
+        pRenderEncoder->setVertexBuffer(b->m_pTileIndices, 0, 1);
+        pRenderEncoder->setFragmentBuffer(b->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), 0, 0);
+        pRenderEncoder->setFragmentBuffer(b->m_BinOutputArg.GetBuffer(r->m_FrameIndex), 0, 1);
+        pRenderEncoder->useResource(b->m_DrawCommandsArg.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_DrawCommandsBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_DrawDataBuffer.GetBuffer(r->m_FrameIndex), MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_pHead, MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_pNodes, MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_pTileIndices, MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_pIndirectCommandBuffer, MTL::ResourceUsageRead);
+        pRenderEncoder->useResource(b->m_pFontTexture, MTL::ResourceUsageRead);
+        pRenderEncoder->setRenderPipelineState(b->m_pDrawPSO);
+        pRenderEncoder->executeCommandsInBuffer(b->m_pIndirectCommandBuffer, NS::Range(0, 1));
+        pRenderEncoder->endEncoding();
+    }
+
+    // no wait here : the next frame is built while this one is rendered, backend_map_buffers waits for the slot
+    uint64_t serial = ++b->m_SubmittedSerial;
+    b->m_SlotSerial[r->m_FrameIndex % DynamicBuffer::MaxInflightBuffers] = serial;
+
+    b->m_pCommandBuffer->addCompletedHandler(^void( MTL::CommandBuffer* pCmd )
+    {
+        atomic_store(&b->m_GPUTime, (float)(pCmd->GPUEndTime() - pCmd->GPUStartTime()));
+        publish_serial(b, serial);
+        dispatch_semaphore_signal(b->m_Completion);
+    });
+
+    b->m_pCommandBuffer->presentDrawable((CA::MetalDrawable*)drawable);
+    b->m_pCommandBuffer->commit();
+    profiler_end("encoding", profiler_start);
+
+    renderPassDescriptor->release();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_set_async(struct renderer* r, bool enable)
+{
+    // always asynchronous
+    UNUSED_VARIABLE(r);
+    UNUSED_VARIABLE(enable);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_finish(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    wait_serial(b, b->m_SubmittedSerial);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void backend_terminate(struct renderer* r)
+{
+    renderer_backend* b = r->m_pBackend;
+    backend_finish(r);
+    dispatch_release(b->m_Completion);
+    b->m_DrawCommandsBuffer.Terminate();
+    b->m_DrawDataBuffer.Terminate();
+    b->m_CommandsAABBBuffer.Terminate();
+    b->m_DrawCommandsArg.Terminate();
+    b->m_BinOutputArg.Terminate();
+    SAFE_RELEASE(b->m_pDepthStencilState);
+    SAFE_RELEASE(b->m_pCountersBuffer);
+    SAFE_RELEASE(b->m_pClearBuffersFence);
+    SAFE_RELEASE(b->m_pWriteIcbFence);
+    SAFE_RELEASE(b->m_pBinningPSO);
+    SAFE_RELEASE(b->m_pDrawPSO);
+    SAFE_RELEASE(b->m_pWriteIcbPSO);
+    SAFE_RELEASE(b->m_pHead);
+    SAFE_RELEASE(b->m_pNodes);
+    SAFE_RELEASE(b->m_pTileIndices);
+    SAFE_RELEASE(b->m_pIndirectArg);
+    SAFE_RELEASE(b->m_pIndirectCommandBuffer);
+    SAFE_RELEASE(b->m_pCommandQueue);
+    SAFE_RELEASE(b->m_pFontTexture);
+    delete b;
+}
@@ -0,0 +1,483 @@
+#include "cpu_kernels.h"
+#include "cpu_shaders.h"
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// returns true if the command has an impact on the tile, smooth_border is the smooth value of the combination containing
+// the command (zero outside of combinations)
+// ---------------------------------------------------------------------------------------------------------------------------
+static bool command_in_tile(const draw_cmd_arguments* input, uint32_t i, uint16_t tile_x, uint16_t tile_y, float smooth_border)
+{
+    const wide_aabb cmd_aabb = cpu_command_aabb(input, i);
+    if (tile_x < cmd_aabb.min_x || tile_y < cmd_aabb.min_y || cmd_aabb.max_x < tile_x || cmd_aabb.max_y < tile_y)
+        return false;
+
+    const draw_command& cmd = input->commands[i];
+    const clip_rect& clip = input->clips[cmd.clip_index];
+
+    uint32_t tile_pos_x = tile_x * TILE_SIZE;
+    uint32_t tile_pos_y = tile_y * TILE_SIZE;
+    if (tile_pos_x > clip.max_x || tile_pos_y > clip.max_y || tile_pos_x + TILE_SIZE < clip.min_x || tile_pos_y + TILE_SIZE < clip.min_y)
+        return false;
+
+    // compute tile bounding box
+    aabb tile_aabb = {.min = float2(tile_x, tile_y), .max = float2(tile_x + 1, tile_y + 1)};
+    tile_aabb.min *= TILE_SIZE; tile_aabb.max *= TILE_SIZE;
+    float2 tile_center = (tile_aabb.min + tile_aabb.max) * .5f;
+
+    // grow the bounding box for anti-aliasing and smooth blend
+    aabb tile_enlarge_aabb = aabb_grow(tile_aabb, (cmd.op == op_union) ? max(input->aa_width, smooth_border) : input->aa_width);
+
+    const bool is_hollow = (primitive_get_fillmode(cmd.type) == fill_hollow);
+    bool to_be_added = false;
+    const float* data = &input->draw_data[cmd.data_index];
+    command_type type = primitive_get_type(cmd.type);
+    switch(type)
+    {
+        case primitive_oriented_box :
+        {
+            float2 p0 = float2(data[0], data[1]);
+            float2 p1 = float2(data[2], data[3]);
+            float width = data[4];
+            aabb tile_rounded = aabb_grow(tile_enlarge_aabb, data[5]);
+            to_be_added = intersection_aabb_obb(tile_rounded, p0, p1, width);
+
+            if (to_be_added && is_hollow && is_aabb_inside_obb(p0, p1, width, tile_rounded))
+                to_be_added = false;
+            break;
+        }
+        case primitive_ellipse :
+        {
+            float2 p0 = float2(data[0], data[1]);
+            float2 p1 = float2(data[2], data[3]);
+            float width = data[4];
+            aabb tile_smooth = aabb_grow(tile_enlarge_aabb, (is_hollow ? data[5] : 0.f));
+            to_be_added = intersection_ellipse_circle(p0, p1, width, tile_center, length(aabb_get_extents(tile_smooth) * .5f));
+
+            if (to_be_added && is_hollow && is_aabb_inside_ellipse(p0, p1, width, tile_smooth))
+                to_be_added = false;
+            break;
+        }
+        case primitive_ring :
+        {
+            float2 center = float2(data[0], data[1]);
+            float radius = data[2];
+            float2 direction = float2(data[3], data[4]);
+            float2 aperture = float2(data[5], data[6]);
+            float thickness = data[7];
+            aabb tile_smooth = aabb_grow(tile_enlarge_aabb, (is_hollow ? thickness : 0.f));
+            to_be_added = intersection_aabb_arc(tile_smooth, center, direction, aperture, radius, thickness);
+            break;
+        }
+        case primitive_pie :
+        {
+            float2 center = float2(data[0], data[1]);
+            float radius = data[2];
+            float2 direction = float2(data[3], data[4]);
+            float2 aperture = float2(data[5], data[6]);
+
+            aabb tile_smooth = aabb_grow(tile_enlarge_aabb, (is_hollow ? data[7] : 0.f));
+            to_be_added = intersection_aabb_pie(tile_smooth, center, direction, aperture, radius);
+
+            if (to_be_added && is_hollow && is_aabb_inside_pie(center, direction, aperture, radius, tile_smooth))
+                to_be_added = false;
+
+            break;
+        }
+        case primitive_disc :
+        {
+            float2 center = float2(data[0], data[1]);
+            float radius = data[2];
+
+            if (is_hollow)
+            {
+                float half_width = data[3] + max(input->aa_width, smooth_border);
+                to_be_added = intersection_aabb_circle(tile_aabb, center, radius, half_width);
+            }
+            else
+            {
+                radius += max(input->aa_width, smooth_border);
+                to_be_added = intersection_aabb_disc(tile_aabb, center, radius);
+            }
+            break;
+        }
+        case primitive_triangle :
+        {
+            float2 p0 = float2(data[0], data[1]);
+            float2 p1 = float2(data[2], data[3]);
+            float2 p2 = float2(data[4], data[5]);
+            aabb tile_rounded = aabb_grow(tile_enlarge_aabb, data[6]);
+            to_be_added = intersection_aabb_triangle(tile_rounded, p0, p1, p2);
+
+            if (to_be_added && is_hollow && is_aabb_inside_triangle(p0, p1, p2, tile_rounded))
+                to_be_added = false;
+
+            break;
+        }
+        case primitive_uneven_capsule :
+        {
+            float2 p0 = float2(data[0], data[1]);
+            float2 p1 = float2(data[2], data[3]);
+            float radius0 = data[4];
+            float radius1 = data[5];
+
+            aabb tile_smooth = aabb_grow(tile_enlarge_aabb, (is_hollow ? data[6] : 0.f));
+
+            // see binning.metal : bounding sphere of the tile against the sdf
+            to_be_added = sd_uneven_capsule(tile_center, p0, p1, radius0, radius1) < length(aabb_get_extents(tile_smooth) * .5f);
+            break;
+        }
+        case primitive_trapezoid:
+        {
+            float2 p0 = float2(data[0], data[1]);
+            float2 p1 = float2(data[2], data[3]);
+            float radius0 = data[4];
+            float radius1 = data[5];
+
+            aabb tile_rounded = aabb_grow(tile_enlarge_aabb, data[6]);
+            to_be_added = intersection_aabb_obb(tile_rounded, p0, p1, radius0, radius1);
+            break;
+        }
+        case combination_begin:
+        case combination_end:
+        case primitive_aabox :
+        case primitive_char : to_be_added = true; break;
+        default : to_be_added = false; break;
+    }
+
+    return to_be_added;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// returns true if the command is opaque and every pixel of the tile is fully inside the shape : the commands before it are
+// not visible in the tile. The command must be outside of a combination. Conservative, the rounding is ignored
+// ---------------------------------------------------------------------------------------------------------------------------
+static bool command_covers_tile(const draw_cmd_arguments* input, uint32_t i, uint16_t tile_x, uint16_t tile_y)
+{
+    const draw_command& cmd = input->commands[i];
+    if (primitive_get_fillmode(cmd.type) != fill_solid || cmd.op != op_add || (cmd.color.packed_data >> 24) != 0xff)
+        return false;
+
+    // the tile must be inside the clip rect
+    const clip_rect& clip = input->clips[cmd.clip_index];
+    uint32_t tile_pos_x = tile_x * TILE_SIZE;
+    uint32_t tile_pos_y = tile_y * TILE_SIZE;
+    if (tile_pos_x < clip.min_x || tile_pos_y < clip.min_y || tile_pos_x + TILE_SIZE > clip.max_x || tile_pos_y + TILE_SIZE > clip.max_y)
+        return false;
+
+    aabb tile_aabb = {.min = float2(tile_x, tile_y), .max = float2(tile_x + 1, tile_y + 1)};
+    tile_aabb.min *= TILE_SIZE; tile_aabb.max *= TILE_SIZE;
+
+    const float* data = &input->draw_data[cmd.data_index];
+    switch(primitive_get_type(cmd.type))
+    {
+        case primitive_oriented_box : return is_aabb_inside_obb(float2(data[0], data[1]), float2(data[2], data[3]), data[4], tile_aabb);
+        case primitive_ellipse : return is_aabb_inside_ellipse(float2(data[0], data[1]), float2(data[2], data[3]), data[4], tile_aabb);
+        case primitive_disc : return is_aabb_inside_disc(float2(data[0], data[1]), data[2], tile_aabb);
+        case primitive_triangle : return is_aabb_inside_triangle(float2(data[0], data[1]), float2(data[2], data[3]), float2(data[4], data[5]), tile_aabb);
+        case primitive_pie : return is_aabb_inside_pie(float2(data[0], data[1]), float2(data[3], data[4]), float2(data[5], data[6]), data[2], tile_aabb);
+        case primitive_aabox :
+            return tile_aabb.min.x >= data[0] && tile_aabb.min.y >= data[1] && tile_aabb.max.x <= data[2] && tile_aabb.max.y <= data[3];
+        default : return false;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// for each tile of the screen, we traverse the list of commands and if the command has an impact on the tile we add the
+// command to the linked list of the tile. command_list is a subset of the commands in submission order, nullptr for all
+// with occlusion culling, the traversal stops at the first command (the last submitted) covering the tile
+// ---------------------------------------------------------------------------------------------------------------------------
+static void bin_tile(const draw_cmd_arguments* input, const uint32_t* command_list, uint32_t num_commands, tiles_data* output,
+                     counters* counter, uint16_t tile_x, uint16_t tile_y)
+{
+    if (tile_x >= input->num_tile_width || tile_y >= input->num_tile_height)
+        return;
+
+    uint32_t tile_index = tile_y * input->num_tile_width + tile_x;
+    float smooth_border = 0.f;
+    bool combining = false;
+    bool draw_something = false;
+
+    // loop through draw commands in reverse order (because of the linked list)
+    for(uint32_t j=num_commands; j-- > 0; )
+    {
+        uint32_t i = (command_list != nullptr) ? command_list[j] : j;
+        if (!command_in_tile(input, i, tile_x, tile_y, smooth_border))
+            continue;
+
+        command_type type = primitive_get_type(input->commands[i].type);
+        if (type == combination_begin)
+        {
+            smooth_border = 0.f;
+            combining = false;
+        }
+        else if (type == combination_end)
+        {
+            smooth_border = input->draw_data[input->commands[i].data_index];    // we traverse in reverse order, so the end comes first
+            combining = true;
+        }
+
+        // allocate one node
+        uint32_t new_node_index = __atomic_fetch_add(&counter->num_nodes, 1, __ATOMIC_RELAXED);
+
+        // avoid access beyond the end of the buffer
+        if (new_node_index<input->max_nodes)
+        {
+            // insert in the linked list the new node
+            output->nodes[new_node_index] = output->head[tile_index];
+            output->head[tile_index].command_index = i;
+            output->head[tile_index].next = new_node_index;
+        }
+
+        if (type != combination_begin && type != combination_end)
+        {
+            draw_something = true;
+            if (input->occlusion_culling && !combining && command_covers_tile(input, i, tile_x, tile_y))
+                break;
+        }
+    }
+
+    // if the tile has some draw command to proceed
+    if (draw_something)
+    {
+        uint32_t pos = __atomic_fetch_add(&counter->num_tiles, 1, __ATOMIC_RELAXED);
+
+        // add tile index
+        output->tile_indices[pos] = tile_index;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_bin(const draw_cmd_arguments* input, tiles_data* output, counters* counter, uint16_t tile_x, uint16_t tile_y)
+{
+    bin_tile(input, nullptr, input->num_commands, output, counter, tile_x, tile_y);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// hierarchical binning
+// ---------------------------------------------------------------------------------------------------------------------------
+void cpu_bin_coarse(const draw_cmd_arguments* input, uint16_t super_x, uint16_t super_y, std::vector<uint32_t>* commands)
+{
+    commands->clear();
+
+    // range of tiles and pixels covered by the super-tile
+    uint32_t min_x = super_x * SUPER_TILE_SIZE, max_x = min_x + SUPER_TILE_SIZE - 1;
+    uint32_t min_y = super_y * SUPER_TILE_SIZE, max_y = min_y + SUPER_TILE_SIZE - 1;
+    uint32_t pos_min_x = min_x * TILE_SIZE, pos_max_x = (max_x + 1) * TILE_SIZE;
+    uint32_t pos_min_y = min_y * TILE_SIZE, pos_max_y = (max_y + 1) * TILE_SIZE;
+
+    // same tests as the beginning of command_in_tile, true if at least one tile of the super-tile passes them
+    for(uint32_t i=0; i<input->num_commands; ++i)
+    {
+        const wide_aabb cmd_aabb = cpu_command_aabb(input, i);
+        if (max_x < cmd_aabb.min_x || max_y < cmd_aabb.min_y || cmd_aabb.max_x < min_x || cmd_aabb.max_y < min_y)
+            continue;
+
+        const clip_rect& clip = input->clips[input->commands[i].clip_index];
+        if (pos_min_x > clip.max_x || pos_min_y > clip.max_y || pos_max_x < clip.min_x || pos_max_y < clip.min_y)
+            continue;
+
+        commands->push_back(i);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_bin_fine(const draw_cmd_arguments* input, const uint32_t* commands, uint32_t num_commands, tiles_data* output,
+                  counters* counter, uint16_t tile_x, uint16_t tile_y)
+{
+    bin_tile(input, commands, num_commands, output, counter, tile_x, tile_y);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// command-centric binning
+// ---------------------------------------------------------------------------------------------------------------------------
+void cpu_bin_smooth_borders(const draw_cmd_arguments* input, float* smooth_borders)
+{
+    // same value as the one found by cpu_bin when it reaches the combination_end, negative outside of combinations
+    float smooth_border = -1.f;
+    for(uint32_t i=0; i<input->num_commands; ++i)
+    {
+        const draw_command& cmd = input->commands[i];
+        command_type type = primitive_get_type(cmd.type);
+        if (type == combination_begin)
+            smooth_border = input->draw_data[cmd.data_index];
+
+        smooth_borders[i] = smooth_border;
+
+        if (type == combination_end)
+            smooth_border = -1.f;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_bin_command(const draw_cmd_arguments* input, uint32_t command_index, float smooth_border, std::vector<bin_hit>* hits)
+{
+    const wide_aabb cmd_aabb = cpu_command_aabb(input, command_index);
+    uint32_t max_x = min((uint32_t)cmd_aabb.max_x, (uint32_t)input->num_tile_width - 1);
+    uint32_t max_y = min((uint32_t)cmd_aabb.max_y, (uint32_t)input->num_tile_height - 1);
+    bool can_cover = input->occlusion_culling && smooth_border < 0.f;
+    smooth_border = max(smooth_border, 0.f);
+
+    for(uint32_t y=cmd_aabb.min_y; y<=max_y; ++y)
+        for(uint32_t x=cmd_aabb.min_x; x<=max_x; ++x)
+            if (command_in_tile(input, command_index, (uint16_t)x, (uint16_t)y, smooth_border))
+            {
+                bool covers = can_cover && command_covers_tile(input, command_index, (uint16_t)x, (uint16_t)y);
+                hits->push_back({.tile_index = y * input->num_tile_width + x, .covers_tile = covers, .command_index = command_index});
+            }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// a hit covering the tile restarts its list, tile_first is the first command kept for each tile
+static void reset_covered_tile(const bin_hit& hit, uint32_t* tile_counts, uint32_t* tile_first)
+{
+    if (hit.covers_tile)
+    {
+        tile_counts[hit.tile_index] = 0;
+        tile_first[hit.tile_index] = hit.command_index;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// count, prefix sum and scatter : the list of a tile is stored in consecutive nodes, in submission order
+void cpu_bin_resolve(const draw_cmd_arguments* input, const std::vector<bin_hit>* chunks, uint32_t num_chunks,
+                     uint32_t* tile_counts, tiles_data* output, counters* counter)
+{
+    const uint32_t draw_flag = 0x80000000;
+    const uint32_t num_tiles = input->num_tile_width * input->num_tile_height;
+    uint32_t* tile_first = tile_counts + num_tiles;
+    memset(tile_counts, 0, num_tiles * 2 * sizeof(uint32_t));
+
+    for(uint32_t c=0; c<num_chunks; ++c)
+        for(const bin_hit& hit : chunks[c])
+        {
+            command_type type = primitive_get_type(input->commands[hit.command_index].type);
+            reset_covered_tile(hit, tile_counts, tile_first);
+            tile_counts[hit.tile_index]++;
+            if (type != combination_begin && type != combination_end)
+                tile_counts[hit.tile_index] |= draw_flag;
+        }
+
+    // tile_counts becomes the write cursor of the tile, head.next the first node of the tile
+    uint32_t num_nodes = 0;
+    counter->num_tiles = 0;
+    for(uint32_t i=0; i<num_tiles; ++i)
+    {
+        uint32_t count = tile_counts[i] & ~draw_flag;
+        if (tile_counts[i] & draw_flag)
+            output->tile_indices[counter->num_tiles++] = i;
+
+        // like cpu_bin, lists that don't fit in the buffer are incomplete
+        if (count > 0 && num_nodes < input->max_nodes)
+            output->head[i].next = num_nodes;
+
+        tile_counts[i] = num_nodes;
+        num_nodes += count;
+    }
+    counter->num_nodes = num_nodes;
+
+    for(uint32_t c=0; c<num_chunks; ++c)
+        for(const bin_hit& hit : chunks[c])
+        {
+            if (hit.command_index < tile_first[hit.tile_index])
+                continue;
+
+            tile_node& head = output->head[hit.tile_index];
+            uint32_t position = tile_counts[hit.tile_index]++;
+            if (position >= input->max_nodes)
+                continue;
+
+            // the head holds the first command, each node holds the next one, the last node is the end of the list
+            if (position == head.next)
+                head.command_index = hit.command_index;
+            else
+                output->nodes[position-1].command_index = hit.command_index;
+
+            output->nodes[position] = {.command_index = INVALID_INDEX, .next = INVALID_INDEX};
+            if (position > head.next)
+                output->nodes[position-1].next = position;
+        }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// tile arrays
+// ---------------------------------------------------------------------------------------------------------------------------
+static_assert(MAX_COMMANDS <= (1 << (sizeof(tile_command) * 8)), "command indices don't fit in tile_command");
+
+// tile_offsets holds the count of each tile, turns it into offsets. Like the linked lists, the commands that don't fit in
+// the buffer are lost : the offsets are clamped to max_nodes
+static uint32_t prefix_sum(uint32_t* tile_offsets, uint32_t num_tiles, uint32_t max_nodes)
+{
+    uint32_t total = 0;
+    for(uint32_t i=0; i<num_tiles; ++i)
+    {
+        uint32_t count = tile_offsets[i];
+        tile_offsets[i] = min(total, max_nodes);
+        total += count;
+    }
+    tile_offsets[num_tiles] = min(total, max_nodes);
+    return total;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_bin_resolve_arrays(const draw_cmd_arguments* input, const std::vector<bin_hit>* chunks, uint32_t num_chunks,
+                            uint32_t* tile_counts, tile_arrays* output, counters* counter)
+{
+    const uint32_t num_tiles = input->num_tile_width * input->num_tile_height;
+    uint32_t* tile_first = tile_counts + num_tiles;
+    memset(output->tile_offsets, 0, num_tiles * sizeof(uint32_t));
+    memset(tile_counts, 0, num_tiles * 2 * sizeof(uint32_t));
+
+    // tile_counts only tells if the tile draws something
+    for(uint32_t c=0; c<num_chunks; ++c)
+        for(const bin_hit& hit : chunks[c])
+        {
+            command_type type = primitive_get_type(input->commands[hit.command_index].type);
+            reset_covered_tile(hit, output->tile_offsets, tile_first);
+            output->tile_offsets[hit.tile_index]++;
+            if (type != combination_begin && type != combination_end)
+                tile_counts[hit.tile_index] = 1;
+        }
+
+    counter->num_tiles = 0;
+    for(uint32_t i=0; i<num_tiles; ++i)
+        if (tile_counts[i])
+            output->tile_indices[counter->num_tiles++] = i;
+
+    counter->num_nodes = prefix_sum(output->tile_offsets, num_tiles, input->max_nodes);
+
+    // tile_counts becomes the write cursor of the tile
+    memcpy(tile_counts, output->tile_offsets, num_tiles * sizeof(uint32_t));
+    for(uint32_t c=0; c<num_chunks; ++c)
+        for(const bin_hit& hit : chunks[c])
+        {
+            if (hit.command_index < tile_first[hit.tile_index])
+                continue;
+
+            uint32_t position = tile_counts[hit.tile_index]++;
+            if (position < output->tile_offsets[hit.tile_index + 1])
+                output->commands[position] = (tile_command) hit.command_index;
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_bin_compact(const draw_cmd_arguments* input, const tiles_data* lists, tile_arrays* output)
+{
+    const uint32_t num_tiles = input->num_tile_width * input->num_tile_height;
+    for(uint32_t i=0; i<num_tiles; ++i)
+    {
+        uint32_t count = 0;
+        for(tile_node node = lists->head[i]; node.next != INVALID_INDEX; node = lists->nodes[node.next])
+            count++;
+        output->tile_offsets[i] = count;
+    }
+
+    prefix_sum(output->tile_offsets, num_tiles, input->max_nodes);
+
+    for(uint32_t i=0; i<num_tiles; ++i)
+    {
+        uint32_t position = output->tile_offsets[i];
+        for(tile_node node = lists->head[i]; node.next != INVALID_INDEX && position < output->tile_offsets[i+1]; node = lists->nodes[node.next])
+            output->commands[position++] = (tile_command) node.command_index;
+    }
+}
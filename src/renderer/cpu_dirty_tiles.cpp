@@ -0,0 +1,106 @@
+#include "cpu_kernels.h"
+#include "../system/hash.h"
+#include <string.h>
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_hash_commands(const draw_cmd_arguments* input, uint32_t num_draw_data, uint64_t* hashes)
+{
+    for(uint32_t i=0; i<input->num_commands; ++i)
+    {
+        const draw_command& cmd = input->commands[i];
+
+        // the data index is replaced by what the rasterizer reads through it, same for the clip index
+        struct
+        {
+            uint8_t type, op, custom_data, padding;
+            draw_color color;
+            clip_rect clip;
+            wide_aabb aabb;
+        } key = {cmd.type, cmd.op, cmd.custom_data, 0, cmd.color, input->clips[cmd.clip_index], cpu_command_aabb(input, i)};
+
+        uint32_t data_end = (i + 1 < input->num_commands) ? input->commands[i+1].data_index : num_draw_data;
+        uint32_t num_data = (data_end > cmd.data_index) ? data_end - cmd.data_index : 0;
+
+        uint64_t data_hash = hash_words_64(&input->draw_data[cmd.data_index], num_data * sizeof(float));
+        hashes[i] = hash_words_64(&key, sizeof(key)) ^ (data_hash * 0x9e3779b97f4a7c15ull);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+uint64_t cpu_hash_arguments(const draw_cmd_arguments* input)
+{
+    struct
+    {
+        float4 clear_color;
+        float2 screen_div;
+        float2 font_size;
+        float aa_width;
+        float outline_width;
+        draw_color outline_color;
+        uint16_t num_tile_width;
+        uint16_t num_tile_height;
+        uint32_t culling_debug;
+        uint32_t occlusion_culling;
+    } key;
+
+    memset(&key, 0, sizeof(key));
+    key.clear_color = input->clear_color;
+    key.screen_div = input->screen_div;
+    key.font_size = input->font_size;
+    key.aa_width = input->aa_width;
+    key.outline_width = input->outline_width;
+    key.outline_color = input->outline_color;
+    key.num_tile_width = input->num_tile_width;
+    key.num_tile_height = input->num_tile_height;
+    key.culling_debug = input->culling_debug;
+    key.occlusion_culling = input->occlusion_culling;
+    return hash_words_64(&key, sizeof(key));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static uint32_t mark_tiles(const draw_cmd_arguments* input, wide_aabb box, uint8_t* dirty, uint32_t* dirty_list, uint32_t count)
+{
+    // culled commands have an empty box, the compact format can go past the last tile
+    uint32_t max_x = (box.max_x < input->num_tile_width) ? box.max_x : input->num_tile_width - 1u;
+    uint32_t max_y = (box.max_y < input->num_tile_height) ? box.max_y : input->num_tile_height - 1u;
+
+    for(uint32_t y=box.min_y; y<=max_y; ++y)
+    {
+        for(uint32_t x=box.min_x; x<=max_x; ++x)
+        {
+            uint32_t tile_index = y * input->num_tile_width + x;
+            if (!dirty[tile_index])
+            {
+                dirty[tile_index] = 1;
+                dirty_list[count++] = tile_index;
+            }
+        }
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+uint32_t cpu_dirty_tiles(const draw_cmd_arguments* input, const uint64_t* hashes, const uint64_t* previous_hashes,
+                         const wide_aabb* previous_aabbs, uint32_t num_previous, uint8_t* dirty, uint32_t* dirty_list)
+{
+    const uint32_t num_commands = input->num_commands;
+    const uint32_t common = (num_commands < num_previous) ? num_commands : num_previous;
+
+    uint32_t prefix = 0;
+    while (prefix < common && hashes[prefix] == previous_hashes[prefix])
+        prefix++;
+
+    uint32_t suffix = 0;
+    while (suffix < common - prefix && hashes[num_commands - 1 - suffix] == previous_hashes[num_previous - 1 - suffix])
+        suffix++;
+
+    // a tile outside of every changed command sees the same prefix, nothing in between and the same suffix
+    uint32_t count = 0;
+    for(uint32_t i=prefix; i<num_previous - suffix; ++i)
+        count = mark_tiles(input, previous_aabbs[i], dirty, dirty_list, count);
+
+    for(uint32_t i=prefix; i<num_commands - suffix; ++i)
+        count = mark_tiles(input, cpu_command_aabb(input, i), dirty, dirty_list, count);
+
+    return count;
+}
@@ -0,0 +1,70 @@
+#include "cpu_kernels.h"
+
+//----------------------------------------------------------------------------------------------------------------------------
+uint32_t cpu_draw_data_points(uint8_t type)
+{
+    switch(primitive_get_type(type))
+    {
+    case primitive_char :
+    case primitive_disc :
+    case primitive_pie :
+    case primitive_ring : return 1;
+    case primitive_aabox :
+    case primitive_oriented_box :
+    case primitive_ellipse :
+    case primitive_uneven_capsule :
+    case primitive_trapezoid : return 2;
+    case primitive_triangle : return 3;
+    default : return 0;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// top-left corner of the command bounding box in pixels, culled commands have an empty box
+static inline float2 command_origin(const draw_cmd_arguments* input, uint32_t i)
+{
+    wide_aabb box = cpu_command_aabb(input, i);
+    if (box.min_x > box.max_x || box.min_y > box.max_y)
+        return float2(0.f, 0.f);
+
+    return float2(float(box.min_x * TILE_SIZE), float(box.min_y * TILE_SIZE));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_encode_draw_data(const draw_cmd_arguments* input, uint32_t num_draw_data, float16* output)
+{
+    const float* data = input->draw_data;
+    uint32_t first = (input->num_commands > 0) ? input->commands[0].data_index : num_draw_data;
+    for(uint32_t j=0; j<first; ++j)
+        output[j] = float_to_half(data[j]);
+
+    for(uint32_t i=0; i<input->num_commands; ++i)
+    {
+        const draw_command& cmd = input->commands[i];
+        uint32_t data_end = (i + 1 < input->num_commands) ? input->commands[i+1].data_index : num_draw_data;
+        uint32_t num_coordinates = cpu_draw_data_points(cmd.type) * 2;
+        float2 origin = command_origin(input, i);
+
+        for(uint32_t j=cmd.data_index, k=0; j<data_end; ++j, ++k)
+            output[j] = float_to_half((k < num_coordinates) ? data[j] - origin[k&1] : data[j]);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_decode_draw_data(const draw_cmd_arguments* input, uint32_t num_draw_data, const float16* data, float* output)
+{
+    uint32_t first = (input->num_commands > 0) ? input->commands[0].data_index : num_draw_data;
+    for(uint32_t j=0; j<first; ++j)
+        output[j] = half_to_float(data[j]);
+
+    for(uint32_t i=0; i<input->num_commands; ++i)
+    {
+        const draw_command& cmd = input->commands[i];
+        uint32_t data_end = (i + 1 < input->num_commands) ? input->commands[i+1].data_index : num_draw_data;
+        uint32_t num_coordinates = cpu_draw_data_points(cmd.type) * 2;
+        float2 origin = command_origin(input, i);
+
+        for(uint32_t j=cmd.data_index, k=0; j<data_end; ++j, ++k)
+            output[j] = (k < num_coordinates) ? half_to_float(data[j]) + origin[k&1] : half_to_float(data[j]);
+    }
+}
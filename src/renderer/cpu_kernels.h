@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "../shaders/common.h"
+#include "../system/float16.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// c++ ports of the metal kernels used by the cpu backend, both are thread safe as long as threads process different tiles
+
+// bounding box of the command in tiles, whatever the format used by the renderer
+static inline wide_aabb cpu_command_aabb(const draw_cmd_arguments* input, uint32_t i)
+{
+    if (input->commands_wide_aabb != nullptr)
+        return input->commands_wide_aabb[i];
+
+    const quantized_aabb& box = input->commands_aabb[i];
+    return (wide_aabb) {.min_x = box.min_x, .min_y = box.min_y, .max_x = box.max_x, .max_y = box.max_y};
+}
+
+// port of the bin kernel (binning.metal) for one tile, counters must be cleared and head filled with INVALID_INDEX before
+void cpu_bin(const draw_cmd_arguments* input, tiles_data* output, counters* counter, uint16_t tile_x, uint16_t tile_y);
+
+// hierarchical alternative to cpu_bin : a coarse pass keeps the commands whose bounding box and clip rect touch a super-tile,
+// then each tile runs the exact tests of cpu_bin only on the list of its super-tile. Gives the same lists as cpu_bin
+#define SUPER_TILE_SIZE (8)     // in tiles
+
+// commands touching the super-tile in submission order, thread safe as long as threads use different arrays
+void cpu_bin_coarse(const draw_cmd_arguments* input, uint16_t super_x, uint16_t super_y, std::vector<uint32_t>* commands);
+
+// same as cpu_bin but only the commands of the tile's super-tile are tested
+void cpu_bin_fine(const draw_cmd_arguments* input, const uint32_t* commands, uint32_t num_commands, tiles_data* output,
+                  counters* counter, uint16_t tile_x, uint16_t tile_y);
+
+// command-centric alternative to cpu_bin (scatter) : each command walks the tiles of its bounding box, then the hits are
+// sorted per tile. Gives the same lists as cpu_bin but the nodes of a tile are consecutive
+struct bin_hit
+{
+    uint32_t tile_index : 31;
+    uint32_t covers_tile : 1;       // occlusion culling : the commands before this one are hidden in the tile
+    uint32_t command_index;
+};
+
+// smooth value of the combination containing each command (negative outside of combinations), computed once per frame
+void cpu_bin_smooth_borders(const draw_cmd_arguments* input, float* smooth_borders);
+
+// appends a hit for each tile touched by the command, thread safe as long as threads use different hits arrays
+void cpu_bin_command(const draw_cmd_arguments* input, uint32_t command_index, float smooth_border, std::vector<bin_hit>* hits);
+
+// builds the lists from the hits, the chunks are in submission order and so are the hits of a chunk
+// head must be filled with INVALID_INDEX before, tile_counts is a scratch buffer of num_tiles * 2 elements
+void cpu_bin_resolve(const draw_cmd_arguments* input, const std::vector<bin_hit>* chunks, uint32_t num_chunks,
+                     uint32_t* tile_counts, tiles_data* output, counters* counter);
+
+// compact alternative to the linked lists of tiles_data : the commands of a tile are contiguous and in submission order
+typedef uint16_t tile_command;      // MAX_COMMANDS indices fit on 16 bits, bigger frames use the linked lists
+
+struct tile_arrays
+{
+    uint32_t* tile_offsets;         // num_tiles + 1 elements, commands of tile i are [tile_offsets[i], tile_offsets[i+1])
+    tile_command* commands;         // max_nodes elements
+    uint32_t* tile_indices;         // tiles with something to draw
+};
+
+// same as cpu_bin_resolve but builds tile_arrays, tile_counts is a scratch buffer of num_tiles * 2 elements
+void cpu_bin_resolve_arrays(const draw_cmd_arguments* input, const std::vector<bin_hit>* chunks, uint32_t num_chunks,
+                            uint32_t* tile_counts, tile_arrays* output, counters* counter);
+
+// converts the linked lists built by cpu_bin or cpu_bin_fine, tile_indices is not modified
+void cpu_bin_compact(const draw_cmd_arguments* input, const tiles_data* lists, tile_arrays* output);
+
+// port of the tile_fs fragment shader (rasterizer.metal) for one tile, output is RGBA8 sRGB
+// font is the BC4 font decoded to one byte per texel
+void cpu_rasterize(const draw_cmd_arguments* input, const tiles_data* tiles, const uint8_t* font, uint32_t tile_index,
+                   uint32_t* framebuffer, uint32_t width, uint32_t height);
+
+// same as cpu_rasterize with tile_arrays
+void cpu_rasterize_arrays(const draw_cmd_arguments* input, const tile_arrays* tiles, const uint8_t* font, uint32_t tile_index,
+                          uint32_t* framebuffer, uint32_t width, uint32_t height);
+
+// clear color converted to RGBA8 sRGB
+uint32_t cpu_pack_color(float4 color);
+
+// instrumentation of the list of a tile (see renderer_heatmap_metric), the evaluations are counted on the pixels the
+// rasterizer would evaluate
+struct tile_cost
+{
+    uint32_t commands;
+    uint32_t combinations;
+    uint32_t evaluations;
+};
+
+tile_cost cpu_tile_cost(const draw_cmd_arguments* input, const tiles_data* tiles, uint32_t tile_index, uint32_t width, uint32_t height);
+tile_cost cpu_tile_cost_arrays(const draw_cmd_arguments* input, const tile_arrays* tiles, uint32_t tile_index, uint32_t width,
+                               uint32_t height);
+
+// incremental rendering : a tile keeps its pixels from the previous frame if the ordered list of commands touching it did not
+// change. The commands are hashed (content, clip rect and aabb, not the position of their draw data), the longest common
+// prefix and suffix of the two frames are unchanged and the tiles touched by the commands in between (old and new) are dirty
+
+// hash of each command, num_draw_data is the size of the draw data buffer (the data of a command ends where the next starts)
+void cpu_hash_commands(const draw_cmd_arguments* input, uint32_t num_draw_data, uint64_t* hashes);
+
+// hash of the arguments that change every tile (clear color, aa width, outline, resolution...)
+uint64_t cpu_hash_arguments(const draw_cmd_arguments* input);
+
+// marks the dirty tiles (dirty has one byte per tile, cleared before) and appends them to dirty_list, returns their count
+uint32_t cpu_dirty_tiles(const draw_cmd_arguments* input, const uint64_t* hashes, const uint64_t* previous_hashes,
+                         const wide_aabb* previous_aabbs, uint32_t num_previous, uint8_t* dirty, uint32_t* dirty_list);
+
+// compact draw data (see renderer_set_draw_data_format) : every float becomes a half, the points of a command are stored
+// relative to the top-left corner of its bounding box so their precision depends on the size of the box, not on the screen
+// position. Sizes are plain halves, both lose the sub-pixel precision on big shapes.
+// num_draw_data is the size of the draw data buffer (the data of a command ends where the next starts)
+void cpu_encode_draw_data(const draw_cmd_arguments* input, uint32_t num_draw_data, float16* output);
+void cpu_decode_draw_data(const draw_cmd_arguments* input, uint32_t num_draw_data, const float16* data, float* output);
+
+// number of points (x, y pairs) at the beginning of the draw data of a command, the values after are sizes, directions
+// or angles
+uint32_t cpu_draw_data_points(uint8_t type);
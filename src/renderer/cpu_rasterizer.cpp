@@ -0,0 +1,411 @@
+#include "cpu_kernels.h"
+#include "cpu_tile_kernels.h"
+#include "cpu_shaders.h"
+#include "../shaders/font.h"
+
+#define LARGE_DISTANCE (100000000.f)
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// color helpers (half4 on the gpu)
+// ---------------------------------------------------------------------------------------------------------------------------
+struct color_tables
+{
+    float srgb_to_linear[256];
+    uint8_t linear_to_srgb[4096];
+
+    color_tables()
+    {
+        for(uint32_t i=0; i<256; ++i)
+        {
+            float c = float(i) / 255.f;
+            srgb_to_linear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for(uint32_t i=0; i<4096; ++i)
+        {
+            float c = float(i) / 4095.f;
+            c = (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.f / 2.4f) - 0.055f;
+            linear_to_srgb[i] = uint8_t(c * 255.f + .5f);
+        }
+    }
+};
+
+static const color_tables& get_color_tables()
+{
+    static color_tables tables;
+    return tables;
+}
+
+static inline float4 mix(float4 a, float4 b, float t)
+{
+    return float4(mix(a.x, b.x, t), mix(a.y, b.y, t), mix(a.z, b.z, t), mix(a.w, b.w, t));
+}
+
+// same as unpack_unorm4x8_srgb_to_half
+static inline float4 unpack_srgb(const color_tables& tables, uint32_t packed)
+{
+    return float4(tables.srgb_to_linear[packed&0xff], tables.srgb_to_linear[(packed>>8)&0xff],
+                  tables.srgb_to_linear[(packed>>16)&0xff], float(packed>>24) / 255.f);
+}
+
+// same as unpack_unorm4x8_to_half
+static inline float4 unpack_unorm(uint32_t packed)
+{
+    return float4(float(packed&0xff) / 255.f, float((packed>>8)&0xff) / 255.f,
+                  float((packed>>16)&0xff) / 255.f, float(packed>>24) / 255.f);
+}
+
+static inline uint32_t pack_srgb(const color_tables& tables, float4 color)
+{
+    uint32_t r = tables.linear_to_srgb[uint32_t(saturate(color.x) * 4095.f + .5f)];
+    uint32_t g = tables.linear_to_srgb[uint32_t(saturate(color.y) * 4095.f + .5f)];
+    uint32_t b = tables.linear_to_srgb[uint32_t(saturate(color.z) * 4095.f + .5f)];
+    uint32_t a = uint32_t(saturate(color.w) * 255.f + .5f);
+    return (a<<24) | (b<<16) | (g<<8) | r;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// bilinear filtering, address::clamp_to_zero
+static float sample_font(const uint8_t* font, float2 uv)
+{
+    float x = uv.x * FONT_TEXTURE_WIDTH - .5f;
+    float y = uv.y * FONT_TEXTURE_HEIGHT - .5f;
+    float x0 = floorf(x);
+    float y0 = floorf(y);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    float texels[4];
+    for(int i=0; i<4; ++i)
+    {
+        int tx = int(x0) + (i&1);
+        int ty = int(y0) + (i>>1);
+        bool inside = (tx >= 0 && ty >= 0 && tx < FONT_TEXTURE_WIDTH && ty < FONT_TEXTURE_HEIGHT);
+        texels[i] = inside ? float(font[ty * FONT_TEXTURE_WIDTH + tx]) / 255.f : 0.f;
+    }
+
+    return mix(mix(texels[0], texels[1], fx), mix(texels[2], texels[3], fx), fy);
+}
+
+static inline int int_min(int a, int b) {return (a<b) ? a : b;}
+static inline int int_max(int a, int b) {return (a>b) ? a : b;}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// the font is sampled per pixel, everything else goes through the simd kernels
+static void evaluate_char(const draw_cmd_arguments* input, const draw_command& cmd, const uint8_t* font,
+                          const pixel_range& range, float2 tile_origin, float* distances)
+{
+    float2 top_left = float2(input->draw_data[cmd.data_index], input->draw_data[cmd.data_index+1]);
+    float2 font_size = input->font_size;
+    float aa_width = input->aa_width;
+    float2 char_uv = float2(float(FONT_CHAR_WIDTH) / float(FONT_TEXTURE_WIDTH), float(FONT_CHAR_HEIGHT) / float(FONT_TEXTURE_HEIGHT));
+    float2 char_offset = float2(float(cmd.custom_data%12), float(cmd.custom_data/12)) * char_uv;
+
+    for(int y=range.min_y; y<range.max_y; ++y)
+        for(int x=range.min_x; x<range.max_x; ++x)
+        {
+            float2 uv = (tile_origin + float2(x + .5f, y + .5f) - top_left) / font_size;
+            if (!all(uv >= 0.f) || !all(uv <= 1.f))
+            {
+                distances[y * TILE_SIZE + x] = 10.f;
+                continue;
+            }
+
+            uv = float2(.1f, .1f) + float2(0.8f, 0.85f) * uv;
+            uv = uv * char_uv + char_offset;
+            distances[y * TILE_SIZE + x] = (1.f - sample_font(font, uv)) * aa_width;
+        }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void evaluate_distances(const draw_cmd_arguments* input, const draw_command& cmd, const uint8_t* font,
+                               const cpu_tile_kernels* kernels, const pixel_range& range, float2 tile_origin, float* distances)
+{
+    command_type type = primitive_get_type(cmd.type);
+    if (type == primitive_char)
+        evaluate_char(input, cmd, font, range, tile_origin, distances);
+    else if (!kernels->distances(cmd.type, &input->draw_data[cmd.data_index], &range, tile_origin, distances))
+    {
+        for(int y=range.min_y; y<range.max_y; ++y)
+            for(int x=range.min_x; x<range.max_x; ++x)
+                distances[y * TILE_SIZE + x] = 10.f;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// state of the combination, the output color is in tile_colors
+struct pixel_state
+{
+    float4 previous_color;
+    float previous_distance;
+    float combination_smoothness;
+    bool combining;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// command list of a tile, one per tile format
+struct node_list
+{
+    const tiles_data* tiles;
+    tile_node node;
+
+    node_list(const tiles_data* t, uint32_t tile_index) : tiles(t), node(t->head[tile_index]) {}
+    bool valid() const {return node.next != INVALID_INDEX;}
+    uint32_t command_index() const {return node.command_index;}
+    void next() {node = tiles->nodes[node.next];}
+};
+
+struct array_list
+{
+    const tile_command* current;
+    const tile_command* end;
+
+    array_list(const tile_arrays* t, uint32_t tile_index) : current(&t->commands[t->tile_offsets[tile_index]]),
+                                                             end(&t->commands[t->tile_offsets[tile_index+1]]) {}
+    bool valid() const {return current != end;}
+    uint32_t command_index() const {return *current;}
+    void next() {current++;}
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// same as tile_fs but the list is traversed once per tile, each command being evaluated on all pixels of the tile
+// ---------------------------------------------------------------------------------------------------------------------------
+template<typename command_list>
+static void rasterize(const draw_cmd_arguments* input, command_list list, const uint8_t* font, uint32_t tile_index,
+                      uint32_t* framebuffer, uint32_t width, uint32_t height)
+{
+    const color_tables& tables = get_color_tables();
+    const cpu_tile_kernels* kernels = cpu_get_tile_kernels();
+
+    int tile_x = (tile_index % input->num_tile_width) * TILE_SIZE;
+    int tile_y = (tile_index / input->num_tile_width) * TILE_SIZE;
+    int tile_width = int_min(TILE_SIZE, (int)width - tile_x);
+    int tile_height = int_min(TILE_SIZE, (int)height - tile_y);
+    float2 tile_origin = float2((float)tile_x, (float)tile_y);
+
+    pixel_state pixels[TILE_SIZE * TILE_SIZE];
+    tile_colors colors;
+    alignas(64) float distances[TILE_SIZE * TILE_SIZE];
+
+    float4 background = input->culling_debug ? float4(0.f, 0.f, 1.f, 1.f) : input->clear_color;
+    for(uint32_t i=0; i<TILE_SIZE * TILE_SIZE; ++i)
+    {
+        colors.red[i] = background.x;
+        colors.green[i] = background.y;
+        colors.blue[i] = background.z;
+        pixels[i].combining = false;
+    }
+
+    float4 outline_color = unpack_unorm(input->outline_color.packed_data);
+    float aa_width = input->aa_width;
+    float outline_full = -input->outline_width;
+    float outline_start = outline_full - aa_width;
+
+    // true if at least one pixel is inside a combination, otherwise the blend can be done by the simd kernel
+    bool any_combining = false;
+
+    for(; list.valid(); list.next())
+    {
+        const draw_command& cmd = input->commands[list.command_index()];
+        const clip_rect& clip = input->clips[cmd.clip_index];
+
+        // pixel center inside the clip rect
+        pixel_range range;
+        range.min_x = int_max(0, (int)clip.min_x - tile_x);
+        range.min_y = int_max(0, (int)clip.min_y - tile_y);
+        range.max_x = int_min(tile_width, (int)clip.max_x - tile_x);
+        range.max_y = int_min(tile_height, (int)clip.max_y - tile_y);
+
+        if (range.min_x < range.max_x && range.min_y < range.max_y)
+        {
+            command_type type = primitive_get_type(cmd.type);
+            const primitive_fillmode fillmode = primitive_get_fillmode(cmd.type);
+            if (type == combination_begin)
+            {
+                float smoothness = input->draw_data[cmd.data_index];
+                for(int y=range.min_y; y<range.max_y; ++y)
+                    for(int x=range.min_x; x<range.max_x; ++x)
+                    {
+                        pixel_state& pixel = pixels[y * TILE_SIZE + x];
+                        pixel.previous_color = float4(0.f, 0.f, 0.f, 0.f);
+                        pixel.previous_distance = LARGE_DISTANCE;
+                        pixel.combination_smoothness = smoothness;
+                        pixel.combining = true;
+                    }
+                any_combining = true;
+            }
+            else if (!any_combining && type != combination_end && fillmode != fill_outline)
+            {
+                evaluate_distances(input, cmd, font, kernels, range, tile_origin, distances);
+                kernels->blend(distances, unpack_srgb(tables, cmd.color.packed_data), aa_width, &range, &colors);
+            }
+            else
+            {
+                const float4 cmd_color = unpack_srgb(tables, cmd.color.packed_data);
+
+                if (type != combination_end)
+                    evaluate_distances(input, cmd, font, kernels, range, tile_origin, distances);
+
+                for(int y=range.min_y; y<range.max_y; ++y)
+                    for(int x=range.min_x; x<range.max_x; ++x)
+                    {
+                        const int index = y * TILE_SIZE + x;
+                        pixel_state& pixel = pixels[index];
+                        float distance;
+                        float4 color;
+
+                        if (type == combination_end)
+                        {
+                            pixel.combining = false;
+                            color = pixel.previous_color;
+                            distance = pixel.previous_distance;
+                        }
+                        else
+                        {
+                            distance = distances[index];
+                            color = cmd_color;
+
+                            if (fillmode == fill_outline && distance >= outline_start)
+                            {
+                                if (distance >= outline_full && distance <= aa_width)
+                                    color = float4(outline_color.x, outline_color.y, outline_color.z, color.w);
+                                else if (distance < outline_full)
+                                {
+                                    float t = linearstep(outline_full, outline_start, distance);
+                                    color = float4(mix(outline_color.x, color.x, t), mix(outline_color.y, color.y, t), mix(outline_color.z, color.z, t), color.w);
+                                }
+                            }
+                        }
+
+                        // blend distance / color and skip writing output
+                        if (pixel.combining)
+                        {
+                            float smooth_factor = (cmd.op == op_union) ? pixel.combination_smoothness : aa_width;
+                            switch(cmd.op)
+                            {
+                            case op_add :
+                            case op_union :
+                            {
+                                float2 smooth = smooth_minimum(distance, pixel.previous_distance, smooth_factor);
+                                pixel.previous_distance = smooth.x;
+                                pixel.previous_color = mix(color, pixel.previous_color, smooth.y);
+                                break;
+                            }
+                            case op_subtraction :
+                            {
+                                pixel.previous_distance = smooth_substraction(pixel.previous_distance, distance, smooth_factor);
+                                break;
+                            }
+                            case op_intersection :
+                            {
+                                pixel.previous_distance = smooth_intersection(pixel.previous_distance, distance, smooth_factor);
+                                break;
+                            }
+                            }
+                        }
+                        else
+                        {
+                            float alpha_factor;
+                            if (fillmode == fill_outline && type == combination_end)
+                            {
+                                float t = (distance > aa_width) ? 0.f : linearstep(aa_width, 0.f, distance);
+                                color = float4(mix(outline_color.x, color.x, t), mix(outline_color.y, color.y, t), mix(outline_color.z, color.z, t), color.w);
+                                alpha_factor = linearstep(aa_width*2+input->outline_width, aa_width+input->outline_width, distance);
+                            }
+                            else
+                                alpha_factor = linearstep(aa_width, 0.f, distance);    // anti-aliasing
+
+                            color.w *= alpha_factor;
+                            colors.red[index] = mix(colors.red[index], color.x, color.w);
+                            colors.green[index] = mix(colors.green[index], color.y, color.w);
+                            colors.blue[index] = mix(colors.blue[index], color.z, color.w);
+                        }
+                    }
+
+                if (type == combination_end)
+                {
+                    any_combining = false;
+                    for(uint32_t i=0; i<TILE_SIZE * TILE_SIZE && !any_combining; ++i)
+                        any_combining = pixels[i].combining;
+                }
+            }
+        }
+    }
+
+    for(int y=0; y<tile_height; ++y)
+    {
+        uint32_t* row = &framebuffer[(tile_y + y) * width + tile_x];
+        for(int x=0; x<tile_width; ++x)
+        {
+            const int index = y * TILE_SIZE + x;
+            row[x] = pack_srgb(tables, float4(colors.red[index], colors.green[index], colors.blue[index], 1.f));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_rasterize(const draw_cmd_arguments* input, const tiles_data* tiles, const uint8_t* font, uint32_t tile_index,
+                   uint32_t* framebuffer, uint32_t width, uint32_t height)
+{
+    rasterize(input, node_list(tiles, tile_index), font, tile_index, framebuffer, width, height);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void cpu_rasterize_arrays(const draw_cmd_arguments* input, const tile_arrays* tiles, const uint8_t* font, uint32_t tile_index,
+                          uint32_t* framebuffer, uint32_t width, uint32_t height)
+{
+    rasterize(input, array_list(tiles, tile_index), font, tile_index, framebuffer, width, height);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// same traversal and pixel range as rasterize, without evaluating anything
+// ---------------------------------------------------------------------------------------------------------------------------
+template<typename command_list>
+static tile_cost measure(const draw_cmd_arguments* input, command_list list, uint32_t tile_index, uint32_t width, uint32_t height)
+{
+    tile_cost cost = {0, 0, 0};
+
+    int tile_x = (tile_index % input->num_tile_width) * TILE_SIZE;
+    int tile_y = (tile_index / input->num_tile_width) * TILE_SIZE;
+    int tile_width = int_min(TILE_SIZE, (int)width - tile_x);
+    int tile_height = int_min(TILE_SIZE, (int)height - tile_y);
+
+    for(; list.valid(); list.next())
+    {
+        const draw_command& cmd = input->commands[list.command_index()];
+        command_type type = primitive_get_type(cmd.type);
+        cost.commands++;
+
+        if (type == combination_begin)
+            cost.combinations++;
+
+        if (type == combination_begin || type == combination_end)
+            continue;
+
+        const clip_rect& clip = input->clips[cmd.clip_index];
+        int range_width = int_min(tile_width, (int)clip.max_x - tile_x) - int_max(0, (int)clip.min_x - tile_x);
+        int range_height = int_min(tile_height, (int)clip.max_y - tile_y) - int_max(0, (int)clip.min_y - tile_y);
+        if (range_width > 0 && range_height > 0)
+            cost.evaluations += range_width * range_height;
+    }
+    return cost;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+tile_cost cpu_tile_cost(const draw_cmd_arguments* input, const tiles_data* tiles, uint32_t tile_index, uint32_t width, uint32_t height)
+{
+    return measure(input, node_list(tiles, tile_index), tile_index, width, height);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+tile_cost cpu_tile_cost_arrays(const draw_cmd_arguments* input, const tile_arrays* tiles, uint32_t tile_index, uint32_t width,
+                               uint32_t height)
+{
+    return measure(input, array_list(tiles, tile_index), tile_index, width, height);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+uint32_t cpu_pack_color(float4 color)
+{
+    return pack_srgb(get_color_tables(), color);
+}
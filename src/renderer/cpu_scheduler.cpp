@@ -0,0 +1,201 @@
+#include "cpu_scheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// range of items [begin, end[ packed in 64 bits so the owner and the thieves can update it with one compare and swap
+struct alignas(64) worker_queue
+{
+    std::atomic<uint64_t> m_Range {0};
+};
+
+struct cpu_scheduler
+{
+    uint32_t m_NumThreads {1};
+    worker_queue* m_pQueues {nullptr};
+    std::thread* m_pThreads {nullptr};
+
+    // current job
+    cpu_task m_Task {nullptr};
+    void* m_pUserData {nullptr};
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeUp;
+    uint64_t m_Generation {0};
+    bool m_Quit {false};
+    std::atomic<uint32_t> m_NumFinished {0};
+    std::atomic<uint64_t> m_NumSteals {0};
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline uint64_t range_pack(uint32_t begin, uint32_t end) {return ((uint64_t)begin << 32) | end;}
+static inline uint32_t range_begin(uint64_t range) {return (uint32_t)(range >> 32);}
+static inline uint32_t range_end(uint64_t range) {return (uint32_t)range;}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool pop_front(worker_queue* queue, uint32_t* item)
+{
+    uint64_t range = queue->m_Range.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        uint32_t begin = range_begin(range), end = range_end(range);
+        if (begin >= end)
+            return false;
+
+        if (queue->m_Range.compare_exchange_weak(range, range_pack(begin + 1, end), std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            *item = begin;
+            return true;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// takes the back half of the victim's range, returns the first stolen item and puts the rest in the thief's queue
+static bool steal_back(worker_queue* victim, worker_queue* thief, uint32_t* item)
+{
+    uint64_t range = victim->m_Range.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        uint32_t begin = range_begin(range), end = range_end(range);
+        if (begin >= end)
+            return false;
+
+        uint32_t split = end - (end - begin + 1) / 2;
+        if (victim->m_Range.compare_exchange_weak(range, range_pack(begin, split), std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            // thief's queue is empty so nobody else modifies it
+            thief->m_Range.store(range_pack(split + 1, end), std::memory_order_release);
+            *item = split;
+            return true;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void execute(cpu_scheduler* s, uint32_t worker_index)
+{
+    worker_queue* own = &s->m_pQueues[worker_index];
+    uint32_t item;
+
+    for(;;)
+    {
+        while (pop_front(own, &item))
+            s->m_Task(s->m_pUserData, item);
+
+        // out of work, look for a victim starting with the next worker
+        bool stolen = false;
+        for(uint32_t i=1; i<s->m_NumThreads && !stolen; ++i)
+            stolen = steal_back(&s->m_pQueues[(worker_index + i) % s->m_NumThreads], own, &item);
+
+        if (!stolen)
+            return;
+
+        s->m_NumSteals.fetch_add(1, std::memory_order_relaxed);
+        s->m_Task(s->m_pUserData, item);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void worker_loop(cpu_scheduler* s, uint32_t worker_index)
+{
+    uint64_t generation = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(s->m_Mutex);
+            s->m_WakeUp.wait(lock, [&]{return s->m_Quit || s->m_Generation != generation;});
+            if (s->m_Quit)
+                return;
+            generation = s->m_Generation;
+        }
+
+        execute(s, worker_index);
+        s->m_NumFinished.fetch_add(1, std::memory_order_release);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+struct cpu_scheduler* scheduler_init(uint32_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+
+    cpu_scheduler* s = new cpu_scheduler;
+    s->m_NumThreads = (num_threads > 0) ? num_threads : 1;
+    s->m_pQueues = new worker_queue[s->m_NumThreads];
+    s->m_pThreads = new std::thread[s->m_NumThreads];
+
+    // worker 0 is the calling thread
+    for(uint32_t i=1; i<s->m_NumThreads; ++i)
+        s->m_pThreads[i] = std::thread(worker_loop, s, i);
+
+    return s;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+uint32_t scheduler_get_num_threads(struct cpu_scheduler* s)
+{
+    return s->m_NumThreads;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void scheduler_run(struct cpu_scheduler* s, uint32_t num_items, cpu_task task, void* user_data)
+{
+    if (s->m_NumThreads == 1 || num_items < s->m_NumThreads)
+    {
+        for(uint32_t i=0; i<num_items; ++i)
+            task(user_data, i);
+        return;
+    }
+
+    // contiguous chunks, stealing will take care of the imbalance
+    for(uint32_t i=0; i<s->m_NumThreads; ++i)
+    {
+        uint32_t begin = (uint32_t)(((uint64_t)num_items * i) / s->m_NumThreads);
+        uint32_t end = (uint32_t)(((uint64_t)num_items * (i+1)) / s->m_NumThreads);
+        s->m_pQueues[i].m_Range.store(range_pack(begin, end), std::memory_order_relaxed);
+    }
+
+    s->m_Task = task;
+    s->m_pUserData = user_data;
+    s->m_NumFinished.store(0, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(s->m_Mutex);
+        s->m_Generation++;
+    }
+    s->m_WakeUp.notify_all();
+
+    execute(s, 0);
+
+    // a worker only finishes when all queues are empty and its own item is done, so when every worker is done the job is
+    // complete and nobody is touching the queues anymore
+    while (s->m_NumFinished.load(std::memory_order_acquire) < s->m_NumThreads - 1)
+        std::this_thread::yield();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+uint64_t scheduler_get_steals(struct cpu_scheduler* s)
+{
+    return s->m_NumSteals.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void scheduler_terminate(struct cpu_scheduler* s)
+{
+    {
+        std::lock_guard<std::mutex> lock(s->m_Mutex);
+        s->m_Quit = true;
+    }
+    s->m_WakeUp.notify_all();
+
+    for(uint32_t i=1; i<s->m_NumThreads; ++i)
+        s->m_pThreads[i].join();
+
+    delete[] s->m_pThreads;
+    delete[] s->m_pQueues;
+    delete s;
+}
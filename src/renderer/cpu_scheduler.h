@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// fork-join scheduler used by the cpu backend to spread tiles over the cores
+//  * persistent worker threads, the calling thread participates as worker 0
+//  * each worker owns a contiguous range of items and pops from the front (keeps tiles of a row on the same core)
+//  * an idle worker steals the back half of the range of another worker
+
+struct cpu_scheduler;
+
+typedef void (*cpu_task)(void* user_data, uint32_t item_index);
+
+// num_threads includes the calling thread, 0 means one thread per core
+struct cpu_scheduler* scheduler_init(uint32_t num_threads);
+uint32_t scheduler_get_num_threads(struct cpu_scheduler* s);
+
+// calls task for each item in [0, num_items[ and returns when all items are processed
+void scheduler_run(struct cpu_scheduler* s, uint32_t num_items, cpu_task task, void* user_data);
+
+// number of successful steals since init
+uint64_t scheduler_get_steals(struct cpu_scheduler* s);
+void scheduler_terminate(struct cpu_scheduler* s);
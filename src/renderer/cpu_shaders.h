@@ -0,0 +1,15 @@
+#pragma once
+
+// includes the metal shader headers as c++, in an anonymous namespace to avoid clashing with system/aabb.h
+#include "../shaders/cpu_compat.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+namespace
+{
+#include "../shaders/collision.h"
+#include "../shaders/sdf.h"
+#include "../shaders/operators.h"
+}
+#pragma GCC diagnostic pop
@@ -0,0 +1,194 @@
+#include "cpu_tile_kernels.h"
+#include "cpu_shaders.h"
+#include "../shaders/cpu_simd.h"
+
+// kernels compiled with the default flags of the target
+namespace SIMD_NAMESPACE {const struct cpu_tile_kernels* get_tile_kernels(void);}
+
+#ifdef TOODEE_AVX2
+namespace simd_avx2 {const struct cpu_tile_kernels* get_tile_kernels(void);}
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// scalar reference : one pixel at a time, same code as tile_fs
+// ---------------------------------------------------------------------------------------------------------------------------
+template<typename F>
+static inline void evaluate(const pixel_range* range, float2 tile_origin, float* distances, F sdf)
+{
+    for(int y=range->min_y; y<range->max_y; ++y)
+        for(int x=range->min_x; x<range->max_x; ++x)
+            distances[y * TILE_SIZE + x] = sdf(tile_origin + float2(x + .5f, y + .5f));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+static bool scalar_distances(uint8_t packed_type, const float* data, const pixel_range* range, float2 tile_origin, float* distances)
+{
+    const bool hollow = (primitive_get_fillmode(packed_type) == fill_hollow);
+
+    switch(primitive_get_type(packed_type))
+    {
+    case primitive_disc :
+    {
+        float2 center = float2(data[0], data[1]);
+        float radius = data[2];
+        float thickness = hollow ? data[3] : 0.f;
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_disc(pos, center, radius);
+            return hollow ? fabsf(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_oriented_box :
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float width = data[4];
+        float roundness = data[5];
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_oriented_box(pos, p0, p1, width);
+            return (hollow ? fabsf(distance) : distance) - roundness;
+        });
+        return true;
+    }
+    case primitive_ellipse :
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float width = data[4];
+        float thickness = hollow ? data[5] : 0.f;
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_oriented_ellipse(pos, p0, p1, width);
+            return hollow ? fabsf(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_aabox:
+    {
+        float2 box_min = float2(data[0], data[1]);
+        float2 box_max = float2(data[2], data[3]);
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            return (all(pos >= box_min) && all(pos <= box_max)) ? 0.f : 10.f;
+        });
+        return true;
+    }
+    case primitive_triangle:
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float2 p2 = float2(data[4], data[5]);
+        float roundness = data[6];
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_triangle(pos, p0, p1, p2);
+            return (hollow ? fabsf(distance) : distance) - roundness;
+        });
+        return true;
+    }
+    case primitive_pie:
+    {
+        float2 center = float2(data[0], data[1]);
+        float radius = data[2];
+        float2 direction = float2(data[3], data[4]);
+        float2 aperture = float2(data[5], data[6]);
+        float thickness = hollow ? data[7] : 0.f;
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_oriented_pie(pos, center, direction, aperture, radius);
+            return hollow ? fabsf(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_ring:
+    {
+        float2 center = float2(data[0], data[1]);
+        float radius = data[2];
+        float2 direction = float2(data[3], data[4]);
+        float2 aperture = float2(data[5], data[6]);
+        float thickness = data[7];
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_oriented_ring(pos, center, direction, aperture, radius, thickness);
+            return hollow ? fabsf(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_uneven_capsule:
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float radius0 = data[4];
+        float radius1 = data[5];
+        float thickness = hollow ? data[6] : 0.f;
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_uneven_capsule(pos, p0, p1, radius0, radius1);
+            return hollow ? fabsf(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_trapezoid:
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float radius0 = data[4];
+        float radius1 = data[5];
+        float roundness_thickness = data[6];
+        evaluate(range, tile_origin, distances, [=](float2 pos)
+        {
+            float distance = sd_trapezoid(pos, p0, p1, radius0, radius1);
+            return (hollow ? fabsf(distance) : distance) - roundness_thickness;
+        });
+        return true;
+    }
+    default : return false;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+static void scalar_blend(const float* distances, float4 color, float aa_width, const pixel_range* range, struct tile_colors* colors)
+{
+    for(int y=range->min_y; y<range->max_y; ++y)
+        for(int x=range->min_x; x<range->max_x; ++x)
+        {
+            const int index = y * TILE_SIZE + x;
+            float alpha = color.w * linearstep(aa_width, 0.f, distances[index]);    // anti-aliasing
+            colors->red[index] = mix(colors->red[index], color.x, alpha);
+            colors->green[index] = mix(colors->green[index], color.y, alpha);
+            colors->blue[index] = mix(colors->blue[index], color.z, alpha);
+        }
+}
+
+static const cpu_tile_kernels scalar_kernels = {"reference", 1, scalar_distances, scalar_blend};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// runtime selection
+// ---------------------------------------------------------------------------------------------------------------------------
+uint32_t cpu_get_all_tile_kernels(const struct cpu_tile_kernels** kernels, uint32_t max_kernels)
+{
+    uint32_t count = 0;
+    if (count < max_kernels) kernels[count++] = &scalar_kernels;
+    if (count < max_kernels) kernels[count++] = SIMD_NAMESPACE::get_tile_kernels();
+
+#ifdef TOODEE_AVX2
+    if (count < max_kernels && __builtin_cpu_supports("avx2"))
+        kernels[count++] = simd_avx2::get_tile_kernels();
+#endif
+
+    return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+const struct cpu_tile_kernels* cpu_get_tile_kernels(void)
+{
+    static const cpu_tile_kernels* best = []
+    {
+        const cpu_tile_kernels* kernels[3];
+        uint32_t count = cpu_get_all_tile_kernels(kernels, 3);
+        return kernels[count-1];
+    }();
+    return best;
+}
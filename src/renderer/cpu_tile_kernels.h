@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include "../shaders/common.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// per tile kernels of the cpu rasterizer, a whole row of the tile is evaluated at once with simd
+//  * one implementation per instruction set (scalar reference, sse2, avx2, neon), selected at runtime
+//  * distances and colors are TILE_SIZE*TILE_SIZE arrays in row major order
+//  * only the pixels inside the range are guaranteed to be written/blended (simd versions write whole rows of distances)
+
+// pixels of the tile covered by the clip rect, in tile space
+struct pixel_range
+{
+    int min_x, min_y, max_x, max_y;
+};
+
+// output of the tile, structure of arrays so the blend can be vectorized (alpha is always one)
+struct tile_colors
+{
+    alignas(64) float red[TILE_SIZE * TILE_SIZE];
+    alignas(64) float green[TILE_SIZE * TILE_SIZE];
+    alignas(64) float blue[TILE_SIZE * TILE_SIZE];
+};
+
+struct cpu_tile_kernels
+{
+    const char* name;
+    uint32_t num_lanes;
+
+    // signed distance of a primitive (everything but primitive_char) for each pixel center
+    // returns false if the primitive is not supported by the kernel
+    bool (*distances)(uint8_t type, const float* data, const pixel_range* range, float2 tile_origin, float* distances);
+
+    // anti-aliasing and alpha blending of a solid color, same as the non-combining/non-outline path of tile_fs
+    void (*blend)(const float* distances, float4 color, float aa_width, const pixel_range* range, struct tile_colors* colors);
+};
+
+// best kernels supported by the cpu
+const struct cpu_tile_kernels* cpu_get_tile_kernels(void);
+
+// all kernels compiled in the executable that can run on this cpu, scalar reference first
+uint32_t cpu_get_all_tile_kernels(const struct cpu_tile_kernels** kernels, uint32_t max_kernels);
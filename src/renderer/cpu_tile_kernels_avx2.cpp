@@ -0,0 +1,19 @@
+// tile kernels for x86-64 cpus with avx2, only called if the cpu supports it
+//  * avx2 is enabled after the shared headers : their inline functions (float2, float2x2...) are emitted with the baseline
+//    instruction set like in the other files, the linker can keep any copy of them
+//  * only the functions of the simd_avx2 namespace are compiled with avx2
+#include "cpu_tile_kernels.h"
+#include "../shaders/cpu_compat.h"
+
+#if defined(__clang__)
+    #pragma clang attribute push(__attribute__((target("avx2"))), apply_to=function)
+#else
+    #pragma GCC target("avx2")
+#endif
+
+#define CPU_SIMD_AVX2
+#include "cpu_tile_kernels_impl.h"
+
+#if defined(__clang__)
+    #pragma clang attribute pop
+#endif
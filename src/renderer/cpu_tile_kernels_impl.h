@@ -0,0 +1,196 @@
+// ---------------------------------------------------------------------------------------------------------------------------
+// simd tile kernels, compiled once per instruction set (see cpu_tile_kernels_simd.cpp and cpu_tile_kernels_avx2.cpp)
+// ---------------------------------------------------------------------------------------------------------------------------
+#include "cpu_tile_kernels.h"
+#include "../shaders/cpu_compat.h"
+#include "../shaders/cpu_simd.h"
+
+namespace SIMD_NAMESPACE
+{
+#include "../shaders/sdf_simd.h"
+
+static_assert(TILE_SIZE % SIMD_NUM_LANES == 0, "a row of the tile must be a multiple of the simd width");
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// evaluates whole rows, pixels outside [min_x, max_x[ are computed for nothing but it's cheaper than masking
+template<typename F>
+static inline void evaluate(const pixel_range* range, float2 tile_origin, float* distances, F sdf)
+{
+    const vfloat origin_x = vset(tile_origin.x);
+    for(int y=range->min_y; y<range->max_y; ++y)
+    {
+        vfloat2 position;
+        position.y = vset(tile_origin.y + (float(y) + .5f));
+        for(int x=0; x<TILE_SIZE; x+=SIMD_NUM_LANES)
+        {
+            position.x = origin_x + (vlane_index() + (float(x) + .5f));
+            vstore(&distances[y * TILE_SIZE + x], sdf(position));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+static bool distances(uint8_t packed_type, const float* data, const pixel_range* range, float2 tile_origin, float* distances)
+{
+    const bool hollow = (primitive_get_fillmode(packed_type) == fill_hollow);
+
+    switch(primitive_get_type(packed_type))
+    {
+    case primitive_disc :
+    {
+        float2 center = float2(data[0], data[1]);
+        float radius = data[2];
+        float thickness = hollow ? data[3] : 0.f;
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_disc(pos, center, radius);
+            return hollow ? abs(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_oriented_box :
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float width = data[4];
+        float roundness = data[5];
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_oriented_box(pos, p0, p1, width);
+            return (hollow ? abs(distance) : distance) - roundness;
+        });
+        return true;
+    }
+    case primitive_ellipse :
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float width = data[4];
+        float thickness = hollow ? data[5] : 0.f;
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_oriented_ellipse(pos, p0, p1, width);
+            return hollow ? abs(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_aabox:
+    {
+        float2 box_min = float2(data[0], data[1]);
+        float2 box_max = float2(data[2], data[3]);
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vmask inside = (pos.x >= box_min.x) & (pos.y >= box_min.y) & (pos.x <= box_max.x) & (pos.y <= box_max.y);
+            return select(inside, vset(0.f), vset(10.f));
+        });
+        return true;
+    }
+    case primitive_triangle:
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float2 p2 = float2(data[4], data[5]);
+        float roundness = data[6];
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_triangle(pos, p0, p1, p2);
+            return (hollow ? abs(distance) : distance) - roundness;
+        });
+        return true;
+    }
+    case primitive_pie:
+    {
+        float2 center = float2(data[0], data[1]);
+        float radius = data[2];
+        float2 direction = float2(data[3], data[4]);
+        float2 aperture = float2(data[5], data[6]);
+        float thickness = hollow ? data[7] : 0.f;
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_oriented_pie(pos, center, direction, aperture, radius);
+            return hollow ? abs(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_ring:
+    {
+        float2 center = float2(data[0], data[1]);
+        float radius = data[2];
+        float2 direction = float2(data[3], data[4]);
+        float2 aperture = float2(data[5], data[6]);
+        float thickness = data[7];
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_oriented_ring(pos, center, direction, aperture, radius, thickness);
+            return hollow ? abs(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_uneven_capsule:
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float radius0 = data[4];
+        float radius1 = data[5];
+        float thickness = hollow ? data[6] : 0.f;
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_uneven_capsule(pos, p0, p1, radius0, radius1);
+            return hollow ? abs(distance) - thickness : distance;
+        });
+        return true;
+    }
+    case primitive_trapezoid:
+    {
+        float2 p0 = float2(data[0], data[1]);
+        float2 p1 = float2(data[2], data[3]);
+        float radius0 = data[4];
+        float radius1 = data[5];
+        float roundness_thickness = data[6];
+        evaluate(range, tile_origin, distances, [=](vfloat2 pos)
+        {
+            vfloat distance = sd_trapezoid(pos, p0, p1, radius0, radius1);
+            return (hollow ? abs(distance) : distance) - roundness_thickness;
+        });
+        return true;
+    }
+    default : return false;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+static void blend(const float* distances, float4 color, float aa_width, const pixel_range* range, struct tile_colors* colors)
+{
+    const vfloat min_x = vset(float(range->min_x));
+    const vfloat max_x = vset(float(range->max_x));
+    const vfloat red = vset(color.x), green = vset(color.y), blue = vset(color.z);
+
+    for(int y=range->min_y; y<range->max_y; ++y)
+    {
+        for(int x=0; x<TILE_SIZE; x+=SIMD_NUM_LANES)
+        {
+            if (x + SIMD_NUM_LANES <= range->min_x || x >= range->max_x)
+                continue;
+
+            const int index = y * TILE_SIZE + x;
+            vfloat lane_x = vlane_index() + float(x);
+            vmask inside = (lane_x >= min_x) & (lane_x < max_x);
+
+            // the pixels outside the range get a zero alpha : output + (color - output) * 0 leaves them unchanged
+            vfloat alpha = select(inside, color.w * linearstep(aa_width, 0.f, vload(&distances[index])), vset(0.f));
+
+            vstore(&colors->red[index], mix(vload(&colors->red[index]), red, alpha));
+            vstore(&colors->green[index], mix(vload(&colors->green[index]), green, alpha));
+            vstore(&colors->blue[index], mix(vload(&colors->blue[index]), blue, alpha));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+const struct cpu_tile_kernels* get_tile_kernels(void)
+{
+    static const cpu_tile_kernels kernels = {SIMD_NAME, SIMD_NUM_LANES, distances, blend};
+    return &kernels;
+}
+
+}
@@ -0,0 +1,2 @@
+// tile kernels for the baseline instruction set of the target (sse2 on x86-64, neon on arm64)
+#include "cpu_tile_kernels_impl.h"
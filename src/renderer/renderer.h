@@ -12,15 +12,96 @@ struct renderer;
 struct mu_Context;
 struct view_proj;
 
+// format of the commands bounding box, in tiles
+enum renderer_aabb_format
+{
+    aabb_compact = 0,       // quantized_aabb : 8 bits per coordinate, culling is clamped above RENDERER_COMPACT_MAX_SIZE
+    aabb_wide = 1           // wide_aabb : 16 bits per coordinate, twice the bandwidth (cpu backend only)
+};
+
+// biggest framebuffer width/height culled exactly by the compact aabb (4096 pixels)
+#define RENDERER_COMPACT_MAX_SIZE ((UINT8_MAX + 1) * TILE_SIZE)
+
+// cpu backend only, the metal backend always does gather
+enum renderer_binning
+{
+    binning_gather = 0,     // each tile walks all the commands (same as binning.metal)
+    binning_scatter = 1,    // each command walks the tiles of its bounding box, then hits are sorted per tile
+    binning_hierarchical = 2    // bounding boxes are binned in super-tiles of 8x8 tiles, then each tile walks its super-tile list
+};
+
+enum renderer_tile_format
+{
+    tile_format_nodes = 0,  // linked list of tile_node per tile (same as the metal backend)
+    tile_format_arrays = 1  // contiguous 16 bits command indices per tile and an offset per tile
+};
+
+// encoding of the draw data sent to the backend
+enum renderer_draw_data_format
+{
+    draw_data_float = 0,    // 32 bits floats written by the front end (same as the metal backend)
+    draw_data_half = 1      // half floats, points relative to the command bounding box, half the bandwidth (cpu backend only)
+};
+
+// per tile instrumentation, see renderer_set_heatmap
+enum renderer_heatmap_metric
+{
+    heatmap_commands = 0,       // commands in the list of the tile, combination begin/end included
+    heatmap_combinations = 1,   // combination begin/end pairs in the list of the tile
+    heatmap_evaluations = 2,    // estimated sdf evaluations : for each primitive of the list, the pixels of the tile in its clip rect
+    heatmap_metric_count = 3
+};
+
+struct renderer_heatmap
+{
+    uint32_t num_tile_width;
+    uint32_t num_tile_height;
+    const uint32_t* tiles[heatmap_metric_count];   // row major, one value per tile, valid until the next flush
+    uint32_t max[heatmap_metric_count];             // over all the tiles of the screen
+    uint32_t p50[heatmap_metric_count];
+    uint32_t p99[heatmap_metric_count];
+};
+
+struct renderer_stats
+{
+    uint32_t num_commands;
+    uint32_t num_draw_data;
+    uint32_t draw_data_size;        // bytes of draw data sent to the backend, see renderer_draw_data_format
+    uint32_t peak_commands;         // high-water marks, the command buffers grow to fit them
+    uint32_t peak_draw_data;
+    uint32_t command_buffers_size;  // bytes reserved for the commands, aabbs and draw data of a frame, overflow included
+    uint32_t num_overflow_chunks;   // allocated since renderer_init when a frame didn't fit, constant in steady state
+    uint32_t num_nodes;             // cpu backend only
+    uint32_t num_tiles;             // cpu backend only
+    uint32_t num_threads;           // cpu backend only
+    uint32_t num_steals;            // cpu backend only, work stealing during the last flush
+    uint32_t num_super_tiles;       // cpu backend only, hierarchical binning
+    uint32_t super_tile_commands;   // sum of the super-tiles command lists, hierarchical binning
+    uint32_t super_tile_max_commands;   // longest super-tile command list, hierarchical binning
+    uint32_t tile_lists_size;       // cpu backend only, bytes of tile lists read by the rasterizer
+    uint32_t num_skipped_tiles;     // cpu backend only, tiles kept from the previous frame by the incremental rendering
+    uint32_t num_cache_hits;        // keys re-emitted from the command cache during the last frame
+    uint32_t num_cache_misses;      // keys drawn and recorded during the last frame
+    uint32_t cache_size;            // bytes of commands, draw data and aabbs retained by the cache
+    float binning_time;             // in seconds, cpu backend only
+    float rasterization_time;       // in seconds, whole gpu frame on metal
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct renderer* renderer_init(void* device, uint32_t width, uint32_t height);
+struct renderer* renderer_init_ex(void* device, uint32_t width, uint32_t height, enum renderer_aabb_format aabb_format);
+// compact up to RENDERER_COMPACT_MAX_SIZE, wide above
+enum renderer_aabb_format renderer_aabb_format_for_size(uint32_t width, uint32_t height);
 void renderer_resize(struct renderer* r, uint32_t width, uint32_t height);
 void renderer_reload_shaders(struct renderer* r);
 void renderer_begin_frame(struct renderer* r);
+// metal backend : drawable is a CA::MetalDrawable
+// cpu backend : drawable is a width*height RGBA8 (sRGB) buffer, can be null to only bin the commands
 void renderer_flush(struct renderer* r, void* drawable);
+void renderer_get_stats(struct renderer* r, struct renderer_stats* stats);
 void renderer_debug_interface(struct renderer* r, struct mu_Context* gui_context);
 void renderer_end_frame(struct renderer* r);
 void renderer_terminate(struct renderer* r);
@@ -29,7 +110,39 @@ void renderer_set_clear_color(struct renderer* r, draw_color color);
 void renderer_set_cliprect(struct renderer* r, uint16_t min_x, uint16_t min_y, uint16_t max_x, uint16_t max_y);
 void renderer_set_cliprect_relative(struct renderer * r, aabb const* box);
 void renderer_set_culling_debug(struct renderer* r, bool b);
+// the commands of a tile hidden by a later opaque solid command covering the whole tile are not binned, enabled by default
+void renderer_set_occlusion_culling(struct renderer* r, bool b);
 void renderer_set_viewproj(struct renderer* r, const struct view_proj* vp);
+void renderer_set_num_threads(struct renderer* r, uint32_t num_threads);   // cpu backend only, 0 means one per core
+void renderer_set_binning(struct renderer* r, enum renderer_binning mode);  // cpu backend only
+void renderer_set_tile_format(struct renderer* r, enum renderer_tile_format format);   // cpu backend only
+// cpu backend only : only the tiles touched by the commands that changed since the last flush are binned and rasterized,
+// the others keep their pixels, so the drawable must be the same buffer and untouched between flushes
+void renderer_set_incremental(struct renderer* r, bool enable);
+void renderer_set_cache(struct renderer* r, bool enable);      // see renderer_begin_cached, enabled by default
+// cpu backend only : the tile lists are measured at each flush (see renderer_heatmap_metric), disabled by default
+void renderer_set_heatmap(struct renderer* r, bool enable);
+bool renderer_get_heatmap(struct renderer* r, struct renderer_heatmap* heatmap);    // false if disabled or not supported
+// cpu backend only : the draw data is encoded at renderer_end_frame and decoded by the backend before the binning.
+// Half is lossy : the points (relative to the command box) and the sizes (radius, width, thickness) have a step of 0.25 pixel
+// from 256 pixels, 0.5 from 512, 1 from 1024 and 2 from 2048. draw_data_bench measures up to 74/255 of difference per
+// channel on the examples at 1080p and 159/255 on its replicated scene, where the decoding also makes the flush up to 18%
+// slower than with floats
+void renderer_set_draw_data_format(struct renderer* r, enum renderer_draw_data_format format);
+// cpu backend only : renderer_flush returns once the frame is submitted to a flush thread, the next frame is built while it's
+// rendered. The drawable must not be read or written before the next renderer_flush or renderer_finish. Disabled by default,
+// the metal backend is always asynchronous
+void renderer_set_async(struct renderer* r, bool enable);
+// waits for the frames in flight, the drawables can be read after
+void renderer_finish(struct renderer* r);
+
+// retained commands : the commands emitted between renderer_begin_cached and renderer_end_cached are kept with the key and
+// the render state (view projection, clip, smooth value, aa width). When the key is drawn again with the same state, the
+// commands are copied back, renderer_begin_cached returns false and renderer_end_cached must not be called.
+// Keys not drawn during a frame are evicted. There is no combination inside a cached block.
+bool renderer_begin_cached(struct renderer* r, uint64_t key);
+bool renderer_is_cache_enabled(struct renderer* r);
+void renderer_end_cached(struct renderer* r);
 
 void renderer_begin_combination(struct renderer* r, float smooth_value);
 void renderer_end_combination(struct renderer* r, bool outline);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "renderer.h"
+#include "../system/PushArray.h"
+#include "../system/ortho.h"
+#include "../system/psmooth.h"
+#include <vector>
+
+struct renderer_backend;
+
+// first capacity of the frame buffers, the backends grow them to the high-water mark when a frame doesn't fit
+#define INITIAL_COMMANDS (1<<12)
+#define INITIAL_DRAWDATA (INITIAL_COMMANDS * 4)
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// retained commands, see renderer_begin_cached
+struct cache_state
+{
+    struct view_proj view_proj;
+    float smooth_value;
+    float aa_width;
+    uint32_t clips_count;
+    uint16_t window_width;
+    uint16_t window_height;
+};
+
+struct cache_entry
+{
+    uint64_t key;
+    uint64_t state;             // hash_words_64 of the cache_state
+    uint32_t frame;             // last frame the entry was drawn
+    uint32_t first_command;     // in m_Commands and m_AABBs
+    uint32_t num_commands;
+    uint32_t first_data;
+    uint32_t num_data;
+    wide_aabb bounds;           // union of the aabbs, merged with the combination aabb when emitted
+};
+
+struct command_cache
+{
+    std::vector<cache_entry> m_Entries;
+    std::vector<uint32_t> m_Table;              // open addressing, index in m_Entries or INVALID_INDEX
+    std::vector<draw_command> m_Commands;       // data_index is relative to the first data of the entry
+    std::vector<float> m_DrawData;
+    std::vector<wide_aabb> m_AABBs;             // always wide, converted to the format of the renderer
+    uint32_t m_NumLiveEntries {0};              // drawn during the current frame
+
+    struct cache_state m_State {};
+    uint64_t m_StateHash {0};
+
+    bool m_Enabled {true};
+    bool m_Recording {false};
+    uint64_t m_RecordKey;
+    uint32_t m_RecordFirstCommand;
+    uint32_t m_RecordFirstData;
+    uint32_t m_RecordFirstAABB;
+
+    // stats
+    uint32_t m_NumHits {0};
+    uint32_t m_NumMisses {0};
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// api agnostic part of the renderer : draw commands building, clips and view projection
+struct renderer
+{
+    struct renderer_backend* m_pBackend {nullptr};
+
+    // buffers of the backend, continued in overflow chunks and linearized by backend_unmap_buffers when they're full
+    PushArray<draw_command> m_Commands;
+    PushArray<float> m_DrawData;
+    PushArray<quantized_aabb> m_CommandsAABB;
+    PushArray<wide_aabb> m_CommandsWideAABB;       // replaces m_CommandsAABB with aabb_wide
+    enum renderer_aabb_format m_AABBFormat {aabb_compact};
+
+    uint32_t m_FrameIndex {0};
+    uint64_t m_ProfilerStart {0};                  // command building, from renderer_begin_frame to renderer_end_frame
+    uint32_t m_ClipsCount {0};
+    clip_rect m_Clips[MAX_CLIPS];
+    uint16_t m_WindowWidth;
+    uint16_t m_WindowHeight;
+    uint16_t m_NumTilesWidth;
+    uint16_t m_NumTilesHeight;
+    uint32_t m_NumDrawCommands {0};
+    float m_AAWidth {VEC2_SQR2};
+    float m_FontScale {1.f};
+    float m_SmoothValue {0.f};
+    float m_OutlineWidth {1.f};
+    bool m_CullingDebug {false};
+    bool m_OcclusionCulling {true};
+    int m_HeatmapDebug {0};
+    struct view_proj m_ViewProj;
+    float m_CameraScale {1.f};
+    vec2 m_CameraPosition {.x = 0.f, .y = 0.f};
+    vec2 m_FontSize;
+    uint32_t m_CombinationAABB {INVALID_INDEX};    // index of the combination_begin aabb
+    float4 m_ClearColor {41.0f/255.0f, 42.0f/255.0f, 48.0f/255.0f, 1.0f};
+    struct command_cache m_Cache;
+
+    // stats
+    uint32_t m_PeakNumDrawCommands {0};
+    uint32_t m_NumDrawData {0};
+    struct psmooth m_AverageGPUTime;
+};
+
+// fills the api agnostic part of the arguments (everything but the buffers and the font)
+void renderer_fill_arguments(struct renderer* r, draw_cmd_arguments* args);
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// backend interface, implemented by RendererMetal.cpp or RendererCPU.cpp
+struct renderer_backend* backend_init(struct renderer* r, void* device);
+void backend_resize(struct renderer* r);
+void backend_reload_shaders(struct renderer* r);
+void backend_map_buffers(struct renderer* r);
+void backend_unmap_buffers(struct renderer* r);
+void backend_flush(struct renderer* r, void* drawable);
+float backend_get_frame_time(struct renderer* r);
+void backend_get_stats(struct renderer* r, struct renderer_stats* stats);
+void backend_set_num_threads(struct renderer* r, uint32_t num_threads);
+void backend_set_binning(struct renderer* r, enum renderer_binning mode);
+void backend_set_tile_format(struct renderer* r, enum renderer_tile_format format);
+void backend_set_incremental(struct renderer* r, bool enable);
+void backend_set_heatmap(struct renderer* r, bool enable);
+bool backend_get_heatmap(struct renderer* r, struct renderer_heatmap* heatmap);
+void backend_set_draw_data_format(struct renderer* r, enum renderer_draw_data_format format);
+void backend_set_async(struct renderer* r, bool enable);
+void backend_finish(struct renderer* r);
+void backend_terminate(struct renderer* r);
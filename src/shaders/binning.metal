@@ -3,9 +3,39 @@
 #include "collision.h"
 #include "sdf.h"
 
+// ---------------------------------------------------------------------------------------------------------------------------
+// returns true if the command is opaque and every pixel of the tile is fully inside the shape : the commands before it are
+// not visible in the tile. The command must be outside of a combination. Conservative, the rounding is ignored
+// ---------------------------------------------------------------------------------------------------------------------------
+bool command_covers_tile(constant draw_cmd_arguments& input, uint32_t i, ushort2 index, aabb tile_aabb)
+{
+    constant draw_command& cmd = input.commands[i];
+    if (primitive_get_fillmode(cmd.type) != fill_solid || cmd.op != op_add || (cmd.color.packed_data >> 24) != 0xff)
+        return false;
+
+    // the tile must be inside the clip rect
+    constant clip_rect& clip = input.clips[cmd.clip_index];
+    uint2 tile_pos = uint2(index) * TILE_SIZE;
+    if (any(tile_pos < uint2(clip.min_x, clip.min_y)) || any((tile_pos + TILE_SIZE) > uint2(clip.max_x, clip.max_y)))
+        return false;
+
+    constant float* data = &input.draw_data[cmd.data_index];
+    switch(primitive_get_type(cmd.type))
+    {
+        case primitive_oriented_box : return is_aabb_inside_obb(float2(data[0], data[1]), float2(data[2], data[3]), data[4], tile_aabb);
+        case primitive_ellipse : return is_aabb_inside_ellipse(float2(data[0], data[1]), float2(data[2], data[3]), data[4], tile_aabb);
+        case primitive_disc : return is_aabb_inside_disc(float2(data[0], data[1]), data[2], tile_aabb);
+        case primitive_triangle : return is_aabb_inside_triangle(float2(data[0], data[1]), float2(data[2], data[3]), float2(data[4], data[5]), tile_aabb);
+        case primitive_pie : return is_aabb_inside_pie(float2(data[0], data[1]), float2(data[3], data[4]), float2(data[5], data[6]), data[2], tile_aabb);
+        case primitive_aabox : return all(tile_aabb.min >= float2(data[0], data[1])) && all(tile_aabb.max <= float2(data[2], data[3]));
+        default : return false;
+    }
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------
 // for each tile of the screen, we traverse the list of commands and if the command has an impact on the tile we add the
-// command to the linked list of the tile
+// command to the linked list of the tile. With occlusion culling, the traversal stops at the first command (the last
+// submitted) covering the tile
 // ---------------------------------------------------------------------------------------------------------------------------
 kernel void bin(constant draw_cmd_arguments& input [[buffer(0)]],
                 device tiles_data& output [[buffer(1)]],
@@ -15,7 +45,7 @@ kernel void bin(constant draw_cmd_arguments& input [[buffer(0)]],
     if (index.x >= input.num_tile_width || index.y >= input.num_tile_height)
         return;
 
-    ushort tile_index = index.y * input.num_tile_width + index.x;
+    uint32_t tile_index = index.y * input.num_tile_width + index.x;
 
     // compute tile bounding box
     aabb tile_aabb = {.min = float2(index.x, index.y), .max = float2(index.x + 1, index.y + 1)};
@@ -23,6 +53,7 @@ kernel void bin(constant draw_cmd_arguments& input [[buffer(0)]],
     float2 tile_center = (tile_aabb.min + tile_aabb.max) * .5f;
 
     float smooth_border = 0.f;
+    bool combining = false;
     bool draw_something = false;
     
     // loop through draw commands in reverse order (because of the linked list)
@@ -79,7 +110,8 @@ kernel void bin(constant draw_cmd_arguments& input [[buffer(0)]],
                 float2 direction = float2(data[3], data[4]);
                 float2 aperture = float2(data[5], data[6]);
                 float thickness = data[7];
-                to_be_added = intersection_aabb_arc(tile_enlarge_aabb, center, direction, aperture, radius, thickness);
+                aabb tile_smooth = aabb_grow(tile_enlarge_aabb, (is_hollow ? thickness : 0.f));
+                to_be_added = intersection_aabb_arc(tile_smooth, center, direction, aperture, radius, thickness);
                 break;
             }
             case primitive_pie :
@@ -161,12 +193,14 @@ kernel void bin(constant draw_cmd_arguments& input [[buffer(0)]],
             case combination_begin:
             {
                 smooth_border = 0.f;
+                combining = false;
                 to_be_added = true;
                 break;
             }
             case combination_end:
             {
                 smooth_border = data[0];    // we traverse in reverse order, so the end comes first
+                combining = true;
                 to_be_added = true;
                 break;
             }
@@ -190,7 +224,11 @@ kernel void bin(constant draw_cmd_arguments& input [[buffer(0)]],
             }
 
             if (type != combination_begin && type != combination_end)
+            {
                 draw_something = true;
+                if (input.occlusion_culling && !combining && command_covers_tile(input, i, index, tile_aabb))
+                    break;
+            }
         }
     }
 
@@ -113,7 +113,7 @@ bool intersection_aabb_ray(aabb box, float2 origin, float2 direction)
 // ---------------------------------------------------------------------------------------------------------------------------
 bool intersection_aabb_disc(aabb box, float2 center, float radius)
 {
-    float2 nearest_point = clamp(center.xy, box.min, box.max);
+    float2 nearest_point = clamp(center, box.min, box.max);
     return distance_squared(nearest_point, center) < square(radius);
 }
 
@@ -123,8 +123,8 @@ bool intersection_aabb_circle(aabb box, float2 center, float radius, float half_
     if (!intersection_aabb_disc(box, center, radius + half_width))
         return false;
 
-    float2 candidate0 = abs(center.xy - box.min);
-    float2 candidate1 = abs(center.xy - box.max);
+    float2 candidate0 = abs(center - box.min);
+    float2 candidate1 = abs(center - box.max);
     float2 furthest_point = max(candidate0, candidate1);
 
     return length_squared(furthest_point) > square(radius - half_width);
@@ -467,6 +467,10 @@ bool is_aabb_inside_obb(float2 p0, float2 p1, float width, aabb box)
 // ---------------------------------------------------------------------------------------------------------------------------
 bool is_aabb_inside_pie(float2 center, float2 direction, float2 aperture, float radius, aabb box)
 {
+    // wider than a half disc the pie is concave : the corners can be inside while the notch at the center crosses the box
+    if (aperture.y < 0.f && intersection_aabb_ray(box, center, -direction))
+        return false;
+
     float2 aabb_vertices[4]; 
     aabb_vertices[0] = box.min;
     aabb_vertices[1] = box.max;
@@ -479,4 +483,14 @@ bool is_aabb_inside_pie(float2 center, float2 direction, float2 aperture, float
             return false;
     }
     return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+bool is_aabb_inside_disc(float2 center, float radius, aabb box)
+{
+    float2 candidate0 = abs(center - box.min);
+    float2 candidate1 = abs(center - box.max);
+    float2 furthest_point = max(candidate0, candidate1);
+
+    return length_squared(furthest_point) <= square(radius);
 }
\ No newline at end of file
@@ -4,21 +4,35 @@
 #define MAX_NODES_COUNT (1<<20)
 #define INVALID_INDEX (0xffffffff)
 #define MAX_CLIPS (256)
-#define MAX_COMMANDS (1<<16)
-#define MAX_DRAWDATA (MAX_COMMANDS * 4)
+#define MAX_COMMANDS (1<<16)        // indexable by the 16 bits tile lists of the cpu backend, the command buffers grow past it
 
 // ---------------------------------------------------------------------------------------------------------------------------
 // cpp compatibility
 #ifndef __METAL_VERSION__
 #pragma once
+#include <math.h>
+#include <stdint.h>
 #define constant
 #define atomic_uint uint32_t
 #define device
 #define command_buffer void*
 #define texture_half uint64_t
 #ifdef __cplusplus
-    typedef struct alignas(8) {float x, y;} float2;
-    typedef struct alignas(16) {float x, y, z, w;} float4;
+    struct alignas(8) float2
+    {
+        float x, y;
+        float2() = default;
+        float2(float value) : x(value), y(value) {}
+        float2(float x_, float y_) : x(x_), y(y_) {}
+        float& operator[](int i) {return (&x)[i];}
+        float operator[](int i) const {return (&x)[i];}
+    };
+    struct alignas(16) float4
+    {
+        float x, y, z, w;
+        float4() = default;
+        float4(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+    };
 #else
     typedef struct {float x, y;} float2;
     typedef struct {float x, y, z, w;} float4;
@@ -163,10 +177,17 @@ typedef struct quantized_aabb
     uint8_t min_x, min_y, max_x, max_y;
 } quantized_aabb;
 
+// same in 16 bits, for framebuffers above 4096 pixels (cpu backend only)
+typedef struct wide_aabb
+{
+    uint16_t min_x, min_y, max_x, max_y;
+} wide_aabb;
+
 typedef struct draw_cmd_arguments
 {
     constant draw_command* commands;
     constant quantized_aabb* commands_aabb;
+    constant wide_aabb* commands_wide_aabb;     // used instead of commands_aabb if not null
     constant float* draw_data;
     texture_half font;
     float4 clear_color;
@@ -181,13 +202,14 @@ typedef struct draw_cmd_arguments
     draw_color outline_color;
     float outline_width;
     bool culling_debug;
+    bool occlusion_culling;     // tile lists start at the last opaque command covering the tile
 } draw_cmd_arguments;
 
 typedef struct tiles_data
 {
     device tile_node* head;
     device tile_node* nodes;
-    device uint16_t* tile_indices;
+    device uint32_t* tile_indices;
 } tiles_data;
 
 typedef struct output_command_buffer
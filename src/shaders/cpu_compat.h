@@ -0,0 +1,98 @@
+// ---------------------------------------------------------------------------------------------------------------------------
+// minimal subset of the metal standard library so sdf.h, collision.h and operators.h can be compiled as c++
+// ---------------------------------------------------------------------------------------------------------------------------
+#ifndef __CPU_COMPAT__H__
+#define __CPU_COMPAT__H__
+
+#include <math.h>
+#include <stdint.h>
+#include "common.h"
+
+struct float3
+{
+    float x, y, z;
+    float3() = default;
+    float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+};
+
+struct bool2 {bool x, y;};
+struct bool4 {bool x, y, z, w;};
+
+static inline bool all(bool2 b) {return b.x && b.y;}
+static inline bool any(bool2 b) {return b.x || b.y;}
+static inline bool all(bool4 b) {return b.x && b.y && b.z && b.w;}
+static inline bool any(bool4 b) {return b.x || b.y || b.z || b.w;}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// float2
+static inline float2 operator+(float2 a, float2 b) {return float2(a.x + b.x, a.y + b.y);}
+static inline float2 operator-(float2 a, float2 b) {return float2(a.x - b.x, a.y - b.y);}
+static inline float2 operator*(float2 a, float2 b) {return float2(a.x * b.x, a.y * b.y);}
+static inline float2 operator/(float2 a, float2 b) {return float2(a.x / b.x, a.y / b.y);}
+static inline float2 operator+(float2 a, float b) {return float2(a.x + b, a.y + b);}
+static inline float2 operator-(float2 a, float b) {return float2(a.x - b, a.y - b);}
+static inline float2 operator*(float2 a, float b) {return float2(a.x * b, a.y * b);}
+static inline float2 operator/(float2 a, float b) {return float2(a.x / b, a.y / b);}
+static inline float2 operator*(float a, float2 b) {return float2(a * b.x, a * b.y);}
+static inline float2 operator/(float a, float2 b) {return float2(a / b.x, a / b.y);}
+static inline float2 operator-(float2 a) {return float2(-a.x, -a.y);}
+static inline float2& operator+=(float2& a, float2 b) {a = a + b; return a;}
+static inline float2& operator-=(float2& a, float2 b) {a = a - b; return a;}
+static inline float2& operator*=(float2& a, float2 b) {a = a * b; return a;}
+static inline float2& operator/=(float2& a, float2 b) {a = a / b; return a;}
+static inline float2& operator*=(float2& a, float b) {a = a * b; return a;}
+static inline float2& operator/=(float2& a, float b) {a = a / b; return a;}
+static inline bool2 operator<(float2 a, float2 b) {return bool2{a.x < b.x, a.y < b.y};}
+static inline bool2 operator>(float2 a, float2 b) {return bool2{a.x > b.x, a.y > b.y};}
+static inline bool2 operator<=(float2 a, float2 b) {return bool2{a.x <= b.x, a.y <= b.y};}
+static inline bool2 operator>=(float2 a, float2 b) {return bool2{a.x >= b.x, a.y >= b.y};}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// float4
+static inline float4& operator-=(float4& a, float b) {a.x -= b; a.y -= b; a.z -= b; a.w -= b; return a;}
+static inline bool4 operator<(float4 a, float b) {return bool4{a.x < b, a.y < b, a.z < b, a.w < b};}
+static inline bool4 operator>(float4 a, float b) {return bool4{a.x > b, a.y > b, a.z > b, a.w > b};}
+static inline bool4 operator!=(float4 a, float b) {return bool4{a.x != b, a.y != b, a.z != b, a.w != b};}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// column major like metal
+struct float2x2
+{
+    float2 columns[2];
+    float2x2(float m00, float m01, float m10, float m11) {columns[0] = float2(m00, m01); columns[1] = float2(m10, m11);}
+};
+
+static inline float2 operator*(float2x2 m, float2 v) {return m.columns[0] * v.x + m.columns[1] * v.y;}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// scalar functions
+static inline float min(float a, float b) {return (a<b) ? a : b;}
+static inline float max(float a, float b) {return (a>b) ? a : b;}
+static inline float clamp(float x, float a, float b) {return min(max(x, a), b);}
+static inline float saturate(float x) {return clamp(x, 0.f, 1.f);}
+static inline float sign(float x) {return (x > 0.f) ? 1.f : ((x < 0.f) ? -1.f : 0.f);}
+static inline float mix(float a, float b, float t) {return a + (b - a) * t;}
+static inline float linearstep(float edge0, float edge1, float x) {return saturate((x - edge0) / (edge1 - edge0));}
+static inline float smoothstep(float edge0, float edge1, float x)
+{
+    float t = linearstep(edge0, edge1, x);
+    return t * t * (3.f - 2.f * t);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// vector functions
+static inline float2 min(float2 a, float2 b) {return float2(min(a.x, b.x), min(a.y, b.y));}
+static inline float2 max(float2 a, float2 b) {return float2(max(a.x, b.x), max(a.y, b.y));}
+static inline float2 max(float2 a, float b) {return float2(max(a.x, b), max(a.y, b));}
+static inline float2 abs(float2 a) {return float2(fabsf(a.x), fabsf(a.y));}
+static inline float2 clamp(float2 x, float2 a, float2 b) {return min(max(x, a), b);}
+static inline float2 saturate(float2 x) {return float2(saturate(x.x), saturate(x.y));}
+static inline float2 skew(float2 v) {return float2(-v.y, v.x);}
+static inline float dot(float2 a, float2 b) {return a.x * b.x + a.y * b.y;}
+static inline float length_squared(float2 a) {return dot(a, a);}
+static inline float length(float2 a) {return sqrtf(dot(a, a));}
+static inline float distance_squared(float2 a, float2 b) {return length_squared(b - a);}
+static inline float2 normalize(float2 a) {return a * (1.f / length(a));}
+static inline float4 sign(float4 a) {return float4(sign(a.x), sign(a.y), sign(a.z), sign(a.w));}
+
+#endif
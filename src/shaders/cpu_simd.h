@@ -0,0 +1,170 @@
+// ---------------------------------------------------------------------------------------------------------------------------
+// minimal simd wrapper used by the cpu backend to evaluate several pixels at once
+//  * the instruction set is selected at compile time : AVX2 (8 lanes), SSE2 (4 lanes), NEON on arm64 (4 lanes) or scalar (1 lane)
+//  * everything is declared in SIMD_NAMESPACE so the same code can be compiled several times with different flags and
+//    linked in the same executable, the choice is done at runtime (see cpu_tile_kernels.h)
+//  * the operations follow the scalar functions of cpu_compat.h (same operands order for min/max and select)
+//  * CPU_SIMD_AVX2 selects avx2 in a file that only enables it on its own functions (see cpu_tile_kernels_avx2.cpp)
+// ---------------------------------------------------------------------------------------------------------------------------
+#ifndef __CPU_SIMD__H__
+#define __CPU_SIMD__H__
+
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(CPU_SIMD_AVX2)
+    #define CPU_SIMD_AVX2
+    #include <immintrin.h>
+    #define SIMD_NAMESPACE simd_avx2
+    #define SIMD_NAME "avx2"
+    #define SIMD_NUM_LANES (8)
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SIMD_NAMESPACE simd_sse2
+    #define SIMD_NAME "sse2"
+    #define SIMD_NUM_LANES (4)
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define SIMD_NAMESPACE simd_neon
+    #define SIMD_NAME "neon"
+    #define SIMD_NUM_LANES (4)
+#else
+    #define SIMD_NAMESPACE simd_scalar
+    #define SIMD_NAME "scalar"
+    #define SIMD_NUM_LANES (1)
+#endif
+
+namespace SIMD_NAMESPACE
+{
+
+#if defined(CPU_SIMD_AVX2)
+
+struct vfloat {__m256 v;};
+struct vmask {__m256 v;};
+
+static inline vfloat vset(float a) {return {_mm256_set1_ps(a)};}
+static inline vfloat vload(const float* p) {return {_mm256_loadu_ps(p)};}
+static inline void vstore(float* p, vfloat a) {_mm256_storeu_ps(p, a.v);}
+static inline vfloat operator+(vfloat a, vfloat b) {return {_mm256_add_ps(a.v, b.v)};}
+static inline vfloat operator-(vfloat a, vfloat b) {return {_mm256_sub_ps(a.v, b.v)};}
+static inline vfloat operator*(vfloat a, vfloat b) {return {_mm256_mul_ps(a.v, b.v)};}
+static inline vfloat operator/(vfloat a, vfloat b) {return {_mm256_div_ps(a.v, b.v)};}
+static inline vfloat operator-(vfloat a) {return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.f))};}
+static inline vfloat min(vfloat a, vfloat b) {return {_mm256_min_ps(a.v, b.v)};}
+static inline vfloat max(vfloat a, vfloat b) {return {_mm256_max_ps(a.v, b.v)};}
+static inline vfloat abs(vfloat a) {return {_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)};}
+static inline vfloat sqrt(vfloat a) {return {_mm256_sqrt_ps(a.v)};}
+static inline vmask operator<(vfloat a, vfloat b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};}
+static inline vmask operator>(vfloat a, vfloat b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};}
+static inline vmask operator<=(vfloat a, vfloat b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};}
+static inline vmask operator>=(vfloat a, vfloat b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};}
+static inline vmask operator&(vmask a, vmask b) {return {_mm256_and_ps(a.v, b.v)};}
+static inline vmask operator|(vmask a, vmask b) {return {_mm256_or_ps(a.v, b.v)};}
+static inline vfloat select(vmask m, vfloat a, vfloat b) {return {_mm256_blendv_ps(b.v, a.v, m.v)};}
+static inline vfloat vlane_index(void) {return {_mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f)};}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct vfloat {__m128 v;};
+struct vmask {__m128 v;};
+
+static inline vfloat vset(float a) {return {_mm_set1_ps(a)};}
+static inline vfloat vload(const float* p) {return {_mm_loadu_ps(p)};}
+static inline void vstore(float* p, vfloat a) {_mm_storeu_ps(p, a.v);}
+static inline vfloat operator+(vfloat a, vfloat b) {return {_mm_add_ps(a.v, b.v)};}
+static inline vfloat operator-(vfloat a, vfloat b) {return {_mm_sub_ps(a.v, b.v)};}
+static inline vfloat operator*(vfloat a, vfloat b) {return {_mm_mul_ps(a.v, b.v)};}
+static inline vfloat operator/(vfloat a, vfloat b) {return {_mm_div_ps(a.v, b.v)};}
+static inline vfloat operator-(vfloat a) {return {_mm_xor_ps(a.v, _mm_set1_ps(-0.f))};}
+static inline vfloat min(vfloat a, vfloat b) {return {_mm_min_ps(a.v, b.v)};}
+static inline vfloat max(vfloat a, vfloat b) {return {_mm_max_ps(a.v, b.v)};}
+static inline vfloat abs(vfloat a) {return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)};}
+static inline vfloat sqrt(vfloat a) {return {_mm_sqrt_ps(a.v)};}
+static inline vmask operator<(vfloat a, vfloat b) {return {_mm_cmplt_ps(a.v, b.v)};}
+static inline vmask operator>(vfloat a, vfloat b) {return {_mm_cmpgt_ps(a.v, b.v)};}
+static inline vmask operator<=(vfloat a, vfloat b) {return {_mm_cmple_ps(a.v, b.v)};}
+static inline vmask operator>=(vfloat a, vfloat b) {return {_mm_cmpge_ps(a.v, b.v)};}
+static inline vmask operator&(vmask a, vmask b) {return {_mm_and_ps(a.v, b.v)};}
+static inline vmask operator|(vmask a, vmask b) {return {_mm_or_ps(a.v, b.v)};}
+static inline vfloat select(vmask m, vfloat a, vfloat b) {return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};}
+static inline vfloat vlane_index(void) {return {_mm_setr_ps(0.f, 1.f, 2.f, 3.f)};}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+struct vfloat {float32x4_t v;};
+struct vmask {uint32x4_t v;};
+
+static inline vfloat vset(float a) {return {vdupq_n_f32(a)};}
+static inline vfloat vload(const float* p) {return {vld1q_f32(p)};}
+static inline void vstore(float* p, vfloat a) {vst1q_f32(p, a.v);}
+static inline vfloat operator+(vfloat a, vfloat b) {return {vaddq_f32(a.v, b.v)};}
+static inline vfloat operator-(vfloat a, vfloat b) {return {vsubq_f32(a.v, b.v)};}
+static inline vfloat operator*(vfloat a, vfloat b) {return {vmulq_f32(a.v, b.v)};}
+static inline vfloat operator/(vfloat a, vfloat b) {return {vdivq_f32(a.v, b.v)};}
+static inline vfloat operator-(vfloat a) {return {vnegq_f32(a.v)};}
+static inline vfloat abs(vfloat a) {return {vabsq_f32(a.v)};}
+static inline vfloat sqrt(vfloat a) {return {vsqrtq_f32(a.v)};}
+static inline vmask operator<(vfloat a, vfloat b) {return {vcltq_f32(a.v, b.v)};}
+static inline vmask operator>(vfloat a, vfloat b) {return {vcgtq_f32(a.v, b.v)};}
+static inline vmask operator<=(vfloat a, vfloat b) {return {vcleq_f32(a.v, b.v)};}
+static inline vmask operator>=(vfloat a, vfloat b) {return {vcgeq_f32(a.v, b.v)};}
+static inline vmask operator&(vmask a, vmask b) {return {vandq_u32(a.v, b.v)};}
+static inline vmask operator|(vmask a, vmask b) {return {vorrq_u32(a.v, b.v)};}
+static inline vfloat select(vmask m, vfloat a, vfloat b) {return {vbslq_f32(m.v, a.v, b.v)};}
+static inline vfloat min(vfloat a, vfloat b) {return select(a < b, a, b);}     // vminq_f32 differs on nan and signed zeros
+static inline vfloat max(vfloat a, vfloat b) {return select(a > b, a, b);}
+static inline vfloat vlane_index(void) {const float lanes[4] = {0.f, 1.f, 2.f, 3.f}; return vload(lanes);}
+
+#else
+
+struct vfloat {float v;};
+struct vmask {bool v;};
+
+static inline vfloat vset(float a) {return {a};}
+static inline vfloat vload(const float* p) {return {*p};}
+static inline void vstore(float* p, vfloat a) {*p = a.v;}
+static inline vfloat operator+(vfloat a, vfloat b) {return {a.v + b.v};}
+static inline vfloat operator-(vfloat a, vfloat b) {return {a.v - b.v};}
+static inline vfloat operator*(vfloat a, vfloat b) {return {a.v * b.v};}
+static inline vfloat operator/(vfloat a, vfloat b) {return {a.v / b.v};}
+static inline vfloat operator-(vfloat a) {return {-a.v};}
+static inline vfloat min(vfloat a, vfloat b) {return {(a.v<b.v) ? a.v : b.v};}
+static inline vfloat max(vfloat a, vfloat b) {return {(a.v>b.v) ? a.v : b.v};}
+static inline vfloat abs(vfloat a) {return {__builtin_fabsf(a.v)};}
+static inline vfloat sqrt(vfloat a) {return {__builtin_sqrtf(a.v)};}
+static inline vmask operator<(vfloat a, vfloat b) {return {a.v < b.v};}
+static inline vmask operator>(vfloat a, vfloat b) {return {a.v > b.v};}
+static inline vmask operator<=(vfloat a, vfloat b) {return {a.v <= b.v};}
+static inline vmask operator>=(vfloat a, vfloat b) {return {a.v >= b.v};}
+static inline vmask operator&(vmask a, vmask b) {return {a.v && b.v};}
+static inline vmask operator|(vmask a, vmask b) {return {a.v || b.v};}
+static inline vfloat select(vmask m, vfloat a, vfloat b) {return {m.v ? a.v : b.v};}
+static inline vfloat vlane_index(void) {return {0.f};}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// isa independent helpers
+static inline vfloat operator+(vfloat a, float b) {return a + vset(b);}
+static inline vfloat operator-(vfloat a, float b) {return a - vset(b);}
+static inline vfloat operator*(vfloat a, float b) {return a * vset(b);}
+static inline vfloat operator/(vfloat a, float b) {return a / vset(b);}
+static inline vfloat operator+(float a, vfloat b) {return vset(a) + b;}
+static inline vfloat operator-(float a, vfloat b) {return vset(a) - b;}
+static inline vfloat operator*(float a, vfloat b) {return vset(a) * b;}
+static inline vfloat operator/(float a, vfloat b) {return vset(a) / b;}
+static inline vmask operator<(vfloat a, float b) {return a < vset(b);}
+static inline vmask operator>(vfloat a, float b) {return a > vset(b);}
+static inline vmask operator<=(vfloat a, float b) {return a <= vset(b);}
+static inline vmask operator>=(vfloat a, float b) {return a >= vset(b);}
+static inline vfloat min(vfloat a, float b) {return min(a, vset(b));}
+static inline vfloat max(vfloat a, float b) {return max(a, vset(b));}
+static inline vfloat max(float a, vfloat b) {return max(vset(a), b);}
+static inline vfloat clamp(vfloat x, float a, float b) {return min(max(x, a), b);}
+static inline vfloat saturate(vfloat x) {return clamp(x, 0.f, 1.f);}
+static inline vfloat sign(vfloat x) {return select(x > 0.f, vset(1.f), select(x < 0.f, vset(-1.f), vset(0.f)));}
+static inline vfloat mix(vfloat a, vfloat b, vfloat t) {return a + (b - a) * t;}
+static inline vfloat linearstep(float edge0, float edge1, vfloat x) {return saturate((x - edge0) / (edge1 - edge0));}
+
+}
+
+#endif
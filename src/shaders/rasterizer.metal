@@ -8,18 +8,18 @@
 struct vs_out
 {
     float4 pos [[position]];
-    uint16_t tile_index [[flat]];
+    uint32_t tile_index [[flat]];
 };
 
 // ---------------------------------------------------------------------------------------------------------------------------
 vertex vs_out tile_vs(uint instance_id [[instance_id]],
                       uint vertex_id [[vertex_id]],
                       constant draw_cmd_arguments& input [[buffer(0)]],
-                      constant uint16_t* tile_indices [[buffer(1)]])
+                      constant uint32_t* tile_indices [[buffer(1)]])
 {
     vs_out out;
 
-    uint16_t tile_index = tile_indices[instance_id];
+    uint32_t tile_index = tile_indices[instance_id];
     uint16_t tile_x = tile_index % input.num_tile_width;
     uint16_t tile_y = tile_index / input.num_tile_width;
     
@@ -0,0 +1,168 @@
+// ---------------------------------------------------------------------------------------------------------------------------
+// simd version of sdf.h, each lane is a pixel. The position varies per lane, the parameters of the primitive are uniforms
+// The operations are done in the same order as sdf.h so results match the scalar version (modulo fma contraction)
+//
+// to be included in SIMD_NAMESPACE after cpu_simd.h
+// ---------------------------------------------------------------------------------------------------------------------------
+
+struct vfloat2
+{
+    vfloat x, y;
+};
+
+static inline vfloat2 vset2(float2 a) {return {vset(a.x), vset(a.y)};}
+static inline vfloat2 operator+(vfloat2 a, vfloat2 b) {return {a.x + b.x, a.y + b.y};}
+static inline vfloat2 operator-(vfloat2 a, vfloat2 b) {return {a.x - b.x, a.y - b.y};}
+static inline vfloat2 operator*(vfloat2 a, vfloat2 b) {return {a.x * b.x, a.y * b.y};}
+static inline vfloat2 operator*(vfloat2 a, vfloat b) {return {a.x * b, a.y * b};}
+static inline vfloat2 operator-(vfloat2 a, float2 b) {return {a.x - b.x, a.y - b.y};}
+static inline vfloat2 operator*(vfloat2 a, float2 b) {return {a.x * b.x, a.y * b.y};}
+static inline vfloat2 operator*(float2 a, vfloat2 b) {return {a.x * b.x, a.y * b.y};}
+static inline vfloat2 operator*(float2 a, vfloat b) {return {a.x * b, a.y * b};}
+static inline vfloat2 operator+(float2 a, vfloat2 b) {return {a.x + b.x, a.y + b.y};}
+static inline vfloat2 operator-(float2 a, vfloat2 b) {return {a.x - b.x, a.y - b.y};}
+static inline vfloat2 abs(vfloat2 a) {return {abs(a.x), abs(a.y)};}
+static inline vfloat2 max(vfloat2 a, float b) {return {max(a.x, b), max(a.y, b)};}
+static inline vfloat2 saturate(vfloat2 a) {return {saturate(a.x), saturate(a.y)};}
+static inline vfloat dot(vfloat2 a, vfloat2 b) {return a.x * b.x + a.y * b.y;}
+static inline vfloat dot(vfloat2 a, float2 b) {return a.x * b.x + a.y * b.y;}
+static inline vfloat length(vfloat2 a) {return sqrt(dot(a, a));}
+static inline vfloat2 normalize(vfloat2 a) {return a * (1.f / length(a));}
+
+// same as float2x2(m00, m01, m10, m11) * v, column major
+static inline vfloat2 mul(float2x2 m, vfloat2 v) {return {m.columns[0].x * v.x + m.columns[1].x * v.y, m.columns[0].y * v.x + m.columns[1].y * v.y};}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_disc(vfloat2 position, float2 center, float radius)
+{
+    return length(center-position) - radius;
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_oriented_box(vfloat2 position, float2 a, float2 b, float width)
+{
+    float l = length(b-a);
+    float2  d = (b-a)/l;
+    vfloat2  q = (position-(a+b)*0.5f);
+    q = mul(float2x2(d.x,-d.y,d.y,d.x), q);
+    q = abs(q)-float2(l,width)*0.5f;
+    vfloat2 q_positive = max(q, 0.f);
+    return length(q_positive) + min(max(q.x,q.y),0.f);
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_triangle(vfloat2 p, float2 p0, float2 p1, float2 p2)
+{
+    float2 e0 = p1 - p0;
+    float2 e1 = p2 - p1;
+    float2 e2 = p0 - p2;
+
+    vfloat2 v0 = p - p0;
+    vfloat2 v1 = p - p1;
+    vfloat2 v2 = p - p2;
+
+    vfloat2 pq0 = v0 - e0*saturate(dot(v0,e0)/dot(e0,e0));
+    vfloat2 pq1 = v1 - e1*saturate(dot(v1,e1)/dot(e1,e1));
+    vfloat2 pq2 = v2 - e2*saturate(dot(v2,e2)/dot(e2,e2));
+
+    float s = e0.x*e2.y - e0.y*e2.x;
+    vfloat dx = min(min(dot(pq0, pq0), dot(pq1, pq1)), dot(pq2, pq2));
+    vfloat dy = min(min(s*(v0.x*e0.y-v0.y*e0.x), s*(v1.x*e1.y-v1.y*e1.x)), s*(v2.x*e2.y-v2.y*e2.x));
+
+    return -sqrt(dx)*sign(dy);
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_ellipse(vfloat2 p, float2 e)
+{
+    vfloat2 pAbs = abs(p);
+    float2 ei = 1.f / e;
+    float2 e2 = e*e;
+    float2 ve = ei * float2(e2.x - e2.y, e2.y - e2.x);
+
+    vfloat2 t = vset2(float2(0.70710678118654752f, 0.70710678118654752f));
+
+    for (int i = 0; i < 3; i++)
+    {
+        vfloat2 v = ve*t*t*t;
+        vfloat2 u = normalize(pAbs - v) * length(t * e - v);
+        vfloat2 w = ei * (v + u);
+        t = normalize(saturate(w));
+    }
+
+    vfloat2 nearestAbs = t * e;
+    vfloat dist = length(pAbs - nearestAbs);
+    return select(dot(pAbs, pAbs) < dot(nearestAbs, nearestAbs), -dist, dist);
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_oriented_ellipse(vfloat2 position, float2 a, float2 b, float width)
+{
+    float height = length(b-a);
+    float2  axis = (b-a)/height;
+    vfloat2  position_translated = (position-(a+b)*.5f);
+    vfloat2 position_boxspace = mul(float2x2(axis.x,-axis.y, axis.y, axis.x), position_translated);
+    return sd_ellipse(position_boxspace, float2(height * .5f, width * .5f));
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_oriented_pie(vfloat2 position, float2 center, float2 direction, float2 aperture, float radius)
+{
+    direction = -skew(direction);
+    position = position - center;
+    position = mul(float2x2(direction.x,-direction.y, direction.y, direction.x), position);
+    position.x = abs(position.x);
+    vfloat l = length(position) - radius;
+    vfloat m = length(position - aperture*clamp(dot(position,aperture),0.f,radius));
+    return max(l,m*sign(aperture.y*position.x - aperture.x*position.y));
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_oriented_ring(vfloat2 position, float2 center, float2 direction, float2 aperture, float radius, float thickness)
+{
+    direction = -skew(direction);
+    position = position - center;
+    position = mul(float2x2(direction.x,-direction.y, direction.y, direction.x), position);
+    position.x = abs(position.x);
+    position = mul(float2x2(aperture.y,aperture.x,-aperture.x,aperture.y), position);
+    vfloat2 q = {position.x, max(0.f, abs(radius-position.y)-thickness*0.5f)};
+    return max(abs(length(position)-radius)-thickness*0.5f, length(q)*sign(position.x));
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_uneven_capsule(vfloat2 p, float2 pa, float2 pb, float ra, float rb)
+{
+    p = p - pa;
+    pb -= pa;
+    float h = dot(pb,pb);
+    vfloat2 q = {dot(p,float2(pb.y,-pb.x)) / h, dot(p,pb) / h};
+
+    q.x = abs(q.x);
+    float b = ra-rb;
+    float2 c = float2(sqrtf(h-b*b),b);
+
+    vfloat k = c.x*q.y - c.y*q.x;
+    vfloat m = dot(q,c);
+    vfloat n = dot(q,q);
+
+    vfloat below = sqrt(h*(n            )) - ra;
+    vfloat above = sqrt(h*(n+1.f-2.f*q.y)) - rb;
+    return select(k < 0.f, below, select(k > c.x, above, m - ra));
+}
+
+//-----------------------------------------------------------------------------
+static inline vfloat sd_trapezoid(vfloat2 p, float2 a, float2 b, float ra, float rb)
+{
+    vfloat2 pa = p - a;
+    float2 ba = b - a;
+    float baba = dot(ba, ba);
+    vfloat x = abs(dot(vfloat2{-pa.y, pa.x}, ba)) / sqrtf(baba);
+    vfloat paba = dot(pa, ba) / baba;
+    float rba = rb - ra;
+    vfloat cax = max(0.f, x - select(paba < 0.5f, vset(ra), vset(rb)));
+    vfloat cay = abs(paba - 0.5f) - 0.5f;
+    vfloat f = saturate((rba*(x - ra) + paba * baba) / (rba * rba + baba));
+    vfloat cbx = x - ra - f * rba;
+    vfloat cby = paba - f;
+    return sign(max(cbx,cay)) * sqrt(min(cax*cax + cay * cay*baba, cbx*cbx + cby * cby*baba));
+}
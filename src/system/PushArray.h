@@ -2,60 +2,196 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-// this class does not allocate memory
-// basically it's just an helper to 
+// elements are pushed in a buffer owned by someone else (a mapped gpu buffer for example)
+// when the buffer is full the array continues in chunks allocated on the heap :
+//  * a new chunk doubles the capacity, elements are never moved so pointers stay valid during the frame
+//  * chunks are kept by Set/Reset and recycled by the next frames
+//  * the owner of the buffer grows it to GetHighWaterMark() and calls Linearize, then the next frames fit in the
+//    buffer and nothing is allocated anymore
+
+#define PUSHARRAY_MAX_CHUNKS (24)
+#define PUSHARRAY_MIN_CHUNK_SIZE (1024)
 
 template<class T>
 class PushArray
 {
 public:
-    PushArray() : m_pData(nullptr), m_NumElements(0), m_MaxElements(0) {}
+    PushArray() {memset(m_Chunks, 0, sizeof(m_Chunks));}
+    PushArray(const PushArray&) = delete;
+    PushArray& operator=(const PushArray&) = delete;
+
+    ~PushArray()
+    {
+        for(uint32_t i=1; i<PUSHARRAY_MAX_CHUNKS; ++i)
+            free(m_Chunks[i].data);
+    }
 
     void Set(void* buffer, uint32_t length_in_bytes)
     {
         assert(buffer != nullptr);
-        m_MaxElements = length_in_bytes / sizeof(T);
-        m_NumElements = 0;
-        m_pData = (T*) buffer;
+        m_Chunks[0].data = (T*) buffer;
+        m_Chunks[0].capacity = length_in_bytes / (uint32_t) sizeof(T);
+        Reset();
     }
 
     T* NewElement()
     {
-        if (m_NumElements < m_MaxElements)
-            return &m_pData[m_NumElements++];
-
-        return nullptr;
+        return NewMultiple(1);
     }
 
+    // the elements are contiguous, a chunk is left early if they don't fit
     T* NewMultiple(uint32_t count)
     {
-        T* output = nullptr;
-        if (m_NumElements + count < m_MaxElements)
+        if (m_NumElements + count <= m_Limit)
         {
-            output = &m_pData[m_NumElements];
+            T* output = &m_pData[m_NumElements - m_First];
             m_NumElements += count;
+            return output;
+        }
+        return NextChunk(count);
+    }
+
+    T* GetElement(uint32_t index)
+    {
+        assert(index < m_NumElements);
+        if (index >= m_First)
+            return &m_pData[index - m_First];
+
+        uint32_t i = m_CurrentChunk;
+        while (index < m_Chunks[i].first)
+            --i;
+
+        return &m_Chunks[i].data[index - m_Chunks[i].first];
+    }
+
+    // copies count elements starting at first, whatever the chunks they are in
+    void CopyTo(uint32_t first, uint32_t count, T* output) const
+    {
+        assert(first + count <= m_NumElements);
+        for(uint32_t i=0; i<=m_CurrentChunk && count > 0; ++i)
+        {
+            const uint32_t end = ChunkEnd(i);
+            if (first >= end)
+                continue;
+
+            const uint32_t n = (end - first < count) ? end - first : count;
+            memcpy(output, &m_Chunks[i].data[first - m_Chunks[i].first], n * sizeof(T));
+            output += n;
+            first += n;
+            count -= n;
         }
-        return output;
     }
 
     void RemoveLast()
     {
-        if (m_NumElements>0)
-            m_NumElements--;
+        if (m_NumElements == 0)
+            return;
+
+        UpdateHighWaterMark();
+        m_NumElements--;
+
+        // the previous chunk was left early, it can be filled again
+        if (m_NumElements == m_First && m_CurrentChunk > 0)
+            SetCurrentChunk(m_CurrentChunk - 1);
     }
 
-    void Reset() 
+    void Reset()
     {
+        UpdateHighWaterMark();
         m_NumElements = 0;
+        SetCurrentChunk(0);
+    }
+
+    // copies the elements in a buffer of at least GetNumElements(), the buffer becomes the first chunk
+    // nothing is copied from the first chunk if the buffer is the same
+    void Linearize(void* buffer, uint32_t length_in_bytes)
+    {
+        T* output = (T*) buffer;
+        assert(length_in_bytes / sizeof(T) >= m_NumElements);
+
+        for(uint32_t i=0; i<=m_CurrentChunk; ++i)
+            if (i > 0 || output != m_Chunks[0].data)
+                memcpy(&output[m_Chunks[i].first], m_Chunks[i].data, (ChunkEnd(i) - m_Chunks[i].first) * sizeof(T));
+
+        m_Chunks[0].data = output;
+        m_Chunks[0].capacity = length_in_bytes / (uint32_t) sizeof(T);
+        SetCurrentChunk(0);
     }
 
+    bool IsContiguous() const {return m_CurrentChunk == 0;}
     uint32_t GetNumElements() const {return m_NumElements;}
-    uint32_t GetMaxElements() const {return m_MaxElements;}
+    uint32_t GetMaxElements() const {return m_Chunks[0].capacity;}
+    uint32_t GetHighWaterMark() const {return (m_NumElements > m_HighWaterMark) ? m_NumElements : m_HighWaterMark;}
+    uint32_t GetNumAllocations() const {return m_NumAllocations;}
+
+    // buffer of the owner and heap chunks
+    size_t GetReservedBytes() const
+    {
+        size_t bytes = 0;
+        for(uint32_t i=0; i<PUSHARRAY_MAX_CHUNKS; ++i)
+            bytes += (size_t) m_Chunks[i].capacity * sizeof(T);
+        return bytes;
+    }
 
 private:
-    T* m_pData;
-    uint32_t m_NumElements;
-    uint32_t m_MaxElements;
-};
+    struct chunk
+    {
+        T* data;
+        uint32_t capacity;
+        uint32_t first;         // index of the first element of the chunk
+        uint32_t end;           // index after the last element, the current chunk ends at m_NumElements
+    };
+
+    uint32_t ChunkEnd(uint32_t i) const {return (i == m_CurrentChunk) ? m_NumElements : m_Chunks[i].end;}
+    void UpdateHighWaterMark() {m_HighWaterMark = GetHighWaterMark();}
+
+    void SetCurrentChunk(uint32_t i)
+    {
+        m_CurrentChunk = i;
+        m_pData = m_Chunks[i].data;
+        m_First = m_Chunks[i].first;
+        m_Limit = m_First + m_Chunks[i].capacity;
+    }
 
+    T* NextChunk(uint32_t count)
+    {
+        if (m_CurrentChunk + 1 == PUSHARRAY_MAX_CHUNKS)
+            return nullptr;
+
+        // twice the capacity used so far, a recycled chunk is kept if it's big enough
+        uint32_t capacity = (m_NumElements > PUSHARRAY_MIN_CHUNK_SIZE) ? m_NumElements : PUSHARRAY_MIN_CHUNK_SIZE;
+        capacity = (capacity > count) ? capacity : count;
+
+        chunk* next = &m_Chunks[m_CurrentChunk + 1];
+        if (next->capacity < capacity)
+        {
+            T* data = (T*) malloc((size_t) capacity * sizeof(T));
+            if (data == nullptr)
+                return nullptr;
+
+            free(next->data);
+            next->data = data;
+            next->capacity = capacity;
+            m_NumAllocations++;
+        }
+
+        m_Chunks[m_CurrentChunk].end = m_NumElements;
+        next->first = m_NumElements;
+        SetCurrentChunk(m_CurrentChunk + 1);
+        return NewMultiple(count);
+    }
+
+    // current chunk, the fast path of NewMultiple only reads these
+    T* m_pData {nullptr};
+    uint32_t m_First {0};
+    uint32_t m_Limit {0};
+    uint32_t m_NumElements {0};
+
+    chunk m_Chunks[PUSHARRAY_MAX_CHUNKS];
+    uint32_t m_CurrentChunk {0};
+    uint32_t m_HighWaterMark {0};
+    uint32_t m_NumAllocations {0};
+};
@@ -2,13 +2,20 @@
 #define __FLOAT16__H__
 
 #include <stdint.h>
-#include <arm_neon.h>
+#include <string.h>
+
+// IEEE 754 half precision, round to nearest even, infinities and nans are kept
+// the neon instructions are used when available, the portable version gives the same results
+// (see https://gist.github.com/rygorous/2156668)
 
 typedef uint16_t float16;
 
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+
 static inline float16 float_to_half(float f)
 {
-    return vget_lane_u16(vcvt_f16_f32(vdupq_n_f32(f)), 0);
+    return vget_lane_u16(vreinterpret_u16_f16(vcvt_f16_f32(vdupq_n_f32(f))), 0);
 }
 
 static inline float half_to_float(float16 h)
@@ -16,5 +23,74 @@ static inline float half_to_float(float16 h)
     return vgetq_lane_f32(vcvt_f32_f16(vreinterpret_f16_u16(vdup_n_u16(h))), 0);
 }
 
+#else
+
+static inline float16 float_to_half(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(uint32_t));
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint32_t result;
+    if (u >= 0x47800000u)
+    {
+        // above the largest half (or inf/nan)
+        result = (u > 0x7f800000u) ? 0x7e00 : 0x7c00;
+    }
+    else if (u < 0x38800000u)
+    {
+        // denormal or zero : the addition rounds the mantissa at the right position
+        float denormal;
+        memcpy(&denormal, &u, sizeof(float));
+        denormal += 0.5f;
+        memcpy(&result, &denormal, sizeof(uint32_t));
+        result -= 0x3f000000u;
+    }
+    else
+    {
+        uint32_t mantissa_odd = (u >> 13) & 1;
+        u += ((uint32_t)(15 - 127) << 23) + 0xfff;
+        u += mantissa_odd;
+        result = u >> 13;
+    }
+    return (float16)(result | (sign >> 16));
+}
+
+static inline float half_to_float(float16 h)
+{
+    const uint32_t shifted_exponent = 0x7c00u << 13;
+    uint32_t u = ((uint32_t)h & 0x7fff) << 13;
+    uint32_t exponent = shifted_exponent & u;
+    u += (uint32_t)(127 - 15) << 23;
+
+    float f;
+    if (exponent == shifted_exponent)
+    {
+        // inf/nan
+        u += (uint32_t)(128 - 16) << 23;
+        memcpy(&f, &u, sizeof(float));
+    }
+    else if (exponent == 0)
+    {
+        // denormal : renormalized by the subtraction
+        const uint32_t magic_bits = 113u << 23;
+        float magic;
+        memcpy(&magic, &magic_bits, sizeof(float));
+        u += 1u << 23;
+        memcpy(&f, &u, sizeof(float));
+        f -= magic;
+    }
+    else
+        memcpy(&f, &u, sizeof(float));
+
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(uint32_t));
+    bits |= ((uint32_t)h & 0x8000) << 16;
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+#endif
 
-#endif // 
\ No newline at end of file
+#endif
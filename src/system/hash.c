@@ -1,4 +1,5 @@
 #include "hash.h"
+#include <string.h>
 
 //-----------------------------------------------------------------------------
 uint32_t hash_fnv_1a(const void *data, size_t length)
@@ -12,6 +13,48 @@ uint32_t hash_fnv_1a(const void *data, size_t length)
     return hash;
 }
 
+//-----------------------------------------------------------------------------
+#define XXH_PRIME64_1 0x9e3779b185ebca87ull
+#define XXH_PRIME64_2 0xc2b2ae3d27d4eb4full
+#define XXH_PRIME64_3 0x165667b19e3779f9ull
+#define XXH_PRIME64_4 0x85ebca77c2b2ae63ull
+#define XXH_PRIME64_5 0x27d4eb2f165667c5ull
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+//-----------------------------------------------------------------------------
+uint64_t hash_words_64(const void *data, size_t length)
+{
+    uint64_t hash = XXH_PRIME64_5 + length;
+    const uint8_t* p = (const uint8_t*) data;
+
+    size_t i=0;
+    for(; i+8<=length; i+=8, p+=8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(uint64_t));
+        hash ^= rotl64(word * XXH_PRIME64_2, 31) * XXH_PRIME64_1;
+        hash = rotl64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (i<length)
+    {
+        uint32_t word;
+        memcpy(&word, p, sizeof(uint32_t));
+        hash ^= (uint64_t)word * XXH_PRIME64_1;
+        hash = rotl64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
 //-----------------------------------------------------------------------------
 uint32_t hash_jenkins(const void* data, size_t length)
 {
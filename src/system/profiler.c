@@ -0,0 +1,128 @@
+#include "profiler.h"
+#include "sokol_time.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+struct profiler_event
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t thread;
+    uint32_t frame;
+};
+
+static struct
+{
+    atomic_bool enabled;
+    atomic_uint frame;
+    atomic_uint num_events;         // never wraps in practice, the ring index is num_events % PROFILER_MAX_EVENTS
+    atomic_uint num_threads;
+    uint64_t frame_start[PROFILER_MAX_FRAMES];
+    struct profiler_event events[PROFILER_MAX_EVENTS];
+} g_profiler;
+
+static _Thread_local uint32_t g_thread_id = UINT32_MAX;
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static uint32_t thread_id(void)
+{
+    if (g_thread_id == UINT32_MAX)
+        g_thread_id = atomic_fetch_add(&g_profiler.num_threads, 1);
+
+    return g_thread_id;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void profiler_set_enabled(bool enabled)
+{
+    if (enabled && !profiler_is_enabled())
+    {
+        // previous recording is dropped, the trace only contains consecutive frames
+        atomic_store(&g_profiler.num_events, 0);
+        atomic_store(&g_profiler.frame, 0);
+        g_profiler.frame_start[0] = stm_now();
+    }
+    atomic_store(&g_profiler.enabled, enabled);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+bool profiler_is_enabled(void)
+{
+    return atomic_load_explicit(&g_profiler.enabled, memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void profiler_begin_frame(void)
+{
+    if (!profiler_is_enabled())
+        return;
+
+    uint32_t frame = atomic_fetch_add(&g_profiler.frame, 1) + 1;
+    g_profiler.frame_start[frame % PROFILER_MAX_FRAMES] = stm_now();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+uint64_t profiler_begin(void)
+{
+    if (!profiler_is_enabled())
+        return 0;
+
+    uint64_t now = stm_now();
+    return (now != 0) ? now : 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void profiler_end(const char* name, uint64_t start)
+{
+    if (start == 0)
+        return;
+
+    uint32_t index = atomic_fetch_add_explicit(&g_profiler.num_events, 1, memory_order_relaxed) % PROFILER_MAX_EVENTS;
+    struct profiler_event* event = &g_profiler.events[index];
+    event->name = name;
+    event->start = start;
+    event->end = stm_now();
+    event->thread = thread_id();
+    event->frame = atomic_load_explicit(&g_profiler.frame, memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+bool profiler_write_trace(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (f == NULL)
+        return false;
+
+    uint32_t current_frame = atomic_load(&g_profiler.frame);
+    uint32_t num_events = atomic_load(&g_profiler.num_events);
+    uint32_t first_frame = (current_frame >= PROFILER_MAX_FRAMES) ? current_frame - PROFILER_MAX_FRAMES + 1 : 0;
+    uint32_t first_event = (num_events > PROFILER_MAX_EVENTS) ? num_events - PROFILER_MAX_EVENTS : 0;
+    uint64_t origin = g_profiler.frame_start[first_frame % PROFILER_MAX_FRAMES];
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"ToodeeSculpt\"}}");
+
+    for(uint32_t frame=first_frame; frame<=current_frame; ++frame)
+    {
+        uint64_t start = g_profiler.frame_start[frame % PROFILER_MAX_FRAMES];
+        fprintf(f, ",\n{\"name\":\"frame %u\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":0,\"tid\":0}",
+                frame, stm_us(start - origin));
+    }
+
+    for(uint32_t i=first_event; i<num_events; ++i)
+    {
+        const struct profiler_event* event = &g_profiler.events[i % PROFILER_MAX_EVENTS];
+
+        // events of frames that went out of the ring or that are still being written
+        if (event->frame < first_frame || event->end < event->start || event->start < origin)
+            continue;
+
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u,"
+                "\"args\":{\"frame\":%u}}", event->name, stm_us(event->start - origin), stm_us(event->end - event->start),
+                event->thread, event->frame);
+    }
+
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
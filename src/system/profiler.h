@@ -0,0 +1,52 @@
+#ifndef __PROFILER__H__
+#define __PROFILER__H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// scoped cpu timers on top of sokol_time, the last PROFILER_MAX_FRAMES frames are kept in a ring buffer and can be written
+// as a chrome trace (chrome://tracing or https://ui.perfetto.dev)
+//  * disabled by default, a disabled timer costs one relaxed atomic load
+//  * names must be string literals (only the pointer is stored)
+//  * stm_setup() must have been called before enabling the profiler
+//  * timers can be used from any thread, the trace should be written between two frames
+
+#define PROFILER_MAX_FRAMES (120)
+#define PROFILER_MAX_EVENTS (PROFILER_MAX_FRAMES * 64)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void profiler_set_enabled(bool enabled);
+bool profiler_is_enabled(void);
+
+// starts a new frame, events recorded after this call belong to it
+void profiler_begin_frame(void);
+
+// returns 0 when the profiler is disabled, profiler_end ignores it
+uint64_t profiler_begin(void);
+void profiler_end(const char* name, uint64_t start);
+
+// writes the events of the last frames as chrome trace_event json, returns false if the file can't be written
+bool profiler_write_trace(const char* path);
+
+#ifdef __cplusplus
+}
+
+struct profiler_scope
+{
+    profiler_scope(const char* name) : m_Name(name), m_Start(profiler_begin()) {}
+    ~profiler_scope() {profiler_end(m_Name, m_Start);}
+
+    const char* m_Name;
+    uint64_t m_Start;
+};
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+#define PROFILER_SCOPE(name) profiler_scope PROFILER_CONCAT(profiler_scope_, __LINE__)(name)
+
+#endif
+
+#endif
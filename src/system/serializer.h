@@ -5,12 +5,15 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdio.h>
 
 //-----------------------------------------------------------------------------------------------------------------------------
 // Simple serializer
 //  * does not allocate/deallocate memory
 //  * allow to write/read basic values, struct (POD)
 //  * avoid overflow
+//  * can stream a file : the buffer holds a chunk of the file, written when full or read again when empty, the size of
+//    the file is not limited by the size of the buffer
 //-----------------------------------------------------------------------------------------------------------------------------
 
 enum serializer_status
@@ -20,12 +23,23 @@ enum serializer_status
     serializer_read_error
 };
 
+enum serializer_stream
+{
+    serializer_stream_none,
+    serializer_stream_write,
+    serializer_stream_read
+};
+
 typedef struct 
 {
 	uint8_t* buffer;
 	size_t position;	
-	size_t buffer_size;
+	size_t buffer_size;         // streams : bytes of the chunk that can be written or that have been read from the file
     enum serializer_status status;
+    enum serializer_stream stream;
+    FILE* file;
+    size_t file_position;       // position in the file of the beginning of the buffer
+    size_t chunk_size;
 } serializer_context;
 
 //-----------------------------------------------------------------------------------------------------------------------------
@@ -35,26 +49,121 @@ static inline void serializer_init(serializer_context* context, void* buffer, si
     context->buffer_size = buffer_size;
     context->position = 0;
     context->status = serializer_no_error;
+    context->stream = serializer_stream_none;
+    context->file = NULL;
+    context->file_position = 0;
+    context->chunk_size = buffer_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// writes in the file (opened in binary mode) through the chunk, call serializer_flush at the end
+static inline void serializer_init_write_file(serializer_context* context, FILE* file, void* chunk, size_t chunk_size)
+{
+    serializer_init(context, chunk, chunk_size);
+    context->stream = serializer_stream_write;
+    context->file = file;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// reads the file from its current position, chunk by chunk
+static inline void serializer_init_read_file(serializer_context* context, FILE* file, void* chunk, size_t chunk_size)
+{
+    serializer_init(context, chunk, chunk_size);
+    context->buffer_size = 0;
+    context->stream = serializer_stream_read;
+    context->file = file;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// writes the pending bytes of the chunk in the file, does nothing if the serializer doesn't write a file
+static inline void serializer_flush(serializer_context* context)
+{
+    if (context->stream != serializer_stream_write || context->position == 0)
+        return;
+
+    if (fwrite(context->buffer, 1, context->position, context->file) == context->position)
+    {
+        context->file_position += context->position;
+        context->position = 0;
+    }
+    else context->status = serializer_write_error;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
-// go back at the beginning of the buffer, doesn't clear the buffer
+// slow path of the write functions when the chunk is full, data bigger than the chunk go directly in the file
+static inline bool serializer_stream_write_data(serializer_context* context, const void* data, size_t size)
+{
+    if (context->stream != serializer_stream_write)
+        return false;
+
+    serializer_flush(context);
+    if (context->status != serializer_no_error)
+        return false;
+
+    if (size <= context->chunk_size)
+    {
+        memcpy(context->buffer, data, size);
+        context->position = size;
+        return true;
+    }
+
+    if (fwrite(data, 1, size, context->file) != size)
+        return false;
+
+    context->file_position += size;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// slow path of the read functions when the chunk is empty, data bigger than the chunk are read directly from the file
+static inline bool serializer_stream_read_data(serializer_context* context, void* data, size_t size)
+{
+    if (context->stream != serializer_stream_read)
+        return false;
+
+    // what's left in the chunk
+    size_t left = context->buffer_size - context->position;
+    memcpy(data, &context->buffer[context->position], left);
+    data = (uint8_t*)data + left;
+    size -= left;
+    context->file_position += context->buffer_size;
+    context->position = context->buffer_size = 0;
+
+    if (size > context->chunk_size)
+    {
+        size_t read = fread(data, 1, size, context->file);
+        context->file_position += read;
+        return read == size;
+    }
+
+    context->buffer_size = fread(context->buffer, 1, context->chunk_size, context->file);
+    if (context->buffer_size < size)
+        return false;
+
+    memcpy(data, context->buffer, size);
+    context->position = size;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// go back at the beginning of the buffer, doesn't clear the buffer (memory buffer only)
 static inline void serializer_restart(serializer_context* context)
 {
     context->position = 0;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
-// returns how many bytes is left to be written/read in the buffer
+// returns how many bytes is left to be written/read in the buffer (in the chunk for streams)
 static inline size_t serializer_get_leftspace(serializer_context* context)
 {
     return context->buffer_size - context->position;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
+// streams : position in the file
 static inline size_t serializer_get_position(serializer_context* context)
 {
-    return context->position;
+    return context->file_position + context->position;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
@@ -64,7 +173,7 @@ static inline enum serializer_status serializer_get_status(serializer_context* c
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
-// write functions, set the status to error if there is no more space in the buffer
+// write functions, set the status to error if there is no more space in the buffer (or the file can't be written)
 #define DECLARE_SERIALIZER_WRITE_FUNC(type)                                             \
 static inline void serializer_write_##type(serializer_context* context, type value)     \
 {                                                                                       \
@@ -74,7 +183,8 @@ static inline void serializer_write_##type(serializer_context* context, type val
         *cast = value;                                                                  \
         context->position += sizeof(type);                                              \
     }                                                                                   \
-    else context->status = serializer_write_error;                                      \
+    else if (!serializer_stream_write_data(context, &value, sizeof(type)))              \
+        context->status = serializer_write_error;                                       \
 }
 
 DECLARE_SERIALIZER_WRITE_FUNC(float);
@@ -95,7 +205,8 @@ static inline void serializer_write_blob(serializer_context* context, const void
         memcpy(&context->buffer[context->position], blob, blob_size);
         context->position += blob_size;
     }
-    else context->status = serializer_write_error;
+    else if (!serializer_stream_write_data(context, blob, blob_size))
+        context->status = serializer_write_error;
 }
 
 #define serializer_write_struct(context, variable) serializer_write_blob(context, &variable, sizeof(variable))
@@ -112,6 +223,9 @@ static inline type serializer_read_##type(serializer_context* context)
         context->position += sizeof(type);                                              \
         return *cast;                                                                   \
     }                                                                                   \
+    type value;                                                                         \
+    if (serializer_stream_read_data(context, &value, sizeof(type)))                     \
+        return value;                                                                   \
     context->status = serializer_read_error;                                            \
     return (type)0;                                                                     \
 }
@@ -134,7 +248,8 @@ static inline void serializer_read_blob(serializer_context* context, void* blob,
         memcpy(blob, &context->buffer[context->position], blob_size);
         context->position += blob_size;
     }
-    else context->status = serializer_read_error;
+    else if (!serializer_stream_read_data(context, blob, blob_size))
+        context->status = serializer_read_error;
 }
 
 #endif
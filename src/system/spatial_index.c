@@ -0,0 +1,278 @@
+#include "spatial_index.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#define CELL_LIMIT (1<<24)          // cell coordinates are clamped, far away boxes share the border cells
+
+enum entry_location
+{
+    location_none,
+    location_grid,
+    location_large
+};
+
+// indices sorted in increasing order
+struct index_bucket
+{
+    uint32_t* indices;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+struct index_entry
+{
+    aabb box;
+    int32_t min_x, min_y, max_x, max_y;     // cells covered
+    enum entry_location location;
+};
+
+struct spatial_index
+{
+    float inv_cell_size;
+    struct index_bucket buckets[SPATIAL_INDEX_NUM_BUCKETS];
+    struct index_bucket large;
+    struct index_entry* entries;
+    uint32_t num_entries;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t cell_hash(int32_t x, int32_t y)
+{
+    return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u)) & (SPATIAL_INDEX_NUM_BUCKETS - 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline int32_t cell_coordinate(const struct spatial_index* index, float value)
+{
+    float cell = floorf(value * index->inv_cell_size);
+    cell = fmaxf(fminf(cell, (float)CELL_LIMIT), -(float)CELL_LIMIT);
+    return (int32_t) cell;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// first position with an index greater or equal
+static uint32_t bucket_lower_bound(const struct index_bucket* bucket, uint32_t value)
+{
+    uint32_t first = 0, count = bucket->count;
+    while (count > 0)
+    {
+        uint32_t step = count / 2;
+        if (bucket->indices[first + step] < value)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+            count = step;
+    }
+    return first;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// several cells of a box can share a bucket, the index is only stored once
+static void bucket_insert(struct index_bucket* bucket, uint32_t value)
+{
+    uint32_t position = bucket_lower_bound(bucket, value);
+    if (position < bucket->count && bucket->indices[position] == value)
+        return;
+
+    if (bucket->count == bucket->capacity)
+    {
+        bucket->capacity = (bucket->capacity == 0) ? 8 : bucket->capacity * 2;
+        bucket->indices = (uint32_t*) realloc(bucket->indices, bucket->capacity * sizeof(uint32_t));
+    }
+
+    memmove(&bucket->indices[position + 1], &bucket->indices[position], (bucket->count - position) * sizeof(uint32_t));
+    bucket->indices[position] = value;
+    bucket->count++;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void bucket_erase(struct index_bucket* bucket, uint32_t value)
+{
+    uint32_t position = bucket_lower_bound(bucket, value);
+    if (position == bucket->count || bucket->indices[position] != value)
+        return;
+
+    memmove(&bucket->indices[position], &bucket->indices[position + 1], (bucket->count - position - 1) * sizeof(uint32_t));
+    bucket->count--;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void entry_insert(struct spatial_index* index, uint32_t box_index)
+{
+    struct index_entry* entry = &index->entries[box_index];
+    int64_t num_cells = (int64_t)(entry->max_x - entry->min_x + 1) * (int64_t)(entry->max_y - entry->min_y + 1);
+    if (num_cells > SPATIAL_INDEX_MAX_CELLS)
+    {
+        entry->location = location_large;
+        bucket_insert(&index->large, box_index);
+        return;
+    }
+
+    entry->location = location_grid;
+    for(int32_t y=entry->min_y; y<=entry->max_y; ++y)
+        for(int32_t x=entry->min_x; x<=entry->max_x; ++x)
+            bucket_insert(&index->buckets[cell_hash(x, y)], box_index);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void entry_erase(struct spatial_index* index, uint32_t box_index)
+{
+    struct index_entry* entry = &index->entries[box_index];
+    if (entry->location == location_large)
+        bucket_erase(&index->large, box_index);
+    else if (entry->location == location_grid)
+    {
+        for(int32_t y=entry->min_y; y<=entry->max_y; ++y)
+            for(int32_t x=entry->min_x; x<=entry->max_x; ++x)
+                bucket_erase(&index->buckets[cell_hash(x, y)], box_index);
+    }
+    entry->location = location_none;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void reserve_entries(struct spatial_index* index, uint32_t num_entries)
+{
+    if (num_entries <= index->num_entries)
+        return;
+
+    uint32_t capacity = index->num_entries * 2;
+    capacity = (capacity > num_entries) ? capacity : num_entries;
+    index->entries = (struct index_entry*) realloc(index->entries, capacity * sizeof(struct index_entry));
+    memset(&index->entries[index->num_entries], 0, (capacity - index->num_entries) * sizeof(struct index_entry));
+    index->num_entries = capacity;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// adds delta to the indices greater or equal to first, the buckets stay sorted
+static void shift_indices(struct spatial_index* index, uint32_t first, int32_t delta)
+{
+    for(uint32_t i=0; i<=SPATIAL_INDEX_NUM_BUCKETS; ++i)
+    {
+        struct index_bucket* bucket = (i < SPATIAL_INDEX_NUM_BUCKETS) ? &index->buckets[i] : &index->large;
+        for(uint32_t j=bucket_lower_bound(bucket, first); j<bucket->count; ++j)
+            bucket->indices[j] = (uint32_t)((int32_t)bucket->indices[j] + delta);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+struct spatial_index* spatial_index_init(float cell_size, uint32_t reservation)
+{
+    assert(cell_size > 0.f);
+    struct spatial_index* index = (struct spatial_index*) calloc(1, sizeof(struct spatial_index));
+    index->inv_cell_size = 1.f / cell_size;
+    index->num_entries = (reservation > 0) ? reservation : 1;
+    index->entries = (struct index_entry*) calloc(index->num_entries, sizeof(struct index_entry));
+    return index;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void spatial_index_update(struct spatial_index* index, uint32_t box_index, aabb box)
+{
+    if (!aabb_is_valid(box))
+    {
+        spatial_index_remove(index, box_index);
+        return;
+    }
+
+    reserve_entries(index, box_index + 1);
+
+    int32_t min_x = cell_coordinate(index, box.min.x), min_y = cell_coordinate(index, box.min.y);
+    int32_t max_x = cell_coordinate(index, box.max.x), max_y = cell_coordinate(index, box.max.y);
+
+    // same cells : only the box used by the queries changes
+    struct index_entry* entry = &index->entries[box_index];
+    entry->box = box;
+    if (entry->location != location_none && entry->min_x == min_x && entry->min_y == min_y && entry->max_x == max_x && entry->max_y == max_y)
+        return;
+
+    entry_erase(index, box_index);
+    entry->min_x = min_x; entry->min_y = min_y;
+    entry->max_x = max_x; entry->max_y = max_y;
+    entry_insert(index, box_index);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void spatial_index_remove(struct spatial_index* index, uint32_t box_index)
+{
+    if (box_index < index->num_entries)
+        entry_erase(index, box_index);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void spatial_index_insert(struct spatial_index* index, uint32_t box_index, aabb box)
+{
+    // the last entry is shifted out, it must be free
+    reserve_entries(index, box_index + 1);
+    if (index->entries[index->num_entries - 1].location != location_none)
+        reserve_entries(index, index->num_entries + 1);
+
+    shift_indices(index, box_index, 1);
+    memmove(&index->entries[box_index + 1], &index->entries[box_index], (index->num_entries - box_index - 1) * sizeof(struct index_entry));
+    index->entries[box_index].location = location_none;
+    spatial_index_update(index, box_index, box);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void spatial_index_erase(struct spatial_index* index, uint32_t box_index)
+{
+    if (box_index >= index->num_entries)
+        return;
+
+    entry_erase(index, box_index);
+    shift_indices(index, box_index + 1, -1);
+    memmove(&index->entries[box_index], &index->entries[box_index + 1], (index->num_entries - box_index - 1) * sizeof(struct index_entry));
+    index->entries[index->num_entries - 1].location = location_none;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void spatial_index_clear(struct spatial_index* index)
+{
+    for(uint32_t i=0; i<SPATIAL_INDEX_NUM_BUCKETS; ++i)
+        index->buckets[i].count = 0;
+
+    index->large.count = 0;
+    memset(index->entries, 0, index->num_entries * sizeof(struct index_entry));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+uint32_t spatial_index_query(const struct spatial_index* index, vec2 point, uint32_t* output, uint32_t max_output)
+{
+    const struct index_bucket* bucket = &index->buckets[cell_hash(cell_coordinate(index, point.x), cell_coordinate(index, point.y))];
+    const struct index_bucket* large = &index->large;
+
+    // both lists are sorted, they're merged from the end
+    uint32_t count = 0;
+    uint32_t i = bucket->count, j = large->count;
+    while (i > 0 || j > 0)
+    {
+        uint32_t box_index;
+        if (j == 0 || (i > 0 && bucket->indices[i-1] > large->indices[j-1]))
+            box_index = bucket->indices[--i];
+        else
+            box_index = large->indices[--j];
+
+        // the bucket also holds the boxes of the other cells with the same hash
+        if (aabb_test_point(&index->entries[box_index].box, point))
+        {
+            if (count < max_output)
+                output[count] = box_index;
+            count++;
+        }
+    }
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void spatial_index_terminate(struct spatial_index* index)
+{
+    for(uint32_t i=0; i<SPATIAL_INDEX_NUM_BUCKETS; ++i)
+        free(index->buckets[i].indices);
+
+    free(index->large.indices);
+    free(index->entries);
+    free(index);
+}
@@ -0,0 +1,46 @@
+#ifndef __SPATIAL_INDEX_H__
+#define __SPATIAL_INDEX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "aabb.h"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// Point queries on a set of boxes identified by an index (the position in a list)
+//   * hashed uniform grid : a box is stored in the buckets of the cells it covers, a point query reads one bucket
+//   * the buckets keep the indices sorted, queries return the boxes containing the point by decreasing index
+//   * boxes covering more than SPATIAL_INDEX_MAX_CELLS cells are kept in a separate list tested by every query
+//   * updating a box is incremental, nothing is touched if it stays in the same cells
+//-----------------------------------------------------------------------------------------------------------------------------
+
+#define SPATIAL_INDEX_NUM_BUCKETS (4096)
+#define SPATIAL_INDEX_MAX_CELLS (64)
+
+struct spatial_index;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct spatial_index* spatial_index_init(float cell_size, uint32_t reservation);
+
+// inserts or moves the box of an index, an invalid box removes it
+void spatial_index_update(struct spatial_index* index, uint32_t box_index, aabb box);
+void spatial_index_remove(struct spatial_index* index, uint32_t box_index);
+void spatial_index_clear(struct spatial_index* index);
+
+// same as an insertion or an erase in the list : the following indices are shifted, the boxes don't move
+void spatial_index_insert(struct spatial_index* index, uint32_t box_index, aabb box);
+void spatial_index_erase(struct spatial_index* index, uint32_t box_index);
+
+// writes up to max_output indices of the boxes containing the point, highest index first
+// returns the number of boxes found, can be bigger than max_output
+uint32_t spatial_index_query(const struct spatial_index* index, vec2 point, uint32_t* output, uint32_t max_output);
+
+void spatial_index_terminate(struct spatial_index* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
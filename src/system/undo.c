@@ -1,80 +1,684 @@
 #include "undo.h"
 #include <stdlib.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
 #include "log.h"
+#include "miniz.h"
+
+#define DELTA_MIN_ZERO_RUN (4)          // shorter runs of zeros stay in the literal, a new run costs two varints
+#define VARINT_MAX_SIZE (10)
+#define SNAPSHOT_INITIAL_SIZE (1<<16)
+#define DEFLATE_LEVEL (1)
+#define NUM_JOBS (4)                    // snapshots waiting for the compression, a new one is stored as is if they're all taken
+#define NO_JOB (UINT32_MAX)
 
 struct undo_state
 {
     size_t start_position;
-    size_t size;
+    size_t size;                // bytes in the buffer
+    size_t raw_size;            // size of the state itself
+    uint32_t keyframe;          // serial of the state stored as is this one is rebuilt from, itself if it's a keyframe
+    uint32_t job;               // deflate storage : job of the state until it's compressed and stored in the buffer
+};
+
+enum job_status
+{
+    job_free,
+    job_queued,
+    job_done
 };
 
+// a snapshot being compressed, the state is read from the uncompressed data until the job is collected
+struct undo_job
+{
+    uint8_t* raw;
+    uint8_t* compressed;
+    size_t raw_size;
+    size_t compressed_size;     // raw_size if the data doesn't compress
+    uint32_t serial;
+    bool cancelled;             // the state was evicted or discarded before the job was collected
+    enum job_status status;
+};
+
+// a state is identified by a serial, incremented at each snapshot
+//   * oldest state : first, current state : first + num_states - 1, followed by num_redo states
+//   * the state of a serial is at states[serial & states_mask] and its data in the ring buffer at start_position
 struct undo_context
 {
     uint8_t* buffer;
     size_t buffer_size;
-    size_t current_position;
+    size_t head;                // where the next state goes, the oldest one starts at the tail
+    size_t used_bytes;
+    size_t raw_total;
 
     struct undo_state* states;
+    uint32_t states_mask;
+    uint32_t first;
     uint32_t num_states;
-    uint32_t max_states;
+    uint32_t num_redo;
+
+    // the snapshot is written in a scratch buffer, the delta storage also keeps the current state whole
+    enum undo_storage storage;
+    uint8_t* snapshot;
+    uint8_t* current;
+    uint8_t* delta;
+    size_t current_size;
+    size_t snapshot_capacity;
+
+    // deflate storage : the jobs are compressed in order by the thread and collected in order, job serials increase
+    struct undo_job jobs[NUM_JOBS];
+    uint32_t job_first;         // oldest job not collected
+    uint32_t job_count;
+    uint32_t job_next;          // next job to compress
+    tdefl_compressor* compressor;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t job_queued;
+    pthread_cond_t job_done;
+    bool quit;
 };
 
 #define UNUSED_VARIABLE(a) (void)(a)
 
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline size_t varint_write(uint8_t* output, size_t value)
+{
+    size_t count = 0;
+    while (value >= 0x80)
+    {
+        output[count++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    output[count++] = (uint8_t)value;
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline size_t varint_read(const uint8_t* input, size_t* position)
+{
+    size_t value = 0;
+    for(uint32_t shift=0; ; shift += 7)
+    {
+        uint8_t byte = input[(*position)++];
+        value |= (size_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// both states are padded with zeros to the longest
+static inline uint8_t xor_at(const uint8_t* state, size_t size, const uint8_t* previous, size_t previous_size, size_t i)
+{
+    return (uint8_t)(((i < size) ? state[i] : 0) ^ ((i < previous_size) ? previous[i] : 0));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// xor of the states as a list of [zeros count][literal count][literal bytes], the trailing zeros are not written
+// returns 0 if the delta doesn't fit in max_output
+static size_t delta_encode(const uint8_t* state, size_t size, const uint8_t* previous, size_t previous_size,
+                           uint8_t* output, size_t max_output)
+{
+    size_t length = (size > previous_size) ? size : previous_size;
+    size_t position = 0;
+    size_t i = 0;
+    while (i < length)
+    {
+        size_t zeros_start = i;
+        while (i < length && xor_at(state, size, previous, previous_size, i) == 0)
+            i++;
+
+        if (i == length)
+            break;
+
+        // the literal ends before DELTA_MIN_ZERO_RUN zeros in a row
+        size_t literal_start = i, literal_end = i;
+        for(size_t j=i; j<length; ++j)
+        {
+            if (xor_at(state, size, previous, previous_size, j) != 0)
+                literal_end = j + 1;
+            else if (j + 1 - literal_end >= DELTA_MIN_ZERO_RUN)
+                break;
+        }
+
+        size_t literal_count = literal_end - literal_start;
+        if (position + VARINT_MAX_SIZE * 2 + literal_count > max_output)
+            return 0;
+
+        position += varint_write(&output[position], literal_start - zeros_start);
+        position += varint_write(&output[position], literal_count);
+        for(size_t j=literal_start; j<literal_end; ++j)
+            output[position++] = xor_at(state, size, previous, previous_size, j);
+
+        i = literal_end;
+    }
+
+    // same states : an empty literal, a delta is never empty
+    if (position == 0 && max_output >= 2)
+    {
+        output[position++] = 0;
+        output[position++] = 0;
+    }
+    return position;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// the delta goes both ways : previous state to this one and back
+static void delta_apply(const uint8_t* delta, size_t delta_size, uint8_t* state, size_t size, size_t target_size)
+{
+    if (target_size > size)
+        memset(&state[size], 0, target_size - size);
+
+    size_t position = 0, offset = 0;
+    while (position < delta_size)
+    {
+        offset += varint_read(delta, &position);
+        size_t literal_count = varint_read(delta, &position);
+        for(size_t i=0; i<literal_count; ++i)
+            state[offset + i] ^= delta[position + i];
+
+        offset += literal_count;
+        position += literal_count;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline struct undo_state* get_state(struct undo_context* context, uint32_t serial)
+{
+    return &context->states[serial & context->states_mask];
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline uint32_t current_serial(const struct undo_context* context)
+{
+    return context->first + context->num_states - 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// serial differences handle the wrap around of the counter
+static inline bool is_stored(const struct undo_context* context, uint32_t serial)
+{
+    return serial - context->first < context->num_states + context->num_redo;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static inline bool has_record(const struct undo_context* context)
+{
+    return context->num_states > 0 && context->states[context->first & context->states_mask].job == NO_JOB;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void cancel_job(struct undo_context* context, uint32_t job)
+{
+    pthread_mutex_lock(&context->mutex);
+    context->jobs[job % NUM_JOBS].cancelled = true;
+    pthread_mutex_unlock(&context->mutex);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void evict_oldest(struct undo_context* context)
+{
+    assert(context->num_states > 0 && context->num_redo == 0);
+    struct undo_state* oldest = get_state(context, context->first);
+    if (oldest->job != NO_JOB)
+        cancel_job(context, oldest->job);
+
+    context->used_bytes -= oldest->size;
+    context->raw_total -= oldest->raw_size;
+    context->first++;
+    context->num_states--;
+
+    if (context->num_states == 0)
+        context->head = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// the deltas following an evicted keyframe are still reachable from the newer deltas, but not once a keyframe follows them :
+// going back from a keyframe rebuilds the previous state from its own keyframe
+static void evict(struct undo_context* context)
+{
+    bool keyframe = get_state(context, context->first)->keyframe == context->first;
+    evict_oldest(context);
+
+    // a group without keyframe never gets a new one (see undo_end_snapshot), it's only looked for once
+    if (!keyframe || context->num_states == 0 || get_state(context, context->first)->keyframe == context->first)
+        return;
+
+    for(uint32_t serial=context->first+1; serial-context->first < context->num_states; ++serial)
+    {
+        if (get_state(context, serial)->keyframe == serial)
+        {
+            while (context->first != serial)
+                evict_oldest(context);
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// returns the position of size contiguous bytes in the ring buffer, the oldest states are evicted until they fit
+static size_t allocate(struct undo_context* context, size_t size)
+{
+    if (size > context->buffer_size)
+    {
+        // only a state bigger than the budget makes it grow
+        while (has_record(context))
+            evict_oldest(context);
+
+        log_warn("undo state of %u kb doesn't fit in the buffer, increasing it", size>>10);
+        free(context->buffer);
+        context->buffer_size = size;
+        context->buffer = (uint8_t*) malloc(context->buffer_size);
+    }
+
+    for(;;)
+    {
+        // the states not compressed yet are the newest ones, they have no data in the buffer
+        if (!has_record(context))
+            return 0;
+
+        size_t tail = get_state(context, context->first)->start_position;
+        if (tail < context->head)
+        {
+            if (context->head + size <= context->buffer_size)
+                return context->head;
+
+            // wraps around, the end of the buffer is left unused
+            if (size <= tail)
+                return 0;
+        }
+        else if (context->head + size <= tail)
+            return context->head;
+
+        evict(context);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void discard_redo(struct undo_context* context)
+{
+    if (context->num_redo == 0)
+        return;
+
+    // the states undone are the newest ones in the ring buffer, followed by the ones not compressed yet
+    if (get_state(context, current_serial(context) + 1)->job == NO_JOB)
+        context->head = get_state(context, current_serial(context) + 1)->start_position;
+
+    for(uint32_t i=1; i<=context->num_redo; ++i)
+    {
+        struct undo_state* state = get_state(context, current_serial(context) + i);
+        if (state->job != NO_JOB)
+            cancel_job(context, state->job);
+
+        context->used_bytes -= state->size;
+        context->raw_total -= state->raw_size;
+    }
+    context->num_redo = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// the compressed data is kept only if it's smaller
+static void deflate_job(tdefl_compressor* compressor, struct undo_job* job)
+{
+    size_t input_size = job->raw_size, output_size = job->raw_size;
+    tdefl_init(compressor, NULL, NULL, (int) tdefl_create_comp_flags_from_zip_params(DEFLATE_LEVEL, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+    tdefl_status status = tdefl_compress(compressor, job->raw, &input_size, job->compressed, &output_size, TDEFL_FINISH);
+    job->compressed_size = (status == TDEFL_STATUS_DONE && output_size < job->raw_size) ? output_size : job->raw_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void* deflate_thread(void* user_data)
+{
+    struct undo_context* context = (struct undo_context*) user_data;
+    pthread_mutex_lock(&context->mutex);
+    for(;;)
+    {
+        while (!context->quit && context->job_next == context->job_first + context->job_count)
+            pthread_cond_wait(&context->job_queued, &context->mutex);
+
+        if (context->quit)
+            break;
+
+        struct undo_job* job = &context->jobs[context->job_next % NUM_JOBS];
+        if (!job->cancelled)
+        {
+            pthread_mutex_unlock(&context->mutex);
+            deflate_job(context->compressor, job);
+            pthread_mutex_lock(&context->mutex);
+        }
+
+        job->status = job_done;
+        context->job_next++;
+        pthread_cond_broadcast(&context->job_done);
+    }
+    pthread_mutex_unlock(&context->mutex);
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void wait_jobs(struct undo_context* context, uint32_t job_count)
+{
+    pthread_mutex_lock(&context->mutex);
+    while (context->job_next - context->job_first < job_count)
+        pthread_cond_wait(&context->job_done, &context->mutex);
+    pthread_mutex_unlock(&context->mutex);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// the states before the serial are already in the buffer
+static void store_record(struct undo_context* context, uint32_t serial, const uint8_t* data, size_t size)
+{
+    size_t position = allocate(context, size);
+    memcpy(&context->buffer[position], data, size);
+    context->head = position + size;
+    context->used_bytes += size;
+
+    struct undo_state* state = get_state(context, serial);
+    state->start_position = position;
+    state->size = size;
+    state->job = NO_JOB;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+static void store_job(struct undo_context* context, struct undo_job* job)
+{
+    const uint8_t* data = (job->compressed_size < job->raw_size) ? job->compressed : job->raw;
+    store_record(context, job->serial, data, job->compressed_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// moves the compressed snapshots to the buffer, in order, the allocation can evict states so it waits until there is no redo
+static void collect_jobs(struct undo_context* context)
+{
+    if (context->num_redo > 0)
+        return;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&context->mutex);
+        struct undo_job* job = &context->jobs[context->job_first % NUM_JOBS];
+        bool done = context->job_count > 0 && job->status == job_done;
+        pthread_mutex_unlock(&context->mutex);
+
+        if (!done)
+            return;
+
+        // a job done is not touched by the thread
+        if (!job->cancelled)
+            store_job(context, job);
+
+        pthread_mutex_lock(&context->mutex);
+        job->status = job_free;
+        context->job_first++;
+        context->job_count--;
+        pthread_mutex_unlock(&context->mutex);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// every job is taken : the editor doesn't wait for the compression, the snapshot is stored uncompressed
+// the states waiting for their job come before it in the buffer, their jobs are cancelled and they're stored uncompressed too
+static void store_uncompressed(struct undo_context* context, size_t size)
+{
+    log_debug("every undo job is taken, storing the snapshot uncompressed");
+    for(uint32_t serial=context->first; serial-context->first < context->num_states; ++serial)
+    {
+        // the thread only reads the snapshot of a job, the buffer is kept until the job is collected
+        struct undo_state* state = get_state(context, serial);
+        if (state->job != NO_JOB)
+        {
+            const uint8_t* data = context->jobs[state->job % NUM_JOBS].raw;
+            cancel_job(context, state->job);
+            store_record(context, serial, data, state->raw_size);
+        }
+    }
+
+    uint32_t serial = context->first + context->num_states;
+    store_record(context, serial, context->snapshot, size);
+
+    struct undo_state* state = get_state(context, serial);
+    state->raw_size = size;
+    state->keyframe = serial;
+    context->num_states++;
+    context->raw_total += size;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// the snapshot buffer is handed over to a job, the state reads it until it's compressed
+static void queue_job(struct undo_context* context, size_t size)
+{
+    if (context->job_count == NUM_JOBS)
+    {
+        store_uncompressed(context, size);
+        return;
+    }
+
+    uint32_t job_index = context->job_first + context->job_count;
+    struct undo_job* job = &context->jobs[job_index % NUM_JOBS];
+    uint8_t* swap = job->raw;
+    job->raw = context->snapshot;
+    context->snapshot = swap;
+    job->raw_size = size;
+    job->serial = context->first + context->num_states;
+    job->cancelled = false;
+    job->status = job_queued;
+
+    struct undo_state* state = get_state(context, job->serial);
+    state->start_position = 0;
+    state->size = 0;
+    state->raw_size = size;
+    state->keyframe = job->serial;
+    state->job = job_index;
+    context->num_states++;
+    context->raw_total += size;
+
+    pthread_mutex_lock(&context->mutex);
+    context->job_count++;
+    pthread_cond_signal(&context->job_queued);
+    pthread_mutex_unlock(&context->mutex);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// data of a state in the deflate storage
+static void* read_state(struct undo_context* context, const struct undo_state* state)
+{
+    // the thread only reads the snapshot it compresses
+    if (state->job != NO_JOB)
+        return context->jobs[state->job % NUM_JOBS].raw;
+
+    if (state->size == state->raw_size)
+        return &context->buffer[state->start_position];
+
+    size_t size = tinfl_decompress_mem_to_mem(context->current, context->snapshot_capacity,
+                                              &context->buffer[state->start_position], state->size, 0);
+    if (size != state->raw_size)
+        log_error("undo state can't be inflated");
+
+    return context->current;
+}
+
 //-----------------------------------------------------------------------------------------------------------------------------
 struct undo_context* undo_init(size_t buffer_size, uint32_t max_states)
 {
-    log_info("initializaing undo context with a %u kb buffer and %u max states", buffer_size>>10, max_states);
-    struct undo_context* context = (struct undo_context*) malloc(sizeof(struct undo_context));
+    return undo_init_ex(buffer_size, max_states, undo_storage_full);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+struct undo_context* undo_init_ex(size_t buffer_size, uint32_t max_states, enum undo_storage storage)
+{
+    uint32_t num_states = 2;
+    while (num_states < max_states)
+        num_states *= 2;
+
+    log_info("initializaing undo context with a %u kb buffer and %u max states", buffer_size>>10, num_states);
+    struct undo_context* context = (struct undo_context*) calloc(1, sizeof(struct undo_context));
     context->buffer = (uint8_t*) malloc(buffer_size);
     context->buffer_size = buffer_size;
-    context->current_position = 0;
-    context->max_states = max_states;
-    context->states = (struct undo_state*) malloc(max_states * sizeof(struct undo_state));
-    context->num_states = 0;
+    context->states = (struct undo_state*) malloc(num_states * sizeof(struct undo_state));
+    context->states_mask = num_states - 1;
+    context->storage = storage;
+    context->snapshot_capacity = SNAPSHOT_INITIAL_SIZE;
+    context->snapshot = (uint8_t*) malloc(context->snapshot_capacity);
+
+    if (storage == undo_storage_delta)
+        context->delta = (uint8_t*) malloc(context->snapshot_capacity);
+
+    if (storage != undo_storage_full)
+        context->current = (uint8_t*) malloc(context->snapshot_capacity);
+
+    if (storage == undo_storage_deflate)
+    {
+        for(uint32_t i=0; i<NUM_JOBS; ++i)
+        {
+            context->jobs[i].raw = (uint8_t*) malloc(context->snapshot_capacity);
+            context->jobs[i].compressed = (uint8_t*) malloc(context->snapshot_capacity);
+        }
+        context->compressor = (tdefl_compressor*) malloc(sizeof(tdefl_compressor));
+        pthread_mutex_init(&context->mutex, NULL);
+        pthread_cond_init(&context->job_queued, NULL);
+        pthread_cond_init(&context->job_done, NULL);
+        pthread_create(&context->thread, NULL, deflate_thread, context);
+    }
     return context;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
 void undo_increase_buffer(struct undo_context* context)
 {
-    context->buffer_size *= 2;
-    context->buffer = (uint8_t*) realloc(context->buffer, context->buffer_size);
-    log_info("increasing undo buffer to %u kb", context->buffer_size>>10);
+    context->snapshot_capacity *= 2;
+    context->snapshot = (uint8_t*) realloc(context->snapshot, context->snapshot_capacity);
+    log_info("increasing undo snapshot buffer to %u kb", context->snapshot_capacity>>10);
+
+    if (context->storage == undo_storage_delta)
+        context->delta = (uint8_t*) realloc(context->delta, context->snapshot_capacity);
+
+    if (context->storage != undo_storage_full)
+        context->current = (uint8_t*) realloc(context->current, context->snapshot_capacity);
+
+    if (context->storage == undo_storage_deflate)
+    {
+        // the snapshots not compressed yet are kept, their buffers are swapped with the snapshot one
+        wait_jobs(context, context->job_count);
+        for(uint32_t i=0; i<NUM_JOBS; ++i)
+        {
+            context->jobs[i].raw = (uint8_t*) realloc(context->jobs[i].raw, context->snapshot_capacity);
+            context->jobs[i].compressed = (uint8_t*) realloc(context->jobs[i].compressed, context->snapshot_capacity);
+        }
+    }
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
 void* undo_begin_snapshot(struct undo_context* context, size_t* max_size)
 {
-    assert(context->current_position <= context->buffer_size);
+    *max_size = context->snapshot_capacity;
+    return context->snapshot;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void undo_end_snapshot(struct undo_context* context, void* data, size_t size)
+{
+    UNUSED_VARIABLE(data);
+    assert(data == context->snapshot && size <= context->snapshot_capacity);
+
+    discard_redo(context);
+    if (context->storage == undo_storage_deflate)
+        collect_jobs(context);
+
+    if (context->num_states > context->states_mask)
+        evict(context);
+
+    if (context->storage == undo_storage_deflate)
+    {
+        queue_job(context, size);
+        return;
+    }
+
+    uint32_t serial = context->first + context->num_states;
+    struct undo_state* previous = (context->num_states > 0) ? get_state(context, serial - 1) : NULL;
+    const uint8_t* data_stored = context->snapshot;
+    size_t size_stored = size;
+    uint32_t keyframe = serial;
+
+    if (context->storage == undo_storage_delta && previous != NULL)
+    {
+        // no periodic keyframe in a group that lost its own, it would cut the group off
+        bool intact = is_stored(context, previous->keyframe);
+        if (!intact || serial - previous->keyframe < UNDO_KEYFRAME_INTERVAL)
+        {
+            // a delta is only kept if it's smaller than the state
+            size_t delta_size = delta_encode(context->snapshot, size, context->current, context->current_size,
+                                             context->delta, (size > 0) ? size - 1 : 0);
+            if (delta_size > 0)
+            {
+                data_stored = context->delta;
+                size_stored = delta_size;
+                keyframe = previous->keyframe;
+            }
+        }
+    }
 
-    if (context->num_states >= context->max_states)
+    // the allocation can also evict the keyframe of the previous state
+    size_t position = allocate(context, size_stored);
+    if (keyframe == serial && context->num_states > 0 && !is_stored(context, get_state(context, serial - 1)->keyframe))
     {
-        context->max_states *= 2;
-        context->states = (struct undo_state*) realloc(context->states, context->max_states * sizeof(struct undo_state));
-        log_info("increasing undo max states to %u", context->max_states);
+        log_debug("undo states before the keyframe can't be rebuilt, evicting them");
+        while (context->num_states > 0)
+            evict_oldest(context);
     }
 
-    if (context->current_position == context->buffer_size)
-        undo_increase_buffer(context);
+    memcpy(&context->buffer[position], data_stored, size_stored);
+    context->head = position + size_stored;
+    context->used_bytes += size_stored;
+    context->raw_total += size;
+
+    // allocate can evict every state, the new one is then the oldest
+    if (context->num_states == 0)
+        context->first = serial;
 
-    *max_size = context->buffer_size - context->current_position;
-    return &context->buffer[context->current_position];
+    struct undo_state* state = get_state(context, serial);
+    state->start_position = position;
+    state->size = size_stored;
+    state->raw_size = size;
+    state->keyframe = keyframe;
+    state->job = NO_JOB;
+    context->num_states++;
+
+    if (context->storage == undo_storage_delta)
+    {
+        // the snapshot becomes the current state
+        uint8_t* swap = context->current;
+        context->current = context->snapshot;
+        context->snapshot = swap;
+        context->current_size = size;
+    }
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
-void undo_end_snapshot(struct undo_context* context, void* data, size_t size)
+// the current state is replaced by the previous one
+static void undo_delta(struct undo_context* context, const struct undo_state* state, const struct undo_state* previous)
 {
-    UNUSED_VARIABLE(data);
-    assert(data >= (void*)&context->buffer[context->current_position]);
-    assert(data < (void*)&context->buffer[context->buffer_size]);
-    assert(context->num_states < context->max_states);
-    struct undo_state* state = &context->states[context->num_states++];
-    state->start_position = context->current_position;
-    state->size = size;
-    context->current_position += size;
+    if (state->keyframe != previous->keyframe)
+    {
+        // no delta to go back from a keyframe, the previous state is rebuilt from its own keyframe
+        uint32_t serial = previous->keyframe;
+        const struct undo_state* keyframe = get_state(context, serial);
+        memcpy(context->current, &context->buffer[keyframe->start_position], keyframe->raw_size);
+        context->current_size = keyframe->raw_size;
+
+        for(const struct undo_state* s=keyframe; s!=previous; )
+        {
+            s = get_state(context, ++serial);
+            delta_apply(&context->buffer[s->start_position], s->size, context->current, context->current_size, s->raw_size);
+            context->current_size = s->raw_size;
+        }
+    }
+    else
+    {
+        delta_apply(&context->buffer[state->start_position], state->size, context->current, context->current_size, previous->raw_size);
+        context->current_size = previous->raw_size;
+    }
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
@@ -83,12 +687,52 @@ void* undo_undo(struct undo_context* context, size_t* output_size)
     // we need at least two states to backup one
     if (context->num_states > 1)
     {
+        struct undo_state* state = get_state(context, current_serial(context));
         context->num_states--;
-        context->current_position = context->states[context->num_states].start_position;
+        context->num_redo++;
 
         // get the previous state to be restored
-        struct undo_state* state = &context->states[context->num_states-1];
-        *output_size = state->size;
+        struct undo_state* previous = get_state(context, current_serial(context));
+        *output_size = previous->raw_size;
+
+        if (context->storage == undo_storage_delta)
+        {
+            undo_delta(context, state, previous);
+            return context->current;
+        }
+        if (context->storage == undo_storage_deflate)
+            return read_state(context, previous);
+
+        return &context->buffer[previous->start_position];
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void* undo_redo(struct undo_context* context, size_t* output_size)
+{
+    if (context->num_redo > 0)
+    {
+        context->num_states++;
+        context->num_redo--;
+
+        uint32_t serial = current_serial(context);
+        struct undo_state* state = get_state(context, serial);
+        *output_size = state->raw_size;
+
+        if (context->storage == undo_storage_delta)
+        {
+            if (state->keyframe == serial)
+                memcpy(context->current, &context->buffer[state->start_position], state->raw_size);
+            else
+                delta_apply(&context->buffer[state->start_position], state->size, context->current, context->current_size, state->raw_size);
+
+            context->current_size = state->raw_size;
+            return context->current;
+        }
+        if (context->storage == undo_storage_deflate)
+            return read_state(context, state);
+
         return &context->buffer[state->start_position];
     }
     return NULL;
@@ -97,8 +741,8 @@ void* undo_undo(struct undo_context* context, size_t* output_size)
 //-----------------------------------------------------------------------------------------------------------------------------
 void undo_stats(struct undo_context* context, float* buffer_usage_percentage, float* states_usage_percentage)
 {
-    *buffer_usage_percentage = (100.f * (float) context->current_position) / (float) context->buffer_size;
-    *states_usage_percentage = (100.f * (float) context->num_states) / (float) context->max_states;
+    *buffer_usage_percentage = (100.f * (float) context->used_bytes) / (float) context->buffer_size;
+    *states_usage_percentage = (100.f * (float) (context->num_states + context->num_redo)) / (float) (context->states_mask + 1);
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
@@ -107,9 +751,55 @@ uint32_t undo_get_num_states(struct undo_context* context)
     return context->num_states;
 }
 
+//-----------------------------------------------------------------------------------------------------------------------------
+uint32_t undo_get_num_redo(struct undo_context* context)
+{
+    return context->num_redo;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void undo_memory(struct undo_context* context, size_t* stored_bytes, size_t* raw_bytes)
+{
+    *stored_bytes = context->used_bytes;
+    *raw_bytes = context->raw_total;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void undo_finish(struct undo_context* context)
+{
+    if (context->storage == undo_storage_deflate)
+    {
+        wait_jobs(context, context->job_count);
+        collect_jobs(context);
+    }
+}
+
 //-----------------------------------------------------------------------------------------------------------------------------
 void undo_terminate(struct undo_context* context)
 {
+    if (context->storage == undo_storage_deflate)
+    {
+        pthread_mutex_lock(&context->mutex);
+        context->quit = true;
+        pthread_cond_signal(&context->job_queued);
+        pthread_mutex_unlock(&context->mutex);
+        pthread_join(context->thread, NULL);
+
+        for(uint32_t i=0; i<NUM_JOBS; ++i)
+        {
+            free(context->jobs[i].raw);
+            free(context->jobs[i].compressed);
+        }
+        free(context->compressor);
+        pthread_mutex_destroy(&context->mutex);
+        pthread_cond_destroy(&context->job_queued);
+        pthread_cond_destroy(&context->job_done);
+    }
+
+    free(context->snapshot);
+    free(context->current);
+    free(context->delta);
+    free(context->buffer);
     free(context->states);
     free(context);
 }
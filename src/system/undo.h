@@ -6,20 +6,37 @@
 
 //-----------------------------------------------------------------------------------------------------------------------------
 // Simple undo system
-//   * store states (no compression, no delta)
+//   * store states, as is or as a delta against the previous state (see undo_storage)
 //   * the last state stored is the current one, when undo functions is called it returns the state before the current one
+//   * the states undone can be redone until a new snapshot is taken
+//   * bounded memory : the states are kept in a ring buffer of the size given at init, when it's full the oldest states are
+//     evicted (with the deltas that depend on an evicted keyframe), the newer ones don't move
 //-----------------------------------------------------------------------------------------------------------------------------
 
+#define UNDO_KEYFRAME_INTERVAL (16)
+
+enum undo_storage
+{
+    undo_storage_full,      // each state is copied in the buffer
+    undo_storage_delta,     // xor against the previous state with the runs of zeros skipped, a full state (keyframe) every
+                            // UNDO_KEYFRAME_INTERVAL states or when the delta is not smaller : an undo applies one delta or
+                            // rebuilds the state from its keyframe with less than UNDO_KEYFRAME_INTERVAL deltas
+    undo_storage_deflate    // each state deflated (miniz, fast level) by a background thread, the snapshot only hands its buffer
+                            // over, an undo inflates the state or reads it from the snapshot not compressed yet
+};
+
 struct undo_context;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// allocate structures and buffer
+// allocate structures and buffer, buffer_size is the memory budget of the states and max_states_count (rounded up to a
+// power of two) the maximum number of states kept, nothing is allocated after the first snapshots
 struct undo_context* undo_init(size_t buffer_size, uint32_t max_states_count);
+struct undo_context* undo_init_ex(size_t buffer_size, uint32_t max_states_count, enum undo_storage storage);
 
-// realloc the undo buffer (x2)
+// the snapshot didn't fit : realloc the snapshot buffer (x2), the budget doesn't change
 void undo_increase_buffer(struct undo_context* context);
 
 // request memory for an undo snapshot
@@ -30,8 +47,18 @@ void undo_end_snapshot(struct undo_context* context, void* data, size_t size);
 // warning : you have to copy the data back as the pointer won't be valid after a new state
 void* undo_undo(struct undo_context* context, size_t* output_size);
 
+// returns the data of the state undone last, null if there is none (same warning as undo_undo)
+void* undo_redo(struct undo_context* context, size_t* output_size);
+
 void undo_stats(struct undo_context* context, float* buffer_usage_percentage, float* states_usage_percentage);
 uint32_t undo_get_num_states(struct undo_context* context);
+uint32_t undo_get_num_redo(struct undo_context* context);
+
+// bytes used by the states in the buffer and size of the same states stored as is
+void undo_memory(struct undo_context* context, size_t* stored_bytes, size_t* raw_bytes);
+
+// waits for the snapshots being compressed and stores them (deflate storage), nothing to do with the other storages
+void undo_finish(struct undo_context* context);
 
 // free memory
 void undo_terminate(struct undo_context* context);
@@ -40,4 +67,4 @@ void undo_terminate(struct undo_context* context);
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,132 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// cost of the wide bounding boxes (wide_aabb, 16 bits per coordinate) against the compact ones (quantized_aabb, 8 bits) on
+// every .tds of a folder
+//  * bandwidth : size of the aabb buffer and bytes of aabb read by the gather binning (each tile reads every aabb)
+//  * binning time without rasterization
+//  * up to 4K, one frame per scene is rasterized with both formats and the images must be identical
+//  * above 4K only the wide format is measured, compact clamps the culling
+//
+// usage : aabb_format_bench [folder] [frames] [threads]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define NUM_FORMATS (2)
+
+struct bench_result
+{
+    double binning_time;    // in seconds, all frames
+    double aabb_size;       // in bytes, all frames
+    double aabb_read;       // in bytes, all frames
+};
+
+static const char* format_names[NUM_FORMATS] = {"compact", "wide"};
+static const size_t format_sizes[NUM_FORMATS] = {sizeof(quantized_aabb), sizeof(wide_aabb)};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(struct renderer* r, std::vector<tds_scene>& scenes, const bench_resolution& res, uint32_t format, uint32_t num_frames)
+{
+    bench_result result = {0.0, 0.0, 0.0};
+    double num_tiles = (double)((res.width + TILE_SIZE - 1) / TILE_SIZE) * ((res.height + TILE_SIZE - 1) / TILE_SIZE);
+
+    for(tds_scene& scene : scenes)
+    {
+        // first frame is a warm-up
+        for(uint32_t frame=0; frame<num_frames+1; ++frame)
+        {
+            bench_draw(r, &scene, res.width, res.height, nullptr);
+
+            struct renderer_stats stats;
+            renderer_get_stats(r, &stats);
+            if (frame>0)
+            {
+                double size = (double) stats.num_commands * format_sizes[format];
+                result.binning_time += stats.binning_time;
+                result.aabb_size += size;
+                result.aabb_read += size * num_tiles;
+            }
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 10;
+    uint32_t num_threads = (argc > 3) ? (uint32_t) atoi(argv[3]) : 0;
+
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    fprintf(stdout, "%zu scenes, %u frames per scene, gather binning\n\n", scenes.size(), num_frames);
+    fprintf(stdout, "resolution   format    aabb KB   aabb read MB   binning ms   slowdown   images\n");
+
+    bool success = true;
+    for(const bench_resolution& res : bench_resolutions)
+    {
+        const bool compact_valid = (renderer_aabb_format_for_size(res.width, res.height) == aabb_compact);
+        size_t image_size = (size_t)res.width * res.height;
+        std::vector<uint32_t*> images[NUM_FORMATS];
+        double reference = 0.0;
+        double total_frames = (double) scenes.size() * num_frames;
+
+        for(uint32_t format=compact_valid ? 0 : 1; format<NUM_FORMATS; ++format)
+        {
+            struct renderer* r = renderer_init_ex(nullptr, res.width, res.height, (renderer_aabb_format) format);
+            renderer_set_num_threads(r, num_threads);
+
+            if (compact_valid)
+            {
+                for(tds_scene& scene : scenes)
+                {
+                    images[format].push_back((uint32_t*) malloc(image_size * sizeof(uint32_t)));
+                    bench_draw(r, &scene, res.width, res.height, images[format].back());
+                }
+            }
+
+            bench_result result = run(r, scenes, res, format, num_frames);
+            renderer_terminate(r);
+
+            double frame_time = result.binning_time / total_frames;
+            if (reference == 0.0)
+                reference = frame_time;
+
+            const char* images_status = "-";
+            if (compact_valid && format > 0)
+            {
+                bool identical = true;
+                for(size_t i=0; i<scenes.size(); ++i)
+                    identical &= bench_same_image(images[0][i], images[format][i], res.width, res.height);
+
+                success &= identical;
+                images_status = identical ? "identical" : "DIFFERENT";
+            }
+
+            fprintf(stdout, "%-10s   %-7s   %7.2f   %12.2f   %10.3f   %7.2fx   %s\n", res.name, format_names[format],
+                    result.aabb_size / (total_frames * 1024.0), result.aabb_read / (total_frames * 1024.0 * 1024.0),
+                    frame_time * 1000.0, frame_time / reference, images_status);
+        }
+
+        for(uint32_t format=0; format<NUM_FORMATS; ++format)
+            for(uint32_t* image : images[format])
+                free(image);
+    }
+
+    bench_free_scenes(&scenes);
+
+    return success ? 0 : -1;
+}
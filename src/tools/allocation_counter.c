@@ -0,0 +1,69 @@
+#include "allocation_counter.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#if defined(__GLIBC__)
+
+static atomic_uint_fast64_t g_allocated_bytes;
+
+// the executable's definitions take precedence over the ones of libc for every shared object, the real allocator is still
+// reachable through its internal names
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void* malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&g_allocated_bytes, size, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void* calloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&g_allocated_bytes, count * size, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void* realloc(void* ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&g_allocated_bytes, size, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+bool allocation_counter_supported(void)
+{
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+uint64_t allocation_counter_bytes(void)
+{
+    return atomic_load_explicit(&g_allocated_bytes, memory_order_relaxed);
+}
+
+#else
+
+//-----------------------------------------------------------------------------------------------------------------------------
+bool allocation_counter_supported(void)
+{
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+uint64_t allocation_counter_bytes(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// counts the bytes requested to malloc, calloc and realloc by the whole process (c++ allocations go through malloc)
+//  * link allocation_counter.c only in the tools that need it, it replaces the allocator entry points
+//  * only implemented with glibc, elsewhere allocation_counter_supported() returns false and the counter stays at 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool allocation_counter_supported(void);
+uint64_t allocation_counter_bytes(void);
+
+#ifdef __cplusplus
+}
+#endif
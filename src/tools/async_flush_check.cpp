@@ -0,0 +1,126 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// asynchronous flush of the cpu backend (renderer_set_async) : the commands of frame N+1 are built while frame N is
+// rendered, in the other frame buffers
+//  * every frame draws a different scene (the .tds of a folder and a big replicated scene, in a loop) so a buffer written
+//    while its frame is in flight changes the image, each image is compared to the synchronous rendering of its scene
+//  * float and half draw data, the buffers of both frames grow during the first frames
+//  * time of the loop, synchronous and pipelined
+//
+// usage : async_flush_check [folder] [frames]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define WIDTH (960)
+#define HEIGHT (540)
+#define REPLICATED_PRIMITIVES (20000)
+#define NUM_DRAWABLES (2)
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of frames that don't match their reference
+static uint32_t run(std::vector<tds_scene>& scenes, std::vector<uint32_t*>& references, uint32_t num_frames, bool async,
+                    enum renderer_draw_data_format format, double* time)
+{
+    struct renderer* r = renderer_init(nullptr, WIDTH, HEIGHT);
+    renderer_set_cache(r, false);
+    renderer_set_draw_data_format(r, format);
+    renderer_set_async(r, async);
+
+    const size_t image_size = WIDTH * HEIGHT * sizeof(uint32_t);
+    uint32_t* drawables[NUM_DRAWABLES];
+    for(uint32_t i=0; i<NUM_DRAWABLES; ++i)
+        drawables[i] = (uint32_t*) malloc(image_size);
+
+    uint32_t num_failed = 0;
+    uint64_t start = stm_now();
+    for(uint32_t frame=0; frame<=num_frames; ++frame)
+    {
+        // the flush of this frame waits for the previous one, its drawable can be read once this one is submitted
+        if (frame < num_frames)
+            bench_draw(r, &scenes[frame % scenes.size()], WIDTH, HEIGHT, drawables[frame % NUM_DRAWABLES]);
+        else
+            renderer_finish(r);
+
+        if (frame == 0)
+            continue;
+
+        uint32_t previous = frame - 1;
+        if (!bench_same_image(drawables[previous % NUM_DRAWABLES], references[previous % scenes.size()], WIDTH, HEIGHT))
+        {
+            fprintf(stderr, "frame %u (scene %zu) doesn't match the synchronous rendering\n", previous, previous % scenes.size());
+            num_failed++;
+        }
+    }
+    *time = stm_sec(stm_since(start));
+
+    renderer_terminate(r);
+    for(uint32_t i=0; i<NUM_DRAWABLES; ++i)
+        free(drawables[i]);
+    return num_failed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 0;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    // the big scene is followed by small ones : they are built while it's rendered
+    scenes.push_back(tds_scene_replicate(scenes, REPLICATED_PRIMITIVES));
+    if (num_frames == 0)
+        num_frames = (uint32_t) scenes.size() * 3;
+
+    const enum renderer_draw_data_format formats[] = {draw_data_float, draw_data_half};
+    const char* format_names[] = {"float", "half"};
+
+    fprintf(stdout, "%u frames of %zu scenes at %ux%u\n\n", num_frames, scenes.size(), WIDTH, HEIGHT);
+    fprintf(stdout, "draw data   sync ms   async ms   failed frames\n");
+
+    uint32_t num_failed = 0;
+    for(uint32_t f=0; f<2; ++f)
+    {
+        // references of the format, rendered one scene at a time
+        std::vector<uint32_t*> references(scenes.size());
+        struct renderer* r = renderer_init(nullptr, WIDTH, HEIGHT);
+        renderer_set_draw_data_format(r, formats[f]);
+        for(size_t i=0; i<scenes.size(); ++i)
+        {
+            references[i] = (uint32_t*) malloc(WIDTH * HEIGHT * sizeof(uint32_t));
+            bench_draw(r, &scenes[i], WIDTH, HEIGHT, references[i]);
+        }
+        renderer_terminate(r);
+
+        // consecutive frames must differ, otherwise an overwritten buffer could go unnoticed
+        for(size_t i=0; i<scenes.size(); ++i)
+            if (bench_same_image(references[i], references[(i + 1) % scenes.size()], WIDTH, HEIGHT))
+                fprintf(stderr, "scenes %zu and %zu give the same image\n", i, (i + 1) % scenes.size());
+
+        double sync_time, async_time;
+        uint32_t failed = run(scenes, references, num_frames, false, formats[f], &sync_time);
+        failed += run(scenes, references, num_frames, true, formats[f], &async_time);
+        fprintf(stdout, "%-9s   %7.2f   %8.2f   %13u\n", format_names[f], sync_time * 1000.0 / num_frames,
+                async_time * 1000.0 / num_frames, failed);
+
+        num_failed += failed;
+        for(uint32_t* image : references)
+            free(image);
+    }
+
+    bench_free_scenes(&scenes);
+
+    fprintf(stdout, "\n%s\n", (num_failed == 0) ? "success" : "failed");
+    return (num_failed == 0) ? 0 : -1;
+}
@@ -0,0 +1,60 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const struct bench_resolution bench_resolutions[resolution_count] =
+{
+    {"1080p", 1920, 1080},
+    {"1440p", 2560, 1440},
+    {"4K", 3840, 2160},
+    {"8K", 7680, 4320},
+    {"16K", 15360, 8640},
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool bench_load_scenes(const char* folder, std::vector<tds_scene>* scenes)
+{
+    if (tds_scene_load_folder(folder, scenes))
+        return true;
+
+    fprintf(stderr, "no scene found in '%s'\n", folder);
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void bench_free_scenes(std::vector<tds_scene>* scenes)
+{
+    for(tds_scene& scene : *scenes)
+        tds_scene_terminate(&scene);
+    scenes->clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void bench_draw(struct renderer* r, tds_scene* scene, uint32_t width, uint32_t height, void* framebuffer)
+{
+    renderer_begin_frame(r);
+    tds_scene_draw(scene, r, width, height);
+    renderer_end_frame(r);
+    renderer_flush(r, framebuffer);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool bench_same_image(const uint32_t* a, const uint32_t* b, uint32_t width, uint32_t height)
+{
+    return memcmp(a, b, (size_t)width * height * sizeof(uint32_t)) == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+float random_float(float min, float max)
+{
+    return min + (max - min) * (float(rand()) / float(RAND_MAX));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+float random_float_portable(uint32_t* state, float min, float max)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(*state >> 8) / (float)(1u << 24);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "tds_scene.h"
+
+struct renderer;
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// scaffolding shared by the benchmarks and checks : example scenes, resolutions, drawing a frame, random values
+
+#define EXAMPLES_PATH "../examples/"
+
+struct bench_resolution
+{
+    const char* name;
+    uint32_t width, height;
+};
+
+enum bench_resolution_id
+{
+    resolution_1080p,
+    resolution_1440p,
+    resolution_4k,
+    resolution_8k,
+    resolution_16k,
+    resolution_count
+};
+
+extern const struct bench_resolution bench_resolutions[resolution_count];
+
+// loads every .tds of the folder (see tds_scene_load_folder), prints an error and returns false if none was found
+bool bench_load_scenes(const char* folder, std::vector<tds_scene>* scenes);
+
+void bench_free_scenes(std::vector<tds_scene>* scenes);
+
+// one frame of the scene flushed in the framebuffer (binning only if null), width and height must match the renderer
+void bench_draw(struct renderer* r, tds_scene* scene, uint32_t width, uint32_t height, void* framebuffer);
+
+bool bench_same_image(const uint32_t* a, const uint32_t* b, uint32_t width, uint32_t height);
+
+// uniform in [min, max] with rand()
+float random_float(float min, float max);
+
+// same sequence on every platform, unlike rand()
+float random_float_portable(uint32_t* state, float min, float max);
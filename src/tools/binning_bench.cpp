@@ -0,0 +1,150 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// compares the binning modes of the cpu backend on every .tds of a folder at several resolutions
+//  * binning time is measured without rasterization (null drawable)
+//  * one frame per scene is rasterized with each mode and the images must be identical
+//  * for the hierarchical mode, the average and longest super-tile command lists are reported to tune SUPER_TILE_SIZE
+//
+// usage : binning_bench [folder] [frames] [threads]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define NUM_MODES (3)
+
+struct bench_result
+{
+    double binning_time;    // in seconds, all scenes
+    double num_nodes;
+    double num_tiles;
+    double super_tile_commands;     // average per super-tile
+    uint32_t super_tile_max_commands;
+};
+
+static const bench_resolution_id resolutions[] = {resolution_1080p, resolution_4k, resolution_8k};
+
+static const char* mode_names[] = {"gather", "scatter", "hierarchical"};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(struct renderer* r, std::vector<tds_scene>& scenes, uint32_t width, uint32_t height, uint32_t num_frames)
+{
+    bench_result result = {0.0, 0.0, 0.0, 0.0, 0};
+    for(tds_scene& scene : scenes)
+    {
+        // first frame is a warm-up
+        for(uint32_t frame=0; frame<num_frames+1; ++frame)
+        {
+            bench_draw(r, &scene, width, height, nullptr);
+
+            struct renderer_stats stats;
+            renderer_get_stats(r, &stats);
+            if (frame>0)
+            {
+                result.binning_time += stats.binning_time;
+                result.num_nodes += stats.num_nodes;
+                result.num_tiles += stats.num_tiles;
+                if (stats.num_super_tiles > 0)
+                    result.super_tile_commands += (double) stats.super_tile_commands / stats.num_super_tiles;
+                result.super_tile_max_commands = std::max(result.super_tile_max_commands, stats.super_tile_max_commands);
+            }
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of scenes that don't render the same with all modes
+static uint32_t compare_modes(struct renderer* r, std::vector<tds_scene>& scenes, uint32_t width, uint32_t height)
+{
+    size_t size = (size_t)width * height;
+    uint32_t* images[NUM_MODES];
+    for(uint32_t mode=0; mode<NUM_MODES; ++mode)
+        images[mode] = (uint32_t*) malloc(size * sizeof(uint32_t));
+
+    uint32_t num_differences = 0;
+    for(tds_scene& scene : scenes)
+    {
+        bool identical = true;
+        for(uint32_t mode=0; mode<NUM_MODES; ++mode)
+        {
+            renderer_set_binning(r, (renderer_binning) mode);
+            bench_draw(r, &scene, width, height, images[mode]);
+            identical &= bench_same_image(images[0], images[mode], width, height);
+        }
+
+        if (!identical)
+            num_differences++;
+    }
+
+    for(uint32_t mode=0; mode<NUM_MODES; ++mode)
+        free(images[mode]);
+
+    return num_differences;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 10;
+    uint32_t num_threads = (argc > 3) ? (uint32_t) atoi(argv[3]) : 0;
+
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_WARN);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    fprintf(stdout, "%zu scenes, %u frames per scene\n\n", scenes.size(), num_frames);
+    fprintf(stdout, "resolution   mode           threads   binning ms   speedup   nodes/frame   tiles/frame   cmds/super-tile   images\n");
+
+    bool success = true;
+    for(bench_resolution_id id : resolutions)
+    {
+        const bench_resolution& res = bench_resolutions[id];
+        struct renderer* r = renderer_init_ex(nullptr, res.width, res.height, renderer_aabb_format_for_size(res.width, res.height));
+        renderer_set_num_threads(r, num_threads);
+
+        uint32_t num_differences = compare_modes(r, scenes, res.width, res.height);
+        success &= (num_differences == 0);
+
+        double reference = 0.0;
+        double total_frames = (double) scenes.size() * num_frames;
+        for(uint32_t mode=0; mode<NUM_MODES; ++mode)
+        {
+            renderer_set_binning(r, (renderer_binning) mode);
+            bench_result result = run(r, scenes, res.width, res.height, num_frames);
+
+            struct renderer_stats stats;
+            renderer_get_stats(r, &stats);
+
+            double frame_time = result.binning_time / total_frames;
+            if (mode == binning_gather)
+                reference = frame_time;
+
+            char super_tiles[32] = "-";
+            if (mode == binning_hierarchical)
+                snprintf(super_tiles, sizeof(super_tiles), "%.1f (max %u)", result.super_tile_commands / total_frames,
+                         result.super_tile_max_commands);
+
+            fprintf(stdout, "%-10s   %-12s   %7u   %10.3f   %6.2fx   %11.0f   %11.0f   %15s   %s\n", res.name, mode_names[mode],
+                    stats.num_threads, frame_time * 1000.0, reference / frame_time, result.num_nodes / total_frames,
+                    result.num_tiles / total_frames, super_tiles, (num_differences == 0) ? "identical" : "DIFFERENT");
+        }
+
+        renderer_terminate(r);
+    }
+
+    bench_free_scenes(&scenes);
+
+    return success ? 0 : -1;
+}
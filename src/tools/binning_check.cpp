@@ -0,0 +1,455 @@
+#include "bench_common.h"
+#include "../renderer/cpu_kernels.h"
+#include "../renderer/cpu_tile_kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// parity check of the cpu port of the bin kernel against a brute-force coverage oracle
+//  * random primitives of every command_type and fill mode are binned alone on a small screen
+//  * the oracle samples the sdf (scalar reference kernels) at every pixel center : a pixel is covered if its distance is
+//    below the anti-aliasing width (alpha > 0), a tile is covered if at least one of its pixels is
+//  * a covered tile missing the command is an error, a tile binned without being covered only costs performance
+//  * the scatter binning (cpu_bin_command/cpu_bin_resolve) must give the same lists as cpu_bin
+//  * the hierarchical binning (cpu_bin_coarse/cpu_bin_fine) must give the same lists as cpu_bin
+//  * the tile arrays (cpu_bin_resolve_arrays/cpu_bin_compact) must hold the same lists as the linked lists
+//  * the same commands with wide_aabb bounding boxes must give the same lists
+//  * occlusion culling : a command removed from a tile by a later opaque primitive must be hidden at every pixel center
+//
+// usage : binning_check [shapes_per_type] [seed]
+// returns 0 if no covered tile is missing a command
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define SCREEN_TILES (16)
+#define SCREEN_SIZE (SCREEN_TILES * TILE_SIZE)
+#define NUM_TILES (SCREEN_TILES * SCREEN_TILES)
+#define AA_WIDTH (1.41421356f)
+
+struct check_result
+{
+    uint32_t covered;       // tiles touched according to the oracle
+    uint32_t binned;        // tiles with the command in their list
+    uint32_t missed;        // covered but not binned : error
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+// shapes of every size, partially outside the screen sometimes
+static uint32_t generate_data(command_type type, float* data)
+{
+    const float margin = 32.f;
+    const float lo = -margin, hi = SCREEN_SIZE + margin;
+    float angle = random_float(0.f, 6.2831853f);
+    float aperture = random_float(0.05f, 3.1415926f);
+
+    switch(type)
+    {
+    case primitive_disc :
+        data[0] = random_float(lo, hi); data[1] = random_float(lo, hi); data[2] = random_float(1.f, 96.f);
+        data[3] = random_float(.5f, 8.f);
+        return 4;
+    case primitive_oriented_box :
+    case primitive_ellipse :
+        data[0] = random_float(lo, hi); data[1] = random_float(lo, hi);
+        data[2] = data[0] + random_float(-96.f, 96.f); data[3] = data[1] + random_float(-96.f, 96.f);
+        data[4] = random_float(1.f, 64.f); data[5] = random_float(0.f, 8.f);
+        return 6;
+    case primitive_triangle :
+        for(int i=0; i<6; i+=2)
+        {
+            data[i] = (i == 0) ? random_float(lo, hi) : data[0] + random_float(-96.f, 96.f);
+            data[i+1] = (i == 0) ? random_float(lo, hi) : data[1] + random_float(-96.f, 96.f);
+        }
+        data[6] = random_float(0.f, 8.f);
+        return 7;
+    case primitive_pie :
+    case primitive_ring :
+        data[0] = random_float(lo, hi); data[1] = random_float(lo, hi); data[2] = random_float(4.f, 96.f);
+        data[3] = cosf(angle); data[4] = sinf(angle); data[5] = sinf(aperture); data[6] = cosf(aperture);
+        data[7] = random_float(.5f, 8.f);
+        return 8;
+    case primitive_uneven_capsule :
+    case primitive_trapezoid :
+        data[0] = random_float(lo, hi); data[1] = random_float(lo, hi);
+        data[2] = data[0] + random_float(-96.f, 96.f); data[3] = data[1] + random_float(-96.f, 96.f);
+        data[4] = random_float(1.f, 32.f); data[5] = random_float(1.f, 32.f); data[6] = random_float(0.f, 8.f);
+        return 7;
+    case primitive_aabox :
+        data[0] = random_float(lo, hi); data[1] = random_float(lo, hi);
+        data[2] = data[0] + random_float(1.f, 96.f); data[3] = data[1] + random_float(1.f, 96.f);
+        return 4;
+    default :
+        data[0] = random_float(lo, hi); data[1] = random_float(lo, hi);
+        return 2;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void fill_arguments(draw_cmd_arguments* args, draw_command* commands, quantized_aabb* commands_aabb,
+                           float* draw_data, uint32_t num_commands)
+{
+    memset(args, 0, sizeof(draw_cmd_arguments));
+    args->commands = commands;
+    args->commands_aabb = commands_aabb;
+    args->draw_data = draw_data;
+    args->clips[0] = {0, 0, SCREEN_SIZE, SCREEN_SIZE};
+    args->num_commands = num_commands;
+    args->max_nodes = MAX_NODES_COUNT;
+    args->num_tile_width = SCREEN_TILES;
+    args->num_tile_height = SCREEN_TILES;
+    args->aa_width = AA_WIDTH;
+    args->outline_width = 1.f;
+    args->occlusion_culling = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// commands of each tile as a bitfield
+static void read_lists(const tiles_data* tiles, uint32_t* tile_commands)
+{
+    for(uint32_t i=0; i<NUM_TILES; ++i)
+    {
+        tile_commands[i] = 0;
+        for(tile_node node = tiles->head[i]; node.next != INVALID_INDEX; node = tiles->nodes[node.next])
+            tile_commands[i] |= 1u << node.command_index;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void read_arrays(const tile_arrays* arrays, uint32_t* tile_commands)
+{
+    for(uint32_t i=0; i<NUM_TILES; ++i)
+    {
+        tile_commands[i] = 0;
+        for(uint32_t j=arrays->tile_offsets[i]; j<arrays->tile_offsets[i+1]; ++j)
+            tile_commands[i] |= 1u << arrays->commands[j];
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// bins every tile with cpu_bin and returns for each tile a bitfield of the commands in its list
+// the scatter and hierarchical binnings must give the same lists
+static uint32_t num_scatter_mismatches = 0;
+static uint32_t num_hierarchical_mismatches = 0;
+static uint32_t num_arrays_mismatches = 0;
+static uint32_t num_wide_mismatches = 0;
+
+static void bin_all_tiles(const draw_cmd_arguments* args, uint32_t* tile_commands)
+{
+    static tile_node head[NUM_TILES];
+    static std::vector<tile_node> nodes(MAX_NODES_COUNT);
+    static uint32_t tile_indices[NUM_TILES];
+    static uint32_t tile_counts[NUM_TILES * 2];
+    static float smooth_borders[32];
+    static uint32_t tile_offsets[NUM_TILES + 1];
+    static std::vector<tile_command> array_commands(MAX_NODES_COUNT);
+
+    tiles_data tiles = {.head = head, .nodes = nodes.data(), .tile_indices = tile_indices};
+    counters counter;
+    memset(&counter, 0, sizeof(counter));
+    memset(head, 0xff, sizeof(head));
+
+    for(uint16_t y=0; y<SCREEN_TILES; ++y)
+        for(uint16_t x=0; x<SCREEN_TILES; ++x)
+            cpu_bin(args, &tiles, &counter, x, y);
+
+    read_lists(&tiles, tile_commands);
+
+    std::vector<bin_hit> hits;
+    cpu_bin_smooth_borders(args, smooth_borders);
+    for(uint32_t i=0; i<args->num_commands; ++i)
+        cpu_bin_command(args, i, smooth_borders[i], &hits);
+
+    memset(&counter, 0, sizeof(counter));
+    memset(head, 0xff, sizeof(head));
+    cpu_bin_resolve(args, &hits, 1, tile_counts, &tiles, &counter);
+
+    uint32_t scatter_commands[NUM_TILES];
+    read_lists(&tiles, scatter_commands);
+    if (memcmp(scatter_commands, tile_commands, sizeof(scatter_commands)) != 0)
+        num_scatter_mismatches++;
+
+    tile_arrays arrays = {.tile_offsets = tile_offsets, .commands = array_commands.data(), .tile_indices = tile_indices};
+    uint32_t arrays_commands[NUM_TILES];
+    cpu_bin_resolve_arrays(args, &hits, 1, tile_counts, &arrays, &counter);
+    read_arrays(&arrays, arrays_commands);
+    if (memcmp(arrays_commands, tile_commands, sizeof(arrays_commands)) != 0)
+        num_arrays_mismatches++;
+
+    const uint16_t num_super_tiles = (SCREEN_TILES + SUPER_TILE_SIZE - 1) / SUPER_TILE_SIZE;
+    std::vector<uint32_t> super_tiles[num_super_tiles * num_super_tiles];
+    for(uint16_t y=0; y<num_super_tiles; ++y)
+        for(uint16_t x=0; x<num_super_tiles; ++x)
+            cpu_bin_coarse(args, x, y, &super_tiles[y * num_super_tiles + x]);
+
+    memset(&counter, 0, sizeof(counter));
+    memset(head, 0xff, sizeof(head));
+    for(uint16_t y=0; y<SCREEN_TILES; ++y)
+        for(uint16_t x=0; x<SCREEN_TILES; ++x)
+        {
+            const std::vector<uint32_t>& commands = super_tiles[(y / SUPER_TILE_SIZE) * num_super_tiles + x / SUPER_TILE_SIZE];
+            cpu_bin_fine(args, commands.data(), (uint32_t) commands.size(), &tiles, &counter, x, y);
+        }
+
+    uint32_t hierarchical_commands[NUM_TILES];
+    read_lists(&tiles, hierarchical_commands);
+    if (memcmp(hierarchical_commands, tile_commands, sizeof(hierarchical_commands)) != 0)
+        num_hierarchical_mismatches++;
+
+    cpu_bin_compact(args, &tiles, &arrays);
+    read_arrays(&arrays, arrays_commands);
+    if (memcmp(arrays_commands, tile_commands, sizeof(arrays_commands)) != 0)
+        num_arrays_mismatches++;
+
+    wide_aabb wide_aabbs[32];
+    for(uint32_t i=0; i<args->num_commands; ++i)
+    {
+        const quantized_aabb& box = args->commands_aabb[i];
+        wide_aabbs[i] = {.min_x = box.min_x, .min_y = box.min_y, .max_x = box.max_x, .max_y = box.max_y};
+    }
+
+    draw_cmd_arguments wide_args = *args;
+    wide_args.commands_aabb = nullptr;
+    wide_args.commands_wide_aabb = wide_aabbs;
+
+    memset(&counter, 0, sizeof(counter));
+    memset(head, 0xff, sizeof(head));
+    for(uint16_t y=0; y<SCREEN_TILES; ++y)
+        for(uint16_t x=0; x<SCREEN_TILES; ++x)
+            cpu_bin(&wide_args, &tiles, &counter, x, y);
+
+    uint32_t wide_commands[NUM_TILES];
+    read_lists(&tiles, wide_commands);
+    if (memcmp(wide_commands, tile_commands, sizeof(wide_commands)) != 0)
+        num_wide_mismatches++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// minimum and maximum distance of the primitive over the pixel centers of the tile
+static float2 tile_distance_range(const cpu_tile_kernels* reference, uint8_t packed_type, const float* data, uint32_t tile)
+{
+    static float distances[TILE_SIZE * TILE_SIZE];
+    const pixel_range full_tile = {0, 0, TILE_SIZE, TILE_SIZE};
+    float2 origin = float2(float((tile % SCREEN_TILES) * TILE_SIZE), float((tile / SCREEN_TILES) * TILE_SIZE));
+
+    reference->distances(packed_type, data, &full_tile, origin, distances);
+
+    float2 result = float2(1e30f, -1e30f);
+    for(uint32_t i=0; i<TILE_SIZE * TILE_SIZE; ++i)
+    {
+        result.x = fminf(result.x, distances[i]);
+        result.y = fmaxf(result.y, distances[i]);
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static float tile_min_distance(const cpu_tile_kernels* reference, uint8_t packed_type, const float* data, uint32_t tile)
+{
+    return tile_distance_range(reference, packed_type, data, tile).x;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void accumulate(check_result* result, bool covered, bool binned)
+{
+    result->covered += covered ? 1 : 0;
+    result->binned += binned ? 1 : 0;
+    result->missed += (covered && !binned) ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// one primitive alone
+static check_result check_primitive(const cpu_tile_kernels* reference, command_type type, primitive_fillmode fillmode, uint32_t num_shapes)
+{
+    check_result result = {0, 0, 0};
+    draw_command command = {.type = pack_type(type, fillmode), .clip_index = 0, .op = op_add, .custom_data = 'A',
+                            .color = draw_color(0xffffffff), .data_index = 0};
+    quantized_aabb everywhere = {0, 0, UINT8_MAX, UINT8_MAX};
+    float data[8];
+    uint32_t tile_commands[NUM_TILES];
+
+    for(uint32_t shape=0; shape<num_shapes; ++shape)
+    {
+        generate_data(type, data);
+
+        draw_cmd_arguments args;
+        fill_arguments(&args, &command, &everywhere, data, 1);
+        bin_all_tiles(&args, tile_commands);
+
+        for(uint32_t tile=0; tile<NUM_TILES; ++tile)
+        {
+            // chars are sampled from the font, the bin kernel never culls them
+            bool covered = (type == primitive_char) || tile_min_distance(reference, command.type, data, tile) < AA_WIDTH;
+            accumulate(&result, covered, tile_commands[tile] != 0);
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// begin, two smooth-unioned primitives, end : the primitives must be binned where they are within the smooth border
+static check_result check_combination(const cpu_tile_kernels* reference, command_type type, uint32_t num_shapes)
+{
+    check_result result = {0, 0, 0};
+    quantized_aabb everywhere[4];
+    for(quantized_aabb& box : everywhere)
+        box = {0, 0, UINT8_MAX, UINT8_MAX};
+
+    uint32_t tile_commands[NUM_TILES];
+    float data[1 + 8 + 8 + 1];
+
+    for(uint32_t shape=0; shape<num_shapes; ++shape)
+    {
+        float smoothness = random_float(0.f, 32.f);
+        data[0] = smoothness;
+        uint32_t first = 1;
+        uint32_t second = first + generate_data(type, &data[first]);
+        uint32_t end = second + generate_data(type, &data[second]);
+        data[end] = smoothness;
+
+        draw_command commands[4] =
+        {
+            {.type = pack_type(combination_begin, fill_solid), .clip_index = 0, .op = op_add, .custom_data = 0, .color = draw_color(0xffffffff), .data_index = 0},
+            {.type = pack_type(type, fill_solid), .clip_index = 0, .op = op_union, .custom_data = 0, .color = draw_color(0xffffffff), .data_index = first},
+            {.type = pack_type(type, fill_solid), .clip_index = 0, .op = op_union, .custom_data = 0, .color = draw_color(0xffffffff), .data_index = second},
+            {.type = pack_type(combination_end, fill_solid), .clip_index = 0, .op = op_add, .custom_data = 0, .color = draw_color(0xffffffff), .data_index = end},
+        };
+
+        draw_cmd_arguments args;
+        fill_arguments(&args, commands, everywhere, data, 4);
+        bin_all_tiles(&args, tile_commands);
+
+        float threshold = fmaxf(AA_WIDTH, smoothness);
+        for(uint32_t tile=0; tile<NUM_TILES; ++tile)
+        {
+            for(uint32_t i=1; i<3; ++i)
+            {
+                bool covered = tile_min_distance(reference, commands[i].type, &data[commands[i].data_index], tile) < threshold;
+                bool binned = (tile_commands[tile] & (1u << i)) != 0;
+
+                // a primitive without its begin/end would be drawn outside of the combination
+                if (binned && (tile_commands[tile] & 0x9) != 0x9)
+                    binned = false;
+
+                accumulate(&result, covered, binned);
+            }
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// a box over the whole screen then an opaque primitive : the box can only be culled from the tiles where every pixel center
+// is inside the primitive. Here covered counts the tiles fully inside the primitive, binned the tiles where the box is culled
+static check_result check_cover(const cpu_tile_kernels* reference, command_type type, uint32_t num_shapes)
+{
+    check_result result = {0, 0, 0};
+    quantized_aabb everywhere[2];
+    for(quantized_aabb& box : everywhere)
+        box = {0, 0, UINT8_MAX, UINT8_MAX};
+
+    uint32_t tile_commands[NUM_TILES];
+    float data[4 + 8] = {0.f, 0.f, SCREEN_SIZE, SCREEN_SIZE};
+
+    draw_command commands[2] =
+    {
+        {.type = pack_type(primitive_aabox, fill_solid), .clip_index = 0, .op = op_add, .custom_data = 0, .color = draw_color(0xffffffff), .data_index = 0},
+        {.type = pack_type(type, fill_solid), .clip_index = 0, .op = op_add, .custom_data = 0, .color = draw_color(0xff00ff00), .data_index = 4},
+    };
+
+    for(uint32_t shape=0; shape<num_shapes; ++shape)
+    {
+        generate_data(type, &data[4]);
+
+        draw_cmd_arguments args;
+        fill_arguments(&args, commands, everywhere, data, 2);
+        bin_all_tiles(&args, tile_commands);
+
+        for(uint32_t tile=0; tile<NUM_TILES; ++tile)
+        {
+            bool inside = tile_distance_range(reference, commands[1].type, &data[4], tile).y <= 0.f;
+            bool culled = (tile_commands[tile] & 1) == 0;
+            result.covered += inside ? 1 : 0;
+            result.binned += culled ? 1 : 0;
+            result.missed += (culled && !inside) ? 1 : 0;
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool report(const char* name, const char* fillmode, check_result result)
+{
+    double overdraw = (result.covered > 0) ? (double) result.binned / result.covered : 0.0;
+    fprintf(stdout, "%-16s %-12s %8u %8u %8u %10.2f   %s\n", name, fillmode, result.covered, result.binned, result.missed,
+            overdraw, (result.missed == 0) ? "ok" : "FAILED");
+    return result.missed == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    uint32_t num_shapes = (argc > 1) ? (uint32_t) atoi(argv[1]) : 256;
+    uint32_t seed = (argc > 2) ? (uint32_t) atoi(argv[2]) : 0x70D33;
+    srand(seed);
+
+    const cpu_tile_kernels* reference;
+    cpu_get_all_tile_kernels(&reference, 1);
+
+    struct {const char* name; command_type type;} primitives[] =
+    {
+        {"char", primitive_char}, {"aabox", primitive_aabox}, {"oriented box", primitive_oriented_box},
+        {"disc", primitive_disc}, {"triangle", primitive_triangle}, {"ellipse", primitive_ellipse},
+        {"pie", primitive_pie}, {"ring", primitive_ring}, {"uneven capsule", primitive_uneven_capsule},
+        {"trapezoid", primitive_trapezoid}
+    };
+
+    const char* fillmode_names[fill_last] = {"solid", "outline", "hollow"};
+
+    fprintf(stdout, "%u shapes per test, %dx%d screen, seed %u\n\n", num_shapes, SCREEN_SIZE, SCREEN_SIZE, seed);
+    fprintf(stdout, "%-16s %-12s %8s %8s %8s %10s\n", "command", "fill", "covered", "binned", "missed", "binned/cov");
+
+    bool success = true;
+    for(auto& primitive : primitives)
+        for(uint32_t fillmode=0; fillmode<fill_last; ++fillmode)
+            success &= report(primitive.name, fillmode_names[fillmode],
+                              check_primitive(reference, primitive.type, (primitive_fillmode) fillmode, num_shapes));
+
+    // combination_begin and combination_end
+    for(auto& primitive : primitives)
+        if (primitive.type != primitive_char && primitive.type != primitive_aabox)
+            success &= report(primitive.name, "combination", check_combination(reference, primitive.type, num_shapes));
+
+    // occlusion culling, "binned/cov" is the share of the fully covered tiles where the box is culled
+    for(auto& primitive : primitives)
+        if (primitive.type != primitive_char)
+            success &= report(primitive.name, "cover", check_cover(reference, primitive.type, num_shapes));
+
+    if (num_scatter_mismatches > 0)
+    {
+        fprintf(stdout, "\nscatter binning differs from gather binning in %u tests\n", num_scatter_mismatches);
+        success = false;
+    }
+
+    if (num_hierarchical_mismatches > 0)
+    {
+        fprintf(stdout, "\nhierarchical binning differs from gather binning in %u tests\n", num_hierarchical_mismatches);
+        success = false;
+    }
+
+    if (num_arrays_mismatches > 0)
+    {
+        fprintf(stdout, "\ntile arrays differ from the linked lists in %u tests\n", num_arrays_mismatches);
+        success = false;
+    }
+
+    if (num_wide_mismatches > 0)
+    {
+        fprintf(stdout, "\nwide bounding boxes give different lists in %u tests\n", num_wide_mismatches);
+        success = false;
+    }
+
+    fprintf(stdout, "\n%s\n", success ? "binning parity ok" : "binning parity FAILED");
+    return success ? 0 : -1;
+}
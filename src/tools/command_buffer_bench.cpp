@@ -0,0 +1,264 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include "../renderer/renderer_private.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// growable command buffers (PushArray with overflow chunks) against the fixed buffers they replaced
+//  * push : a frame of N commands (command, 4 floats of draw data, aabb) pushed in fixed buffers of MAX_COMMANDS, and in
+//    growable buffers that start at INITIAL_COMMANDS and are linearized like the cpu backend does
+//  * renderer : command building of replicated scenes, first frame (buffers grow) and following frames
+//
+// usage : command_buffer_bench [folder] [frames]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define DATA_PER_COMMAND (4)
+
+// the previous PushArray : a buffer of fixed size, elements are dropped when it's full
+template<class T>
+struct fixed_array
+{
+    T* data;
+    uint32_t num_elements;
+    uint32_t max_elements;
+
+    T* NewMultiple(uint32_t count)
+    {
+        T* output = nullptr;
+        if (num_elements + count < max_elements)
+        {
+            output = &data[num_elements];
+            num_elements += count;
+        }
+        return output;
+    }
+};
+
+struct push_result
+{
+    double first_frame;         // in seconds
+    double steady_frame;        // median of the following frames
+    uint32_t num_pushed;
+    uint32_t num_allocations;   // chunks and buffer growths of all the frames
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static double median(std::vector<double>& times)
+{
+    std::sort(times.begin(), times.end());
+    return times[(times.size() - 1) / 2];
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static inline void write_command(draw_command* cmd, float* data, wide_aabb* box, uint32_t i, uint32_t data_index)
+{
+    cmd->type = pack_type(primitive_disc, fill_solid);
+    cmd->data_index = data_index;
+    cmd->clip_index = 0;
+    for(uint32_t k=0; k<DATA_PER_COMMAND; ++k)
+        data[k] = (float) (i + k);
+    *box = (wide_aabb) {.min_x = (uint16_t) (i & 127), .min_y = 0, .max_x = (uint16_t) (i & 127), .max_y = 8};
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static push_result push_fixed(uint32_t num_commands, uint32_t num_frames)
+{
+    fixed_array<draw_command> commands = {(draw_command*) malloc(sizeof(draw_command) * MAX_COMMANDS), 0, MAX_COMMANDS};
+    fixed_array<float> draw_data = {(float*) malloc(sizeof(float) * MAX_COMMANDS * 4), 0, MAX_COMMANDS * 4};
+    fixed_array<wide_aabb> aabbs = {(wide_aabb*) malloc(sizeof(wide_aabb) * MAX_COMMANDS), 0, MAX_COMMANDS};
+
+    push_result result = {};
+    std::vector<double> times;
+    for(uint32_t frame=0; frame<num_frames; ++frame)
+    {
+        commands.num_elements = draw_data.num_elements = aabbs.num_elements = 0;
+        uint64_t start = stm_now();
+        for(uint32_t i=0; i<num_commands; ++i)
+        {
+            draw_command* cmd = commands.NewMultiple(1);
+            float* data = draw_data.NewMultiple(DATA_PER_COMMAND);
+            wide_aabb* box = aabbs.NewMultiple(1);
+            if (cmd != nullptr && data != nullptr && box != nullptr)
+                write_command(cmd, data, box, i, draw_data.num_elements - DATA_PER_COMMAND);
+        }
+        double time = stm_sec(stm_since(start));
+        if (frame == 0)
+            result.first_frame = time;
+        else
+            times.push_back(time);
+    }
+
+    result.steady_frame = times.empty() ? result.first_frame : median(times);
+    result.num_pushed = commands.num_elements;
+    free(commands.data);
+    free(draw_data.data);
+    free(aabbs.data);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// same policy as the cpu backend : the buffer grows to the high-water mark, at least twice bigger
+template<class T>
+static T* linearize(PushArray<T>& array, T* buffer, uint32_t* capacity, uint32_t* num_allocations)
+{
+    if (array.IsContiguous())
+        return buffer;
+
+    if (array.GetNumElements() <= *capacity)
+    {
+        array.Linearize(buffer, *capacity * sizeof(T));
+        return buffer;
+    }
+
+    uint32_t new_capacity = std::max(array.GetHighWaterMark(), *capacity * 2);
+    T* output = (T*) malloc(sizeof(T) * new_capacity);
+    array.Linearize(output, new_capacity * sizeof(T));
+    free(buffer);
+    *capacity = new_capacity;
+    (*num_allocations)++;
+    return output;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static push_result push_growable(uint32_t num_commands, uint32_t num_frames)
+{
+    uint32_t commands_capacity = INITIAL_COMMANDS, data_capacity = INITIAL_DRAWDATA, aabbs_capacity = INITIAL_COMMANDS;
+    draw_command* commands_buffer = (draw_command*) malloc(sizeof(draw_command) * commands_capacity);
+    float* data_buffer = (float*) malloc(sizeof(float) * data_capacity);
+    wide_aabb* aabbs_buffer = (wide_aabb*) malloc(sizeof(wide_aabb) * aabbs_capacity);
+
+    PushArray<draw_command> commands;
+    PushArray<float> draw_data;
+    PushArray<wide_aabb> aabbs;
+
+    push_result result = {};
+    std::vector<double> times;
+    for(uint32_t frame=0; frame<num_frames; ++frame)
+    {
+        commands.Set(commands_buffer, sizeof(draw_command) * commands_capacity);
+        draw_data.Set(data_buffer, sizeof(float) * data_capacity);
+        aabbs.Set(aabbs_buffer, sizeof(wide_aabb) * aabbs_capacity);
+
+        // the time includes the linearization, done by backend_unmap_buffers
+        uint64_t start = stm_now();
+        for(uint32_t i=0; i<num_commands; ++i)
+        {
+            draw_command* cmd = commands.NewMultiple(1);
+            float* data = draw_data.NewMultiple(DATA_PER_COMMAND);
+            wide_aabb* box = aabbs.NewMultiple(1);
+            if (cmd != nullptr && data != nullptr && box != nullptr)
+                write_command(cmd, data, box, i, draw_data.GetNumElements() - DATA_PER_COMMAND);
+        }
+        commands_buffer = linearize(commands, commands_buffer, &commands_capacity, &result.num_allocations);
+        data_buffer = linearize(draw_data, data_buffer, &data_capacity, &result.num_allocations);
+        aabbs_buffer = linearize(aabbs, aabbs_buffer, &aabbs_capacity, &result.num_allocations);
+        double time = stm_sec(stm_since(start));
+
+        if (frame == 0)
+            result.first_frame = time;
+        else
+            times.push_back(time);
+    }
+
+    result.steady_frame = times.empty() ? result.first_frame : median(times);
+    result.num_pushed = commands.GetNumElements();
+    result.num_allocations += commands.GetNumAllocations() + draw_data.GetNumAllocations() + aabbs.GetNumAllocations();
+
+    // the last data_index must point to the last data after the linearization
+    if (num_commands > 0 && commands_buffer[num_commands-1].data_index != (num_commands-1) * DATA_PER_COMMAND)
+        fprintf(stderr, "linearization failed\n");
+
+    free(commands_buffer);
+    free(data_buffer);
+    free(aabbs_buffer);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void print_push(const char* name, uint32_t num_commands, const push_result& result)
+{
+    fprintf(stdout, "%-9s %8u   %8u   %8.3f   %8.3f   %8.2f   %11u\n", name, num_commands, result.num_pushed,
+            result.first_frame * 1000.0, result.steady_frame * 1000.0, result.steady_frame * 1e9 / std::max(num_commands, 1u),
+            result.num_allocations);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void bench_renderer(std::vector<tds_scene>& scenes, uint32_t num_primitives, uint32_t num_frames)
+{
+    tds_scene scene = tds_scene_replicate(scenes, num_primitives);
+    struct renderer* r = renderer_init(nullptr, 1920, 1080);
+    renderer_set_cache(r, false);
+
+    std::vector<double> times;
+    double first_frame = 0.0;
+    uint32_t first_chunks = 0;
+    renderer_stats stats;
+    for(uint32_t frame=0; frame<num_frames; ++frame)
+    {
+        uint64_t start = stm_now();
+        renderer_begin_frame(r);
+        tds_scene_draw(&scene, r, 1920, 1080);
+        renderer_end_frame(r);
+        double time = stm_sec(stm_since(start));
+
+        renderer_get_stats(r, &stats);
+        if (frame == 0)
+        {
+            first_frame = time;
+            first_chunks = stats.num_overflow_chunks;
+        }
+        else
+            times.push_back(time);
+    }
+
+    double steady_frame = times.empty() ? first_frame : median(times);
+    fprintf(stdout, "%10u   %8u   %9u   %8.3f   %8.3f   %9.1f   %12u   %11u\n", num_primitives, stats.num_commands,
+            stats.peak_draw_data, first_frame * 1000.0, steady_frame * 1000.0, stats.command_buffers_size / 1024.0,
+            first_chunks, stats.num_overflow_chunks - first_chunks);
+
+    renderer_terminate(r);
+    tds_scene_terminate(&scene);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 20;
+    if (num_frames < 2) num_frames = 2;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    fprintf(stdout, "push : %u frames, fixed buffers of %u commands, growable buffers start at %u commands\n\n", num_frames,
+            MAX_COMMANDS, INITIAL_COMMANDS);
+    fprintf(stdout, "buffers   commands     pushed   first ms  steady ms   ns/cmd   allocations\n");
+
+    const uint32_t counts[] = {1000, 10000, 60000, 250000};
+    for(uint32_t count : counts)
+    {
+        print_push("fixed", count, push_fixed(count, num_frames));
+        print_push("growable", count, push_growable(count, num_frames));
+    }
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    fprintf(stdout, "\nrenderer : command building at 1920x1080, cache disabled, %u frames\n\n", num_frames);
+    fprintf(stdout, "primitives   commands   draw data   first ms  steady ms   buffers KB   first chunks   then chunks\n");
+
+    const uint32_t primitives[] = {1000, 10000, 100000};
+    for(uint32_t count : primitives)
+        bench_renderer(scenes, count, num_frames);
+
+    bench_free_scenes(&scenes);
+
+    return 0;
+}
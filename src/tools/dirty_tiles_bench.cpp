@@ -0,0 +1,116 @@
+#include "bench_common.h"
+#include "../editor/primitive.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// incremental rendering of the cpu backend on every .tds of a folder : a primitive is dragged a few pixels per frame, like
+// in the editor, and each frame is rendered by an incremental renderer and by a full one
+//  * skipped tiles and flush time (binning + rasterization) of both
+//  * every incremental frame must be identical to the full one
+//
+// usage : dirty_tiles_bench [folder] [frames] [width] [height]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+struct bench_result
+{
+    double full_time;           // in seconds, all frames
+    double incremental_time;
+    double skipped_tiles;
+    uint32_t num_mismatches;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static double flush(struct renderer* r, tds_scene* scene, uint32_t width, uint32_t height, uint32_t* framebuffer, renderer_stats* stats)
+{
+    bench_draw(r, scene, width, height, framebuffer);
+    renderer_get_stats(r, stats);
+    return stats->binning_time + stats->rasterization_time;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(tds_scene* scene, uint32_t num_frames, uint32_t width, uint32_t height)
+{
+    bench_result result = {0.0, 0.0, 0.0, 0};
+    struct renderer* full = renderer_init(nullptr, width, height);
+    struct renderer* incremental = renderer_init(nullptr, width, height);
+    renderer_set_incremental(incremental, true);
+
+    size_t image_size = (size_t)width * height * sizeof(uint32_t);
+    uint32_t* reference = (uint32_t*) malloc(image_size);
+    uint32_t* image = (uint32_t*) malloc(image_size);
+
+    // the dragged primitive is the middle one, moving along a small circle
+    struct primitive* dragged = &scene->primitives[scene->num_primitives / 2];
+    struct primitive original = *dragged;
+
+    renderer_stats stats;
+    flush(incremental, scene, width, height, image, &stats);
+    for(uint32_t frame=0; frame<num_frames; ++frame)
+    {
+        float angle = (float) frame * 0.1f;
+        *dragged = original;
+        primitive_translate(dragged, vec2_set(cosf(angle) * 10.f, sinf(angle) * 10.f));
+
+        result.full_time += flush(full, scene, width, height, reference, &stats);
+        result.incremental_time += flush(incremental, scene, width, height, image, &stats);
+        result.skipped_tiles += stats.num_skipped_tiles;
+        result.num_mismatches += bench_same_image(reference, image, width, height) ? 0 : 1;
+    }
+
+    *dragged = original;
+    free(reference);
+    free(image);
+    renderer_terminate(full);
+    renderer_terminate(incremental);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 60;
+    uint32_t width = (argc > 3) ? (uint32_t) atoi(argv[3]) : 1920;
+    uint32_t height = (argc > 4) ? (uint32_t) atoi(argv[4]) : 1080;
+
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_WARN);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    uint32_t num_tiles = ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+    fprintf(stdout, "%zu scenes, %ux%u (%u tiles), %u frames per scene, one primitive dragged\n\n", scenes.size(), width, height,
+            num_tiles, num_frames);
+    fprintf(stdout, "scene   primitives   skipped tiles   full ms   incremental ms   speedup   images\n");
+
+    bool success = true;
+    double total_full = 0.0, total_incremental = 0.0;
+    for(size_t i=0; i<scenes.size(); ++i)
+    {
+        bench_result result = run(&scenes[i], num_frames, width, height);
+        success &= (result.num_mismatches == 0);
+        total_full += result.full_time;
+        total_incremental += result.incremental_time;
+
+        fprintf(stdout, "%5zu   %10u   %12.1f%%   %7.3f   %14.3f   %6.2fx   %s\n", i, scenes[i].num_primitives,
+                result.skipped_tiles * 100.0 / (num_tiles * (double) num_frames), result.full_time * 1000.0 / num_frames,
+                result.incremental_time * 1000.0 / num_frames, result.full_time / result.incremental_time,
+                (result.num_mismatches == 0) ? "identical" : "DIFFERENT");
+    }
+
+    fprintf(stdout, "\noverall speedup %.2fx\n", total_full / total_incremental);
+
+    bench_free_scenes(&scenes);
+
+    return success ? 0 : -1;
+}
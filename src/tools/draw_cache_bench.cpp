@@ -0,0 +1,133 @@
+#include "bench_common.h"
+#include "../editor/primitive.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// cost of building the draw commands (renderer_begin_frame to renderer_end_frame) with and without the command cache, on a
+// scene made of the primitives of every .tds of a folder copied until it reaches the requested count
+//  * no cache : every primitive goes through renderer_draw_*
+//  * idle : nothing changes, every block of primitives is re-emitted from the cache
+//  * editing : one primitive moves every frame, like dragging it in the editor
+// the image of the last frame must be the same with and without the cache
+//
+// usage : draw_cache_bench [folder] [primitives] [frames]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define WIDTH (1920)
+#define HEIGHT (1080)
+
+enum bench_mode
+{
+    mode_no_cache,
+    mode_idle,
+    mode_editing,
+    mode_count
+};
+
+static const char* mode_names[mode_count] = {"no cache", "idle", "editing"};
+
+struct bench_result
+{
+    double build_time;      // in seconds, all frames
+    double hits;
+    double misses;
+    uint32_t cache_size;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(struct renderer* r, tds_scene* scene, bench_mode mode, uint32_t num_frames, uint32_t* image)
+{
+    bench_result result = {0.0, 0.0, 0.0, 0};
+    renderer_set_cache(r, mode != mode_no_cache);
+
+    // first frame is a warm-up
+    for(uint32_t frame=0; frame<num_frames+1; ++frame)
+    {
+        struct primitive* edited = &scene->primitives[frame % scene->num_primitives];
+        if (mode == mode_editing)
+            primitive_translate(edited, vec2_set(1.f, 0.f));
+
+        uint64_t start = stm_now();
+        renderer_begin_frame(r);
+        tds_scene_draw(scene, r, WIDTH, HEIGHT);
+        renderer_end_frame(r);
+        double build_time = stm_sec(stm_since(start));
+
+        if (mode == mode_editing)
+            primitive_translate(edited, vec2_set(-1.f, 0.f));
+
+        struct renderer_stats stats;
+        renderer_get_stats(r, &stats);
+        if (frame>0)
+        {
+            result.build_time += build_time;
+            result.hits += stats.num_cache_hits;
+            result.misses += stats.num_cache_misses;
+            result.cache_size = stats.cache_size;
+        }
+    }
+
+    // idle frame rendered for the image comparison
+    bench_draw(r, scene, WIDTH, HEIGHT, image);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_primitives = (argc > 2) ? (uint32_t) atoi(argv[2]) : 4096;
+    uint32_t num_frames = (argc > 3) ? (uint32_t) atoi(argv[3]) : 100;
+
+    if (num_primitives == 0) num_primitives = 1;
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    tds_scene scene = tds_scene_replicate(scenes, num_primitives);
+    struct renderer* r = renderer_init(nullptr, WIDTH, HEIGHT);
+    size_t image_size = (size_t)WIDTH * HEIGHT * sizeof(uint32_t);
+    uint32_t* images[mode_count];
+
+    fprintf(stdout, "%u primitives, %ux%u, %u frames\n\n", scene.num_primitives, WIDTH, HEIGHT, num_frames);
+    fprintf(stdout, "mode       build ms   speedup   hits/frame   misses/frame   cache KB   image\n");
+
+    bool success = true;
+    double reference = 0.0;
+    for(uint32_t mode=0; mode<mode_count; ++mode)
+    {
+        images[mode] = (uint32_t*) malloc(image_size);
+        bench_result result = run(r, &scene, (bench_mode) mode, num_frames, images[mode]);
+
+        double frame_time = result.build_time / num_frames;
+        if (reference == 0.0)
+            reference = frame_time;
+
+        bool identical = bench_same_image(images[0], images[mode], WIDTH, HEIGHT);
+        success &= identical;
+
+        fprintf(stdout, "%-8s   %8.3f   %6.2fx   %10.1f   %12.1f   %8.1f   %s\n", mode_names[mode], frame_time * 1000.0,
+                reference / frame_time, result.hits / num_frames, result.misses / num_frames, result.cache_size / 1024.0,
+                identical ? "identical" : "DIFFERENT");
+    }
+
+    for(uint32_t mode=0; mode<mode_count; ++mode)
+        free(images[mode]);
+
+    renderer_terminate(r);
+    tds_scene_terminate(&scene);
+    for(tds_scene& source : scenes)
+        tds_scene_terminate(&source);
+
+    return success ? 0 : -1;
+}
@@ -0,0 +1,254 @@
+#include "bench_common.h"
+#include "../renderer/cpu_kernels.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// half precision draw data (renderer_set_draw_data_format) against the 32 bits floats
+//  * precision : random primitives of every type (up to 512 pixels wide) on a 1920x1080 screen are encoded and decoded, max error of the points
+//    (in pixels), of the sizes (radius, width, thickness, roundness, in pixels) and of the directions
+//  * scenes : every .tds of a folder and a replicated scene are rendered with both formats, draw data bytes sent to the
+//    backend, flush time (decoding included) and pixels that changed
+//
+// usage : draw_data_bench [folder] [shapes_per_type] [frames]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define WIDTH (1920)
+#define HEIGHT (1080)
+#define REPLICATED_PRIMITIVES (10000)
+#define MAX_EXTENT (256.f)
+
+// layout of the draw data : 'p' point coordinate, 's' size in pixels, 'u' component of a unit vector
+struct type_layout
+{
+    command_type type;
+    const char* name;
+    const char* values;
+};
+
+static const type_layout layouts[] =
+{
+    {primitive_char, "char", "pp"},
+    {primitive_aabox, "aabox", "pppp"},
+    {primitive_oriented_box, "oriented_box", "ppppss"},
+    {primitive_disc, "disc", "ppss"},
+    {primitive_triangle, "triangle", "ppppppss"},
+    {primitive_ellipse, "ellipse", "ppppss"},
+    {primitive_pie, "pie", "ppsuuuus"},
+    {primitive_ring, "ring", "ppsuuuus"},
+    {primitive_uneven_capsule, "uneven_capsule", "ppppsss"},
+    {primitive_trapezoid, "trapezoid", "ppppssss"},
+};
+
+#define NUM_TYPES (sizeof(layouts) / sizeof(type_layout))
+
+struct type_error
+{
+    float point;
+    float size;
+    float unit;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+// bounding box of the points grown by the biggest size, clamped to the screen like write_aabb
+static wide_aabb command_aabb(const float* data, const char* values)
+{
+    float min_x = 1e9f, min_y = 1e9f, max_x = -1e9f, max_y = -1e9f, grow = 0.f;
+    for(uint32_t k=0; values[k] != 0; ++k)
+    {
+        if (values[k] == 'p' && (k&1) == 0) {min_x = fminf(min_x, data[k]); max_x = fmaxf(max_x, data[k]);}
+        if (values[k] == 'p' && (k&1) == 1) {min_y = fminf(min_y, data[k]); max_y = fmaxf(max_y, data[k]);}
+        if (values[k] == 's') grow = fmaxf(grow, data[k]);
+    }
+
+    min_x -= grow; min_y -= grow; max_x += grow; max_y += grow;
+    if (max_x < 0.f || max_y < 0.f || min_x >= WIDTH || min_y >= HEIGHT)
+        return (wide_aabb) {.min_x = UINT16_MAX, .min_y = UINT16_MAX, .max_x = 0, .max_y = 0};
+
+    return (wide_aabb)
+    {
+        .min_x = (uint16_t)(uint32_t(fmaxf(min_x, 0.f)) / TILE_SIZE),
+        .min_y = (uint16_t)(uint32_t(fmaxf(min_y, 0.f)) / TILE_SIZE),
+        .max_x = (uint16_t)(uint32_t(fminf(max_x, WIDTH - 1)) / TILE_SIZE),
+        .max_y = (uint16_t)(uint32_t(fminf(max_y, HEIGHT - 1)) / TILE_SIZE)
+    };
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static type_error measure_type(const type_layout& layout, uint32_t num_shapes)
+{
+    const uint32_t num_values = (uint32_t) strlen(layout.values);
+    std::vector<draw_command> commands(num_shapes);
+    std::vector<wide_aabb> boxes(num_shapes);
+    std::vector<float> data(num_shapes * num_values);
+    std::vector<float16> encoded(data.size());
+    std::vector<float> decoded(data.size());
+
+    for(uint32_t i=0; i<num_shapes; ++i)
+    {
+        // the points of a shape are around a center, up to MAX_EXTENT pixels away
+        float* values = &data[i * num_values];
+        float center_x = random_float(-64.f, WIDTH + 64.f);
+        float center_y = random_float(-64.f, HEIGHT + 64.f);
+        for(uint32_t k=0; k<num_values; ++k)
+        {
+            if (layout.values[k] == 'p')
+                values[k] = ((k&1) ? center_y : center_x) + random_float(-MAX_EXTENT, MAX_EXTENT);
+            else if (layout.values[k] == 's')
+                values[k] = random_float(.5f, 400.f);
+            else
+            {
+                // unit vectors come in pairs
+                float angle = random_float(0.f, 6.2831853f);
+                values[k] = cosf(angle);
+                values[++k] = sinf(angle);
+            }
+        }
+
+        commands[i] = {};
+        commands[i].type = pack_type(layout.type, fill_solid);
+        commands[i].data_index = i * num_values;
+        boxes[i] = command_aabb(values, layout.values);
+    }
+
+    draw_cmd_arguments args = {};
+    args.commands = commands.data();
+    args.commands_wide_aabb = boxes.data();
+    args.draw_data = data.data();
+    args.num_commands = num_shapes;
+    args.num_tile_width = (WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    args.num_tile_height = (HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+
+    cpu_encode_draw_data(&args, (uint32_t) data.size(), encoded.data());
+    cpu_decode_draw_data(&args, (uint32_t) data.size(), encoded.data(), decoded.data());
+
+    // culled commands keep absolute coordinates but are never rasterized
+    type_error error = {0.f, 0.f, 0.f};
+    for(size_t j=0; j<data.size(); ++j)
+    {
+        const wide_aabb& box = boxes[j / num_values];
+        if (box.min_x > box.max_x)
+            continue;
+
+        float difference = fabsf(decoded[j] - data[j]);
+        switch(layout.values[j % num_values])
+        {
+        case 'p' : error.point = fmaxf(error.point, difference); break;
+        case 's' : error.size = fmaxf(error.size, difference); break;
+        default : error.unit = fmaxf(error.unit, difference); break;
+        }
+    }
+    return error;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static double render(struct renderer* r, tds_scene* scene, uint32_t num_frames, uint32_t* image, renderer_stats* stats)
+{
+    double time = 0.0;
+    for(uint32_t frame=0; frame<num_frames; ++frame)
+    {
+        bench_draw(r, scene, WIDTH, HEIGHT, image);
+        renderer_get_stats(r, stats);
+        time += stats->binning_time + stats->rasterization_time;
+    }
+    return time / num_frames;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void compare_scene(const char* name, tds_scene* scene, uint32_t num_frames, uint32_t* reference, uint32_t* image)
+{
+    struct renderer* r = renderer_init(nullptr, WIDTH, HEIGHT);
+    renderer_stats float_stats, half_stats;
+
+    double float_time = render(r, scene, num_frames, reference, &float_stats);
+    renderer_set_draw_data_format(r, draw_data_half);
+    double half_time = render(r, scene, num_frames, image, &half_stats);
+    renderer_terminate(r);
+
+    uint32_t num_different = 0, max_difference = 0;
+    for(uint32_t i=0; i<WIDTH * HEIGHT; ++i)
+    {
+        uint32_t difference = 0;
+        for(uint32_t shift=0; shift<24; shift+=8)
+        {
+            int d = abs((int)((reference[i] >> shift) & 0xff) - (int)((image[i] >> shift) & 0xff));
+            difference = ((uint32_t)d > difference) ? (uint32_t)d : difference;
+        }
+        num_different += (difference > 0) ? 1 : 0;
+        max_difference = (difference > max_difference) ? difference : max_difference;
+    }
+
+    fprintf(stdout, "%-22s   %8u   %9.1f   %8.1f   %8.3f   %7.3f   %10u   %8u\n", name, float_stats.num_draw_data,
+            float_stats.draw_data_size / 1024.0, half_stats.draw_data_size / 1024.0, float_time * 1000.0, half_time * 1000.0,
+            num_different, max_difference);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_shapes = (argc > 2) ? (uint32_t) atoi(argv[2]) : 100000;
+    uint32_t num_frames = (argc > 3) ? (uint32_t) atoi(argv[3]) : 5;
+
+    if (num_shapes == 0) num_shapes = 1;
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+    srand(1);
+
+    fprintf(stdout, "precision : %u random primitives per type on a %ux%u screen, max error of the visible ones\n\n", num_shapes, WIDTH, HEIGHT);
+    fprintf(stdout, "type              point px    size px    direction\n");
+
+    bool success = true;
+    for(uint32_t i=0; i<NUM_TYPES; ++i)
+    {
+        const type_layout& layout = layouts[i];
+        uint32_t num_points = 0;
+        while (layout.values[num_points] == 'p')
+            num_points++;
+
+        // the layout of the tool must match the one of the encoder
+        success &= (num_points == cpu_draw_data_points(pack_type(layout.type, fill_solid)) * 2);
+
+        type_error error = measure_type(layout, num_shapes);
+        fprintf(stdout, "%-14s   %9.5f   %8.5f   %10.6f\n", layout.name, error.point, error.size, error.unit);
+    }
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    fprintf(stdout, "\nscenes : %ux%u, %u frames, flush is binning + rasterization (decoding included with half)\n\n", WIDTH,
+            HEIGHT, num_frames);
+    fprintf(stdout, "scene                    floats    float KB    half KB   float ms   half ms   pixels diff   max diff\n");
+
+    uint32_t* reference = (uint32_t*) malloc(WIDTH * HEIGHT * sizeof(uint32_t));
+    uint32_t* image = (uint32_t*) malloc(WIDTH * HEIGHT * sizeof(uint32_t));
+
+    for(size_t i=0; i<scenes.size(); ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "scene %zu", i);
+        compare_scene(name, &scenes[i], num_frames, reference, image);
+    }
+
+    tds_scene replicated = tds_scene_replicate(scenes, REPLICATED_PRIMITIVES);
+    compare_scene("replicated", &replicated, 1, reference, image);
+    tds_scene_terminate(&replicated);
+
+    free(reference);
+    free(image);
+    bench_free_scenes(&scenes);
+
+    if (!success)
+        fprintf(stderr, "the layouts of the tool don't match cpu_draw_data_points\n");
+
+    return success ? 0 : -1;
+}
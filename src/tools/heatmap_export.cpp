@@ -0,0 +1,110 @@
+#include "heatmap_export.h"
+#include "png_export.h"
+#include "../system/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------------------------------------------------
+const char* heatmap_metric_name(enum renderer_heatmap_metric metric)
+{
+    static const char* names[heatmap_metric_count] = {"commands", "combinations", "evaluations"};
+    return names[metric];
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool heatmap_write_csv(const char* path, const struct renderer_heatmap* heatmap)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+        log_error("can't create '%s'", path);
+        return false;
+    }
+
+    fprintf(file, "x,y");
+    for(uint32_t i=0; i<heatmap_metric_count; ++i)
+        fprintf(file, ",%s", heatmap_metric_name((enum renderer_heatmap_metric) i));
+    fprintf(file, "\n");
+
+    for(uint32_t y=0; y<heatmap->num_tile_height; ++y)
+        for(uint32_t x=0; x<heatmap->num_tile_width; ++x)
+        {
+            uint32_t tile_index = y * heatmap->num_tile_width + x;
+            fprintf(file, "%u,%u", x, y);
+            for(uint32_t i=0; i<heatmap_metric_count; ++i)
+                fprintf(file, ",%u", heatmap->tiles[i][tile_index]);
+            fprintf(file, "\n");
+        }
+
+    bool success = (ferror(file) == 0);
+    fclose(file);
+    return success;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// black, purple, red, orange, yellow then white : t in [0, 1] to RGBA8
+static uint32_t heat_color(float t)
+{
+    static const float stops[][3] =
+    {
+        {0.f, 0.f, 0.f}, {.35f, .05f, .55f}, {.85f, .15f, .25f}, {1.f, .55f, .05f}, {1.f, .95f, .3f}, {1.f, 1.f, 1.f}
+    };
+    const uint32_t num_segments = sizeof(stops) / sizeof(stops[0]) - 1;
+
+    float position = t * num_segments;
+    uint32_t segment = (position >= num_segments) ? num_segments - 1 : (uint32_t) position;
+    float f = position - segment;
+
+    uint32_t color = 0xff000000;
+    for(uint32_t c=0; c<3; ++c)
+    {
+        float value = stops[segment][c] + (stops[segment+1][c] - stops[segment][c]) * f;
+        color |= (uint32_t)(value * 255.f + .5f) << (c * 8);
+    }
+    return color;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static float luminance(uint32_t color)
+{
+    return ((color & 0xff) * .2126f + ((color >> 8) & 0xff) * .7152f + ((color >> 16) & 0xff) * .0722f) / 255.f;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool heatmap_write_png(const char* path, const struct renderer_heatmap* heatmap, enum renderer_heatmap_metric metric,
+                       const uint32_t* frame, uint32_t width, uint32_t height)
+{
+    uint32_t* image = (uint32_t*) malloc((size_t)width * height * sizeof(uint32_t));
+    if (image == NULL)
+        return false;
+
+    const uint32_t* values = heatmap->tiles[metric];
+    float scale = (heatmap->max[metric] > 0) ? 1.f / (float) heatmap->max[metric] : 0.f;
+
+    for(uint32_t y=0; y<height; ++y)
+    {
+        uint32_t tile_y = y / TILE_SIZE;
+        for(uint32_t x=0; x<width; ++x)
+        {
+            uint32_t tile_x = x / TILE_SIZE;
+            uint32_t value = (tile_x < heatmap->num_tile_width && tile_y < heatmap->num_tile_height) ?
+                             values[tile_y * heatmap->num_tile_width + tile_x] : 0;
+            uint32_t color = heat_color(value * scale);
+
+            // keep a bit of the heat color on black pixels
+            if (frame != NULL)
+            {
+                float factor = .35f + .65f * luminance(frame[y * width + x]);
+                uint32_t red = (uint32_t)((color & 0xff) * factor);
+                uint32_t green = (uint32_t)(((color >> 8) & 0xff) * factor);
+                uint32_t blue = (uint32_t)(((color >> 16) & 0xff) * factor);
+                color = 0xff000000 | (blue << 16) | (green << 8) | red;
+            }
+            image[y * width + x] = color;
+        }
+    }
+
+    bool success = png_write(path, image, width, height);
+    free(image);
+    return success;
+}
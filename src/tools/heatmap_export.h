@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include "../renderer/renderer.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// export of the tile heatmap of the cpu backend (see renderer_set_heatmap)
+
+// one row per tile : tile coordinates then one column per metric
+bool heatmap_write_csv(const char* path, const struct renderer_heatmap* heatmap);
+
+// width x height png of one metric, each tile is a square going from black (zero) to white (max of the frame)
+// if frame is not null (RGBA8, as filled by renderer_flush), the heatmap is modulated by its luminance to show the shapes
+bool heatmap_write_png(const char* path, const struct renderer_heatmap* heatmap, enum renderer_heatmap_metric metric,
+                       const uint32_t* frame, uint32_t width, uint32_t height);
+
+// name of the metric in the csv header and the file names
+const char* heatmap_metric_name(enum renderer_heatmap_metric metric);
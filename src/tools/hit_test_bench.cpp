@@ -0,0 +1,196 @@
+#include "bench_common.h"
+#include "../editor/primitive.h"
+#include "../editor/primitive_list.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <float.h>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// hit-testing of the editor (selection and hover) : linear scan of the primitive list against the spatial index
+//  * the primitives of the example scenes are copied at random positions of the edition zone
+//  * a mouse path is tested both ways, the primitives under the cursor and the selected one must be the same
+//  * update : a primitive is moved then primitive_update_aabb updates the index, like the editor does when dragging
+//  * order : a primitive brought to the front or to the back, the index is shifted
+//
+// usage : hit_test_bench [folder] [moves]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define NUM_UPDATES (10000)
+
+//----------------------------------------------------------------------------------------------------------------------------
+static vec2 random_position(const aabb* zone)
+{
+    return vec2_set(random_float(zone->min.x, zone->max.x), random_float(zone->min.y, zone->max.y));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// same rule as PrimitiveEditor::SelectPrimitive, hits in list order
+static uint32_t select_nearest(const std::vector<uint32_t>& hits, vec2 position)
+{
+    uint32_t selected = INVALID_INDEX;
+    float min_distance = FLT_MAX;
+    for(uint32_t index : hits)
+    {
+        float distance = primitive_distance_to_nearest_point(plist_get(index), position);
+        if (distance < min_distance)
+        {
+            min_distance = distance;
+            selected = index;
+        }
+    }
+    return selected;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void linear_hits(vec2 position, std::vector<uint32_t>& hits)
+{
+    hits.clear();
+    for(uint32_t i=0; i<plist_size(); ++i)
+        if (primitive_test_mouse_cursor(plist_get(i), position, true))
+            hits.push_back(i);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the candidates are topmost first, the hits are returned in list order
+static uint32_t index_hits(vec2 position, std::vector<uint32_t>& candidates, std::vector<uint32_t>& hits)
+{
+    uint32_t num_candidates = plist_query_candidates(position, candidates.data(), (uint32_t) candidates.size());
+    if (num_candidates > candidates.size())
+    {
+        candidates.resize(num_candidates);
+        plist_query_candidates(position, candidates.data(), num_candidates);
+    }
+
+    hits.clear();
+    for(uint32_t i=num_candidates; i-->0; )
+        if (primitive_test_mouse_cursor(plist_get(candidates[i]), position, true))
+            hits.push_back(candidates[i]);
+
+    return num_candidates;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of positions where the index and the linear scan disagree
+static uint32_t check(const std::vector<vec2>& path, std::vector<uint32_t>& candidates)
+{
+    std::vector<uint32_t> reference, hits;
+    uint32_t num_mismatches = 0;
+    for(vec2 position : path)
+    {
+        linear_hits(position, reference);
+        index_hits(position, candidates, hits);
+        if (hits != reference || select_nearest(hits, position) != select_nearest(reference, position))
+            num_mismatches++;
+    }
+    return num_mismatches;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void bench(const std::vector<primitive>& templates, const aabb* zone, uint32_t num_primitives, uint32_t num_moves)
+{
+    plist_init(num_primitives);
+
+    // the primitives are spread over the edition zone
+    uint64_t start = stm_now();
+    for(uint32_t i=0; i<num_primitives; ++i)
+    {
+        primitive p = templates[rand() % templates.size()];
+        primitive_translate(&p, vec2_sub(random_position(zone), aabb_get_center(&p.m_AABB)));
+        primitive_update_aabb(&p);
+        plist_push(&p);
+    }
+    double build_time = stm_sec(stm_since(start));
+
+    // mouse moves : a random walk with a few jumps
+    std::vector<vec2> path(num_moves);
+    vec2 position = aabb_get_center(zone);
+    for(uint32_t i=0; i<num_moves; ++i)
+    {
+        if (i % 100 == 0)
+            position = random_position(zone);
+        position = vec2_add(position, vec2_set(random_float(-8.f, 8.f), random_float(-8.f, 8.f)));
+        path[i] = position;
+    }
+
+    std::vector<uint32_t> candidates(64), hits;
+    uint64_t total_hits = 0, total_candidates = 0;
+
+    start = stm_now();
+    for(vec2 p : path)
+    {
+        linear_hits(p, hits);
+        total_hits += hits.size();
+    }
+    double linear_time = stm_sec(stm_since(start));
+
+    start = stm_now();
+    for(vec2 p : path)
+        total_candidates += index_hits(p, candidates, hits);
+    double index_time = stm_sec(stm_since(start));
+
+    // primitives dragged around, the index must follow
+    start = stm_now();
+    for(uint32_t i=0; i<NUM_UPDATES; ++i)
+    {
+        primitive* p = plist_get(rand() % num_primitives);
+        primitive_translate(p, vec2_set(random_float(-20.f, 20.f), random_float(-20.f, 20.f)));
+        primitive_update_aabb(p);
+    }
+    double update_time = stm_sec(stm_since(start));
+
+    // reordering like the editor does (bring to front then to back), the primitives after the moved one are renumbered
+    start = stm_now();
+    primitive moved = *plist_get(0);
+    plist_erase(0);
+    plist_push(&moved);
+    moved = *plist_get(plist_last());
+    plist_erase(plist_last());
+    plist_insert(0, &moved);
+    double reorder_time = stm_sec(stm_since(start)) * .5;
+
+    uint32_t num_mismatches = check(path, candidates);
+
+    fprintf(stdout, "%10u   %9.3f   %9.3f   %7.1fx   %10.1f   %5.2f   %9.3f   %10.3f   %8.2f   %10u\n", num_primitives,
+            linear_time * 1e6 / num_moves, index_time * 1e6 / num_moves, linear_time / index_time,
+            double(total_candidates) / num_moves, double(total_hits) / num_moves, build_time * 1000.0,
+            update_time * 1e6 / NUM_UPDATES, reorder_time * 1000.0, num_mismatches);
+
+    plist_terminate();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_moves = (argc > 2) ? (uint32_t) atoi(argv[2]) : 2000;
+    if (num_moves == 0) num_moves = 1;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+    srand(1);
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    std::vector<primitive> templates;
+    for(tds_scene& scene : scenes)
+        for(uint32_t i=0; i<scene.num_primitives; ++i)
+            if (aabb_is_valid(scene.primitives[i].m_AABB))
+                templates.push_back(scene.primitives[i]);
+
+    const aabb zone = scenes[0].edition_zone;
+    fprintf(stdout, "%u mouse moves over the edition zone, primitives copied from %zu scenes\n\n", num_moves, scenes.size());
+    fprintf(stdout, "primitives   linear us    index us   speedup   candidates    hits   build ms   update us   order ms   mismatches\n");
+
+    const uint32_t counts[] = {1000, 10000, 100000};
+    for(uint32_t count : counts)
+        bench(templates, &zone, count, num_moves);
+
+    bench_free_scenes(&scenes);
+
+    return 0;
+}
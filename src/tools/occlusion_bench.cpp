@@ -0,0 +1,134 @@
+#include "bench_common.h"
+#include "../editor/primitive.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/ortho.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// occlusion culling of the binning on every .tds of a folder : each scene is rendered with and without it
+//  * scene : drawn like the editor, all the primitives are in the combination of the scene so nothing can be culled
+//  * layers : the same primitives drawn one after the other as opaque shapes, outside of any combination
+//  * nodes are the (tile, command) pairs evaluated by the rasterizer, the culled ones are the saved evaluations
+//  * binning and rasterization time of both
+//  * the images must be the same
+//
+// usage : occlusion_bench [folder] [frames] [width] [height]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+struct bench_result
+{
+    uint32_t num_nodes;
+    double binning_time;        // in seconds, average of all frames
+    double rasterization_time;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void draw_layers(tds_scene* scene, struct renderer* r, uint32_t width, uint32_t height)
+{
+    struct view_proj vp;
+    ortho_set_target(&vp, &scene->edition_zone, vec2_set((float)width, (float)height));
+    renderer_set_viewproj(r, &vp);
+    renderer_set_cliprect_relative(r, &scene->edition_zone);
+
+    for(uint32_t i=0; i<scene->num_primitives; ++i)
+    {
+        struct primitive* p = &scene->primitives[i];
+        draw_color color = draw_color_from_float(p->m_Color.red, p->m_Color.green, p->m_Color.blue, 1.f);
+        primitive_draw(p, r, p->m_Roundness, color, op_add);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(struct renderer* r, tds_scene* scene, bool layers, bool occlusion_culling, uint32_t num_frames,
+                        uint32_t width, uint32_t height, uint32_t* image)
+{
+    bench_result result = {0, 0.0, 0.0};
+    renderer_set_occlusion_culling(r, occlusion_culling);
+
+    for(uint32_t frame=0; frame<num_frames; ++frame)
+    {
+        renderer_begin_frame(r);
+        if (layers)
+            draw_layers(scene, r, width, height);
+        else
+            tds_scene_draw(scene, r, width, height);
+        renderer_end_frame(r);
+        renderer_flush(r, image);
+
+        struct renderer_stats stats;
+        renderer_get_stats(r, &stats);
+        result.num_nodes = stats.num_nodes;
+        result.binning_time += stats.binning_time / num_frames;
+        result.rasterization_time += stats.rasterization_time / num_frames;
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 20;
+    uint32_t width = (argc > 3) ? (uint32_t) atoi(argv[3]) : 1920;
+    uint32_t height = (argc > 4) ? (uint32_t) atoi(argv[4]) : 1080;
+
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_WARN);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    struct renderer* r = renderer_init(nullptr, width, height);
+    size_t image_size = (size_t)width * height * sizeof(uint32_t);
+    uint32_t* reference = (uint32_t*) malloc(image_size);
+    uint32_t* image = (uint32_t*) malloc(image_size);
+
+    fprintf(stdout, "%zu scenes, %ux%u, %u frames per scene\n", scenes.size(), width, height, num_frames);
+
+    bool success = true;
+    for(uint32_t layers=0; layers<2; ++layers)
+    {
+        fprintf(stdout, "\n%-6s  primitives      nodes   culled nodes   saved   binning ms   raster ms   speedup   image\n",
+                layers ? "layers" : "scene");
+
+        uint64_t total_nodes = 0, total_culled = 0;
+        double total_off = 0.0, total_on = 0.0;
+        for(size_t i=0; i<scenes.size(); ++i)
+        {
+            bench_result off = run(r, &scenes[i], layers, false, num_frames, width, height, reference);
+            bench_result on = run(r, &scenes[i], layers, true, num_frames, width, height, image);
+
+            bool identical = bench_same_image(reference, image, width, height);
+            success &= identical;
+
+            uint32_t culled = off.num_nodes - on.num_nodes;
+            double time_off = off.binning_time + off.rasterization_time;
+            double time_on = on.binning_time + on.rasterization_time;
+            total_nodes += off.num_nodes;
+            total_culled += culled;
+            total_off += time_off;
+            total_on += time_on;
+
+            fprintf(stdout, "%6zu  %10u   %8u   %12u   %4.1f%%   %10.3f   %9.3f   %6.2fx   %s\n", i, scenes[i].num_primitives,
+                    off.num_nodes, culled, culled * 100.0 / off.num_nodes, on.binning_time * 1000.0,
+                    on.rasterization_time * 1000.0, time_off / time_on, identical ? "identical" : "DIFFERENT");
+        }
+
+        fprintf(stdout, "%llu of %llu node evaluations saved (%.1f%%), overall speedup %.2fx\n", (unsigned long long) total_culled,
+                (unsigned long long) total_nodes, total_culled * 100.0 / total_nodes, total_off / total_on);
+    }
+
+    free(reference);
+    free(image);
+    renderer_terminate(r);
+    bench_free_scenes(&scenes);
+
+    return success ? 0 : -1;
+}
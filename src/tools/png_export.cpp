@@ -0,0 +1,189 @@
+#include "png_export.h"
+#include "tds_scene.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include "../system/spng.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_BAND_PIXELS (1<<22)     // 16 MB of framebuffer
+
+//----------------------------------------------------------------------------------------------------------------------------
+// RGBA8 framebuffer rows to RGB8 png rows, alpha is always opaque
+static bool encode_rows(spng_ctx* ctx, const uint32_t* framebuffer, uint8_t* row, uint32_t width, uint32_t num_rows)
+{
+    for(uint32_t y=0; y<num_rows; ++y)
+    {
+        const uint32_t* pixels = &framebuffer[y * width];
+        for(uint32_t x=0; x<width; ++x)
+        {
+            row[x*3+0] = (uint8_t)(pixels[x] & 0xff);
+            row[x*3+1] = (uint8_t)((pixels[x] >> 8) & 0xff);
+            row[x*3+2] = (uint8_t)((pixels[x] >> 16) & 0xff);
+        }
+
+        // the last row returns SPNG_EOI
+        int error = spng_encode_row(ctx, row, width * 3);
+        if (error != 0 && error != SPNG_EOI)
+        {
+            log_error("png encoding failed : %s", spng_strerror(error));
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// creates the file and starts a progressive RGB8 encoding, rows are then sent with encode_rows
+static spng_ctx* png_begin(const char* path, uint32_t width, uint32_t height, FILE** file)
+{
+    FILE* f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        log_error("can't create file '%s'", path);
+        return NULL;
+    }
+
+    spng_ctx* ctx = spng_ctx_new(SPNG_CTX_ENCODER);
+    spng_set_png_file(ctx, f);
+
+    struct spng_ihdr ihdr =
+    {
+        .width = width,
+        .height = height,
+        .bit_depth = 8,
+        .color_type = SPNG_COLOR_TYPE_TRUECOLOR,
+        .compression_method = 0,
+        .filter_method = 0,
+        .interlace_method = 0
+    };
+    spng_set_ihdr(ctx, &ihdr);
+
+    int error = spng_encode_image(ctx, NULL, 0, SPNG_FMT_PNG, SPNG_ENCODE_PROGRESSIVE | SPNG_ENCODE_FINALIZE);
+    if (error != 0)
+    {
+        log_error("can't start png encoding : %s", spng_strerror(error));
+        spng_ctx_free(ctx);
+        fclose(f);
+        return NULL;
+    }
+
+    *file = f;
+    return ctx;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool png_write(const char* path, const uint32_t* framebuffer, uint32_t width, uint32_t height)
+{
+    FILE* f;
+    spng_ctx* ctx = png_begin(path, width, height, &f);
+    if (ctx == NULL)
+        return false;
+
+    uint8_t* row = (uint8_t*) malloc((size_t)width * 3);
+    bool result = encode_rows(ctx, framebuffer, row, width, height);
+
+    free(row);
+    spng_ctx_free(ctx);
+    fclose(f);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+uint32_t* png_read(const char* path, uint32_t* width, uint32_t* height)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    spng_ctx* ctx = spng_ctx_new(0);
+    spng_set_png_file(ctx, f);
+
+    struct spng_ihdr ihdr;
+    size_t size;
+    uint32_t* framebuffer = NULL;
+    int error = spng_get_ihdr(ctx, &ihdr);
+    if (error == 0)
+        error = spng_decoded_image_size(ctx, SPNG_FMT_RGBA8, &size);
+
+    if (error == 0)
+    {
+        // RGBA8 bytes are the framebuffer pixels on little endian
+        framebuffer = (uint32_t*) malloc(size);
+        error = spng_decode_image(ctx, framebuffer, size, SPNG_FMT_RGBA8, SPNG_DECODE_TRNS);
+    }
+
+    if (error != 0)
+    {
+        log_error("can't read png '%s' : %s", path, spng_strerror(error));
+        free(framebuffer);
+        framebuffer = NULL;
+    }
+    else
+    {
+        *width = ihdr.width;
+        *height = ihdr.height;
+    }
+
+    spng_ctx_free(ctx);
+    fclose(f);
+    return framebuffer;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool tds_scene_export_png(struct tds_scene* scene, const char* path, uint32_t width, uint32_t height, uint32_t band_height,
+                          uint32_t num_threads, struct png_export_stats* stats)
+{
+    stats->num_bands = 0;
+    stats->render_time = stats->encode_time = 0.0;
+
+    if (width == 0 || height == 0 || width > UINT16_MAX)
+    {
+        log_error("can't export a %ux%u image", width, height);
+        return false;
+    }
+
+    // bands are made of full tiles
+    if (band_height == 0)
+        band_height = DEFAULT_BAND_PIXELS / width;
+    if (band_height > height)
+        band_height = height;
+    band_height = ((band_height + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+
+    FILE* f;
+    spng_ctx* ctx = png_begin(path, width, height, &f);
+    if (ctx == NULL)
+        return false;
+
+    struct renderer* r = renderer_init_ex(nullptr, width, band_height, renderer_aabb_format_for_size(width, band_height));
+    renderer_set_num_threads(r, num_threads);
+
+    uint32_t* framebuffer = (uint32_t*) malloc((size_t)width * band_height * sizeof(uint32_t));
+    uint8_t* row = (uint8_t*) malloc((size_t)width * 3);
+    bool result = true;
+
+    // the last band is rendered full size, the rows below the canvas are not encoded
+    for(uint32_t y=0; y<height && result; y+=band_height)
+    {
+        uint64_t start = stm_now();
+        renderer_begin_frame(r);
+        tds_scene_draw_band(scene, r, width, height, y, band_height);
+        renderer_end_frame(r);
+        renderer_flush(r, framebuffer);
+        stats->render_time += stm_sec(stm_since(start));
+
+        start = stm_now();
+        uint32_t num_rows = (height - y < band_height) ? height - y : band_height;
+        result = encode_rows(ctx, framebuffer, row, width, num_rows);
+        stats->encode_time += stm_sec(stm_since(start));
+        stats->num_bands++;
+    }
+
+    free(row);
+    free(framebuffer);
+    renderer_terminate(r);
+    spng_ctx_free(ctx);
+    fclose(f);
+    return result;
+}
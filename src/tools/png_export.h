@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+struct tds_scene;
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// offscreen export of a .tds scene to a png file with the cpu backend
+//  * the canvas is rendered in horizontal bands of band_height pixels, each band has its own view projection and the
+//    commands outside of the band are culled
+//  * the rows of a finished band are streamed to the png encoder
+//  * memory depends on width * band_height, not on the height of the canvas
+
+struct png_export_stats
+{
+    uint32_t num_bands;
+    double render_time;     // in seconds, draw + binning + rasterization
+    double encode_time;     // in seconds, png compression and file writing
+};
+
+// width must be below 65536, band_height 0 is a band of about 4 Mpixels whatever the width
+// num_threads is the number of threads of the renderer (0 for all cores)
+bool tds_scene_export_png(struct tds_scene* scene, const char* path, uint32_t width, uint32_t height, uint32_t band_height,
+                          uint32_t num_threads, struct png_export_stats* stats);
+
+// writes a width x height RGBA8 framebuffer (as filled by renderer_flush) to an opaque RGB8 png
+bool png_write(const char* path, const uint32_t* framebuffer, uint32_t width, uint32_t height);
+
+// reads a png in the framebuffer layout (RGBA8), returns NULL on error, the framebuffer must be released with free()
+uint32_t* png_read(const char* path, uint32_t* width, uint32_t* height);
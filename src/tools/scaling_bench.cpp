@@ -0,0 +1,93 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// renders every .tds of a folder with the cpu backend, from 1 to N threads, and reports the scaling
+//
+// usage : scaling_bench [folder] [max_threads] [frames] [width] [height]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+struct bench_result
+{
+    double flush_time;      // binning + rasterization, in seconds
+    double steals;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(struct renderer* r, std::vector<tds_scene>& scenes, uint32_t* framebuffer,
+                        uint32_t width, uint32_t height, uint32_t num_frames)
+{
+    bench_result result = {0.0, 0.0};
+    for(tds_scene& scene : scenes)
+    {
+        // first frame is a warm-up
+        for(uint32_t frame=0; frame<num_frames+1; ++frame)
+        {
+            bench_draw(r, &scene, width, height, framebuffer);
+
+            struct renderer_stats stats;
+            renderer_get_stats(r, &stats);
+            if (frame>0)
+            {
+                result.flush_time += stats.binning_time + stats.rasterization_time;
+                result.steals += stats.num_steals;
+            }
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t max_threads = (argc > 2) ? (uint32_t) atoi(argv[2]) : std::thread::hardware_concurrency();
+    uint32_t num_frames = (argc > 3) ? (uint32_t) atoi(argv[3]) : 10;
+    uint32_t width = (argc > 4) ? (uint32_t) atoi(argv[4]) : 1920;
+    uint32_t height = (argc > 5) ? (uint32_t) atoi(argv[5]) : 1080;
+
+    if (max_threads == 0) max_threads = 1;
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_WARN);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    fprintf(stdout, "%zu scenes, %ux%u, %u frames per scene\n\n", scenes.size(), width, height, num_frames);
+    fprintf(stdout, "threads   ms/frame   frames/s   speedup   efficiency   steals/frame\n");
+
+    struct renderer* r = renderer_init(nullptr, width, height);
+    uint32_t* framebuffer = (uint32_t*) malloc(width * height * sizeof(uint32_t));
+    double total_frames = (double) scenes.size() * num_frames;
+    double reference = 0.0;
+
+    for(uint32_t num_threads=1; num_threads<=max_threads; ++num_threads)
+    {
+        renderer_set_num_threads(r, num_threads);
+        bench_result result = run(r, scenes, framebuffer, width, height, num_frames);
+
+        double frame_time = result.flush_time / total_frames;
+        if (num_threads == 1)
+            reference = frame_time;
+
+        double speedup = reference / frame_time;
+        fprintf(stdout, "%7u   %8.3f   %8.1f   %6.2fx   %9.0f%%   %12.1f\n", num_threads, frame_time * 1000.0, 1.0 / frame_time,
+                speedup, speedup * 100.0 / num_threads, result.steals / total_frames);
+    }
+
+    free(framebuffer);
+    renderer_terminate(r);
+
+    bench_free_scenes(&scenes);
+
+    return 0;
+}
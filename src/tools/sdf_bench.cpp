@@ -0,0 +1,167 @@
+#include "bench_common.h"
+#include "../renderer/cpu_tile_kernels.h"
+#include "../system/sokol_time.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// microbenchmark of the cpu tile kernels : every primitive is evaluated on a full tile with each instruction set
+// available on this cpu and compared against the scalar reference (time and max error)
+//
+// usage : sdf_bench [iterations]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define MAX_KERNELS (4)
+#define NUM_SHAPES (64)
+
+struct primitive_setup
+{
+    const char* name;
+    command_type type;
+    primitive_fillmode fillmode;
+};
+
+static const primitive_setup setups[] =
+{
+    {"disc", primitive_disc, fill_solid},
+    {"disc hollow", primitive_disc, fill_hollow},
+    {"oriented box", primitive_oriented_box, fill_solid},
+    {"triangle", primitive_triangle, fill_solid},
+    {"ellipse", primitive_ellipse, fill_solid},
+    {"pie", primitive_pie, fill_solid},
+    {"ring", primitive_ring, fill_solid},
+    {"uneven capsule", primitive_uneven_capsule, fill_solid},
+    {"trapezoid", primitive_trapezoid, fill_solid},
+    {"aabox", primitive_aabox, fill_solid},
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+// shapes around the tile [0, 16]x[0, 16] so the pixels cover inside, outside and the edges
+static void generate_data(command_type type, float* data)
+{
+    float angle = random_float(0.f, 6.28f);
+    float aperture = random_float(0.1f, 3.1f);
+
+    switch(type)
+    {
+    case primitive_disc :
+        data[0] = random_float(0.f, 16.f); data[1] = random_float(0.f, 16.f); data[2] = random_float(2.f, 12.f);
+        data[3] = random_float(.5f, 2.f);
+        break;
+    case primitive_oriented_box :
+    case primitive_ellipse :
+        data[0] = random_float(-4.f, 20.f); data[1] = random_float(-4.f, 20.f);
+        data[2] = random_float(-4.f, 20.f); data[3] = random_float(-4.f, 20.f);
+        data[4] = random_float(2.f, 10.f); data[5] = random_float(0.f, 2.f);
+        break;
+    case primitive_triangle :
+        for(int i=0; i<6; ++i)
+            data[i] = random_float(-8.f, 24.f);
+        data[6] = random_float(0.f, 2.f);
+        break;
+    case primitive_pie :
+    case primitive_ring :
+        data[0] = random_float(0.f, 16.f); data[1] = random_float(0.f, 16.f); data[2] = random_float(4.f, 14.f);
+        data[3] = cosf(angle); data[4] = sinf(angle); data[5] = sinf(aperture); data[6] = cosf(aperture);
+        data[7] = random_float(.5f, 3.f);
+        break;
+    case primitive_uneven_capsule :
+    case primitive_trapezoid :
+        data[0] = random_float(-4.f, 20.f); data[1] = random_float(-4.f, 20.f);
+        data[2] = random_float(-4.f, 20.f); data[3] = random_float(-4.f, 20.f);
+        data[4] = random_float(1.f, 6.f); data[5] = random_float(1.f, 6.f); data[6] = random_float(0.f, 2.f);
+        break;
+    case primitive_aabox :
+        data[0] = random_float(-4.f, 8.f); data[1] = random_float(-4.f, 8.f);
+        data[2] = random_float(8.f, 20.f); data[3] = random_float(8.f, 20.f);
+        break;
+    default : break;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    uint32_t iterations = (argc > 1) ? (uint32_t) atoi(argv[1]) : 2000;
+    if (iterations == 0) iterations = 1;
+
+    stm_setup();
+    srand(0x70D33);
+
+    const cpu_tile_kernels* kernels[MAX_KERNELS];
+    uint32_t num_kernels = cpu_get_all_tile_kernels(kernels, MAX_KERNELS);
+    const pixel_range full_tile = {0, 0, TILE_SIZE, TILE_SIZE};
+    const float2 origin = float2(0.f, 0.f);
+
+    fprintf(stdout, "%u tiles of %dx%d pixels per primitive, %u iterations, selected kernels : %s\n\n", NUM_SHAPES, TILE_SIZE,
+            TILE_SIZE, iterations, cpu_get_tile_kernels()->name);
+    fprintf(stdout, "%-16s %-10s %6s %10s %9s %12s\n", "primitive", "kernels", "lanes", "ns/pixel", "speedup", "max error");
+
+    static float reference[NUM_SHAPES][TILE_SIZE * TILE_SIZE];
+    alignas(64) static float distances[TILE_SIZE * TILE_SIZE];
+    float data[NUM_SHAPES][8];
+
+    for(const primitive_setup& setup : setups)
+    {
+        uint8_t packed_type = pack_type(setup.type, setup.fillmode);
+        for(uint32_t shape=0; shape<NUM_SHAPES; ++shape)
+            generate_data(setup.type, data[shape]);
+
+        double reference_time = 0.0;
+        for(uint32_t k=0; k<num_kernels; ++k)
+        {
+            float max_error = 0.f;
+            for(uint32_t shape=0; shape<NUM_SHAPES; ++shape)
+            {
+                kernels[k]->distances(packed_type, data[shape], &full_tile, origin, distances);
+                for(uint32_t i=0; i<TILE_SIZE * TILE_SIZE; ++i)
+                {
+                    if (k == 0)
+                        reference[shape][i] = distances[i];
+                    else
+                        max_error = fmaxf(max_error, fabsf(distances[i] - reference[shape][i]));
+                }
+            }
+
+            uint64_t start = stm_now();
+            for(uint32_t i=0; i<iterations; ++i)
+                for(uint32_t shape=0; shape<NUM_SHAPES; ++shape)
+                    kernels[k]->distances(packed_type, data[shape], &full_tile, origin, distances);
+            double time = stm_sec(stm_since(start));
+
+            if (k == 0)
+                reference_time = time;
+
+            double ns_per_pixel = time * 1e9 / ((double)iterations * NUM_SHAPES * TILE_SIZE * TILE_SIZE);
+            fprintf(stdout, "%-16s %-10s %6u %10.3f %8.2fx %12g\n", (k == 0) ? setup.name : "", kernels[k]->name,
+                    kernels[k]->num_lanes, ns_per_pixel, reference_time / time, max_error);
+        }
+    }
+
+    // anti-aliasing + alpha blending
+    static tile_colors colors;
+    for(uint32_t i=0; i<TILE_SIZE * TILE_SIZE; ++i)
+        distances[i] = random_float(-2.f, 2.f);
+
+    double reference_time = 0.0;
+    for(uint32_t k=0; k<num_kernels; ++k)
+    {
+        for(uint32_t i=0; i<TILE_SIZE * TILE_SIZE; ++i)
+            colors.red[i] = colors.green[i] = colors.blue[i] = .5f;
+
+        uint64_t start = stm_now();
+        for(uint32_t i=0; i<iterations * NUM_SHAPES; ++i)
+            kernels[k]->blend(distances, float4(.2f, .4f, .6f, .5f), 1.41f, &full_tile, &colors);
+        double time = stm_sec(stm_since(start));
+
+        if (k == 0)
+            reference_time = time;
+
+        double ns_per_pixel = time * 1e9 / ((double)iterations * NUM_SHAPES * TILE_SIZE * TILE_SIZE);
+        fprintf(stdout, "%-16s %-10s %6u %10.3f %8.2fx %12s\n", (k == 0) ? "blend" : "", kernels[k]->name,
+                kernels[k]->num_lanes, ns_per_pixel, reference_time / time, "-");
+    }
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include "bench_common.h"
+#include "../editor/tds.h"
+#include "../system/serializer.h"
+#include "../system/log.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// serializer streaming a file through a chunk, against the memory serializer
+//  * random values and blobs (some bigger than the chunk) are written with several chunk sizes, the file must be the same
+//    as the memory buffer and must be read back, reading past the end of the file is an error
+//  * scenes, one bigger than the former 64 KB limit, are saved then loaded, the file must be the same as the memory
+//    serialization and the loaded scene the same as the one loaded from memory
+//
+// usage : serializer_stream_check [folder]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define NUM_VALUES (20000)
+#define MAX_BLOB_SIZE (300)
+#define REPLICATED_PRIMITIVES (20000)
+
+enum value_type {type_uint8, type_uint16, type_uint32, type_uint64, type_float, type_blob, type_count};
+
+struct value
+{
+    enum value_type type;
+    uint64_t integer;
+    float real;
+    std::vector<uint8_t> blob;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static std::vector<value> random_values()
+{
+    std::vector<value> values(NUM_VALUES);
+    for(value& v : values)
+    {
+        v.type = (enum value_type) (rand() % type_count);
+        v.integer = ((uint64_t) rand() << 32) ^ (uint64_t) rand();
+        v.real = (float) rand() / (float) RAND_MAX;
+        if (v.type == type_blob)
+        {
+            v.blob.resize(rand() % MAX_BLOB_SIZE);
+            for(uint8_t& byte : v.blob)
+                byte = (uint8_t) rand();
+        }
+    }
+    return values;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void write_values(serializer_context* context, const std::vector<value>& values)
+{
+    for(const value& v : values)
+    {
+        switch(v.type)
+        {
+        case type_uint8 : serializer_write_uint8_t(context, (uint8_t) v.integer); break;
+        case type_uint16 : serializer_write_uint16_t(context, (uint16_t) v.integer); break;
+        case type_uint32 : serializer_write_uint32_t(context, (uint32_t) v.integer); break;
+        case type_uint64 : serializer_write_uint64_t(context, v.integer); break;
+        case type_float : serializer_write_float(context, v.real); break;
+        default : serializer_write_blob(context, v.blob.data(), v.blob.size()); break;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of values that don't match
+static uint32_t read_values(serializer_context* context, const std::vector<value>& values)
+{
+    uint32_t num_errors = 0;
+    std::vector<uint8_t> blob;
+    for(const value& v : values)
+    {
+        switch(v.type)
+        {
+        case type_uint8 : num_errors += (serializer_read_uint8_t(context) == (uint8_t) v.integer) ? 0 : 1; break;
+        case type_uint16 : num_errors += (serializer_read_uint16_t(context) == (uint16_t) v.integer) ? 0 : 1; break;
+        case type_uint32 : num_errors += (serializer_read_uint32_t(context) == (uint32_t) v.integer) ? 0 : 1; break;
+        case type_uint64 : num_errors += (serializer_read_uint64_t(context) == v.integer) ? 0 : 1; break;
+        case type_float : num_errors += (serializer_read_float(context) == v.real) ? 0 : 1; break;
+        default :
+            {
+                blob.resize(v.blob.size());
+                serializer_read_blob(context, blob.data(), blob.size());
+                num_errors += (blob == v.blob) ? 0 : 1;
+                break;
+            }
+        }
+    }
+    return num_errors;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static std::vector<uint8_t> read_whole_file(const char* path)
+{
+    std::vector<uint8_t> content(std::filesystem::file_size(path));
+    FILE* f = fopen(path, "rb");
+    if (f != NULL)
+    {
+        if (fread(content.data(), 1, content.size(), f) != content.size())
+            content.clear();
+        fclose(f);
+    }
+    return content;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of errors
+static uint32_t check_values(const std::vector<value>& values, const std::vector<uint8_t>& reference, const char* path, size_t chunk_size)
+{
+    std::vector<uint8_t> chunk(chunk_size);
+    uint32_t num_errors = 0;
+
+    FILE* f = fopen(path, "wb");
+    serializer_context serializer;
+    serializer_init_write_file(&serializer, f, chunk.data(), chunk.size());
+    write_values(&serializer, values);
+    serializer_flush(&serializer);
+    fclose(f);
+    num_errors += (serializer_get_status(&serializer) == serializer_no_error) ? 0 : 1;
+    num_errors += (serializer_get_position(&serializer) == reference.size()) ? 0 : 1;
+    num_errors += (read_whole_file(path) == reference) ? 0 : 1;
+
+    f = fopen(path, "rb");
+    serializer_init_read_file(&serializer, f, chunk.data(), chunk.size());
+    uint32_t num_mismatches = read_values(&serializer, values);
+    num_errors += num_mismatches;
+    num_errors += (serializer_get_status(&serializer) == serializer_no_error) ? 0 : 1;
+    num_errors += (serializer_get_position(&serializer) == reference.size()) ? 0 : 1;
+
+    // end of the file
+    serializer_read_uint8_t(&serializer);
+    num_errors += (serializer_get_status(&serializer) == serializer_read_error) ? 0 : 1;
+    fclose(f);
+
+    fprintf(stdout, "values       %10zu   %10zu   %10u   %6u\n", chunk_size, reference.size(), num_mismatches, num_errors);
+    return num_errors;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of errors
+static uint32_t check_scene(const tds_scene* scene, const char* name, const char* path)
+{
+    std::vector<uint8_t> reference(1<<16);
+    size_t size;
+    while ((size = tds_scene_serialize(scene, reference.data(), reference.size())) == 0)
+        reference.resize(reference.size() * 2);
+    reference.resize(size);
+
+    uint32_t num_errors = 0;
+    num_errors += tds_scene_save(scene, path) ? 0 : 1;
+    num_errors += (read_whole_file(path) == reference) ? 0 : 1;
+
+    // loading expands the normalized primitives, the scene loaded from memory is the reference
+    tds_scene loaded, expected;
+    if (tds_scene_load(&loaded, path) && tds_scene_load_memory(&expected, reference.data(), reference.size()))
+    {
+        num_errors += (loaded.num_primitives == expected.num_primitives) ? 0 : 1;
+        std::vector<uint8_t> a(reference.size()), b(reference.size());
+        num_errors += (tds_scene_serialize(&loaded, a.data(), a.size()) > 0 && tds_scene_serialize(&expected, b.data(), b.size()) > 0 && a == b) ? 0 : 1;
+        tds_scene_terminate(&loaded);
+        tds_scene_terminate(&expected);
+    }
+    else
+        num_errors++;
+
+    fprintf(stdout, "%-12s %10zu   %10zu   %10u   %6u\n", name, TDS_FILE_CHUNKSIZE, reference.size(), scene->num_primitives, num_errors);
+    return num_errors;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    log_set_level(LOG_ERROR);
+    srand(1);
+
+    std::string path = (std::filesystem::temp_directory_path() / "serializer_stream_check.tds").string();
+    uint32_t num_errors = 0;
+
+    std::vector<value> values = random_values();
+    std::vector<uint8_t> reference(NUM_VALUES * MAX_BLOB_SIZE);
+    serializer_context serializer;
+    serializer_init(&serializer, reference.data(), reference.size());
+    write_values(&serializer, values);
+    reference.resize(serializer_get_position(&serializer));
+
+    fprintf(stdout, "data         chunk size   file bytes   mismatches   errors\n");
+    const size_t chunk_sizes[] = {1, 3, 8, 64, 4096, 1<<20};
+    for(size_t chunk_size : chunk_sizes)
+        num_errors += check_values(values, reference, path.c_str(), chunk_size);
+
+    std::vector<tds_scene> scenes;
+    if (bench_load_scenes(folder, &scenes))
+    {
+        tds_scene replicated = tds_scene_replicate(scenes, REPLICATED_PRIMITIVES);
+
+        fprintf(stdout, "\nscene        chunk size   file bytes   primitives   errors\n");
+        for(size_t i=0; i<scenes.size(); ++i)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "scene %zu", i);
+            num_errors += check_scene(&scenes[i], name, path.c_str());
+        }
+        num_errors += check_scene(&replicated, "replicated", path.c_str());
+
+        bench_free_scenes(&scenes);
+        tds_scene_terminate(&replicated);
+    }
+    else
+        num_errors++;
+
+    remove(path.c_str());
+
+    fprintf(stdout, "\n%s\n", (num_errors == 0) ? "success" : "failed");
+    return (num_errors == 0) ? 0 : -1;
+}
@@ -0,0 +1,323 @@
+#include "bench_common.h"
+#include "allocation_counter.h"
+#include "../editor/primitive.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// reproducible benchmark of the pipeline phases, each one run in isolation on every .tds of a folder and on stress scenes
+// made of the primitives of all the files replicated up to a given count
+//  * deserialization : tds_scene_load_memory of the file in memory (includes the primitive_update_aabb of the loading)
+//  * update_aabb : primitive_update_aabb on every primitive
+//  * command_building : renderer_begin_frame to renderer_end_frame, command cache disabled
+//  * binning : cpu binning of the commands built once, renderer_flush without drawable
+//  * rasterization : cpu rasterization, renderer_flush with a framebuffer (bytes allocated include the binning)
+// median and 95th percentile of the iterations (the first one is a warm-up), bytes allocated per iteration
+// results are written as json to track regressions across commits
+//
+// usage : tds_bench [-f folder] [-n iterations] [-s size] [-j threads] [-c count]... [-o results.json]
+//         size is "1920x1080" by default, one thread by default, counts are 1000, 10000 and 60000 primitives by default,
+//         "-c 0" only benchmarks the files
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define DEFAULT_ITERATIONS (20)
+#define DEFAULT_OUTPUT "tds_bench.json"
+
+enum bench_phase
+{
+    phase_deserialization,
+    phase_update_aabb,
+    phase_command_building,
+    phase_binning,
+    phase_rasterization,
+    phase_count
+};
+
+static const char* phase_names[phase_count] = {"deserialization", "update_aabb", "command_building", "binning", "rasterization"};
+
+struct bench_settings
+{
+    uint32_t num_iterations;
+    uint32_t width, height;
+    uint32_t num_threads;
+};
+
+struct phase_result
+{
+    double median;          // in seconds
+    double p95;
+    uint64_t bytes;         // allocated per iteration
+};
+
+struct workload_result
+{
+    std::string name;
+    uint32_t num_primitives;
+    uint32_t num_commands;
+    uint32_t num_draw_data;
+    size_t file_size;
+    phase_result phases[phase_count];
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// times and allocations of the iterations of one phase
+struct phase_samples
+{
+    std::vector<double> times;
+    uint64_t bytes;
+    uint64_t start_bytes;
+    uint64_t start_time;
+
+    void begin() {start_bytes = allocation_counter_bytes(); start_time = stm_now();}
+    void end() {add(stm_sec(stm_since(start_time)));}
+    void add(double time)
+    {
+        bytes += allocation_counter_bytes() - start_bytes;
+        times.push_back(time);
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+// nearest rank percentile, the warm-up iteration is dropped
+static phase_result summarize(phase_samples& samples)
+{
+    std::vector<double> times(samples.times.begin() + 1, samples.times.end());
+    std::sort(times.begin(), times.end());
+
+    size_t p95 = (times.size() * 95 + 99) / 100;
+    return phase_result
+    {
+        .median = times[(times.size() - 1) / 2],
+        .p95 = times[(p95 > 0) ? p95 - 1 : 0],
+        .bytes = samples.bytes / samples.times.size()
+    };
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void build_commands(struct renderer* r, tds_scene* scene, const bench_settings& settings)
+{
+    renderer_begin_frame(r);
+    tds_scene_draw(scene, r, settings.width, settings.height);
+    renderer_end_frame(r);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static workload_result run(const char* name, tds_scene* scene, const bench_settings& settings)
+{
+    workload_result result;
+    result.name = name;
+    result.num_primitives = scene->num_primitives;
+
+    const uint32_t num_samples = settings.num_iterations + 1;
+    phase_samples samples[phase_count];
+    for(phase_samples& s : samples)
+        s.bytes = 0;
+
+    // deserialization from memory, the file is serialized again so replicated scenes go through the same path
+    size_t buffer_size = 1024 + (size_t) scene->num_primitives * sizeof(struct primitive) * 2;
+    void* buffer = malloc(buffer_size);
+    result.file_size = tds_scene_serialize(scene, buffer, buffer_size);
+    for(uint32_t i=0; i<num_samples && result.file_size > 0; ++i)
+    {
+        tds_scene copy;
+        samples[phase_deserialization].begin();
+        tds_scene_load_memory(&copy, buffer, result.file_size);
+        samples[phase_deserialization].end();
+        tds_scene_terminate(&copy);
+    }
+    free(buffer);
+
+    for(uint32_t i=0; i<num_samples; ++i)
+    {
+        samples[phase_update_aabb].begin();
+        for(uint32_t j=0; j<scene->num_primitives; ++j)
+            primitive_update_aabb(&scene->primitives[j]);
+        samples[phase_update_aabb].end();
+    }
+
+    struct renderer* r = renderer_init(nullptr, settings.width, settings.height);
+    renderer_set_num_threads(r, settings.num_threads);
+    renderer_set_cache(r, false);
+
+    for(uint32_t i=0; i<num_samples; ++i)
+    {
+        samples[phase_command_building].begin();
+        build_commands(r, scene, settings);
+        samples[phase_command_building].end();
+    }
+
+    struct renderer_stats stats;
+    renderer_get_stats(r, &stats);
+    result.num_commands = stats.num_commands;
+    result.num_draw_data = stats.num_draw_data;
+
+    // the commands of the last frame are binned again and again, the renderer measures each part of the flush
+    for(uint32_t i=0; i<num_samples; ++i)
+    {
+        samples[phase_binning].begin();
+        renderer_flush(r, nullptr);
+        renderer_get_stats(r, &stats);
+        samples[phase_binning].add(stats.binning_time);
+    }
+
+    uint32_t* framebuffer = (uint32_t*) malloc((size_t)settings.width * settings.height * sizeof(uint32_t));
+    for(uint32_t i=0; i<num_samples; ++i)
+    {
+        samples[phase_rasterization].begin();
+        renderer_flush(r, framebuffer);
+        renderer_get_stats(r, &stats);
+        samples[phase_rasterization].add(stats.rasterization_time);
+    }
+    free(framebuffer);
+    renderer_terminate(r);
+
+    for(uint32_t phase=0; phase<phase_count; ++phase)
+        result.phases[phase] = samples[phase].times.size() > 1 ? summarize(samples[phase]) : phase_result{0.0, 0.0, 0};
+
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void print_result(const workload_result& result)
+{
+    fprintf(stdout, "%s : %u primitives, %u commands, %u draw data, %zu bytes file\n", result.name.c_str(),
+            result.num_primitives, result.num_commands, result.num_draw_data, result.file_size);
+    fprintf(stdout, "    phase              median ms     p95 ms   bytes/iteration\n");
+
+    for(uint32_t phase=0; phase<phase_count; ++phase)
+    {
+        const phase_result& p = result.phases[phase];
+        fprintf(stdout, "    %-16s   %9.4f   %8.4f   %15llu\n", phase_names[phase], p.median * 1000.0, p.p95 * 1000.0,
+                (unsigned long long) p.bytes);
+    }
+    fprintf(stdout, "\n");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool write_json(const char* path, const bench_settings& settings, const std::vector<workload_result>& results)
+{
+    FILE* f = fopen(path, "w");
+    if (f == NULL)
+        return false;
+
+    fprintf(f, "{\n  \"width\": %u,\n  \"height\": %u,\n  \"threads\": %u,\n  \"iterations\": %u,\n", settings.width,
+            settings.height, settings.num_threads, settings.num_iterations);
+    fprintf(f, "  \"allocation_tracking\": %s,\n  \"workloads\": [", allocation_counter_supported() ? "true" : "false");
+
+    for(size_t i=0; i<results.size(); ++i)
+    {
+        const workload_result& result = results[i];
+        fprintf(f, "%s\n    {\n      \"name\": \"%s\",\n      \"primitives\": %u,\n      \"commands\": %u,\n", (i > 0) ? "," : "",
+                result.name.c_str(), result.num_primitives, result.num_commands);
+        fprintf(f, "      \"draw_data\": %u,\n      \"file_size\": %zu,\n      \"phases\": {", result.num_draw_data, result.file_size);
+
+        for(uint32_t phase=0; phase<phase_count; ++phase)
+        {
+            const phase_result& p = result.phases[phase];
+            fprintf(f, "%s\n        \"%s\": {\"median_ms\": %.6f, \"p95_ms\": %.6f, \"bytes_allocated\": %llu}",
+                    (phase > 0) ? "," : "", phase_names[phase], p.median * 1000.0, p.p95 * 1000.0, (unsigned long long) p.bytes);
+        }
+        fprintf(f, "\n      }\n    }");
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = EXAMPLES_PATH;
+    const char* output = DEFAULT_OUTPUT;
+    bench_settings settings = {.num_iterations = DEFAULT_ITERATIONS, .width = 1920, .height = 1080, .num_threads = 1};
+    std::vector<uint32_t> counts;
+
+    for(int i=1; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "-f") == 0 && i+1 < argc)
+            folder = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i+1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && i+1 < argc)
+            settings.num_iterations = (uint32_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "-j") == 0 && i+1 < argc)
+            settings.num_threads = (uint32_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i+1 < argc)
+            counts.push_back((uint32_t) atoi(argv[++i]));
+        else if (strcmp(argv[i], "-s") == 0 && i+1 < argc)
+        {
+            int count = sscanf(argv[++i], "%ux%u", &settings.width, &settings.height);
+            if (count == 1)
+                settings.height = settings.width;
+            else if (count != 2 || settings.width == 0 || settings.height == 0)
+            {
+                fprintf(stderr, "invalid size '%s'\n", argv[i]);
+                return -1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage : tds_bench [-f folder] [-n iterations] [-s size] [-j threads] [-c count]... [-o results.json]\n");
+            return -1;
+        }
+    }
+
+    if (settings.num_iterations == 0) settings.num_iterations = 1;
+    if (counts.empty()) counts = {1000, 10000, 60000};
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    std::vector<std::string> paths = tds_scene_list_folder(folder);
+
+    std::vector<tds_scene> scenes;
+    std::vector<workload_result> results;
+    for(const std::string& path : paths)
+    {
+        tds_scene scene;
+        if (!tds_scene_load(&scene, path.c_str()))
+            continue;
+
+        scenes.push_back(scene);
+        results.push_back(run(std::filesystem::path(path).filename().string().c_str(), &scenes.back(), settings));
+        print_result(results.back());
+    }
+
+    if (scenes.empty())
+    {
+        fprintf(stderr, "no scene found in '%s'\n", folder);
+        return -1;
+    }
+
+    for(uint32_t count : counts)
+    {
+        if (count == 0)
+            continue;
+
+        tds_scene stress = tds_scene_replicate(scenes, count);
+        results.push_back(run(("stress_" + std::to_string(count)).c_str(), &stress, settings));
+        print_result(results.back());
+        tds_scene_terminate(&stress);
+    }
+
+    if (!allocation_counter_supported())
+        fprintf(stdout, "allocations are not tracked on this platform\n");
+
+    bool success = write_json(output, settings, results);
+    if (success)
+        fprintf(stdout, "results written to '%s'\n", output);
+    else
+        fprintf(stderr, "can't write '%s'\n", output);
+
+    bench_free_scenes(&scenes);
+
+    return success ? 0 : -1;
+}
@@ -0,0 +1,60 @@
+#include "tds_scene.h"
+#include "png_export.h"
+#include "../system/log.h"
+#include <sys/resource.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// renders a .tds file to a png of any size (up to 65535 pixels wide) with bounded memory, see png_export.h
+// band_height 0 picks a band size so that the framebuffer stays around 16 MB
+//
+// usage : tds_export file.tds output.png [width] [height] [band_height] [threads]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------------
+static double peak_memory_mb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (double) usage.ru_maxrss / (1024.0 * 1024.0);    // bytes
+#else
+    return (double) usage.ru_maxrss / 1024.0;               // kilobytes
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage : tds_export file.tds output.png [width] [height] [band_height] [threads]\n");
+        return -1;
+    }
+
+    uint32_t width = (argc > 3) ? (uint32_t) atoi(argv[3]) : 4096;
+    uint32_t height = (argc > 4) ? (uint32_t) atoi(argv[4]) : width;
+    uint32_t band_height = (argc > 5) ? (uint32_t) atoi(argv[5]) : 0;
+    uint32_t num_threads = (argc > 6) ? (uint32_t) atoi(argv[6]) : 0;
+
+    log_set_level(LOG_WARN);
+
+    tds_scene scene;
+    if (!tds_scene_load(&scene, argv[1]))
+        return -1;
+
+    png_export_stats stats;
+    bool result = tds_scene_export_png(&scene, argv[2], width, height, band_height, num_threads, &stats);
+    tds_scene_terminate(&scene);
+
+    if (!result)
+        return -1;
+
+    double megapixels = (double) width * height / 1e6;
+    fprintf(stdout, "%ux%u (%.1f Mpixels) in %u bands\n", width, height, megapixels, stats.num_bands);
+    fprintf(stdout, "render %.3f s, encode %.3f s, %.1f Mpixels/s\n", stats.render_time, stats.encode_time,
+            megapixels / (stats.render_time + stats.encode_time));
+    fprintf(stdout, "peak memory %.1f MB\n", peak_memory_mb());
+    return 0;
+}
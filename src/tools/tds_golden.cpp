@@ -0,0 +1,331 @@
+#include "bench_common.h"
+#include "png_export.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/ortho.h"
+#include "../system/sokol_time.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// golden image regression check of the cpu backend, meant to gate changes of sdf.h, collision.h, operators.h, the binning
+// or Renderer.cpp
+//  * every .tds of the examples folder is rendered like the editor does, plus synthetic stress scenes : every shape and
+//    fill mode, combinations with every operator, text, and a pile of overlapping opaque and translucent shapes
+//  * each image is compared with <golden>/<name>.png, a pixel fails if one channel differs by more than the tolerance
+//  * on failure <diff>/<name>_diff.png (failing pixels in red over the dimmed golden image) and <diff>/<name>.png (the
+//    new image) are written
+//  * -u writes the new images as golden images instead of comparing them
+//
+// usage : tds_golden [-u] [-f folder] [-g golden] [-d diff] [-t tolerance]
+// returns 0 if every image matches its golden image
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define GOLDEN_PATH "../examples/golden/"
+#define DIFF_PATH "golden_diff/"
+#define DEFAULT_TOLERANCE (2)
+#define EXAMPLE_SIZE (256)
+#define STRESS_SIZE (512)
+
+struct golden_settings
+{
+    std::string golden;
+    std::string diff;
+    uint32_t tolerance;
+    bool update;
+};
+
+struct golden_image
+{
+    std::string name;
+    uint32_t width, height;
+    uint32_t* pixels;
+};
+
+typedef void (*draw_function)(struct renderer* r, uint32_t size);
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void draw_shape(struct renderer* r, uint32_t shape, vec2 center, float radius, float thickness, enum primitive_fillmode fill,
+                       draw_color color, enum sdf_operator op)
+{
+    vec2 p0 = vec2_set(center.x - radius, center.y - radius * .5f);
+    vec2 p1 = vec2_set(center.x + radius, center.y + radius * .5f);
+    vec2 p2 = vec2_set(center.x - radius * .25f, center.y + radius);
+
+    switch(shape)
+    {
+    case 0 : renderer_draw_disc(r, center, radius, thickness, fill, color, op); break;
+    case 1 : renderer_draw_orientedbox(r, p0, p1, radius, radius * .2f, thickness, fill, color, op); break;
+    case 2 : renderer_draw_ellipse(r, p0, p1, radius * .8f, thickness, fill, color, op); break;
+    case 3 : renderer_draw_triangle(r, p0, p1, p2, radius * .1f, thickness, fill, color, op); break;
+    case 4 : renderer_draw_pie(r, center, p1, 2.f, thickness, fill, color, op); break;
+    case 5 : renderer_draw_unevencapsule(r, p0, p1, radius * .5f, radius * .2f, thickness, fill, color, op); break;
+    case 6 : renderer_draw_arc(r, center, vec2_set(0.f, -1.f), 2.f, radius * .8f, thickness, fill, color, op); break;
+    case 7 : renderer_draw_trapezoid(r, p0, p1, radius * .6f, radius * .2f, radius * .1f, thickness, fill, color, op); break;
+    default : renderer_draw_line(r, p0, p1, thickness, color, op); break;
+    }
+}
+
+#define NUM_SHAPES (9)
+
+//----------------------------------------------------------------------------------------------------------------------------
+// one row per fill mode, then combinations of every operator with and without smoothing, then text
+static void draw_shapes(struct renderer* r, uint32_t size)
+{
+    const float cell = (float) size / NUM_SHAPES;
+    const float radius = cell * .4f;
+
+    for(uint32_t fill=0; fill<fill_last; ++fill)
+    {
+        for(uint32_t shape=0; shape<NUM_SHAPES; ++shape)
+        {
+            vec2 center = vec2_set(cell * (shape + .5f), cell * (fill + .5f));
+            draw_color color((uint8_t)(64 + shape * 20), (uint8_t)(220 - fill * 60), 180, 255);
+            draw_shape(r, shape, center, radius, 3.f, (enum primitive_fillmode) fill, color, op_add);
+        }
+    }
+
+    for(uint32_t op=op_union; op<op_last; ++op)
+    {
+        for(uint32_t smooth=0; smooth<3; ++smooth)
+        {
+            vec2 center = vec2_set(cell * (1.f + smooth * 3.f), cell * (3.5f + (op - op_union) * 1.5f));
+            renderer_begin_combination(r, (float) smooth * 6.f);
+            draw_shape(r, 0, center, radius * 1.2f, 0.f, fill_solid, draw_color(240, 120, 40, 255), op_union);
+            draw_shape(r, smooth + 1, vec2_add(center, vec2_set(radius, 0.f)), radius, 0.f, fill_solid, draw_color(40, 120, 240, 255),
+                       (enum sdf_operator) op);
+            renderer_end_combination(r, smooth == 2);
+        }
+    }
+
+    renderer_draw_text(r, 8.f, (float) size - 24.f, "ToodeeSculpt 0123456789 !?", draw_color(255, 255, 255, 255));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// opaque and translucent shapes piled up and crossing the borders, the later opaque ones hide the tiles below
+static void draw_overdraw(struct renderer* r, uint32_t size)
+{
+    uint32_t state = 0x2545f491;
+    const float margin = 32.f;
+
+    for(uint32_t i=0; i<600; ++i)
+    {
+        vec2 center = vec2_set(random_float_portable(&state, -margin, size + margin),
+                               random_float_portable(&state, -margin, size + margin));
+        float radius = random_float_portable(&state, 4.f, (i % 50 == 0) ? size * .4f : 48.f);
+        uint8_t alpha = (i % 3 == 0) ? 128 : 255;
+        draw_color color((uint8_t) random_float_portable(&state, 0.f, 255.f), (uint8_t) random_float_portable(&state, 0.f, 255.f),
+                         (uint8_t) random_float_portable(&state, 0.f, 255.f), alpha);
+
+        draw_shape(r, i % NUM_SHAPES, center, radius, 2.f, (i % 7 == 0) ? fill_outline : fill_solid, color, op_add);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static golden_image render_stress(const char* name, draw_function draw, uint32_t size)
+{
+    golden_image image = {name, size, size, (uint32_t*) malloc((size_t)size * size * sizeof(uint32_t))};
+    struct renderer* r = renderer_init(nullptr, size, size);
+
+    // pixel coordinates
+    struct view_proj vp;
+    ortho_set_viewport(&vp, vec2_set((float)size, (float)size), vec2_set((float)size, (float)size), vec2_zero());
+
+    renderer_begin_frame(r);
+    renderer_set_viewproj(r, &vp);
+    draw(r, size);
+    renderer_end_frame(r);
+    renderer_flush(r, image.pixels);
+    renderer_terminate(r);
+    return image;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static golden_image render_scene(const char* name, tds_scene* scene, uint32_t size)
+{
+    golden_image image = {name, size, size, (uint32_t*) malloc((size_t)size * size * sizeof(uint32_t))};
+    struct renderer* r = renderer_init(nullptr, size, size);
+
+    bench_draw(r, scene, size, size, image.pixels);
+    renderer_terminate(r);
+    return image;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static uint32_t channel_difference(uint32_t a, uint32_t b)
+{
+    uint32_t result = 0;
+    for(uint32_t shift=0; shift<24; shift+=8)
+    {
+        int difference = (int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff);
+        uint32_t value = (uint32_t) abs(difference);
+        result = (value > result) ? value : result;
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of failing pixels, the diff image is written if there is any
+static uint32_t compare(const golden_settings& settings, const golden_image& image, const uint32_t* golden, uint32_t* max_difference)
+{
+    size_t num_pixels = (size_t)image.width * image.height;
+    uint32_t* diff = (uint32_t*) malloc(num_pixels * sizeof(uint32_t));
+    uint32_t num_failed = 0;
+    *max_difference = 0;
+
+    for(size_t i=0; i<num_pixels; ++i)
+    {
+        uint32_t difference = channel_difference(image.pixels[i], golden[i]);
+        *max_difference = (difference > *max_difference) ? difference : *max_difference;
+
+        if (difference > settings.tolerance)
+        {
+            diff[i] = 0xff0000ff;
+            num_failed++;
+        }
+        else
+        {
+            // dimmed golden image
+            diff[i] = (golden[i] >> 2) & 0x003f3f3f;
+        }
+    }
+
+    if (num_failed > 0)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(settings.diff, error);
+        png_write((std::filesystem::path(settings.diff) / (image.name + "_diff.png")).string().c_str(), diff, image.width, image.height);
+        png_write((std::filesystem::path(settings.diff) / (image.name + ".png")).string().c_str(), image.pixels, image.width, image.height);
+    }
+
+    free(diff);
+    return num_failed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool check(const golden_settings& settings, const golden_image& image)
+{
+    std::string path = (std::filesystem::path(settings.golden) / (image.name + ".png")).string();
+    if (settings.update)
+    {
+        bool written = png_write(path.c_str(), image.pixels, image.width, image.height);
+        fprintf(stdout, "%-24s   %s\n", image.name.c_str(), written ? "updated" : "CAN'T WRITE");
+        return written;
+    }
+
+    uint32_t width, height;
+    uint32_t* golden = png_read(path.c_str(), &width, &height);
+    if (golden == nullptr)
+    {
+        fprintf(stdout, "%-24s   MISSING golden image '%s' (run with -u)\n", image.name.c_str(), path.c_str());
+        return false;
+    }
+
+    bool success = false;
+    if (width != image.width || height != image.height)
+        fprintf(stdout, "%-24s   FAILED golden image is %ux%u instead of %ux%u\n", image.name.c_str(), width, height, image.width, image.height);
+    else
+    {
+        uint32_t max_difference;
+        uint32_t num_failed = compare(settings, image, golden, &max_difference);
+        success = (num_failed == 0);
+
+        if (success)
+            fprintf(stdout, "%-24s   ok (max difference %u)\n", image.name.c_str(), max_difference);
+        else
+            fprintf(stdout, "%-24s   FAILED %u pixels (max difference %u), see '%s'\n", image.name.c_str(), num_failed,
+                    max_difference, settings.diff.c_str());
+    }
+
+    free(golden);
+    return success;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = EXAMPLES_PATH;
+    golden_settings settings = {GOLDEN_PATH, DIFF_PATH, DEFAULT_TOLERANCE, false};
+
+    for(int i=1; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "-u") == 0)
+            settings.update = true;
+        else if (strcmp(argv[i], "-f") == 0 && i+1 < argc)
+            folder = argv[++i];
+        else if (strcmp(argv[i], "-g") == 0 && i+1 < argc)
+            settings.golden = argv[++i];
+        else if (strcmp(argv[i], "-d") == 0 && i+1 < argc)
+            settings.diff = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0 && i+1 < argc)
+            settings.tolerance = (uint32_t) atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage : tds_golden [-u] [-f folder] [-g golden] [-d diff] [-t tolerance]\n");
+            return -1;
+        }
+    }
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    std::vector<std::string> paths = tds_scene_list_folder(folder);
+
+    // a file that can't be loaded anymore is a regression too
+    std::vector<tds_scene> scenes;
+    std::vector<std::string> names;
+    uint32_t num_failed = 0;
+    for(const std::string& path : paths)
+    {
+        tds_scene scene;
+        if (tds_scene_load(&scene, path.c_str()))
+        {
+            scenes.push_back(scene);
+            names.push_back(std::filesystem::path(path).stem().string());
+        }
+        else
+        {
+            fprintf(stdout, "%-24s   FAILED can't be loaded\n", path.c_str());
+            num_failed++;
+        }
+    }
+
+    if (scenes.empty())
+    {
+        fprintf(stderr, "no scene found in '%s'\n", folder);
+        return -1;
+    }
+
+    if (settings.update)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(settings.golden, error);
+    }
+
+    uint64_t start = stm_now();
+    std::vector<golden_image> images;
+    for(size_t i=0; i<scenes.size(); ++i)
+        images.push_back(render_scene(names[i].c_str(), &scenes[i], EXAMPLE_SIZE));
+
+    tds_scene replicated = tds_scene_replicate(scenes, 2000);
+    images.push_back(render_scene("stress_replicated", &replicated, STRESS_SIZE));
+    images.push_back(render_stress("stress_shapes", draw_shapes, STRESS_SIZE));
+    images.push_back(render_stress("stress_overdraw", draw_overdraw, STRESS_SIZE));
+    tds_scene_terminate(&replicated);
+
+    for(const golden_image& image : images)
+        num_failed += check(settings, image) ? 0 : 1;
+
+    fprintf(stdout, "\n%zu images, %u failed, tolerance %u, %.2f s\n", images.size(), num_failed, settings.tolerance,
+            stm_sec(stm_since(start)));
+
+    for(golden_image& image : images)
+        free(image.pixels);
+    bench_free_scenes(&scenes);
+
+    return (num_failed == 0) ? 0 : -1;
+}
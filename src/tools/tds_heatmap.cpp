@@ -0,0 +1,112 @@
+#include "tds_scene.h"
+#include "heatmap_export.h"
+#include "png_export.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// per tile cost of .tds scenes rendered with the cpu backend, to find out why a scene is slow
+//  * <output>/<name>_heatmap.csv : commands, combination pairs and estimated sdf evaluations of each tile
+//  * <output>/<name>_<metric>.png : one heatmap per metric over the rendered image
+//  * max, p50 and p99 over the tiles of each scene are printed
+//
+// usage : tds_heatmap [-o output] [-s size] files or folders...
+//         size is "1024" (square) or "1920x1080", default is 1024
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define DEFAULT_SIZE (1024)
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool export_heatmap(const renderer_heatmap& heatmap, const uint32_t* frame, uint32_t width, uint32_t height,
+                           const std::string& base)
+{
+    bool success = heatmap_write_csv((base + "_heatmap.csv").c_str(), &heatmap);
+    for(uint32_t i=0; i<heatmap_metric_count; ++i)
+    {
+        renderer_heatmap_metric metric = (renderer_heatmap_metric) i;
+        std::string path = base + "_" + heatmap_metric_name(metric) + ".png";
+        success &= heatmap_write_png(path.c_str(), &heatmap, metric, frame, width, height);
+    }
+    return success;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    std::string output = ".";
+    uint32_t width = DEFAULT_SIZE, height = DEFAULT_SIZE;
+    std::vector<std::string> paths;
+
+    for(int i=1; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i+1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i+1 < argc)
+        {
+            if (!tds_scene_parse_size(argv[++i], &width, &height))
+            {
+                fprintf(stderr, "invalid size '%s'\n", argv[i]);
+                return -1;
+            }
+        }
+        else
+            tds_scene_add_path(argv[i], &paths);
+    }
+
+    if (paths.empty())
+    {
+        fprintf(stderr, "usage : tds_heatmap [-o output] [-s size] files or folders...\n");
+        return -1;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(output, error);
+    log_set_level(LOG_WARN);
+
+    struct renderer* r = renderer_init_ex(nullptr, width, height, renderer_aabb_format_for_size(width, height));
+    renderer_set_heatmap(r, true);
+    uint32_t* frame = (uint32_t*) malloc((size_t)width * height * sizeof(uint32_t));
+
+    fprintf(stdout, "%ux%u, %ux%u tiles\n\n", width, height, (width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE);
+    fprintf(stdout, "%-24s %-13s %8s %8s %8s\n", "scene", "per tile", "max", "p50", "p99");
+
+    uint32_t num_failed = 0;
+    for(const std::string& path : paths)
+    {
+        tds_scene scene;
+        if (!tds_scene_load(&scene, path.c_str()))
+        {
+            log_error("skipping '%s'", path.c_str());
+            num_failed++;
+            continue;
+        }
+
+        renderer_begin_frame(r);
+        tds_scene_draw(&scene, r, width, height);
+        renderer_end_frame(r);
+        renderer_flush(r, frame);
+
+        renderer_heatmap heatmap;
+        renderer_get_heatmap(r, &heatmap);
+
+        std::string name = std::filesystem::path(path).stem().string();
+        if (!export_heatmap(heatmap, frame, width, height, (std::filesystem::path(output) / name).string()))
+            num_failed++;
+
+        for(uint32_t i=0; i<heatmap_metric_count; ++i)
+            fprintf(stdout, "%-24s %-13s %8u %8u %8u\n", (i == 0) ? name.c_str() : "",
+                    heatmap_metric_name((renderer_heatmap_metric) i), heatmap.max[i], heatmap.p50[i], heatmap.p99[i]);
+
+        tds_scene_terminate(&scene);
+    }
+
+    free(frame);
+    renderer_terminate(r);
+    return (num_failed == 0) ? 0 : -1;
+}
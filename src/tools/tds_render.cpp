@@ -0,0 +1,248 @@
+#include "tds_scene.h"
+#include "png_export.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/profiler.h"
+#include "../system/sokol_time.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// batch renderer for the asset pipeline : every .tds (or every .tds of a folder) is rendered with the cpu backend at each
+// requested size and written as png
+//  * files are processed in parallel, each job has its own single threaded renderer
+//  * loading goes through the primitive list of the editor which is global, loads are serialized
+//  * output is <output>/<name>.png with one size, <output>/<name>_<width>x<height>.png otherwise
+//  * with -p, each image is a profiler frame and the last ones are written as a chrome trace at the end
+//
+// usage : tds_render [-o output] [-s size]... [-j jobs] [-p trace.json] files or folders...
+//         size is "256" (square) or "512x256", default is 256, jobs default is one per core
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define DEFAULT_SIZE (256)
+
+struct image_size
+{
+    uint32_t width, height;
+};
+
+// in seconds, summed over all jobs
+struct phase_timings
+{
+    double load;
+    double draw;            // primitive_draw to renderer_end_frame
+    double binning;
+    double rasterization;
+    double encode;          // png compression and file writing
+};
+
+struct batch
+{
+    std::vector<std::string> paths;
+    std::vector<image_size> sizes;
+    std::string output;
+    std::atomic<uint32_t> next_file;
+    std::atomic<uint32_t> num_failed;
+    std::mutex load_mutex;
+    bool wide;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static std::string output_path(const batch& b, const std::string& path, const image_size& size)
+{
+    std::string name = std::filesystem::path(path).stem().string();
+    if (b.sizes.size() > 1)
+        name += "_" + std::to_string(size.width) + "x" + std::to_string(size.height);
+
+    return (std::filesystem::path(b.output) / (name + ".png")).string();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void job(batch* b, phase_timings* timings)
+{
+    struct renderer* r = nullptr;
+    image_size current = {0, 0};
+    uint32_t* framebuffer = nullptr;
+
+    for(uint32_t i=b->next_file++; i<b->paths.size(); i=b->next_file++)
+    {
+        const std::string& path = b->paths[i];
+        tds_scene scene;
+
+        // waiting for the lock is not counted
+        bool loaded;
+        uint64_t start;
+        {
+            std::lock_guard<std::mutex> lock(b->load_mutex);
+            PROFILER_SCOPE("load");
+            start = stm_now();
+            loaded = tds_scene_load(&scene, path.c_str());
+            timings->load += stm_sec(stm_since(start));
+        }
+
+        if (!loaded)
+        {
+            log_error("skipping '%s'", path.c_str());
+            b->num_failed++;
+            continue;
+        }
+
+        bool success = true;
+        for(const image_size& size : b->sizes)
+        {
+            if (r == nullptr)
+            {
+                r = renderer_init_ex(nullptr, size.width, size.height, b->wide ? aabb_wide : aabb_compact);
+                renderer_set_num_threads(r, 1);
+            }
+            else if (size.width != current.width || size.height != current.height)
+                renderer_resize(r, size.width, size.height);
+
+            if (size.width * size.height > current.width * current.height)
+                framebuffer = (uint32_t*) realloc(framebuffer, (size_t)size.width * size.height * sizeof(uint32_t));
+            current = size;
+
+            profiler_begin_frame();
+            start = stm_now();
+            renderer_begin_frame(r);
+            tds_scene_draw(&scene, r, size.width, size.height);
+            renderer_end_frame(r);
+            timings->draw += stm_sec(stm_since(start));
+
+            renderer_flush(r, framebuffer);
+
+            struct renderer_stats stats;
+            renderer_get_stats(r, &stats);
+            timings->binning += stats.binning_time;
+            timings->rasterization += stats.rasterization_time;
+
+            PROFILER_SCOPE("encode");
+            start = stm_now();
+            success &= png_write(output_path(*b, path, size).c_str(), framebuffer, size.width, size.height);
+            timings->encode += stm_sec(stm_since(start));
+        }
+
+        if (!success)
+            b->num_failed++;
+
+        tds_scene_terminate(&scene);
+    }
+
+    free(framebuffer);
+    if (r != nullptr)
+        renderer_terminate(r);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    batch b;
+    b.output = ".";
+    b.next_file = 0;
+    b.num_failed = 0;
+    b.wide = false;
+    uint32_t num_jobs = std::thread::hardware_concurrency();
+    const char* trace_path = nullptr;
+
+    for(int i=1; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i+1 < argc)
+            b.output = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i+1 < argc)
+            num_jobs = (uint32_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0 && i+1 < argc)
+            trace_path = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i+1 < argc)
+        {
+            image_size size;
+            if (!tds_scene_parse_size(argv[++i], &size.width, &size.height))
+            {
+                fprintf(stderr, "invalid size '%s'\n", argv[i]);
+                return -1;
+            }
+            b.sizes.push_back(size);
+        }
+        else
+            tds_scene_add_path(argv[i], &b.paths);
+    }
+
+    if (b.paths.empty())
+    {
+        fprintf(stderr, "usage : tds_render [-o output] [-s size]... [-j jobs] [-p trace.json] files or folders...\n");
+        return -1;
+    }
+
+    if (b.sizes.empty())
+        b.sizes.push_back({DEFAULT_SIZE, DEFAULT_SIZE});
+
+    for(const image_size& size : b.sizes)
+        b.wide |= (renderer_aabb_format_for_size(size.width, size.height) == aabb_wide);
+
+    std::error_code error;
+    std::filesystem::create_directories(b.output, error);
+
+    if (num_jobs == 0) num_jobs = 1;
+    num_jobs = std::min(num_jobs, (uint32_t) b.paths.size());
+
+    log_set_level(LOG_WARN);
+    stm_setup();
+    profiler_set_enabled(trace_path != nullptr);
+
+    std::vector<phase_timings> timings(num_jobs, phase_timings{0.0, 0.0, 0.0, 0.0, 0.0});
+    std::vector<std::thread> threads;
+
+    uint64_t start = stm_now();
+    for(uint32_t i=0; i<num_jobs; ++i)
+        threads.emplace_back(job, &b, &timings[i]);
+
+    for(std::thread& thread : threads)
+        thread.join();
+    double wall_time = stm_sec(stm_since(start));
+
+    phase_timings total = {0.0, 0.0, 0.0, 0.0, 0.0};
+    for(const phase_timings& t : timings)
+    {
+        total.load += t.load;
+        total.draw += t.draw;
+        total.binning += t.binning;
+        total.rasterization += t.rasterization;
+        total.encode += t.encode;
+    }
+
+    uint32_t num_files = (uint32_t) b.paths.size();
+    uint32_t num_images = (num_files - b.num_failed) * (uint32_t) b.sizes.size();
+    double sum = total.load + total.draw + total.binning + total.rasterization + total.encode;
+
+    fprintf(stdout, "%u files (%u failed), %u images, %u jobs\n", num_files, b.num_failed.load(), num_images, num_jobs);
+    fprintf(stdout, "%.3f s, %.1f files/s, %.1f images/s\n\n", wall_time, num_files / wall_time, num_images / wall_time);
+    fprintf(stdout, "phase           total s   ms/file   share\n");
+
+    const struct {const char* name; double time;} phases[] =
+    {
+        {"load", total.load},
+        {"draw", total.draw},
+        {"binning", total.binning},
+        {"rasterization", total.rasterization},
+        {"encode", total.encode},
+    };
+
+    for(const auto& phase : phases)
+        fprintf(stdout, "%-13s   %7.3f   %7.3f   %4.1f%%\n", phase.name, phase.time, phase.time * 1000.0 / num_files,
+                phase.time * 100.0 / sum);
+
+    if (trace_path != nullptr && !profiler_write_trace(trace_path))
+    {
+        fprintf(stderr, "can't write the trace to '%s'\n", trace_path);
+        return -1;
+    }
+
+    return (b.num_failed == 0) ? 0 : -1;
+}
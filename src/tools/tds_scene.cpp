@@ -0,0 +1,270 @@
+#include "tds_scene.h"
+#include "../editor/tds.h"
+#include "../editor/primitive.h"
+#include "../editor/primitive_list.h"
+#include "../system/palettes.h"
+#include "../renderer/renderer.h"
+#include "../system/ortho.h"
+#include "../system/log.h"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// same edition zone as the editor (see App.cpp)
+static const aabb edition_zone = {.min = {.x = 510.f, .y = 100.f}, .max = {.x = 1410.f, .y = 1000.f}};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool read_scene(struct tds_scene* scene, serializer_context* context)
+{
+    if (serializer_read_uint32_t(context) != TDS_FOURCC)
+    {
+        log_error("not a ToodeeSculpt file");
+        return false;
+    }
+
+    uint16_t major = serializer_read_uint16_t(context);
+    if (major != TDS_MAJOR)
+    {
+        log_error("file too old and not compatible");
+        return false;
+    }
+
+    // same as PrimitiveEditor::Deserialize
+    uint16_t minor = serializer_read_uint16_t(context);
+    scene->alpha = serializer_read_float(context);
+    scene->smooth_blend = serializer_read_float(context);
+    serializer_read_uint32_t(context);      // selected primitive
+
+    if (minor==5)
+        serializer_read_float(context);     // skip outline width
+
+    plist_init(64);
+    plist_deserialize(context, major, minor, tds_normalizion_support(major, minor), &edition_zone);
+
+    if (minor >= 7)
+        palette_deserialize(context, &primitive_palette);
+
+    bool result = (serializer_get_status(context) == serializer_no_error);
+    if (result)
+    {
+        scene->num_primitives = plist_size();
+        scene->primitives = (struct primitive*) malloc(sizeof(struct primitive) * scene->num_primitives);
+        for(uint32_t i=0; i<scene->num_primitives; ++i)
+            scene->primitives[i] = *plist_get(i);
+    }
+    else
+        log_error("unable to load primitives");
+
+    plist_terminate();
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool tds_scene_load(struct tds_scene* scene, const char* path)
+{
+    memset(scene, 0, sizeof(struct tds_scene));
+    scene->edition_zone = edition_zone;
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        log_error("can't open file '%s'", path);
+        return false;
+    }
+
+    // streamed like Editor::Load
+    uint8_t chunk[TDS_FILE_CHUNKSIZE];
+    serializer_context serializer;
+    serializer_init_read_file(&serializer, f, chunk, sizeof(chunk));
+    bool result = read_scene(scene, &serializer);
+
+    fclose(f);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool tds_scene_load_memory(struct tds_scene* scene, const void* buffer, size_t size)
+{
+    memset(scene, 0, sizeof(struct tds_scene));
+    scene->edition_zone = edition_zone;
+
+    // the serializer only reads the buffer
+    serializer_context serializer;
+    serializer_init(&serializer, (void*) buffer, size);
+    return read_scene(scene, &serializer);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void write_scene(const struct tds_scene* scene, serializer_context* context)
+{
+    // same as Editor::Save
+    serializer_write_uint32_t(context, TDS_FOURCC);
+    serializer_write_uint16_t(context, TDS_MAJOR);
+    serializer_write_uint16_t(context, TDS_MINOR);
+    serializer_write_float(context, scene->alpha);
+    serializer_write_float(context, scene->smooth_blend);
+    serializer_write_uint32_t(context, 0);      // selected primitive
+
+    plist_init(scene->num_primitives);
+    for(uint32_t i=0; i<scene->num_primitives; ++i)
+        plist_push(&scene->primitives[i]);
+
+    plist_serialize(context, tds_normalizion_support(TDS_MAJOR, TDS_MINOR), &scene->edition_zone);
+    plist_terminate();
+    palette_serialize(context, &primitive_palette);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+size_t tds_scene_serialize(const struct tds_scene* scene, void* buffer, size_t size)
+{
+    serializer_context serializer;
+    serializer_init(&serializer, buffer, size);
+    write_scene(scene, &serializer);
+    return (serializer_get_status(&serializer) == serializer_no_error) ? serializer_get_position(&serializer) : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool tds_scene_save(const struct tds_scene* scene, const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        log_error("can't write file '%s'", path);
+        return false;
+    }
+
+    // streamed like Editor::Save
+    uint8_t chunk[TDS_FILE_CHUNKSIZE];
+    serializer_context serializer;
+    serializer_init_write_file(&serializer, f, chunk, sizeof(chunk));
+    write_scene(scene, &serializer);
+    serializer_flush(&serializer);
+
+    bool result = (fclose(f) == 0) && (serializer_get_status(&serializer) == serializer_no_error);
+    if (!result)
+        log_error("unable to write file '%s'", path);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+struct tds_scene tds_scene_replicate(const std::vector<tds_scene>& scenes, uint32_t num_primitives)
+{
+    tds_scene scene = scenes[0];
+    scene.primitives = (struct primitive*) malloc(sizeof(struct primitive) * num_primitives);
+    scene.num_primitives = 0;
+
+    for(uint32_t copy=0; scene.num_primitives<num_primitives; ++copy)
+    {
+        for(const tds_scene& source : scenes)
+        {
+            for(uint32_t i=0; i<source.num_primitives && scene.num_primitives<num_primitives; ++i)
+            {
+                struct primitive* p = &scene.primitives[scene.num_primitives++];
+                *p = source.primitives[i];
+                primitive_translate(p, vec2_set((float)(copy % 16) * 4.f, (float)(copy / 16) * 4.f));
+            }
+        }
+    }
+    return scene;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> tds_scene_list_folder(const char* folder)
+{
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(folder, error))
+        if (entry.path().extension() == ".tds")
+            paths.push_back(entry.path().string());
+
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void tds_scene_add_path(const char* path, std::vector<std::string>* paths)
+{
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error))
+    {
+        std::vector<std::string> folder = tds_scene_list_folder(path);
+        paths->insert(paths->end(), folder.begin(), folder.end());
+    }
+    else
+        paths->push_back(path);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool tds_scene_parse_size(const char* text, uint32_t* width, uint32_t* height)
+{
+    int count = sscanf(text, "%ux%u", width, height);
+    if (count == 1)
+        *height = *width;
+    else if (count != 2)
+        return false;
+
+    return *width > 0 && *height > 0 && *width <= UINT16_MAX && *height <= UINT16_MAX;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+bool tds_scene_load_folder(const char* folder, std::vector<tds_scene>* scenes)
+{
+    for(const std::string& path : tds_scene_list_folder(folder))
+    {
+        tds_scene scene;
+        if (tds_scene_load(&scene, path.c_str()))
+            scenes->push_back(scene);
+    }
+    return !scenes->empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void draw_primitives(struct tds_scene* scene, struct renderer* r, const struct view_proj* vp)
+{
+    renderer_set_viewproj(r, vp);
+
+    // see PrimitiveEditor::Draw
+    renderer_set_cliprect_relative(r, &scene->edition_zone);
+    renderer_begin_combination(r, scene->smooth_blend);
+
+    primitive_draw_array_cached(scene->primitives, scene->num_primitives, r, scene->alpha);
+
+    renderer_end_combination(r, false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void tds_scene_draw(struct tds_scene* scene, struct renderer* r, uint32_t width, uint32_t height)
+{
+    struct view_proj vp;
+    ortho_set_target(&vp, &scene->edition_zone, vec2_set((float)width, (float)height));
+    draw_primitives(scene, r, &vp);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void tds_scene_draw_band(struct tds_scene* scene, struct renderer* r, uint32_t width, uint32_t height, uint32_t y, uint32_t band_height)
+{
+    // the band is a window on the canvas : the world space rectangle under its rows becomes the target
+    struct view_proj canvas;
+    ortho_set_target(&canvas, &scene->edition_zone, vec2_set((float)width, (float)height));
+
+    aabb band =
+    {
+        .min = ortho_to_world_space(&canvas, vec2_set(0.f, (float)y)),
+        .max = ortho_to_world_space(&canvas, vec2_set((float)width, (float)(y + band_height)))
+    };
+
+    struct view_proj vp;
+    ortho_set_target(&vp, &band, vec2_set((float)width, (float)band_height));
+    draw_primitives(scene, r, &vp);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+void tds_scene_terminate(struct tds_scene* scene)
+{
+    free(scene->primitives);
+    scene->primitives = NULL;
+    scene->num_primitives = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "../system/aabb.h"
+
+struct primitive;
+struct renderer;
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// .tds file loaded outside of the editor, used by the command line tools
+//  * loading goes through the primitive list of the editor (not thread safe), then primitives are copied in the scene
+//  * drawing a scene is thread safe as long as each thread has its own renderer
+
+struct tds_scene
+{
+    struct primitive* primitives;
+    uint32_t num_primitives;
+    float alpha;
+    float smooth_blend;
+    aabb edition_zone;
+};
+
+// the file is streamed, there is no size limit
+bool tds_scene_load(struct tds_scene* scene, const char* path);
+
+// same as tds_scene_load with the content of a .tds file already in memory
+bool tds_scene_load_memory(struct tds_scene* scene, const void* buffer, size_t size);
+
+// writes the scene as a .tds file in memory, returns the number of bytes written or 0 if the buffer is too small
+size_t tds_scene_serialize(const struct tds_scene* scene, void* buffer, size_t size);
+
+// writes the scene as a .tds file, streamed like the editor saves
+bool tds_scene_save(const struct tds_scene* scene, const char* path);
+
+// scene made of the primitives of every scene copied until it reaches num_primitives, the copies are shifted by a few
+// pixels so they don't share the same cache key
+struct tds_scene tds_scene_replicate(const std::vector<tds_scene>& scenes, uint32_t num_primitives);
+
+// paths of the .tds of a folder in alphabetical order
+std::vector<std::string> tds_scene_list_folder(const char* folder);
+
+// command line argument of the tools : a .tds is added, a folder adds its .tds in alphabetical order
+void tds_scene_add_path(const char* path, std::vector<std::string>* paths);
+
+// command line size of the tools : "1024" (square) or "1920x1080", up to UINT16_MAX pixels
+bool tds_scene_parse_size(const char* text, uint32_t* width, uint32_t* height);
+
+// loads every .tds of a folder in alphabetical order, returns false if no scene was loaded
+bool tds_scene_load_folder(const char* folder, std::vector<tds_scene>* scenes);
+
+// draws the scene like the editor does (between renderer_begin_frame and renderer_end_frame), the edition zone is scaled
+// to fit the window, width and height must match the renderer
+void tds_scene_draw(struct tds_scene* scene, struct renderer* r, uint32_t width, uint32_t height);
+
+// same as tds_scene_draw for the rows [y, y + band_height) of a width x height canvas, the renderer is width x band_height
+void tds_scene_draw_band(struct tds_scene* scene, struct renderer* r, uint32_t width, uint32_t height, uint32_t y, uint32_t band_height);
+
+void tds_scene_terminate(struct tds_scene* scene);
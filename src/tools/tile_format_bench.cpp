@@ -0,0 +1,133 @@
+#include "bench_common.h"
+#include "../renderer/renderer.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// compares the tile list formats of the cpu backend (linked tile_node lists vs contiguous command arrays) on every .tds of
+// a folder : memory read by the rasterizer, binning time (arrays are built during binning) and rasterization time
+// every combination must render the same image as gather + nodes
+//
+// usage : tile_format_bench [folder] [frames] [threads]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+struct configuration
+{
+    const char* name;
+    renderer_binning binning;
+    renderer_tile_format format;
+};
+
+struct bench_result
+{
+    double binning_time;        // in seconds, all frames
+    double rasterization_time;
+    double tile_lists_size;     // in bytes, all frames
+    bool identical;
+};
+
+static const bench_resolution_id resolutions[] = {resolution_1080p, resolution_4k};
+
+static const configuration configurations[] =
+{
+    {"gather nodes", binning_gather, tile_format_nodes},
+    {"gather arrays", binning_gather, tile_format_arrays},
+    {"scatter nodes", binning_scatter, tile_format_nodes},
+    {"scatter arrays", binning_scatter, tile_format_arrays},
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bench_result run(struct renderer* r, std::vector<tds_scene>& scenes, const bench_resolution& res, uint32_t num_frames,
+                        uint32_t* image, const std::vector<uint32_t*>& references)
+{
+    bench_result result = {0.0, 0.0, 0.0, true};
+
+    for(size_t i=0; i<scenes.size(); ++i)
+    {
+        // first frame is a warm-up and is compared to the reference
+        for(uint32_t frame=0; frame<num_frames+1; ++frame)
+        {
+            bench_draw(r, &scenes[i], res.width, res.height, image);
+
+            struct renderer_stats stats;
+            renderer_get_stats(r, &stats);
+            if (frame>0)
+            {
+                result.binning_time += stats.binning_time;
+                result.rasterization_time += stats.rasterization_time;
+                result.tile_lists_size += stats.tile_lists_size;
+            }
+            else
+                result.identical &= bench_same_image(image, references[i], res.width, res.height);
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_frames = (argc > 2) ? (uint32_t) atoi(argv[2]) : 10;
+    uint32_t num_threads = (argc > 3) ? (uint32_t) atoi(argv[3]) : 0;
+
+    if (num_frames == 0) num_frames = 1;
+
+    log_set_level(LOG_WARN);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    fprintf(stdout, "%zu scenes, %u frames per scene\n\n", scenes.size(), num_frames);
+    fprintf(stdout, "resolution   configuration    lists KB   binning ms   raster ms   raster speedup   images\n");
+
+    bool success = true;
+    for(bench_resolution_id id : resolutions)
+    {
+        const bench_resolution& res = bench_resolutions[id];
+        struct renderer* r = renderer_init(nullptr, res.width, res.height);
+        renderer_set_num_threads(r, num_threads);
+
+        size_t image_size = (size_t)res.width * res.height * sizeof(uint32_t);
+        uint32_t* image = (uint32_t*) malloc(image_size);
+        std::vector<uint32_t*> references;
+        for(tds_scene& scene : scenes)
+        {
+            uint32_t* reference = (uint32_t*) malloc(image_size);
+            bench_draw(r, &scene, res.width, res.height, reference);
+            references.push_back(reference);
+        }
+
+        double reference_time = 0.0;
+        double total_frames = (double) scenes.size() * num_frames;
+        for(const configuration& config : configurations)
+        {
+            renderer_set_binning(r, config.binning);
+            renderer_set_tile_format(r, config.format);
+            bench_result result = run(r, scenes, res, num_frames, image, references);
+            success &= result.identical;
+
+            double raster_time = result.rasterization_time / total_frames;
+            if (reference_time == 0.0)
+                reference_time = raster_time;
+
+            fprintf(stdout, "%-10s   %-14s   %8.1f   %10.3f   %9.3f   %13.2fx   %s\n", res.name, config.name,
+                    result.tile_lists_size / (total_frames * 1024.0), result.binning_time * 1000.0 / total_frames,
+                    raster_time * 1000.0, reference_time / raster_time, result.identical ? "identical" : "DIFFERENT");
+        }
+
+        for(uint32_t* reference : references)
+            free(reference);
+        free(image);
+        renderer_terminate(r);
+    }
+
+    bench_free_scenes(&scenes);
+
+    return success ? 0 : -1;
+}
@@ -0,0 +1,176 @@
+#include "bench_common.h"
+#include "../editor/primitive.h"
+#include "../system/undo.h"
+#include "../system/log.h"
+#include "../system/sokol_time.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// memory and latency of the undo storages (undo_init_ex) on editing sessions of the example scenes
+//  * an edit moves a primitive most of the time, sometimes changes its look, adds, deletes or reorders primitives
+//  * after each edit the scene is serialized in an undo snapshot, like PrimitiveEditor::UndoSnapshot
+//  * store : time of undo_end_snapshot on the editor thread, background : time until the compression is done
+//  * every state is undone and compared to the scene it was taken from
+//
+// usage : undo_bench [folder] [edits]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define REPLICATED_PRIMITIVES (2000)
+#define UNDO_BUDGET (1<<26)
+
+typedef std::vector<uint8_t> state;
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void edit(std::vector<primitive>& primitives)
+{
+    uint32_t index = rand() % primitives.size();
+    uint32_t action = rand() % 100;
+
+    if (action < 70)
+        primitive_translate(&primitives[index], vec2_set(random_float(-20.f, 20.f), random_float(-20.f, 20.f)));
+    else if (action < 80)
+    {
+        primitives[index].m_Color.red = random_float(0.f, 1.f);
+        primitives[index].m_Roundness = random_float(0.f, 10.f);
+    }
+    else if (action < 88)
+    {
+        primitive copy = primitives[index];
+        primitive_translate(&copy, vec2_splat(10.f));
+        primitives.push_back(copy);
+    }
+    else if (action < 94 && primitives.size() > 1)
+        primitives.erase(primitives.begin() + index);
+    else
+    {
+        // bring to front
+        primitive moved = primitives[index];
+        primitives.erase(primitives.begin() + index);
+        primitives.push_back(moved);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the time of undo_end_snapshot
+static double snapshot(struct undo_context* undo, tds_scene* scene, std::vector<primitive>& primitives)
+{
+    scene->primitives = primitives.data();
+    scene->num_primitives = (uint32_t) primitives.size();
+
+    for(;;)
+    {
+        size_t max_size;
+        void* buffer = undo_begin_snapshot(undo, &max_size);
+        size_t size = tds_scene_serialize(scene, buffer, max_size);
+        if (size > 0)
+        {
+            uint64_t start = stm_now();
+            undo_end_snapshot(undo, buffer, size);
+            return stm_sec(stm_since(start));
+        }
+        undo_increase_buffer(undo);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of undone states that don't match
+static uint32_t run(const tds_scene* source, const char* name, uint32_t num_edits, enum undo_storage storage)
+{
+    srand(1);
+    tds_scene scene = *source;
+    std::vector<primitive> primitives(source->primitives, source->primitives + source->num_primitives);
+    std::vector<state> expected;
+    // budget big enough to keep every state
+    struct undo_context* undo = undo_init_ex(UNDO_BUDGET, num_edits + 1, storage);
+
+    double snapshot_time = 0.0, background_time = 0.0;
+    for(uint32_t i=0; i<=num_edits; ++i)
+    {
+        if (i > 0)
+            edit(primitives);
+
+        snapshot_time += snapshot(undo, &scene, primitives);
+
+        // the undos below inflate every state
+        uint64_t start = stm_now();
+        undo_finish(undo);
+        background_time += stm_sec(stm_since(start));
+
+        // the reference is serialized again, the snapshot buffer is owned by the undo context
+        state reference(1<<16);
+        size_t size;
+        while ((size = tds_scene_serialize(&scene, reference.data(), reference.size())) == 0)
+            reference.resize(reference.size() * 2);
+        reference.resize(size);
+        expected.push_back(reference);
+    }
+
+    size_t stored_bytes, raw_bytes;
+    undo_memory(undo, &stored_bytes, &raw_bytes);
+    uint32_t num_states = undo_get_num_states(undo);
+
+    uint32_t num_mismatches = 0;
+    double undo_time = 0.0, max_undo_time = 0.0;
+    for(uint32_t i=num_states-1; i-->0; )
+    {
+        size_t size;
+        uint64_t start = stm_now();
+        void* data = undo_undo(undo, &size);
+        double time = stm_sec(stm_since(start));
+        undo_time += time;
+        max_undo_time = (time > max_undo_time) ? time : max_undo_time;
+
+        if (data == nullptr || size != expected[i].size() || memcmp(data, expected[i].data(), size) != 0)
+            num_mismatches++;
+    }
+
+    const char* storage_names[] = {"full", "delta", "deflate"};
+    fprintf(stdout, "%-12s %-7s   %10zu   %11zu   %6.1f%%   %8.2f   %13.2f   %7.2f   %11.2f   %10u\n", name, storage_names[storage],
+            raw_bytes / num_states, stored_bytes / num_states, 100.0 * double(stored_bytes) / double(raw_bytes),
+            snapshot_time * 1e6 / num_states, background_time * 1e6 / num_states, undo_time * 1e6 / (num_states - 1),
+            max_undo_time * 1e6, num_mismatches);
+
+    undo_terminate(undo);
+    return num_mismatches;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* folder = (argc > 1) ? argv[1] : EXAMPLES_PATH;
+    uint32_t num_edits = (argc > 2) ? (uint32_t) atoi(argv[2]) : 200;
+    if (num_edits == 0) num_edits = 1;
+
+    log_set_level(LOG_ERROR);
+    stm_setup();
+
+    std::vector<tds_scene> scenes;
+    if (!bench_load_scenes(folder, &scenes))
+        return -1;
+
+    tds_scene replicated = tds_scene_replicate(scenes, REPLICATED_PRIMITIVES);
+
+    fprintf(stdout, "%u edits per scene\n\n", num_edits);
+    fprintf(stdout, "scene        storage   raw bytes   bytes/state     ratio   store us   background us   undo us   max undo us   mismatches\n");
+
+    uint32_t num_mismatches = 0;
+    for(size_t i=0; i<=scenes.size(); ++i)
+    {
+        const tds_scene* scene = (i < scenes.size()) ? &scenes[i] : &replicated;
+        char name[32] = "replicated";
+        if (i < scenes.size())
+            snprintf(name, sizeof(name), "scene %zu", i);
+
+        for(uint32_t s=0; s<3; ++s)
+            num_mismatches += run(scene, name, num_edits, (enum undo_storage) s);
+    }
+
+    bench_free_scenes(&scenes);
+    tds_scene_terminate(&replicated);
+
+    fprintf(stdout, "\n%s\n", (num_mismatches == 0) ? "success" : "failed");
+    return (num_mismatches == 0) ? 0 : -1;
+}
@@ -0,0 +1,262 @@
+#include "allocation_counter.h"
+#include "../system/undo.h"
+#include "../system/log.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------
+// bounded undo (ring buffer of states with eviction of the oldest ones) and redo, against a list of every state taken
+//  * random snapshots, undos and redos : each state returned must be the expected one, the redo count must match
+//  * the states are small edits of the previous one, sometimes a full rewrite (a keyframe in delta storage, data that doesn't
+//    compress in deflate storage), so the ring buffer wraps around many times, evicting keyframes, whole groups of deltas
+//    or parts of the newest group
+//  * deflate storage : the states are read while they're compressed, redo states are discarded before they're stored
+//  * the memory used stays under the budget, the states ring wraps with small max states
+//  * no allocation by the undo context once the first snapshot is taken
+//  * periodically every state kept is undone then redone
+//
+// usage : undo_ring_check [operations]
+// ---------------------------------------------------------------------------------------------------------------------------
+
+#define MIN_STATE_SIZE (64)
+#define MAX_STATE_SIZE (1500)
+#define FULL_CHECK_INTERVAL (1000)
+
+typedef std::vector<uint8_t> state;
+
+struct config
+{
+    enum undo_storage storage;
+    size_t budget;
+    uint32_t max_states;
+};
+
+struct model
+{
+    std::vector<state> states;      // every state taken, the ones undone are removed by a new snapshot
+    size_t current;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static state next_state(const state& previous)
+{
+    state s = previous;
+    uint32_t action = rand() % 100;
+    if (action < 70 || s.size() < MIN_STATE_SIZE)
+    {
+        for(uint32_t i=0, count=1+rand()%8; i<count && !s.empty(); ++i)
+            s[rand() % s.size()] = (uint8_t) rand();
+    }
+    else if (action < 80 && s.size() < MAX_STATE_SIZE)
+    {
+        size_t position = rand() % s.size(), count = 1 + rand() % 64;
+        for(size_t i=0; i<count; ++i)
+            s.insert(s.begin() + position, (uint8_t) rand());
+    }
+    else if (action < 90)
+    {
+        size_t position = rand() % s.size(), count = 1 + rand() % 32;
+        count = (position + count < s.size()) ? count : s.size() - position;
+        s.erase(s.begin() + position, s.begin() + position + count);
+    }
+    else if (action < 95)
+    {
+        // half of them compress
+        uint32_t range = (action & 1) ? 256 : 16;
+        s.resize(MIN_STATE_SIZE + rand() % (MAX_STATE_SIZE - MIN_STATE_SIZE));
+        for(uint8_t& byte : s)
+            byte = (uint8_t) (rand() % range);
+    }
+    return s;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+static bool same(const void* data, size_t size, const state& expected)
+{
+    return data != nullptr && size == expected.size() && memcmp(data, expected.data(), size) == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// the context allocates nothing after the first snapshot
+struct allocation_scope
+{
+    uint64_t start;
+    uint64_t* bytes;
+    allocation_scope(uint64_t* b) : start(allocation_counter_bytes()), bytes(b) {}
+    ~allocation_scope() {*bytes += allocation_counter_bytes() - start;}
+};
+
+//----------------------------------------------------------------------------------------------------------------------------
+static void snapshot(struct undo_context* undo, const state& s, uint64_t* allocated)
+{
+    allocation_scope scope(allocated);
+    size_t max_size;
+    void* buffer = undo_begin_snapshot(undo, &max_size);
+    memcpy(buffer, s.data(), s.size());
+    undo_end_snapshot(undo, buffer, s.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// undoes every state kept then redoes them, returns the number of errors
+static uint32_t full_check(struct undo_context* undo, const model& m, uint64_t* allocated)
+{
+    allocation_scope scope(allocated);
+    uint32_t num_errors = 0;
+    uint32_t num_states = undo_get_num_states(undo), num_redo = undo_get_num_redo(undo);
+    size_t size;
+
+    for(uint32_t i=1; i<num_states; ++i)
+    {
+        void* data = undo_undo(undo, &size);
+        num_errors += same(data, size, m.states[m.current - i]) ? 0 : 1;
+    }
+
+    num_errors += (undo_undo(undo, &size) == nullptr) ? 0 : 1;
+
+    for(uint32_t i=1; i<num_states+num_redo; ++i)
+    {
+        void* data = undo_redo(undo, &size);
+        num_errors += same(data, size, m.states[m.current - num_states + 1 + i]) ? 0 : 1;
+    }
+
+    num_errors += (undo_redo(undo, &size) == nullptr) ? 0 : 1;
+
+    // back to the current state
+    for(uint32_t i=0; i<num_redo; ++i)
+        undo_undo(undo, &size);
+
+    num_errors += (undo_get_num_states(undo) == num_states && undo_get_num_redo(undo) == num_redo) ? 0 : 1;
+    return num_errors;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+// returns the number of errors
+static uint32_t run(const config& c, uint32_t num_operations)
+{
+    srand(1);
+    struct undo_context* undo = undo_init_ex(c.budget, c.max_states, c.storage);
+
+    model m;
+    m.states.push_back(state(MIN_STATE_SIZE + rand() % (MAX_STATE_SIZE - MIN_STATE_SIZE)));
+    m.current = 0;
+    for(uint8_t& byte : m.states[0])
+        byte = (uint8_t) (rand() % 16);
+
+    uint64_t allocated = 0;
+    snapshot(undo, m.states[0], &allocated);
+    allocated = 0;
+
+    uint32_t num_errors = 0, min_kept = UINT32_MAX, max_kept = 0, num_snapshots = 1, num_undos = 0, num_redos = 0;
+    size_t raw_bytes = m.states[0].size(), max_stored = 0;
+    for(uint32_t op=0; op<num_operations; ++op)
+    {
+        uint32_t action = rand() % 100;
+        size_t size;
+        if (action < 60)
+        {
+            m.states.resize(m.current + 1);
+            m.states.push_back(next_state(m.states[m.current]));
+            m.current++;
+            snapshot(undo, m.states[m.current], &allocated);
+            num_errors += (undo_get_num_redo(undo) == 0 && undo_get_num_states(undo) <= m.current + 1) ? 0 : 1;
+            raw_bytes += m.states[m.current].size();
+            num_snapshots++;
+        }
+        else if (action < 85)
+        {
+            bool possible = undo_get_num_states(undo) > 1;
+            void* data;
+            {
+                allocation_scope scope(&allocated);
+                data = undo_undo(undo, &size);
+            }
+            if (possible)
+            {
+                num_errors += same(data, size, m.states[m.current - 1]) ? 0 : 1;
+                m.current--;
+                num_undos++;
+            }
+            else
+                num_errors += (data == nullptr) ? 0 : 1;
+        }
+        else
+        {
+            bool possible = m.current + 1 < m.states.size();
+            num_errors += (undo_get_num_redo(undo) == m.states.size() - m.current - 1) ? 0 : 1;
+            void* data;
+            {
+                allocation_scope scope(&allocated);
+                data = undo_redo(undo, &size);
+            }
+            if (possible)
+            {
+                num_errors += same(data, size, m.states[m.current + 1]) ? 0 : 1;
+                m.current++;
+                num_redos++;
+            }
+            else
+                num_errors += (data == nullptr) ? 0 : 1;
+        }
+
+        size_t stored_bytes, kept_raw_bytes;
+        undo_memory(undo, &stored_bytes, &kept_raw_bytes);
+        num_errors += (stored_bytes <= c.budget) ? 0 : 1;
+        max_stored = (stored_bytes > max_stored) ? stored_bytes : max_stored;
+
+        uint32_t kept = undo_get_num_states(undo) + undo_get_num_redo(undo);
+        num_errors += (kept <= c.max_states) ? 0 : 1;
+        min_kept = (op > num_operations / 2 && kept < min_kept) ? kept : min_kept;
+        max_kept = (kept > max_kept) ? kept : max_kept;
+
+        if (op % FULL_CHECK_INTERVAL == FULL_CHECK_INTERVAL - 1)
+            num_errors += full_check(undo, m, &allocated);
+    }
+    num_errors += full_check(undo, m, &allocated);
+
+    const char* storage_names[] = {"full", "delta", "deflate"};
+    fprintf(stdout, "%-7s   %6zu kb   %10u   %9u   %5u   %5u   %8.1f   %8.1f%%   %9u-%-4u   %9llu   %6u\n",
+            storage_names[c.storage], c.budget>>10, c.max_states, num_snapshots, num_undos, num_redos,
+            double(raw_bytes) / double(c.budget), 100.0 * double(max_stored) / double(c.budget), min_kept, max_kept,
+            (unsigned long long) allocated, num_errors);
+
+    undo_terminate(undo);
+    return num_errors + (allocated > 0 ? 1 : 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    uint32_t num_operations = (argc > 1) ? (uint32_t) atoi(argv[1]) : 20000;
+    if (num_operations == 0) num_operations = 1;
+
+    log_set_level(LOG_ERROR);
+
+    if (!allocation_counter_supported())
+        fprintf(stdout, "allocation tracking not supported, the allocated bytes stay at 0\n");
+
+    const config configs[] =
+    {
+        {undo_storage_full, 1<<12, 256},
+        {undo_storage_full, 1<<16, 256},
+        {undo_storage_full, 1<<16, 8},
+        {undo_storage_delta, 1<<12, 256},
+        {undo_storage_delta, 1<<14, 256},
+        {undo_storage_delta, 1<<16, 256},
+        {undo_storage_delta, 1<<16, 8},
+        {undo_storage_deflate, 1<<12, 256},
+        {undo_storage_deflate, 1<<16, 256},
+        {undo_storage_deflate, 1<<16, 8},
+    };
+
+    fprintf(stdout, "%u operations\n\n", num_operations);
+    fprintf(stdout, "storage      budget   max states   snapshots   undos   redos   raw/budget   max used   states kept   allocated   errors\n");
+
+    uint32_t num_errors = 0;
+    for(const config& c : configs)
+        num_errors += run(c, num_operations);
+
+    fprintf(stdout, "\n%s\n", (num_errors == 0) ? "success" : "failed");
+    return (num_errors == 0) ? 0 : -1;
+}